@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "hal.h"
+#include "hal_posix.h"
+#include "charge_control.h"
+#include "scale_frame.h"
+#include "gp_lite.h"
+#include "json_writer.h"
+
+// Host benchmarks for the core modules
+//
+// Time per call of the hot paths, measured with hal_time_us(). The numbers are for comparing changes on
+// the same machine, not a prediction of the timing on the RP2040.
+
+
+#define SCALE_FRAMES        100000
+#define CONTROL_STEPS       1000000
+#define GP_ROUNDS           20
+#define JSON_DOCUMENTS      100000
+
+
+static volatile float sink;
+
+
+static void _report(const char * name, uint32_t start_us, uint32_t count) {
+    uint32_t elapsed_us = hal_time_us() - start_us;
+    printf("%-24s %10lu calls %10.3f us/call\n", name, (unsigned long) count, (double) elapsed_us / count);
+}
+
+
+static void bench_scale_frame(void) {
+    const char * line = "ST,+00012.34  g\r\n";
+    size_t line_len = strlen(line);
+    char frame[17];
+    scale_frame_reader_t reader;
+    scale_frame_reader_init(&reader, frame, sizeof(frame), SCALE_FRAME_NO_HEADER);
+
+    uint32_t start_us = hal_time_us();
+    for (uint32_t idx = 0; idx < SCALE_FRAMES; idx += 1) {
+        for (size_t ch = 0; ch < line_len; ch += 1) {
+            if (scale_frame_feed(&reader, line[ch])) {
+                sink = scale_frame_parse_weight(frame + 3, 9, '+');
+            }
+        }
+    }
+    _report("scale_frame", start_us, SCALE_FRAMES);
+}
+
+
+static void bench_charge_control(void) {
+    charge_control_gains_t gains = {0.5f, 0.01f, 2.0f, 0.1f, 5.0f};
+    float integral = 0.0f;
+
+    uint32_t start_us = hal_time_us();
+    for (uint32_t idx = 0; idx < CONTROL_STEPS; idx += 1) {
+        float error = 10.0f - (idx % 1000) * 0.01f;
+        integral += error;
+        sink = charge_control_speed(&gains, error, integral, 0.001f);
+        sink = charge_control_gate_opening(error, 5.0f, 1.0f, 0.2f);
+    }
+    _report("charge_control", start_us, CONTROL_STEPS);
+}
+
+
+static void bench_gp_lite(void) {
+    static gp_model_t gp;
+    gp_init(&gp, 0.0f, 1.0f, 0.0f, 5.0f);
+
+    float kp = 0.5f, kd = 2.5f;
+    uint32_t start_us = hal_time_us();
+    for (uint32_t idx = 0; idx < GP_ROUNDS; idx += 1) {
+        gp_add_observation(&gp, kp, kd, 100.0f - 50.0f * (kp - 0.6f) * (kp - 0.6f) - (kd - 2.0f) * (kd - 2.0f));
+        gp_get_next_params(&gp, &kp, &kd);
+    }
+    _report("gp_lite round", start_us, GP_ROUNDS);
+}
+
+
+static void bench_json_writer(void) {
+    char buf[256];
+    json_writer_t json;
+
+    uint32_t start_us = hal_time_us();
+    for (uint32_t idx = 0; idx < JSON_DOCUMENTS; idx += 1) {
+        json_writer_init(&json, buf, sizeof(buf));
+        json_begin_object(&json);
+        json_add_float(&json, "weight", 12.34f, 3);
+        json_add_float(&json, "target", 42.0f, 3);
+        json_add_uint(&json, "count", idx);
+        json_add_string(&json, "profile", "Varget 42gr");
+        json_end_object(&json);
+    }
+    _report("json_writer document", start_us, JSON_DOCUMENTS);
+}
+
+
+int main(void) {
+    hal_posix_reset();
+
+    bench_scale_frame();
+    bench_charge_control();
+    bench_gp_lite();
+    bench_json_writer();
+
+    return 0;
+}
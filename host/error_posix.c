@@ -0,0 +1,27 @@
+#include <stdio.h>
+
+#include "error.h"
+
+// Error reporting for the host build, the errors are printed to stderr and the last one is kept so the
+// tests can check for it. The error task, LEDs and EEPROM log only exist on the device.
+
+
+static error_code_t last_error = ERR_NONE;
+
+
+void report_error_context(error_code_t code, uint32_t context) {
+    last_error = code;
+    fprintf(stderr, "ERROR %d (context 0x%08lx)\n", (int) code, (unsigned long) context);
+}
+
+void report_error(error_code_t code) {
+    report_error_context(code, 0);
+}
+
+error_code_t error_get_last(void) {
+    return last_error;
+}
+
+void error_clear_last(void) {
+    last_error = ERR_NONE;
+}
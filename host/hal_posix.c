@@ -0,0 +1,102 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <string.h>
+#include <time.h>
+
+#include "hal_posix.h"
+
+
+typedef struct {
+    uint8_t rx[HAL_POSIX_UART_BUFFER_SIZE];
+    size_t rx_head;
+    size_t rx_tail;
+    uint8_t tx[HAL_POSIX_UART_BUFFER_SIZE];
+    size_t tx_len;
+} posix_uart_t;
+
+
+static posix_uart_t uarts[HAL_NUM_UARTS];
+
+
+static uint64_t _monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000u + (uint64_t) ts.tv_nsec / 1000u;
+}
+
+
+void hal_posix_reset(void) {
+    memset(uarts, 0, sizeof(uarts));
+}
+
+
+uint32_t hal_time_us(void) {
+    return (uint32_t) _monotonic_us();
+}
+
+uint32_t hal_time_ms(void) {
+    return (uint32_t) (_monotonic_us() / 1000u);
+}
+
+void hal_delay_ms(uint32_t ms) {
+    struct timespec ts = {
+        .tv_sec = ms / 1000,
+        .tv_nsec = (long) (ms % 1000) * 1000000L,
+    };
+    nanosleep(&ts, NULL);
+}
+
+
+bool hal_uart_is_readable(hal_uart_t uart) {
+    return uarts[uart].rx_tail != uarts[uart].rx_head;
+}
+
+char hal_uart_getc(hal_uart_t uart) {
+    posix_uart_t * u = &uarts[uart];
+
+    // Same as the SDK, wait for a byte. The tests only read what they have injected.
+    if (u->rx_tail == u->rx_head) {
+        return 0;
+    }
+
+    char ch = (char) u->rx[u->rx_tail];
+    u->rx_tail = (u->rx_tail + 1) % HAL_POSIX_UART_BUFFER_SIZE;
+    return ch;
+}
+
+void hal_uart_write(hal_uart_t uart, const uint8_t * data, size_t len) {
+    posix_uart_t * u = &uarts[uart];
+
+    size_t room = sizeof(u->tx) - u->tx_len;
+    if (len > room) {
+        len = room;
+    }
+    memcpy(u->tx + u->tx_len, data, len);
+    u->tx_len += len;
+}
+
+void hal_posix_uart_inject(hal_uart_t uart, const void * data, size_t len) {
+    posix_uart_t * u = &uarts[uart];
+    const uint8_t * bytes = (const uint8_t *) data;
+
+    for (size_t idx = 0; idx < len; idx += 1) {
+        size_t next = (u->rx_head + 1) % HAL_POSIX_UART_BUFFER_SIZE;
+        if (next == u->rx_tail) {
+            // Overrun, the byte is lost as on the device
+            break;
+        }
+        u->rx[u->rx_head] = bytes[idx];
+        u->rx_head = next;
+    }
+}
+
+size_t hal_posix_uart_take_tx(hal_uart_t uart, void * data, size_t len) {
+    posix_uart_t * u = &uarts[uart];
+
+    if (len > u->tx_len) {
+        len = u->tx_len;
+    }
+    memcpy(data, u->tx, len);
+    u->tx_len = 0;
+    return len;
+}
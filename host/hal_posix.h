@@ -0,0 +1,38 @@
+#ifndef HAL_POSIX_H_
+#define HAL_POSIX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hal.h"
+
+// POSIX hardware abstraction layer
+//
+// hal.h for the host build: time from the monotonic clock and the UARTs, which receive what the tests
+// inject and record what the modules write. The driver services of hal_pico.h have no host
+// implementation, the drivers are firmware only.
+
+#define HAL_POSIX_UART_BUFFER_SIZE  1024
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Back to power on: UARTs empty
+*/
+void hal_posix_reset(void);
+
+// Bytes received by the module on the next hal_uart_getc() calls
+void hal_posix_uart_inject(hal_uart_t uart, const void * data, size_t len);
+
+// Bytes written by the module since the last call, returns the count copied into data
+size_t hal_posix_uart_take_tx(hal_uart_t uart, void * data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // HAL_POSIX_H_
@@ -0,0 +1,32 @@
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdio.h>
+#include <math.h>
+
+// Minimal assertions for the host tests. A failed check is printed and counted, the test keeps running
+// and main() returns TEST_RESULT() so ctest sees the failure.
+
+static int test_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            test_failures += 1; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { \
+        double _a = (actual), _e = (expected); \
+        if (!(fabs(_a - _e) <= (tolerance))) { \
+            fprintf(stderr, "%s:%d: %s = %g, expected %g\n", __FILE__, __LINE__, #actual, _a, _e); \
+            test_failures += 1; \
+        } \
+    } while (0)
+
+#define TEST_RESULT()   (test_failures == 0 ? 0 : 1)
+
+
+#endif  // TEST_H_
@@ -0,0 +1,65 @@
+#include "charge_control.h"
+#include "test.h"
+
+
+static void test_speed_is_clamped(void) {
+    charge_control_gains_t gains = {2.0f, 0.5f, 10.0f, 0.1f, 5.0f};
+
+    // 2 * 1 + 0.5 * 2 + 10 * 0.1
+    CHECK_NEAR(charge_control_speed(&gains, 1.0f, 2.0f, 0.1f), 4.0f, 1e-5);
+
+    // Above the range
+    CHECK_NEAR(charge_control_speed(&gains, 10.0f, 0.0f, 0.0f), 5.0f, 1e-6);
+
+    // Overshoot runs at the minimum speed, never backwards
+    CHECK_NEAR(charge_control_speed(&gains, -1.0f, 0.0f, 0.0f), 0.1f, 1e-6);
+}
+
+
+static void test_gate_opening(void) {
+    // Open above the start error, closed to the minimum at the stop threshold
+    CHECK_NEAR(charge_control_gate_opening(10.0f, 5.0f, 1.0f, 0.2f), 1.0f, 1e-6);
+    CHECK_NEAR(charge_control_gate_opening(1.0f, 5.0f, 1.0f, 0.2f), 0.2f, 1e-6);
+    CHECK_NEAR(charge_control_gate_opening(0.0f, 5.0f, 1.0f, 0.2f), 0.2f, 1e-6);
+
+    // Half way, 0.2 + 0.8 * 0.5
+    CHECK_NEAR(charge_control_gate_opening(3.0f, 5.0f, 1.0f, 0.2f), 0.6f, 1e-6);
+
+    // Quantised to the opening step
+    float opening = charge_control_gate_opening(3.1f, 5.0f, 1.0f, 0.2f);
+    float steps = opening / CHARGE_CONTROL_GATE_OPENING_STEP;
+    CHECK_NEAR(steps, roundf(steps), 1e-4);
+
+    // Flow control off when the start error is not above the stop threshold
+    CHECK_NEAR(charge_control_gate_opening(0.5f, 1.0f, 1.0f, 0.2f), 1.0f, 1e-6);
+
+    // Minimum opening out of range
+    CHECK_NEAR(charge_control_gate_opening(1.0f, 5.0f, 1.0f, -1.0f), 0.0f, 1e-6);
+}
+
+
+static void test_outcome_events(void) {
+    CHECK(charge_control_outcome(-0.05f, 0.03f) == CHARGE_CONTROL_EVENT_OVER_CHARGE);
+    CHECK(charge_control_outcome(0.05f, 0.03f) == CHARGE_CONTROL_EVENT_UNDER_CHARGE);
+    CHECK(charge_control_outcome(0.01f, 0.03f) == 0);
+
+    // An over charge, then an under charge only reports the under charge
+    uint32_t events = 0;
+    events = charge_control_record_outcome(events, charge_control_outcome(-0.05f, 0.03f));
+    CHECK(events == CHARGE_CONTROL_EVENT_OVER_CHARGE);
+    events = charge_control_record_outcome(events, charge_control_outcome(0.05f, 0.03f));
+    CHECK(events == CHARGE_CONTROL_EVENT_UNDER_CHARGE);
+
+    // A normal charge clears the outcome, other events are kept
+    events = charge_control_record_outcome(events | 1u, charge_control_outcome(0.0f, 0.03f));
+    CHECK(events == 1u);
+}
+
+
+int main(void) {
+    test_speed_is_clamped();
+    test_gate_opening();
+    test_outcome_events();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,60 @@
+#include "FloatRingBuffer.h"
+#include "test.h"
+
+
+static void test_enqueue_dequeue() {
+    float storage[4];
+    FloatRingBuffer buffer(storage, 4);
+
+    buffer.enqueue(1.0f);
+    buffer.enqueue(2.0f);
+    CHECK(buffer.getCounter() == 2);
+    CHECK_NEAR(buffer.first(), 1.0f, 0.0);
+
+    CHECK_NEAR(buffer.dequeue(), 1.0f, 0.0);
+    CHECK_NEAR(buffer.dequeue(), 2.0f, 0.0);
+    CHECK(buffer.getCounter() == 0);
+}
+
+
+static void test_wraps_when_full() {
+    StaticFloatRingBuffer<4> buffer;
+
+    for (int idx = 1; idx <= 6; idx += 1) {
+        buffer.enqueue((float) idx);
+    }
+
+    // The two oldest values have been overwritten
+    CHECK(buffer.getCounter() == 4);
+    CHECK(buffer.getWritePtr() == 2);
+    CHECK_NEAR(buffer[0], 5.0f, 0.0);
+    CHECK_NEAR(buffer[1], 6.0f, 0.0);
+    CHECK_NEAR(buffer[2], 3.0f, 0.0);
+}
+
+
+static void test_statistics() {
+    StaticFloatRingBuffer<4> buffer;
+
+    buffer.enqueue(2.0f);
+    buffer.enqueue(4.0f);
+    buffer.enqueue(4.0f);
+    buffer.enqueue(6.0f);
+
+    CHECK_NEAR(buffer.getSum(), 16.0, 1e-9);
+    CHECK_NEAR(buffer.getMean(), 4.0f, 1e-6);
+    CHECK_NEAR(buffer.getSd(), 1.41421356f, 1e-5);
+
+    buffer.reset();
+    CHECK(buffer.getCounter() == 0);
+    CHECK(!buffer.isLocked());
+}
+
+
+int main() {
+    test_enqueue_dequeue();
+    test_wraps_when_full();
+    test_statistics();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,71 @@
+#include "gp_lite.h"
+#include "test.h"
+
+
+static float _score(float kp, float kd) {
+    // Single peak at Kp = 0.6, Kd = 2.0
+    return 100.0f - 100.0f * (kp - 0.6f) * (kp - 0.6f) - 10.0f * (kd - 2.0f) * (kd - 2.0f);
+}
+
+
+static void test_prediction_follows_observations(void) {
+    static gp_model_t gp;
+    gp_init(&gp, 0.0f, 1.0f, 0.0f, 5.0f);
+
+    CHECK(gp_add_observation(&gp, 0.2f, 1.0f, _score(0.2f, 1.0f)));
+    CHECK(gp_add_observation(&gp, 0.6f, 2.0f, _score(0.6f, 2.0f)));
+    CHECK(gp_add_observation(&gp, 0.9f, 4.0f, _score(0.9f, 4.0f)));
+
+    float mean_at_obs, var_at_obs;
+    gp_predict(&gp, 0.6f, 2.0f, &mean_at_obs, &var_at_obs);
+
+    float mean_far, var_far;
+    gp_predict(&gp, 0.0f, 5.0f, &mean_far, &var_far);
+
+    // Close to the observation (noise 5) and more certain there than far from the data
+    CHECK_NEAR(mean_at_obs, 100.0f, 10.0f);
+    CHECK(var_at_obs < var_far);
+
+    float kp, kd, score;
+    gp_get_best_observed(&gp, &kp, &kd, &score);
+    CHECK_NEAR(kp, 0.6f, 1e-6);
+    CHECK_NEAR(kd, 2.0f, 1e-6);
+}
+
+
+static void test_next_params_in_bounds(void) {
+    static gp_model_t gp;
+    gp_init(&gp, 0.1f, 1.0f, 0.5f, 5.0f);
+
+    float kp = 0.3f, kd = 1.0f;
+    for (int idx = 0; idx < 8; idx += 1) {
+        gp_add_observation(&gp, kp, kd, _score(kp, kd));
+        gp_get_next_params(&gp, &kp, &kd);
+
+        CHECK(kp >= 0.1f && kp <= 1.0f);
+        CHECK(kd >= 0.5f && kd <= 5.0f);
+    }
+}
+
+
+static void test_capacity(void) {
+    static gp_model_t gp;
+    gp_init(&gp, 0.0f, 1.0f, 0.0f, 1.0f);
+
+    for (int idx = 0; idx < GP_MAX_POINTS; idx += 1) {
+        CHECK(gp_add_observation(&gp, idx / (float) GP_MAX_POINTS, 0.5f, 50.0f));
+    }
+    CHECK(!gp_add_observation(&gp, 0.5f, 0.5f, 50.0f));
+
+    gp_reset(&gp);
+    CHECK(gp.n_obs == 0);
+}
+
+
+int main(void) {
+    test_prediction_follows_observations();
+    test_next_params_in_bounds();
+    test_capacity();
+
+    return TEST_RESULT();
+}
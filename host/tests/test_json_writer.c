@@ -0,0 +1,46 @@
+#include <string.h>
+
+#include "json_writer.h"
+#include "test.h"
+
+
+static void test_nesting_and_escaping(void) {
+    char buf[128];
+    json_writer_t json;
+    json_writer_init(&json, buf, sizeof(buf));
+
+    json_begin_object(&json);
+    json_add_string(&json, "name", "a \"b\"");
+    json_add_array(&json, "values");
+    json_int(&json, -1);
+    json_float(&json, 0.5f, 2);
+    json_bool(&json, true);
+    json_end_array(&json);
+    json_add_float(&json, "nan", NAN, 1);
+    json_end_object(&json);
+
+    CHECK(!json_writer_overflow(&json));
+    CHECK(json.len == strlen("{\"name\":\"a \\\"b\\\"\",\"values\":[-1,0.50,true],\"nan\":null}"));
+    CHECK(strncmp(buf, "{\"name\":\"a \\\"b\\\"\",\"values\":[-1,0.50,true],\"nan\":null}", json.len) == 0);
+}
+
+
+static void test_overflow(void) {
+    char buf[8];
+    json_writer_t json;
+    json_writer_init(&json, buf, sizeof(buf));
+
+    json_begin_object(&json);
+    json_add_string(&json, "key", "too long for the buffer");
+
+    CHECK(json_writer_overflow(&json));
+    CHECK(json.len <= sizeof(buf));
+}
+
+
+int main(void) {
+    test_nesting_and_escaping();
+    test_overflow();
+
+    return TEST_RESULT();
+}
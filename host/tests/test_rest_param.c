@@ -0,0 +1,144 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "rest_param.h"
+#include "test.h"
+
+
+typedef struct {
+    float speed;
+    int32_t offset;
+    uint16_t count;
+    bool enabled;
+    uint32_t colour;
+} test_config_t;
+
+static const rest_param_t test_params[] = {
+    REST_PARAM_ENTRY("s0", test_config_t, speed, REST_PARAM_FLOAT, 2, 0.0f, 10.0f),
+    REST_PARAM_ENTRY("s1", test_config_t, offset, REST_PARAM_INT32, 0, -5.0f, 5.0f),
+    REST_PARAM_ENTRY("s2", test_config_t, count, REST_PARAM_UINT16, 0, 1.0f, 1000.0f),
+    REST_PARAM_ENTRY("s3", test_config_t, enabled, REST_PARAM_BOOL, 0, 0.0f, 1.0f),
+    REST_PARAM_ENTRY("s4", test_config_t, colour, REST_PARAM_COLOUR, 0, 0.0f, 16777215.0f),
+};
+
+static rest_param_schema_t test_schema = REST_PARAM_SCHEMA(test_params);
+
+static const test_config_t default_config = {1.0f, 0, 10, false, 0};
+
+
+static rest_param_result_t _apply(test_config_t * config, const char * key, const char * value) {
+    char * params[] = {(char *) key};
+    char * values[] = {(char *) value};
+    return rest_param_apply(&test_schema, config, 1, params, values);
+}
+
+
+static void test_bool(void) {
+    test_config_t config = default_config;
+
+    rest_param_result_t result = _apply(&config, "s3", "true");
+    CHECK(config.enabled);
+    CHECK(REST_PARAM_CHANGED(&result, 3));
+
+    result = _apply(&config, "s3", "false");
+    CHECK(!config.enabled);
+    CHECK(result.invalid == 0);
+
+    // Only "true" and "false", anything else is rejected and the field is kept
+    const char * rejected[] = {"1", "0", "yes", "True", ""};
+    for (size_t idx = 0; idx < sizeof(rejected) / sizeof(rejected[0]); idx += 1) {
+        config.enabled = true;
+        result = _apply(&config, "s3", rejected[idx]);
+        CHECK(config.enabled);
+        CHECK(!REST_PARAM_CHANGED(&result, 3));
+        CHECK(result.invalid == (1u << 3));
+    }
+}
+
+
+static void test_range(void) {
+    test_config_t config = default_config;
+
+    // Inclusive bounds
+    rest_param_result_t result = _apply(&config, "s0", "10");
+    CHECK(REST_PARAM_CHANGED(&result, 0));
+    CHECK_NEAR(config.speed, 10.0f, 0.0);
+    _apply(&config, "s0", "0");
+    CHECK_NEAR(config.speed, 0.0f, 0.0);
+    _apply(&config, "s1", "-5");
+    CHECK(config.offset == -5);
+
+    // Out of range, not a number or with trailing text: rejected, the field is kept
+    config = default_config;
+    const char * rejected[] = {"10.01", "-0.5", "abc", "2.5x", "", "nan", "inf"};
+    for (size_t idx = 0; idx < sizeof(rejected) / sizeof(rejected[0]); idx += 1) {
+        rest_param_result_t result = _apply(&config, "s0", rejected[idx]);
+        CHECK_NEAR(config.speed, 1.0f, 0.0);
+        CHECK(result.invalid == 1u);
+        CHECK(result.changed == 0);
+    }
+
+    CHECK(_apply(&config, "s1", "6").invalid == (1u << 1));
+    CHECK(config.offset == 0);
+    CHECK(_apply(&config, "s2", "0").invalid == (1u << 2));
+    CHECK(_apply(&config, "s2", "1001").invalid == (1u << 2));
+    CHECK(config.count == 10);
+
+    // Colours are range checked as numbers, "#" is required
+    CHECK(_apply(&config, "s4", "ff0080").invalid == (1u << 4));
+    CHECK(_apply(&config, "s4", "#1000000").invalid == (1u << 4));
+    CHECK(_apply(&config, "s4", "#ff0080").invalid == 0);
+    CHECK(config.colour == 0xff0080);
+}
+
+
+static void test_unknown_keys_and_save(void) {
+    test_config_t config = default_config;
+
+    char * params[] = {"s9", "S0", "speed", "s2", "ee"};
+    char * values[] = {"1", "2", "3", "20", "true"};
+    rest_param_result_t result = rest_param_apply(&test_schema, &config, 5, params, values);
+
+    // Unknown keys are ignored, neither changed nor invalid
+    CHECK(result.changed == (1u << 2));
+    CHECK(result.invalid == 0);
+    CHECK_NEAR(config.speed, 1.0f, 0.0);
+    CHECK(config.count == 20);
+    CHECK(result.save);
+
+    // Only ee asks for a save
+    result = _apply(&config, "s1", "3");
+    CHECK(!result.save);
+
+    result = _apply(&config, "ee", "no");
+    CHECK(!result.save);
+}
+
+
+static void test_to_json(void) {
+    test_config_t config = default_config;
+
+    char * params[] = {"s0", "s1", "s4"};
+    char * values[] = {"2.5", "9", "#ff0080"};
+    rest_param_result_t result = rest_param_apply(&test_schema, &config, 3, params, values);
+
+    char buf[160];
+    json_writer_t json;
+    json_writer_init(&json, buf, sizeof(buf));
+    rest_param_to_json(&test_schema, &config, &result, &json);
+
+    const char * expected = "{\"s0\":2.50,\"s1\":0,\"s2\":10,\"s3\":false,\"s4\":\"#ff0080\",\"invalid\":[\"s1\"]}";
+    CHECK(!json_writer_overflow(&json));
+    CHECK(json.len == strlen(expected));
+    CHECK(strncmp(buf, expected, json.len) == 0);
+}
+
+
+int main(void) {
+    test_bool();
+    test_range();
+    test_unknown_keys_and_save();
+    test_to_json();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,83 @@
+#include <string.h>
+
+#include "scale_frame.h"
+#include "hal_posix.h"
+#include "test.h"
+
+
+// A&D standard data format, no header
+typedef union {
+    struct __attribute__((__packed__)){
+        char header[2];
+        char comma;
+        char data[9];
+        char unit[3];
+        char terminator[2];
+    };
+    char bytes[17];
+} standard_frame_t;
+
+
+static void test_frames_split_on_terminator(void) {
+    hal_posix_reset();
+
+    standard_frame_t frame;
+    scale_frame_reader_t reader;
+    scale_frame_reader_init(&reader, &frame, sizeof(frame), SCALE_FRAME_NO_HEADER);
+
+    // A partial frame first, dropped at its terminator
+    const char * stream = "12.3 g\r\n"
+                          "ST,+00012.34  g\r\n"
+                          "ST,-00001.50  g\r\n";
+    hal_posix_uart_inject(HAL_UART_SCALE, stream, strlen(stream));
+
+    CHECK(scale_frame_read(&reader, HAL_UART_SCALE));
+    CHECK_NEAR(scale_frame_parse_weight(frame.data, sizeof(frame.data), '+'), 12.34, 1e-4);
+
+    CHECK(scale_frame_read(&reader, HAL_UART_SCALE));
+    CHECK_NEAR(scale_frame_parse_weight(frame.data, sizeof(frame.data), '+'), -1.5, 1e-4);
+
+    // Drained
+    CHECK(!scale_frame_read(&reader, HAL_UART_SCALE));
+}
+
+
+static void test_frames_split_on_header(void) {
+    hal_posix_reset();
+
+    char frame[8];
+    scale_frame_reader_t reader;
+    scale_frame_reader_init(&reader, frame, sizeof(frame), '$');
+
+    // Noise before the header, then a frame received in two parts
+    hal_posix_uart_inject(HAL_UART_SCALE, "xx\n$  1", 7);
+    CHECK(!scale_frame_read(&reader, HAL_UART_SCALE));
+
+    hal_posix_uart_inject(HAL_UART_SCALE, "0.25\n", 5);
+    CHECK(scale_frame_read(&reader, HAL_UART_SCALE));
+    CHECK(frame[0] == '$');
+    CHECK_NEAR(scale_frame_parse_weight(frame + 1, 7, '-'), -10.25, 1e-4);
+}
+
+
+static void test_parse_weight(void) {
+    CHECK_NEAR(scale_frame_parse_weight("   42.10", 8, '+'), 42.1, 1e-4);
+
+    // Not terminated, only len bytes are read
+    CHECK_NEAR(scale_frame_parse_weight("1.5999", 3, '+'), 1.5, 1e-6);
+
+    CHECK(isnan(scale_frame_parse_weight("  -----", 7, '+')));
+    CHECK(isnan(scale_frame_parse_weight("", 0, '+')));
+
+    // Too long for a weight, the extra bytes are ignored
+    CHECK_NEAR(scale_frame_parse_weight("0000000000000001234", 19, '+'), 0.0, 1e-6);
+}
+
+
+int main(void) {
+    test_frames_split_on_terminator();
+    test_frames_split_on_header();
+    test_parse_weight();
+
+    return TEST_RESULT();
+}
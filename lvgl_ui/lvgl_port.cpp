@@ -30,3 +30,10 @@ void ui_init(void) {
 lv_obj_t* ui_get_main_screen(void) {
     return main_screen;
 }
+
+// Dispatch a change event to the screens
+void ui_handle_event(const ui_event_t *event) {
+    ui_charge_mode_handle_event(event);
+    ui_cleanup_mode_handle_event(event);
+    ui_ai_tuning_handle_event(event);
+}
@@ -11,6 +11,7 @@ extern "C" {
 #endif
 
 #include "lvgl.h"
+#include "ui_events.h"
 
 // Initialize UI (called from tft35_lvgl_task)
 void ui_init(void);
@@ -26,11 +27,16 @@ void ui_show_charge_mode(void);
 void ui_show_cleanup_mode(void);
 void ui_show_settings(void);
 void ui_show_ai_tuning(void);
+void ui_show_task_stats(void);
 void ui_show_warning(const char *title, const char *message, void (*on_confirm)(void), void (*on_cancel)(void));
 
-// Update functions for dynamic screens
-void ui_charge_mode_update(float current_weight, float target_weight, float elapsed_time, const char *status);
-void ui_cleanup_mode_update(float weight, float flow_rate, float speed, const char *servo_state);
+// Apply a change event from charge mode, the scale or AI tuning (called from tft35_lvgl_task)
+void ui_handle_event(const ui_event_t *event);
+
+// Event handlers of the dynamic screens, they ignore events while their screen is not shown
+void ui_charge_mode_handle_event(const ui_event_t *event);
+void ui_cleanup_mode_handle_event(const ui_event_t *event);
+void ui_ai_tuning_handle_event(const ui_event_t *event);
 
 #ifdef __cplusplus
 }
@@ -42,8 +42,6 @@ static lv_obj_t *btn_start = NULL;
 static lv_obj_t *btn_apply = NULL;
 static lv_obj_t *btn_cancel = NULL;
 
-static lv_timer_t *update_timer = NULL;
-
 // Start tuning callback
 static void btn_start_cb(lv_event_t *e) {
     (void)e;
@@ -118,10 +116,8 @@ static void btn_back_cb(lv_event_t *e) {
     }
 }
 
-// Update timer callback - refresh display during tuning
-static void update_timer_cb(lv_timer_t *timer) {
-    (void)timer;
-
+// Refresh the display from the tuning session, on each session change
+static void refresh_session(void) {
     if (!ai_tuning_screen) return;
 
     ai_tuning_session_t *session = ai_tuning_get_session();
@@ -135,42 +131,42 @@ static void update_timer_cb(lv_timer_t *timer) {
 
     // Update drop count
     snprintf(buf, sizeof(buf), "Drop %d / %d", session->drops_completed, session->total_drops_target);
-    lv_label_set_text(drop_label, buf);
+    ui_label_set_text_if_changed(drop_label, buf);
 
     // Update phase
     switch (session->state) {
         case AI_TUNING_PHASE_1_COARSE:
-            lv_label_set_text(phase_label, "Phase 1: Tuning Coarse Trickler");
-            lv_label_set_text(status_label, "Put pan on scale, charge will start...");
+            ui_label_set_text_if_changed(phase_label, "Phase 1: Tuning Coarse Trickler");
+            ui_label_set_text_if_changed(status_label, "Put pan on scale, charge will start...");
             break;
 
         case AI_TUNING_PHASE_2_FINE:
-            lv_label_set_text(phase_label, "Phase 2: Tuning Fine Trickler");
-            lv_label_set_text(status_label, "Continue charging...");
+            ui_label_set_text_if_changed(phase_label, "Phase 2: Tuning Fine Trickler");
+            ui_label_set_text_if_changed(status_label, "Continue charging...");
             break;
 
         case AI_TUNING_COMPLETE:
-            lv_label_set_text(phase_label, "Tuning Complete!");
-            lv_label_set_text(status_label, "Review results below");
+            ui_label_set_text_if_changed(phase_label, "Tuning Complete!");
+            ui_label_set_text_if_changed(status_label, "Review results below");
 
             // Show results
             snprintf(buf, sizeof(buf), "Coarse Kp: %.2f", session->recommended_coarse_kp);
-            lv_label_set_text(coarse_kp_label, buf);
+            ui_label_set_text_if_changed(coarse_kp_label, buf);
 
             snprintf(buf, sizeof(buf), "Coarse Kd: %.2f", session->recommended_coarse_kd);
-            lv_label_set_text(coarse_kd_label, buf);
+            ui_label_set_text_if_changed(coarse_kd_label, buf);
 
             snprintf(buf, sizeof(buf), "Fine Kp: %.2f", session->recommended_fine_kp);
-            lv_label_set_text(fine_kp_label, buf);
+            ui_label_set_text_if_changed(fine_kp_label, buf);
 
             snprintf(buf, sizeof(buf), "Fine Kd: %.2f", session->recommended_fine_kd);
-            lv_label_set_text(fine_kd_label, buf);
+            ui_label_set_text_if_changed(fine_kd_label, buf);
 
             snprintf(buf, sizeof(buf), "Avg Overthrow: %.2f%%", session->avg_overthrow);
-            lv_label_set_text(overthrow_label, buf);
+            ui_label_set_text_if_changed(overthrow_label, buf);
 
             snprintf(buf, sizeof(buf), "Avg Time: %.1f ms", session->avg_total_time);
-            lv_label_set_text(time_label, buf);
+            ui_label_set_text_if_changed(time_label, buf);
 
             // Show apply button, hide cancel
             lv_obj_clear_flag(btn_apply, LV_OBJ_FLAG_HIDDEN);
@@ -178,8 +174,8 @@ static void update_timer_cb(lv_timer_t *timer) {
             break;
 
         case AI_TUNING_ERROR:
-            lv_label_set_text(phase_label, "Error!");
-            lv_label_set_text(status_label, session->error_message);
+            ui_label_set_text_if_changed(phase_label, "Error!");
+            ui_label_set_text_if_changed(status_label, session->error_message);
             lv_obj_add_flag(btn_cancel, LV_OBJ_FLAG_HIDDEN);
             lv_obj_clear_flag(btn_start, LV_OBJ_FLAG_HIDDEN);
             break;
@@ -194,11 +190,11 @@ static void update_timer_cb(lv_timer_t *timer) {
 
         snprintf(buf, sizeof(buf), "Last: Kp=%.2f Kd=%.2f Score=%.0f",
                  last_drop->coarse_kp_used, last_drop->coarse_kd_used, last_drop->overall_score);
-        lv_label_set_text(overthrow_label, buf);
+        ui_label_set_text_if_changed(overthrow_label, buf);
 
         snprintf(buf, sizeof(buf), "Overthrow: %.2f%% Time: %.0fms",
                  last_drop->overthrow_percent, last_drop->total_time_ms);
-        lv_label_set_text(time_label, buf);
+        ui_label_set_text_if_changed(time_label, buf);
     }
 }
 
@@ -322,11 +318,17 @@ void ui_ai_tuning_create(void) {
     lv_obj_set_style_text_font(btn_cancel, UI_FONT_MEDIUM, 0);
     lv_obj_add_flag(btn_cancel, LV_OBJ_FLAG_HIDDEN);
 
-    // Start update timer
-    if (update_timer) {
-        lv_timer_del(update_timer);
+    // Show a session already in progress, then follow its changes
+    refresh_session();
+}
+
+// Apply a UI event
+void ui_ai_tuning_handle_event(const ui_event_t *event) {
+    if (event->type != UI_EVENT_AI_TUNING || !ai_tuning_screen || lv_scr_act() != ai_tuning_screen) {
+        return;
     }
-    update_timer = lv_timer_create(update_timer_cb, 500, NULL);
+
+    refresh_session();
 }
 
 void ui_ai_tuning_show(void) {
@@ -7,16 +7,21 @@
 #include "ui_common.h"
 #include "lvgl.h"
 #include <stdio.h>
+#include <math.h>
 
 // External dependencies
 extern "C" {
     #include "charge_mode.h"
     #include "profile.h"
     #include "app.h"
+    #include "charge_history.h"
+    #include "scale.h"
 }
 
 // Forward declarations
 extern void ui_show_main_menu(void);
+static void update_history_chart(void);
+static void update_weight_label(float current_weight);
 
 // Screen objects
 static lv_obj_t *charge_mode_screen = NULL;
@@ -27,6 +32,29 @@ static lv_obj_t *status_label = NULL;
 static lv_obj_t *profile_label = NULL;
 static lv_obj_t *progress_bar = NULL;
 static lv_obj_t *status_led = NULL;
+static lv_obj_t *history_chart = NULL;
+static lv_chart_series_t *history_max_series = NULL;
+static lv_chart_series_t *history_min_series = NULL;
+static lv_chart_series_t *target_series = NULL;
+static lv_chart_series_t *coarse_stop_series = NULL;
+static lv_chart_series_t *fine_stop_series = NULL;
+
+// Charge timer label refresh while charging
+#define CHARGE_TIMER_PERIOD_MS  50
+
+// Last state received from charge mode
+static uint8_t charge_state = CHARGE_MODE_EXIT;
+static float target_weight = 0.0f;
+static uint32_t charge_start_tick = 0;
+static lv_timer_t *charge_timer = NULL;
+
+// Weight history shown on the chart, in thousandths of the unit
+#define HISTORY_CHART_SCALE     1000
+#define HISTORY_READ_BUCKETS    16
+
+static bool history_synced = false;
+static uint32_t history_revision = 0;
+static uint16_t history_count = 0;
 
 // Status colors
 static const lv_color_t color_waiting = {.blue = 0xF3, .green = 0x96, .red = 0x21};  // Blue
@@ -34,6 +62,22 @@ static const lv_color_t color_charging = {.blue = 0x07, .green = 0xC1, .red = 0x
 static const lv_color_t color_complete = {.blue = 0x50, .green = 0xAF, .red = 0x4C}; // Green
 static const lv_color_t color_error = {.blue = 0x36, .green = 0x43, .red = 0xF4};    // Red
 
+// Running charge timer, only while charging
+static void charge_timer_cb(lv_timer_t *timer) {
+    (void)timer;
+
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%.2fs", lv_tick_elaps(charge_start_tick) / 1000.0f);
+    ui_label_set_text_if_changed(timer_label, buf);
+}
+
+static void stop_charge_timer(void) {
+    if (charge_timer) {
+        lv_timer_del(charge_timer);
+        charge_timer = NULL;
+    }
+}
+
 // Stop button callback
 static void btn_stop_cb(lv_event_t *e) {
     (void)e;
@@ -53,6 +97,8 @@ void ui_charge_mode_create(void) {
     if (charge_mode_screen) {
         lv_obj_del(charge_mode_screen);
     }
+    stop_charge_timer();
+    target_weight = 0.0f;
 
     charge_mode_screen = lv_obj_create(NULL);
     lv_obj_set_style_bg_color(charge_mode_screen, UI_COLOR_BG, 0);
@@ -75,17 +121,21 @@ void ui_charge_mode_create(void) {
     lv_label_set_text(timer_label, "0.00s");
     lv_obj_set_style_text_font(timer_label, UI_FONT_NORMAL, 0);
     lv_obj_set_style_text_color(timer_label, UI_COLOR_TEXT_SECONDARY, 0);
+    lv_obj_set_width(timer_label, 100);
+    lv_obj_set_style_text_align(timer_label, LV_TEXT_ALIGN_RIGHT, 0);
     lv_obj_align(timer_label, LV_ALIGN_RIGHT_MID, -UI_PADDING, 0);
 
-    // Large weight display
+    // Large weight display, left half
     lv_obj_t *weight_panel = ui_create_panel(charge_mode_screen);
-    lv_obj_set_size(weight_panel, UI_SCREEN_WIDTH - 40, 100);
-    lv_obj_align(weight_panel, LV_ALIGN_TOP_MID, 0, 54);
+    lv_obj_set_size(weight_panel, (UI_SCREEN_WIDTH - 50) / 2, 100);
+    lv_obj_align(weight_panel, LV_ALIGN_TOP_LEFT, 20, 54);
 
     weight_label = lv_label_create(weight_panel);
     lv_label_set_text(weight_label, "---.---");
     lv_obj_set_style_text_font(weight_label, UI_FONT_XLARGE, 0);
     lv_obj_set_style_text_color(weight_label, UI_COLOR_TEXT, 0);
+    lv_obj_set_width(weight_label, (UI_SCREEN_WIDTH - 50) / 2 - 20);  // Fixed width, a new value only redraws the label
+    lv_obj_set_style_text_align(weight_label, LV_TEXT_ALIGN_CENTER, 0);
     lv_obj_align(weight_label, LV_ALIGN_CENTER, 0, -10);
 
     lv_obj_t *unit_label = lv_label_create(weight_panel);
@@ -94,6 +144,27 @@ void ui_charge_mode_create(void) {
     lv_obj_set_style_text_color(unit_label, UI_COLOR_TEXT_SECONDARY, 0);
     lv_obj_align(unit_label, LV_ALIGN_CENTER, 0, 25);
 
+    // Weight history of the charge, right half
+    history_chart = lv_chart_create(charge_mode_screen);
+    lv_obj_set_size(history_chart, (UI_SCREEN_WIDTH - 50) / 2, 100);
+    lv_obj_align(history_chart, LV_ALIGN_TOP_RIGHT, -20, 54);
+    lv_obj_set_style_bg_color(history_chart, UI_COLOR_PANEL, 0);
+    lv_obj_set_style_border_width(history_chart, 0, 0);
+    lv_obj_set_style_pad_all(history_chart, 4, 0);
+    lv_obj_set_style_line_color(history_chart, UI_COLOR_BG, LV_PART_MAIN);
+    lv_obj_set_style_size(history_chart, 0, 0, LV_PART_INDICATOR);  // Lines only, no point markers
+    lv_obj_set_style_line_width(history_chart, 1, LV_PART_ITEMS);
+    lv_chart_set_type(history_chart, LV_CHART_TYPE_LINE);
+    lv_chart_set_div_line_count(history_chart, 3, 0);
+    lv_chart_set_point_count(history_chart, CHARGE_HISTORY_BUCKETS);
+
+    coarse_stop_series = lv_chart_add_series(history_chart, UI_COLOR_TEXT_SECONDARY, LV_CHART_AXIS_PRIMARY_Y);
+    fine_stop_series = lv_chart_add_series(history_chart, UI_COLOR_WARNING, LV_CHART_AXIS_PRIMARY_Y);
+    target_series = lv_chart_add_series(history_chart, UI_COLOR_SECONDARY, LV_CHART_AXIS_PRIMARY_Y);
+    history_min_series = lv_chart_add_series(history_chart, UI_COLOR_PRIMARY, LV_CHART_AXIS_PRIMARY_Y);
+    history_max_series = lv_chart_add_series(history_chart, UI_COLOR_PRIMARY, LV_CHART_AXIS_PRIMARY_Y);
+    history_synced = false;
+
     // Progress bar
     progress_bar = lv_bar_create(charge_mode_screen);
     lv_obj_set_size(progress_bar, UI_SCREEN_WIDTH - 40, 20);
@@ -139,72 +210,191 @@ void ui_charge_mode_create(void) {
     lv_obj_set_style_shadow_color(btn_stop, lv_color_hex(0x000000), 0);
     lv_obj_set_style_shadow_opa(btn_stop, LV_OPA_30, 0);
     lv_obj_set_style_radius(btn_stop, 12, 0);
+
+    // Weight events are only published on change, start from the current measurement
+    update_weight_label(scale_get_current_measurement());
 }
 
 void ui_charge_mode_show(void) {
     ui_charge_mode_create();
+    update_history_chart();
     lv_scr_load(charge_mode_screen);
 }
 
-// Update charge mode display
-void ui_charge_mode_update(float current_weight, float target_weight, float elapsed_time, const char *status) {
-    if (!charge_mode_screen) return;
+// Status text and LED for a charge mode state
+static void apply_charge_state(uint8_t state) {
+    const char *status;
+    lv_color_t colour = color_charging;
 
-    char buf[32];
+    switch (state) {
+        case CHARGE_MODE_WAIT_FOR_ZERO:
+            status = "Waiting for Zero";
+            colour = color_waiting;
+            break;
+        case CHARGE_MODE_WAIT_FOR_COMPLETE:
+            status = "Charging";
+            break;
+        case CHARGE_MODE_WAIT_FOR_CUP_REMOVAL:
+            status = "Remove Cup";
+            break;
+        case CHARGE_MODE_WAIT_FOR_CUP_RETURN:
+            status = "Return Cup";
+            colour = color_waiting;
+            break;
+        default:
+            status = "Stopped";
+            colour = color_waiting;
+            break;
+    }
+
+    ui_label_set_text_if_changed(status_label, status);
+    lv_led_set_color(status_led, colour);
+}
+
+// Over/under/good once the charge is complete
+static void apply_charge_result(float current_weight) {
+    float error = current_weight - target_weight;
+    if (error < -0.02f) {
+        lv_led_set_color(status_led, color_charging);  // Under
+    } else if (error > 0.02f) {
+        lv_led_set_color(status_led, color_error);  // Over
+    } else {
+        lv_led_set_color(status_led, color_complete);  // Good
+    }
+}
+
+static int32_t history_chart_value(float weight) {
+    return isfinite(weight) ? (int32_t)(weight * HISTORY_CHART_SCALE) : LV_CHART_POINT_NONE;
+}
+
+// Start over: scale to the target and draw the thresholds, the history is cleared
+static void reset_history_chart(const charge_history_info_t *info) {
+    lv_chart_set_all_value(history_chart, history_min_series, LV_CHART_POINT_NONE);
+    lv_chart_set_all_value(history_chart, history_max_series, LV_CHART_POINT_NONE);
+    lv_chart_set_all_value(history_chart, target_series, history_chart_value(info->target));
+    lv_chart_set_all_value(history_chart, coarse_stop_series, history_chart_value(info->coarse_stop));
+    lv_chart_set_all_value(history_chart, fine_stop_series, history_chart_value(info->fine_stop));
+
+    if (isfinite(info->target) && info->target > 0) {
+        lv_chart_set_range(history_chart, LV_CHART_AXIS_PRIMARY_Y, 0, history_chart_value(info->target * 1.1f));
+    }
+}
+
+// Copy the buckets added or changed since the last update, a new revision redraws the whole history
+static void update_history_chart(void) {
+    charge_history_info_t info;
+    charge_history_bucket_t buckets[HISTORY_READ_BUCKETS];
 
-    // Update target
-    if (target_label) {
-        snprintf(buf, sizeof(buf), "Target: %.2f gr", target_weight);
-        lv_label_set_text(target_label, buf);
+    // The last bucket copied may have changed since
+    uint16_t first = history_count > 0 ? history_count - 1 : 0;
+    uint16_t num_buckets = charge_history_read(&info, first, buckets, HISTORY_READ_BUCKETS);
+
+    if (!history_synced || info.revision != history_revision) {
+        reset_history_chart(&info);
+        history_synced = true;
+        history_revision = info.revision;
+        history_count = 0;
+        first = 0;
+        num_buckets = charge_history_read(&info, first, buckets, HISTORY_READ_BUCKETS);
     }
 
-    // Update weight
-    if (weight_label) {
-        charge_mode_config_t *config = get_charge_mode_config();
-        if (config->eeprom_charge_mode_data.decimal_places == DP_2) {
-            snprintf(buf, sizeof(buf), "%.2f", current_weight);
-        } else {
-            snprintf(buf, sizeof(buf), "%.3f", current_weight);
+    bool changed = false;
+    while (num_buckets > 0 && info.revision == history_revision) {
+        for (uint16_t idx = 0; idx < num_buckets; idx += 1) {
+            lv_chart_set_value_by_id(history_chart, history_min_series, first + idx, history_chart_value(buckets[idx].min));
+            lv_chart_set_value_by_id(history_chart, history_max_series, first + idx, history_chart_value(buckets[idx].max));
         }
-        lv_label_set_text(weight_label, buf);
+        first += num_buckets;
+        history_count = first;
+        changed = true;
+
+        if (num_buckets < HISTORY_READ_BUCKETS) {
+            break;
+        }
+        num_buckets = charge_history_read(&info, first, buckets, HISTORY_READ_BUCKETS);
     }
 
-    // Update timer
-    if (timer_label) {
-        snprintf(buf, sizeof(buf), "%.2fs", elapsed_time);
-        lv_label_set_text(timer_label, buf);
+    if (info.revision != history_revision) {
+        // Merged while reading, redrawn on the next update
+        history_synced = false;
+        history_count = 0;
     }
 
-    // Update status
-    if (status_label && status) {
-        lv_label_set_text(status_label, status);
+    if (changed) {
+        lv_chart_refresh(history_chart);
     }
+}
 
-    // Update progress bar
-    if (progress_bar && target_weight > 0) {
-        int progress = (int)((current_weight / target_weight) * 100);
-        if (progress < 0) progress = 0;
-        if (progress > 100) progress = 100;
-        lv_bar_set_value(progress_bar, progress, LV_ANIM_ON);
+static void update_weight_label(float current_weight) {
+    char buf[32];
+    charge_mode_config_t *config = get_charge_mode_config();
+    ui_format_weight(buf, sizeof(buf), current_weight,
+                     config->eeprom_charge_mode_data.decimal_places == DP_2 ? 2 : 3);
+    ui_label_set_text_if_changed(weight_label, buf);
+}
+
+// Apply a UI event, only the widgets it affects are updated
+void ui_charge_mode_handle_event(const ui_event_t *event) {
+    if (!charge_mode_screen || lv_scr_act() != charge_mode_screen) {
+        // The timer has no screen to run on
+        if (event->type == UI_EVENT_CHARGE_STATE && event->state != CHARGE_MODE_WAIT_FOR_COMPLETE) {
+            stop_charge_timer();
+        }
+        return;
     }
 
-    // Update LED color based on status
-    if (status_led && status) {
-        if (strstr(status, "Zero") || strstr(status, "Return")) {
-            lv_led_set_color(status_led, color_waiting);
-        } else if (strstr(status, "Complete") || strstr(status, "Remove")) {
-            // Check if over/under
-            float error = current_weight - target_weight;
-            if (error < -0.02f) {
-                lv_led_set_color(status_led, color_charging);  // Under
-            } else if (error > 0.02f) {
-                lv_led_set_color(status_led, color_error);  // Over
-            } else {
-                lv_led_set_color(status_led, color_complete);  // Good
+    char buf[32];
+
+    switch (event->type) {
+        case UI_EVENT_WEIGHT: {
+            float current_weight = event->value;
+            update_weight_label(current_weight);
+
+            // lv_bar_set_value() does nothing if the value is unchanged
+            if (target_weight > 0) {
+                int progress = (int)((current_weight / target_weight) * 100);
+                if (progress < 0) progress = 0;
+                if (progress > 100) progress = 100;
+                lv_bar_set_value(progress_bar, progress, LV_ANIM_ON);
+            }
+
+            if (charge_state == CHARGE_MODE_WAIT_FOR_CUP_REMOVAL) {
+                apply_charge_result(current_weight);
             }
-        } else {
-            lv_led_set_color(status_led, color_charging);
+
+            update_history_chart();
+            break;
         }
+
+        case UI_EVENT_CHARGE_STATE:
+            charge_state = event->state;
+
+            if (event->value != target_weight) {
+                target_weight = event->value;
+                snprintf(buf, sizeof(buf), "Target: %.2f gr", target_weight);
+                ui_label_set_text_if_changed(target_label, buf);
+            }
+
+            apply_charge_state(charge_state);
+
+            if (charge_state == CHARGE_MODE_WAIT_FOR_COMPLETE) {
+                charge_start_tick = lv_tick_get();
+                if (!charge_timer) {
+                    charge_timer = lv_timer_create(charge_timer_cb, CHARGE_TIMER_PERIOD_MS, NULL);
+                }
+            } else {
+                stop_charge_timer();
+            }
+            break;
+
+        case UI_EVENT_CHARGE_TIME:
+            stop_charge_timer();
+            snprintf(buf, sizeof(buf), "%.2fs", event->value);
+            ui_label_set_text_if_changed(timer_label, buf);
+            break;
+
+        default:
+            break;
     }
 }
 
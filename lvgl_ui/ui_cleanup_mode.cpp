@@ -11,7 +11,9 @@
 // External dependencies
 extern "C" {
     #include "cleanup_mode.h"
+    #include "servo_gate.h"
     #include "app.h"
+    #include "scale.h"
 }
 
 // Forward declarations
@@ -28,6 +30,10 @@ static lv_obj_t *speed_slider = NULL;
 // Current speed value
 static float current_speed = 0.0f;
 
+// Previous measurement, for the flow rate
+static float last_weight = 0.0f;
+static uint32_t last_weight_tick = 0;
+
 // Speed slider callback
 static void slider_cb(lv_event_t *e) {
     lv_obj_t *slider = lv_event_get_target(e);
@@ -110,6 +116,8 @@ void ui_cleanup_mode_create(void) {
         lv_obj_del(cleanup_screen);
     }
 
+    last_weight_tick = 0;
+
     cleanup_screen = lv_obj_create(NULL);
     lv_obj_set_style_bg_color(cleanup_screen, UI_COLOR_BG, 0);
 
@@ -188,6 +196,11 @@ void ui_cleanup_mode_create(void) {
     lv_obj_align(btn_exit, LV_ALIGN_BOTTOM_RIGHT, -20, -20);
     lv_obj_set_style_bg_color(btn_exit, UI_COLOR_ERROR, 0);
     lv_obj_set_style_text_font(btn_exit, UI_FONT_MEDIUM, 0);
+
+    // Weight events are only published on change, start from the current measurement
+    char buf[32];
+    snprintf(buf, sizeof(buf), "Weight: %.3f gr", scale_get_current_measurement());
+    lv_label_set_text(weight_label, buf);
 }
 
 void ui_cleanup_mode_show(void) {
@@ -195,30 +208,47 @@ void ui_cleanup_mode_show(void) {
     lv_scr_load(cleanup_screen);
 }
 
-// Update cleanup mode display
-void ui_cleanup_mode_update(float weight, float flow_rate, float speed, const char *servo_state) {
-    if (!cleanup_screen) return;
-
-    char buf[32];
-
-    if (weight_label) {
-        snprintf(buf, sizeof(buf), "Weight: %.3f gr", weight);
-        lv_label_set_text(weight_label, buf);
-    }
-
-    if (flow_label) {
-        snprintf(buf, sizeof(buf), "Flow: %.3f gr/s", flow_rate);
-        lv_label_set_text(flow_label, buf);
+// Apply a UI event, only the widgets it affects are updated
+void ui_cleanup_mode_handle_event(const ui_event_t *event) {
+    if (!cleanup_screen || lv_scr_act() != cleanup_screen) {
+        return;
     }
 
-    if (speed_label) {
-        snprintf(buf, sizeof(buf), "Speed: %.1f rps", speed);
-        lv_label_set_text(speed_label, buf);
-    }
+    char buf[32];
 
-    if (servo_label && servo_state) {
-        snprintf(buf, sizeof(buf), "Servo: %s", servo_state);
-        lv_label_set_text(servo_label, buf);
+    switch (event->type) {
+        case UI_EVENT_WEIGHT: {
+            snprintf(buf, sizeof(buf), "Weight: %.3f gr", event->value);
+            ui_label_set_text_if_changed(weight_label, buf);
+
+            // Flow rate over the time between two measurements
+            uint32_t now = lv_tick_get();
+            uint32_t elapsed_ms = now - last_weight_tick;
+            if (last_weight_tick != 0 && elapsed_ms > 0) {
+                float flow_rate = (event->value - last_weight) * 1000.0f / elapsed_ms;
+                snprintf(buf, sizeof(buf), "Flow: %.3f gr/s", flow_rate);
+                ui_label_set_text_if_changed(flow_label, buf);
+            }
+            last_weight = event->value;
+            last_weight_tick = now;
+            break;
+        }
+
+        case UI_EVENT_CLEANUP_SPEED:
+            // Changed by the encoder or over REST
+            current_speed = event->value;
+            lv_slider_set_value(speed_slider, (int)(current_speed * 10), LV_ANIM_OFF);
+            snprintf(buf, sizeof(buf), "Speed: %.1f rps", current_speed);
+            ui_label_set_text_if_changed(speed_label, buf);
+            break;
+
+        case UI_EVENT_GATE_STATE:
+            snprintf(buf, sizeof(buf), "Servo: %s", gate_state_to_string((gate_state_t) event->state));
+            ui_label_set_text_if_changed(servo_label, buf);
+            break;
+
+        default:
+            break;
     }
 }
 
@@ -225,3 +225,12 @@ void ui_format_weight(char *buf, size_t buf_size, float weight, int decimals) {
         snprintf(buf, buf_size, "%.3f", weight);
     }
 }
+
+// Set label text if changed
+bool ui_label_set_text_if_changed(lv_obj_t *label, const char *text) {
+    if (!label || strcmp(lv_label_get_text(label), text) == 0) {
+        return false;
+    }
+    lv_label_set_text(label, text);
+    return true;
+}
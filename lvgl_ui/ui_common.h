@@ -67,6 +67,10 @@ void ui_show_toast(const char *message, uint32_t duration_ms);
 // Utility: Format weight string
 void ui_format_weight(char *buf, size_t buf_size, float weight, int decimals);
 
+// Utility: Set the label text only if it differs, so an unchanged value does not invalidate the label.
+// Returns true if the text has changed.
+bool ui_label_set_text_if_changed(lv_obj_t *label, const char *text);
+
 #ifdef __cplusplus
 }
 #endif
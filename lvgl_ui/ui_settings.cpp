@@ -20,6 +20,7 @@ extern "C" {
 // Forward declarations
 extern void ui_show_main_menu(void);
 extern void ui_show_ai_tuning(void);
+extern void ui_show_task_stats(void);
 
 // Screen objects
 static lv_obj_t *settings_screen = NULL;
@@ -34,6 +35,7 @@ typedef enum {
     SETTINGS_SERVO,
     SETTINGS_DISPLAY,
     SETTINGS_REBOOT,
+    SETTINGS_TASKS,
     SETTINGS_VERSION,
     SETTINGS_BACK,
 } settings_item_t;
@@ -111,6 +113,11 @@ static void list_item_cb(lv_event_t *e) {
                            NULL);
             break;
 
+        case SETTINGS_TASKS:
+            // Show CPU load and stack usage of the tasks
+            ui_show_task_stats();
+            break;
+
         case SETTINGS_VERSION:
             // Show version info
             {
@@ -161,6 +168,7 @@ void ui_settings_create(void) {
         {LV_SYMBOL_POWER,     "Servo Gate",      SETTINGS_SERVO},
         {LV_SYMBOL_IMAGE,     "Display",         SETTINGS_DISPLAY},
         {LV_SYMBOL_LOOP,      "Reboot",          SETTINGS_REBOOT},
+        {LV_SYMBOL_SETTINGS,  "Tasks",           SETTINGS_TASKS},
         {LV_SYMBOL_HOME,      "Version Info",    SETTINGS_VERSION},
     };
 
@@ -0,0 +1,125 @@
+/**
+ * @file ui_task_stats.cpp
+ * @brief Task Statistics Screen
+ *
+ * Debug screen listing the FreeRTOS tasks with their CPU load and minimum ever free stack, and the
+ * idle share of each core, as sampled by the metrics task.
+ */
+
+#include "lvgl_port.h"
+#include "ui_common.h"
+#include "lvgl.h"
+#include <stdio.h>
+
+// External dependencies
+extern "C" {
+    #include "metrics.h"
+}
+
+// Forward declarations
+extern void ui_show_settings(void);
+
+// Screen objects
+static lv_obj_t *task_stats_screen = NULL;
+static lv_obj_t *idle_label = NULL;
+static lv_obj_t *task_table = NULL;
+static lv_timer_t *refresh_timer = NULL;
+
+// Back button callback
+static void btn_back_cb(lv_event_t *e) {
+    (void)e;
+    ui_show_settings();
+}
+
+// Fill the table from the last sample, new samples are taken every METRICS_TASK_PERIOD_MS
+static void refresh_cb(lv_timer_t *timer) {
+    (void)timer;
+
+    static metrics_task_t tasks[METRICS_MAX_TASKS];
+    uint16_t idle_permille[configNUMBER_OF_CORES] = {0};
+    uint8_t num_tasks = metrics_get_tasks(tasks, METRICS_MAX_TASKS, idle_permille);
+
+    char buf[48];
+    snprintf(buf, sizeof(buf), "Idle: core 0 %u.%u%%  core 1 %u.%u%%",
+             idle_permille[0] / 10, idle_permille[0] % 10,
+             idle_permille[configNUMBER_OF_CORES - 1] / 10, idle_permille[configNUMBER_OF_CORES - 1] % 10);
+    ui_label_set_text_if_changed(idle_label, buf);
+
+    lv_table_set_row_count(task_table, num_tasks + 1);
+    for (uint8_t idx = 0; idx < num_tasks; idx++) {
+        uint32_t row = idx + 1;
+        lv_table_set_cell_value(task_table, row, 0, tasks[idx].name);
+        lv_table_set_cell_value_fmt(task_table, row, 1, "%u.%u", tasks[idx].cpu_permille / 10, tasks[idx].cpu_permille % 10);
+        lv_table_set_cell_value_fmt(task_table, row, 2, "%lu", (unsigned long)tasks[idx].stack_high_water_bytes);
+        lv_table_set_cell_value_fmt(task_table, row, 3, "%u", tasks[idx].priority);
+    }
+}
+
+// The screen is kept when leaving it, only refresh while it is shown
+static void screen_unloaded_cb(lv_event_t *e) {
+    (void)e;
+    if (refresh_timer) {
+        lv_timer_del(refresh_timer);
+        refresh_timer = NULL;
+    }
+}
+
+// Create task statistics screen
+void ui_task_stats_create(void) {
+    if (task_stats_screen) {
+        lv_obj_del(task_stats_screen);
+    }
+
+    task_stats_screen = lv_obj_create(NULL);
+    lv_obj_set_style_bg_color(task_stats_screen, UI_COLOR_BG, 0);
+    lv_obj_add_event_cb(task_stats_screen, screen_unloaded_cb, LV_EVENT_SCREEN_UNLOADED, NULL);
+
+    // Title bar with the idle share of the cores
+    lv_obj_t *title_bar = ui_create_titlebar(task_stats_screen, "Tasks");
+
+    idle_label = lv_label_create(title_bar);
+    lv_label_set_text(idle_label, "");
+    lv_obj_set_style_text_font(idle_label, UI_FONT_NORMAL, 0);
+    lv_obj_set_style_text_color(idle_label, UI_COLOR_TEXT_SECONDARY, 0);
+    lv_obj_align(idle_label, LV_ALIGN_RIGHT_MID, -UI_PADDING, 0);
+
+    // Task table, scrolls when there are more tasks than rows
+    task_table = lv_table_create(task_stats_screen);
+    lv_obj_set_size(task_table, UI_SCREEN_WIDTH - 40, UI_SCREEN_HEIGHT - 54 - 74);
+    lv_obj_align(task_table, LV_ALIGN_TOP_MID, 0, 54);
+    lv_obj_set_style_bg_color(task_table, UI_COLOR_PANEL, 0);
+    lv_obj_set_style_bg_color(task_table, UI_COLOR_PANEL, LV_PART_ITEMS);
+    lv_obj_set_style_text_color(task_table, UI_COLOR_TEXT, LV_PART_ITEMS);
+    lv_obj_set_style_text_font(task_table, UI_FONT_SMALL, LV_PART_ITEMS);
+    lv_obj_set_style_pad_ver(task_table, 4, LV_PART_ITEMS);
+    lv_obj_set_style_border_width(task_table, 0, 0);
+
+    lv_table_set_column_count(task_table, 4);
+    lv_table_set_column_width(task_table, 0, UI_SCREEN_WIDTH - 40 - 3 * 90);
+    lv_table_set_column_width(task_table, 1, 90);
+    lv_table_set_column_width(task_table, 2, 90);
+    lv_table_set_column_width(task_table, 3, 90);
+    lv_table_set_cell_value(task_table, 0, 0, "Task");
+    lv_table_set_cell_value(task_table, 0, 1, "CPU %");
+    lv_table_set_cell_value(task_table, 0, 2, "Stack free");
+    lv_table_set_cell_value(task_table, 0, 3, "Priority");
+
+    // Back button
+    lv_obj_t *btn_back = ui_create_button(task_stats_screen, "BACK", btn_back_cb);
+    lv_obj_set_size(btn_back, 100, 44);
+    lv_obj_align(btn_back, LV_ALIGN_BOTTOM_LEFT, 20, -15);
+}
+
+void ui_task_stats_show(void) {
+    ui_task_stats_create();
+    refresh_cb(NULL);
+    if (!refresh_timer) {
+        refresh_timer = lv_timer_create(refresh_cb, METRICS_TASK_PERIOD_MS, NULL);
+    }
+    lv_scr_load(task_stats_screen);
+}
+
+// Public interface
+void ui_show_task_stats(void) {
+    ui_task_stats_show();
+}
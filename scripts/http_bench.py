@@ -0,0 +1,74 @@
+"""
+Measure REST request rate and latency of the OpenTrickler, with a new TCP connection per request
+(Connection: close) and with one persistent HTTP/1.1 connection (keep-alive). After each mode the
+connection counters of /rest/http_pool are read back: k0 (keep-alive responses) shows the connection
+was reused, c1 the peak connections in use.
+
+Usage:
+    python http_bench.py --host 192.168.4.1 -n 200 -p /rest/charge_mode_state
+"""
+
+import argparse
+import http.client
+import json
+import statistics
+import time
+
+
+def run(host, port, path, count, keepalive):
+    latencies = []
+    conn = None
+
+    start = time.perf_counter()
+    for _ in range(count):
+        if conn is None:
+            conn = http.client.HTTPConnection(host, port, timeout=5)
+
+        t0 = time.perf_counter()
+        conn.request("GET", path, headers={} if keepalive else {"Connection": "close"})
+        response = conn.getresponse()
+        response.read()
+        latencies.append(time.perf_counter() - t0)
+
+        if not keepalive or response.will_close:
+            conn.close()
+            conn = None
+    elapsed = time.perf_counter() - start
+
+    if conn is not None:
+        conn.close()
+
+    latencies.sort()
+    p95 = latencies[int(0.95 * (len(latencies) - 1))]
+    return count / elapsed, statistics.median(latencies), p95, max(latencies)
+
+
+def pool_stats(host, port):
+    conn = http.client.HTTPConnection(host, port, timeout=5)
+    conn.request("GET", "/rest/http_pool", headers={"Connection": "close"})
+    stats = json.loads(conn.getresponse().read())
+    conn.close()
+    return stats
+
+
+def main(host, port, path, count):
+    for keepalive in (False, True):
+        before = pool_stats(host, port)
+        rate, median, p95, worst = run(host, port, path, count, keepalive)
+        after = pool_stats(host, port)
+
+        mode = "keep-alive" if keepalive else "close"
+        print(f"{mode:>10}: {rate:7.1f} req/s, median {median * 1000:6.1f} ms, p95 {p95 * 1000:6.1f} ms, "
+              f"max {worst * 1000:6.1f} ms, kept alive {after['k0'] - before['k0']}, "
+              f"peak connections {after['c1']}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Benchmark REST requests with and without keep-alive")
+    parser.add_argument("--host", required=True, help="OpenTrickler IP address or host name")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("-p", "--path", default="/rest/charge_mode_state", help="Resource to request")
+    parser.add_argument("-n", "--count", type=int, default=100, help="Requests per mode")
+    args = parser.parse_args()
+
+    main(args.host, args.port, args.path, args.count)
@@ -0,0 +1,92 @@
+"""
+Measure the start-up load of the OpenTrickler web portal: the page and the settings it reads, either one
+request per resource (as before /rest/batch) or with one batch request. After each run the lwIP heap
+use and its peak (m0, m1 of /rest/http_pool, MEM_STATS) are read back.
+
+The peak is kept since boot, so for before/after heap numbers reboot the device before each mode:
+    python page_load_bench.py --host 192.168.4.1 --mode individual
+    (reboot)
+    python page_load_bench.py --host 192.168.4.1 --mode batch
+"""
+
+import argparse
+import http.client
+import json
+import time
+
+
+# Read by the portal at start-up, see batchResources in web_portal.html
+RESOURCES = [
+    "scale_config",
+    "charge_mode_config",
+    "coarse_motor_config",
+    "fine_motor_config",
+    "mini_12864_config",
+    "display_config",
+    "wireless_config",
+    "servo_gate_config",
+    "profile_summary",
+]
+
+
+def get(host, port, path):
+    # A new connection per request, as the browser without keep-alive
+    conn = http.client.HTTPConnection(host, port, timeout=10)
+    conn.request("GET", path, headers={"Connection": "close"})
+    response = conn.getresponse()
+    body = response.read()
+    conn.close()
+    return response.status, body
+
+
+def load(host, port, mode):
+    start = time.perf_counter()
+
+    status, page = get(host, port, "/")
+    if status != 200:
+        raise RuntimeError(f"GET / returned {status}")
+
+    if mode == "batch":
+        status, _ = get(host, port, "/rest/batch?r=" + ",".join(RESOURCES))
+        if status != 200:
+            raise RuntimeError(f"GET /rest/batch returned {status}")
+        requests = 2
+    else:
+        for resource in RESOURCES:
+            status, _ = get(host, port, "/rest/" + resource)
+            if status != 200:
+                raise RuntimeError(f"GET /rest/{resource} returned {status}")
+        requests = 1 + len(RESOURCES)
+
+    return time.perf_counter() - start, requests, len(page)
+
+
+def heap(host, port):
+    _, body = get(host, port, "/rest/http_pool")
+    stats = json.loads(body)
+    return stats.get("m0"), stats.get("m1"), stats.get("m2")
+
+
+def main(host, port, modes, count):
+    for mode in modes:
+        times = []
+        for _ in range(count):
+            elapsed, requests, page_len = load(host, port, mode)
+            times.append(elapsed)
+
+        used, peak, size = heap(host, port)
+        print(f"{mode:>10}: {requests} requests, page {page_len} bytes, "
+              f"load min {min(times) * 1000:6.1f} ms, mean {sum(times) / len(times) * 1000:6.1f} ms, "
+              f"lwIP heap {used} / peak {peak} / MEM_SIZE {size} bytes")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Measure the web portal start-up load and the lwIP heap peak")
+    parser.add_argument("--host", required=True, help="OpenTrickler IP address or host name")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--mode", choices=["individual", "batch", "both"], default="both")
+    parser.add_argument("-n", "--count", type=int, default=10, help="Page loads per mode")
+    args = parser.parse_args()
+
+    modes = ["individual", "batch"] if args.mode == "both" else [args.mode]
+    main(args.host, args.port, modes, args.count)
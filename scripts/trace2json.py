@@ -0,0 +1,153 @@
+"""
+Convert the OpenTrickler trace dump (GET /rest/trace, see src/trace.c) into Chrome trace JSON, which
+opens in chrome://tracing and https://ui.perfetto.dev.
+
+Each core gets a track with the running task, start/end events become slices on a track of their own,
+counters (weight, controller error, motor commands) become counter tracks.
+
+Usage:
+    python trace2json.py --host 192.168.4.1 -o trace.json
+    python trace2json.py --input trace.bin -o trace.json
+"""
+
+import argparse
+import json
+import struct
+import urllib.request
+
+
+HEADER = struct.Struct("<4sHBBI")
+EVENT = struct.Struct("<B3xi16s")
+TASK = struct.Struct("<I16s")
+RECORD = struct.Struct("<II")
+
+KIND_TASK, KIND_INSTANT, KIND_COUNTER, KIND_BEGIN, KIND_END = range(5)
+
+PID = 1
+SLICE_TID_BASE = 100        # Start/end tracks, after the core tracks
+
+
+def _name(raw):
+    return raw.split(b"\0", 1)[0].decode("ascii", "replace")
+
+
+def parse(data):
+    magic, version, num_cores, num_ids, timestamp_hz = HEADER.unpack_from(data, 0)
+    if magic != b"OTTR" or version != 1:
+        raise ValueError(f"Not a trace dump (magic {magic!r}, version {version})")
+    offset = HEADER.size
+
+    num_records = struct.unpack_from(f"<{num_cores}I", data, offset)
+    offset += 4 * num_cores
+
+    events = []
+    for _ in range(num_ids):
+        kind, scale, label = EVENT.unpack_from(data, offset)
+        events.append((kind, scale, _name(label)))
+        offset += EVENT.size
+
+    tasks = {}
+    while True:
+        number, name = TASK.unpack_from(data, offset)
+        offset += TASK.size
+        if number == 0:
+            break
+        tasks[number] = _name(name)
+
+    records = []
+    for core in range(num_cores):
+        for _ in range(num_records[core]):
+            timestamp, word = RECORD.unpack_from(data, offset)
+            offset += RECORD.size
+            arg = word & 0xFFFFFF
+            if arg & 0x800000:
+                arg -= 1 << 24
+            records.append((timestamp, core, word >> 24, arg))
+
+    return timestamp_hz, events, tasks, records
+
+
+def convert(timestamp_hz, events, tasks, records):
+    if not records:
+        return {"traceEvents": []}
+
+    # The timestamp is 32 bits, count back from the newest record so a wrap in between does not matter
+    newest = max(timestamp for timestamp, _, _, _ in records)
+    unwrapped = []
+    for timestamp, core, event_id, arg in records:
+        delta = (timestamp - newest) & 0xFFFFFFFF
+        if delta & 0x80000000:
+            delta -= 1 << 32
+        unwrapped.append((delta, core, event_id, arg))
+    unwrapped.sort(key=lambda record: record[0])
+    origin = unwrapped[0][0]
+
+    def us(ticks):
+        return (ticks - origin) * 1e6 / timestamp_hz
+
+    cores = sorted({core for _, core, _, _ in unwrapped})
+    labels = sorted({label for kind, _, label in events if kind in (KIND_BEGIN, KIND_END)})
+    slice_tids = {label: SLICE_TID_BASE + idx for idx, label in enumerate(labels)}
+
+    out = [{"ph": "M", "pid": PID, "name": "process_name", "args": {"name": "OpenTrickler"}}]
+    for core in cores:
+        out.append({"ph": "M", "pid": PID, "tid": core, "name": "thread_name", "args": {"name": f"Core {core}"}})
+    for label, tid in slice_tids.items():
+        out.append({"ph": "M", "pid": PID, "tid": tid, "name": "thread_name", "args": {"name": label}})
+
+    running = {}        # core: (start, task name)
+    for ticks, core, event_id, arg in unwrapped:
+        if event_id >= len(events):
+            continue
+        kind, scale, label = events[event_id]
+        ts = us(ticks)
+        value = arg / scale
+
+        if kind == KIND_TASK:
+            if core in running:
+                start, name = running[core]
+                out.append({"ph": "X", "pid": PID, "tid": core, "name": name, "ts": start, "dur": ts - start})
+            running[core] = (ts, tasks.get(arg, f"task {arg}"))
+        elif kind == KIND_COUNTER:
+            out.append({"ph": "C", "pid": PID, "name": label, "ts": ts, "args": {label: value}})
+        elif kind == KIND_INSTANT:
+            out.append({"ph": "i", "s": "t", "pid": PID, "tid": core, "name": label, "ts": ts, "args": {"value": value}})
+        elif kind == KIND_BEGIN:
+            out.append({"ph": "B", "pid": PID, "tid": slice_tids[label], "name": label, "ts": ts,
+                        "args": {"value": value, "core": core}})
+        elif kind == KIND_END:
+            out.append({"ph": "E", "pid": PID, "tid": slice_tids[label], "ts": ts, "args": {"value": value}})
+
+    # Tasks still running when the dump was taken
+    end = us(unwrapped[-1][0])
+    for core, (start, name) in running.items():
+        out.append({"ph": "X", "pid": PID, "tid": core, "name": name, "ts": start, "dur": end - start})
+
+    return {"traceEvents": out, "displayTimeUnit": "ms"}
+
+
+def main(host, port, input_path, output_path):
+    if input_path:
+        with open(input_path, "rb") as f:
+            data = f.read()
+    else:
+        with urllib.request.urlopen(f"http://{host}:{port}/rest/trace", timeout=10) as response:
+            data = response.read()
+
+    timestamp_hz, events, tasks, records = parse(data)
+    with open(output_path, "w") as f:
+        json.dump(convert(timestamp_hz, events, tasks, records), f)
+
+    print(f"{len(records)} records, {len(tasks)} tasks written to {output_path}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Convert the OpenTrickler trace dump into Chrome trace JSON")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--host", help="OpenTrickler IP address or host name, the dump is downloaded")
+    source.add_argument("--input", help="Dump saved from /rest/trace")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("-o", "--output", default="trace.json", help="Chrome trace JSON file")
+    args = parser.parse_args()
+
+    main(args.host, args.port, args.input, args.output)
@@ -3,10 +3,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-extern "C" {
-#include "error.h"
-}
-
 // TODO: Integrate CMSIS DSP for core algorithm
 
 float FloatRingBuffer::getSd(void){
@@ -40,27 +36,11 @@ float FloatRingBuffer::getMean(void){
 }
 
 
-FloatRingBuffer::FloatRingBuffer(const size_t size)
-    :buffer_size(size > 0 ? size : 1)  // Ensure minimum size of 1 to prevent division by zero
+FloatRingBuffer::FloatRingBuffer(float *storage, const size_t size)
+    :buffer_size(size),
+     data(storage)
 {
     reset();
-
-    // container
-    // data = new T[buffer_size];
-
-    // use c styled memory allocation instead
-    data = (float *)malloc(buffer_size * sizeof(float));
-    if (data == NULL) {
-        report_error(ERR_MEMORY_ALLOC);
-        // Set buffer_size to 0 to indicate failed state
-        // Methods will need to check this
-    }
-}
-
-FloatRingBuffer::~FloatRingBuffer()
-{
-    // delete[] data;
-    free(data);
 }
 
 bool FloatRingBuffer::isLocked()
@@ -28,8 +28,7 @@ protected:
     
     
 public:
-    FloatRingBuffer(const size_t size);
-    ~FloatRingBuffer();
+    FloatRingBuffer(float *storage, const size_t size);     // Uses the caller's storage, nothing is allocated
     
     // psudo mutex
     bool isLocked();
@@ -64,4 +63,17 @@ public:
 
 };
 
+
+// Ring buffer with its storage inline, for buffers that live on a task stack
+template<size_t N>
+class StaticFloatRingBuffer : public FloatRingBuffer
+{
+private:
+    static_assert(N > 0, "The ring buffer needs at least one sample");
+    float storage[N];
+
+public:
+    StaticFloatRingBuffer() : FloatRingBuffer(storage, N) {}
+};
+
 #endif // FLOATRINGBUFFER_H_
\ No newline at end of file
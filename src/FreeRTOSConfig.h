@@ -35,7 +35,10 @@
 #define configMESSAGE_BUFFER_LENGTH_TYPE        size_t
 
 /* Memory allocation related definitions. */
-#define configSUPPORT_STATIC_ALLOCATION         0
+/* Long-lived tasks, queues and semaphores are statically allocated, their storage shows in the map file.
+   The heap is left to lwIP (tcpip thread 16KB, mailboxes), the cyw43 async context and short-lived
+   tasks such as Motor Init (8KB). Check opentrickler_heap_min_free_bytes on /metrics before shrinking it. */
+#define configSUPPORT_STATIC_ALLOCATION         1
 #define configSUPPORT_DYNAMIC_ALLOCATION        1
 /* RP2350 has 520KB RAM vs RP2040's 264KB - use larger heap on RP2350 */
 #if defined(PICO_RP2350) || defined(RASPBERRYPI_PICO2_W) || defined(RASPBERRYPI_PICO2)
@@ -51,10 +54,19 @@
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           1
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
+/* Run time counted in microseconds of the 1 MHz system timer, 64 bits so it does not wrap. The timer is
+   always running, nothing to configure. */
+#ifndef __ASSEMBLER__
+#include "hardware/timer.h"
+#endif
+#define configRUN_TIME_COUNTER_TYPE             uint64_t
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()        time_us_64()
+
 /* Co-routine related definitions. */
 #define configUSE_CO_ROUTINES                   0
 #define configMAX_CO_ROUTINE_PRIORITIES         1
@@ -107,4 +119,16 @@
 #define configMAX_SYSCALL_INTERRUPT_PRIORITY    16
 #define configENABLE_FPU                        1
 
+/* Trace points (trace.h). The task number is the xTaskNumber uxTaskGetSystemState() reports. */
+#if defined( TRACE_ENABLED ) && TRACE_ENABLED && !defined( __ASSEMBLER__ )
+void trace_task_created( uint32_t task_number, const char * name );
+void trace_task_switched_in( uint32_t task_number );
+#define traceTASK_CREATE( pxNewTCB )            trace_task_created( ( pxNewTCB )->uxTCBNumber, ( pxNewTCB )->pcTaskName )
+#if ( configNUMBER_OF_CORES > 1 )
+#define traceTASK_SWITCHED_IN()                 trace_task_switched_in( pxCurrentTCBs[ portGET_CORE_ID() ]->uxTCBNumber )
+#else
+#define traceTASK_SWITCHED_IN()                 trace_task_switched_in( pxCurrentTCB->uxTCBNumber )
+#endif
+#endif
+
 #endif /* FREERTOS_CONFIG_H */
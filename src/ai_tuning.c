@@ -3,6 +3,8 @@
 #include "charge_mode.h"
 #include "eeprom.h"
 #include "profile.h"
+#include "deferred_log.h"
+#include "ui_events.h"
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
@@ -260,6 +262,7 @@ bool ai_tuning_start(profile_t* profile) {
     printf("  - Leverages RP2350 FPU for fast matrix ops\n");
     printf("========================================================\n\n");
 
+    ui_events_publish(UI_EVENT_AI_TUNING, (uint8_t) g_session.state, 0);
     return true;
 }
 
@@ -315,6 +318,7 @@ bool ai_tuning_record_drop(const ai_drop_telemetry_t* telemetry) {
         g_session.recommended_coarse_kd = g_session.coarse_kd_best;
         g_session.recommended_fine_kp = g_session.fine_kp_best;
         g_session.recommended_fine_kd = g_session.fine_kd_best;
+        ui_events_publish(UI_EVENT_AI_TUNING, (uint8_t) g_session.state, 0);
         return false;
     }
 
@@ -326,14 +330,10 @@ bool ai_tuning_record_drop(const ai_drop_telemetry_t* telemetry) {
     // Calculate score for GP
     float score = calculate_score(telemetry);
 
-    printf("\n------------------------------------------------\n");
-    printf("Drop %d completed (score: %.1f)\n", g_session.drops_completed, score);
-    printf("------------------------------------------------\n");
-    printf("Coarse: Kp=%.3f, Kd=%.3f (range 0-1)\n", telemetry->coarse_kp_used, telemetry->coarse_kd_used);
-    printf("Fine:   Kp=%.2f, Kd=%.2f (range 0-10)\n", telemetry->fine_kp_used, telemetry->fine_kd_used);
-    printf("Overthrow: %.3f gr (%.2f%%)\n", telemetry->overthrow, telemetry->overthrow_percent);
-    printf("Time: %.0f ms (coarse: %.0f ms)\n", telemetry->total_time_ms, telemetry->coarse_time_ms);
-    printf("------------------------------------------------\n");
+    DLOG4(AI_DROP_DONE, g_session.drops_completed, DLOG_F(score), DLOG_F(telemetry->total_time_ms), DLOG_F(telemetry->coarse_time_ms));
+    DLOG2(AI_DROP_COARSE, DLOG_F(telemetry->coarse_kp_used), DLOG_F(telemetry->coarse_kd_used));
+    DLOG2(AI_DROP_FINE, DLOG_F(telemetry->fine_kp_used), DLOG_F(telemetry->fine_kd_used));
+    DLOG2(AI_DROP_OVERTHROW, DLOG_F(telemetry->overthrow), DLOG_F(telemetry->overthrow_percent));
 
     if (g_session.state == AI_TUNING_PHASE_1_COARSE) {
         // Add to GP model for coarse
@@ -352,6 +352,7 @@ bool ai_tuning_record_drop(const ai_drop_telemetry_t* telemetry) {
         calculate_next_params_phase2(telemetry);
     }
 
+    ui_events_publish(UI_EVENT_AI_TUNING, (uint8_t) g_session.state, 0);
     return true;
 }
 
@@ -369,9 +370,8 @@ static void calculate_next_params_phase1(const ai_drop_telemetry_t* drop) {
     bool has_overthrow = (drop->overthrow > coarse_threshold);
     bool time_ok = (drop->coarse_time_ms <= target_time_ms);
 
-    printf("Phase 1 [%s]: overthrow=%.3f (thr=%.3f), time=%.0fms\n",
-           g_coarse_tuning_phase == TUNING_PHASE_GP_REFINE ? "GP" : "Adaptive",
-           drop->overthrow, coarse_threshold, drop->coarse_time_ms);
+    DLOG4(AI_PHASE1_DROP, DLOG_S(g_coarse_tuning_phase == TUNING_PHASE_GP_REFINE ? "GP" : "Adaptive"),
+          DLOG_F(drop->overthrow), DLOG_F(coarse_threshold), DLOG_F(drop->coarse_time_ms));
 
     if (g_coarse_tuning_phase == TUNING_PHASE_GP_REFINE) {
         // GP refinement phase
@@ -416,25 +416,24 @@ static void calculate_next_params_phase1(const ai_drop_telemetry_t* drop) {
                 g_coarse_kp_step /= 2.0f;
                 if (g_coarse_kp_step < COARSE_MIN_STEP) g_coarse_kp_step = COARSE_MIN_STEP;
 
-                printf("  Overthrow! Back off Kp to %.3f, step=%.3f\n",
-                       g_session.coarse_kp_best, g_coarse_kp_step);
+                DLOG2(AI_KP_BACK_OFF, DLOG_F(g_session.coarse_kp_best), DLOG_F(g_coarse_kp_step));
 
                 g_session.coarse_kp_best += g_coarse_kp_step;
             } else {
                 // Switch to Kd tuning
-                printf("  Kp converged at %.3f, tuning Kd...\n", g_session.coarse_kp_best);
+                DLOG1(AI_KP_CONVERGED, DLOG_F(g_session.coarse_kp_best));
                 g_coarse_tuning_phase = TUNING_PHASE_ADAPTIVE_KD;
                 g_session.coarse_kd_best += g_coarse_kd_step;
             }
         } else {
             // No overthrow - increase Kp
             g_session.coarse_kp_best += g_coarse_kp_step;
-            printf("  No overthrow, Kp -> %.3f\n", g_session.coarse_kp_best);
+            DLOG1(AI_KP_INCREASE, DLOG_F(g_session.coarse_kp_best));
 
             // Check if hit max
             if (g_session.coarse_kp_best >= COARSE_KP_MAX) {
                 g_session.coarse_kp_best = COARSE_KP_MAX;
-                printf("  Hit max Kp, switching to Kd tuning\n");
+                DLOG0(AI_KP_MAX);
                 g_coarse_tuning_phase = TUNING_PHASE_ADAPTIVE_KD;
             }
         }
@@ -444,8 +443,7 @@ static void calculate_next_params_phase1(const ai_drop_telemetry_t* drop) {
 
         if (overthrow_ok && time_ok) {
             // Adaptive done - start GP refinement
-            printf("\n  Adaptive coarse tuning found baseline.\n");
-            printf("  Starting GP refinement to optimize Kp×Kd...\n\n");
+            DLOG1(AI_GP_START, DLOG_S("coarse"));
 
             g_session.coarse_kp_best = fminf(g_session.coarse_kp_best, COARSE_KP_MAX);
             g_session.coarse_kd_best = fminf(g_session.coarse_kd_best, COARSE_KD_MAX);
@@ -456,19 +454,19 @@ static void calculate_next_params_phase1(const ai_drop_telemetry_t* drop) {
         else if (!overthrow_ok) {
             // Still overthrowing - increase Kd
             g_session.coarse_kd_best += g_coarse_kd_step;
-            printf("  Still overthrow, Kd -> %.3f\n", g_session.coarse_kd_best);
+            DLOG2(AI_KD_CHANGE, DLOG_S("Still overthrow"), DLOG_F(g_session.coarse_kd_best));
 
             if (g_session.coarse_kd_best >= COARSE_KD_MAX) {
                 // Hit Kd limit - go to GP refinement anyway
                 g_session.coarse_kd_best = COARSE_KD_MAX;
-                printf("  Hit max Kd, starting GP refinement...\n");
+                DLOG0(AI_KD_MAX);
                 g_coarse_tuning_phase = TUNING_PHASE_GP_REFINE;
             }
         }
         else {
             // Time too slow - need more Kp
             g_session.coarse_kp_best += COARSE_MIN_STEP;
-            printf("  Time slow, Kp -> %.3f\n", g_session.coarse_kp_best);
+            DLOG2(AI_TIME_SLOW, DLOG_F(drop->coarse_time_ms), DLOG_F(g_session.coarse_kp_best));
         }
     }
 
@@ -492,9 +490,8 @@ static void calculate_next_params_phase2(const ai_drop_telemetry_t* drop) {
     bool overthrow_acceptable = (fabsf(drop->overthrow_percent) <= max_overthrow_percent);
     bool time_ok = (drop->total_time_ms <= target_time_ms);
 
-    printf("Phase 2 [%s]: overthrow=%.2f%% (max=%.1f%%), time=%.0fms\n",
-           g_fine_tuning_phase == TUNING_PHASE_GP_REFINE ? "GP" : "Adaptive",
-           drop->overthrow_percent, max_overthrow_percent, drop->total_time_ms);
+    DLOG4(AI_PHASE2_DROP, DLOG_S(g_fine_tuning_phase == TUNING_PHASE_GP_REFINE ? "GP" : "Adaptive"),
+          DLOG_F(drop->overthrow_percent), DLOG_F(max_overthrow_percent), DLOG_F(drop->total_time_ms));
 
     if (g_fine_tuning_phase == TUNING_PHASE_GP_REFINE) {
         // GP refinement phase
@@ -525,24 +522,23 @@ static void calculate_next_params_phase2(const ai_drop_telemetry_t* drop) {
                 g_fine_kp_step /= 2.0f;
                 if (g_fine_kp_step < FINE_MIN_STEP) g_fine_kp_step = FINE_MIN_STEP;
 
-                printf("  Overthrow! Back off Kp to %.2f, step=%.2f\n",
-                       g_session.fine_kp_best, g_fine_kp_step);
+                DLOG2(AI_KP_BACK_OFF, DLOG_F(g_session.fine_kp_best), DLOG_F(g_fine_kp_step));
 
                 g_session.fine_kp_best += g_fine_kp_step;
             } else {
                 // Switch to Kd tuning
-                printf("  Kp converged at %.2f, tuning Kd...\n", g_session.fine_kp_best);
+                DLOG1(AI_KP_CONVERGED, DLOG_F(g_session.fine_kp_best));
                 g_fine_tuning_phase = TUNING_PHASE_ADAPTIVE_KD;
                 g_session.fine_kd_best += g_fine_kd_step;
             }
         } else {
             // No overthrow - increase Kp
             g_session.fine_kp_best += g_fine_kp_step;
-            printf("  No overthrow, Kp -> %.2f\n", g_session.fine_kp_best);
+            DLOG1(AI_KP_INCREASE, DLOG_F(g_session.fine_kp_best));
 
             if (g_session.fine_kp_best >= FINE_KP_MAX) {
                 g_session.fine_kp_best = FINE_KP_MAX;
-                printf("  Hit max Kp, switching to Kd tuning\n");
+                DLOG0(AI_KP_MAX);
                 g_fine_tuning_phase = TUNING_PHASE_ADAPTIVE_KD;
             }
         }
@@ -550,8 +546,7 @@ static void calculate_next_params_phase2(const ai_drop_telemetry_t* drop) {
     else if (g_fine_tuning_phase == TUNING_PHASE_ADAPTIVE_KD) {
         if (overthrow_acceptable && time_ok) {
             // Adaptive done - start GP refinement
-            printf("\n  Adaptive fine tuning found baseline.\n");
-            printf("  Starting GP refinement to optimize Kp×Kd...\n\n");
+            DLOG1(AI_GP_START, DLOG_S("fine"));
 
             g_session.fine_kp_best = fminf(g_session.fine_kp_best, FINE_KP_MAX);
             g_session.fine_kd_best = fminf(g_session.fine_kd_best, FINE_KD_MAX);
@@ -562,26 +557,24 @@ static void calculate_next_params_phase2(const ai_drop_telemetry_t* drop) {
         else if (!overthrow_acceptable && has_overthrow) {
             // Still overthrowing too much - increase Kd
             g_session.fine_kd_best += g_fine_kd_step;
-            printf("  Overthrow high (%.2f%%), Kd -> %.2f\n",
-                   drop->overthrow_percent, g_session.fine_kd_best);
+            DLOG2(AI_KD_OVERTHROW, DLOG_F(drop->overthrow_percent), DLOG_F(g_session.fine_kd_best));
 
             if (g_session.fine_kd_best >= FINE_KD_MAX) {
                 g_session.fine_kd_best = FINE_KD_MAX;
-                printf("  Hit max Kd, starting GP refinement...\n");
+                DLOG0(AI_KD_MAX);
                 g_fine_tuning_phase = TUNING_PHASE_GP_REFINE;
             }
         }
         else if (!time_ok) {
             // Time too slow
             g_session.fine_kp_best += FINE_MIN_STEP;
-            printf("  Time slow (%.0fms), Kp -> %.2f\n",
-                   drop->total_time_ms, g_session.fine_kp_best);
+            DLOG2(AI_TIME_SLOW, DLOG_F(drop->total_time_ms), DLOG_F(g_session.fine_kp_best));
         }
         else {
             // Underthrow - reduce Kd slightly
             if (g_session.fine_kd_best > FINE_MIN_STEP) {
                 g_session.fine_kd_best -= FINE_MIN_STEP;
-                printf("  Underthrow, Kd -> %.2f\n", g_session.fine_kd_best);
+                DLOG2(AI_KD_CHANGE, DLOG_S("Underthrow"), DLOG_F(g_session.fine_kd_best));
             }
         }
     }
@@ -669,6 +662,7 @@ bool ai_tuning_apply_params(void) {
            g_session.target_profile->fine_kp, g_session.target_profile->fine_kd);
 
     g_session.state = AI_TUNING_IDLE;
+    ui_events_publish(UI_EVENT_AI_TUNING, (uint8_t) g_session.state, 0);
 
     return true;
 }
@@ -677,6 +671,7 @@ void ai_tuning_cancel(void) {
     printf("AI Tuning: Session cancelled\n");
     g_session.state = AI_TUNING_IDLE;
     memset(&g_session, 0, sizeof(ai_tuning_session_t));
+    ui_events_publish(UI_EVENT_AI_TUNING, (uint8_t) g_session.state, 0);
 }
 
 bool ai_tuning_is_active(void) {
@@ -760,8 +755,7 @@ void ai_tuning_record_charge(uint8_t profile_idx,
         g_history.count++;
     }
 
-    printf("AI ML: Recorded drop #%d (overthrow=%.3f, time=%.0fms)\n",
-           g_history.count, overthrow, coarse_time_ms + fine_time_ms);
+    DLOG3(AI_ML_DROP, g_history.count, DLOG_F(overthrow), DLOG_F(coarse_time_ms + fine_time_ms));
 
     // Auto-calculate refinements when we have enough data
     if (g_history.count >= 3) {
@@ -11,6 +11,7 @@
 #include "configuration.h"
 #include "scale.h"
 #include "app.h"
+#include "scale_frame.h"
 
 
 typedef union {
@@ -42,51 +43,23 @@ static float _decode_measurement_msg(scale_standard_data_format_t * msg) {
     // Decode header
     // Doesn't really matter though..
 
-    // Decode weight information
-    char *endptr;
-    float weight = strtof(msg->data, &endptr);
-
-    if( endptr == msg->data ) {
-        // Conversion failed
-        return nanf(msg->data);
-    }
-
-    return weight;
+    // Decode weight information, the sign is part of the field
+    return scale_frame_parse_weight(msg->data, sizeof(msg->data), '+');
 }
 
 
 void _and_scale_listener_task(void *p) {
-    uint8_t string_buf_idx = 0;
     scale_standard_data_format_t frame;
+    scale_frame_reader_t reader;
+    scale_frame_reader_init(&reader, &frame, sizeof(frame), SCALE_FRAME_NO_HEADER);
 
     while (true) {
-        // Read all data 
-        while (uart_is_readable(SCALE_UART)) {
-            char ch = uart_getc(SCALE_UART);
-
-            frame.bytes[string_buf_idx++] = ch;
-
-            // If we have received 17 bytes then we can decode the message
-            if (string_buf_idx == sizeof(scale_standard_data_format_t)) {
-                // Data is ready, send to decode
-                scale_config.current_scale_measurement = _decode_measurement_msg(&frame);
-
-                // Signal the data is ready
-                if (scale_config.scale_measurement_ready) {
-                    xSemaphoreGive(scale_config.scale_measurement_ready);
-                }
-
-                // Reset
-                string_buf_idx = 0;
-            }
-
-            // \n is the terminator. We shall reset the receive of message on receiving any of those character.
-            if (ch =='\n') {
-                string_buf_idx = 0;
-            }
+        // Decode every frame received so far
+        while (scale_frame_read(&reader, HAL_UART_SCALE)) {
+            scale_update_measurement(_decode_measurement_msg(&frame));
         }
 
-        vTaskDelay(pdMS_TO_TICKS(20));
+        hal_delay_ms(20);
     }
 }
 
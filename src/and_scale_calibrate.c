@@ -23,6 +23,8 @@ char line2[32] = "";
 bool show_next_key = false;
 
 TaskHandle_t scale_calibration_render_task_handler = NULL;
+static StackType_t scale_calibration_render_task_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t scale_calibration_render_task_buffer;
 
 
 extern void scale_press_cal_key();
@@ -71,8 +73,9 @@ void scale_calibration_render_task(void *p) {
 uint8_t scale_calibrate_with_external_weight() {
     if (scale_calibration_render_task_handler == NULL) {
         UBaseType_t current_task_priority = uxTaskPriorityGet(xTaskGetCurrentTaskHandle());
-        BaseType_t task_created = xTaskCreate(scale_calibration_render_task, "Scale Measurement Render Task", configMINIMAL_STACK_SIZE, NULL, current_task_priority - 1, &scale_calibration_render_task_handler);
-        if (task_created != pdPASS) {
+        scale_calibration_render_task_handler = xTaskCreateStatic(scale_calibration_render_task, "Scale Measurement Render Task", configMINIMAL_STACK_SIZE, NULL, current_task_priority - 1,
+                                                                  scale_calibration_render_task_stack, &scale_calibration_render_task_buffer);
+        if (scale_calibration_render_task_handler == NULL) {
             report_error(ERR_CALIBRATE_TASK_CREATE);
             return 37;  // Return to menu
         }
@@ -18,6 +18,8 @@
 #include "rest_endpoints.h"
 #include "wireless.h"
 #include "error.h"
+#include "deferred_log.h"
+#include "metrics.h"
 #include "eeprom.h"
 #include "neopixel_led.h"
 #include "scale.h"
@@ -31,6 +33,7 @@
 #endif
 #include "menu.h"
 #include "motors.h"
+#include "boot.h"
 
 extern "C" {
 #include "dhcpserver.h"
@@ -44,24 +47,10 @@ extern "C" {
 // Global for DHCP/DNS servers
 static dhcp_server_t dhcp_server;
 static dns_server_t dns_server;
+static bool wifi_initialized = false;
 static bool connected_to_home = false;
 static bool need_reboot = false;
 
-// Simple task for WiFi maintenance and reboot handling
-void simple_wifi_task(void *params) {
-    (void)params;
-    printf("Simple WiFi task started\n");
-    while (1) {
-        if (need_reboot) {
-            printf("Rebooting...\n");
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            watchdog_reboot(0, 0, 0);
-            while(1);
-        }
-        vTaskDelay(pdMS_TO_TICKS(500));
-    }
-}
-
 static uint32_t get_cyw43_auth(uint32_t auth_method) {
     switch (auth_method) {
         case 0: return CYW43_AUTH_OPEN;
@@ -72,175 +61,205 @@ static uint32_t get_cyw43_auth(uint32_t auth_method) {
     }
 }
 
-int main()
-{
-    stdio_init_all();
-    error_system_init();
-
-    printf("\n=== OpenTrickler v1.17 ===\n");
-
-    bool has_saved_creds = wireless_config_init();
-
-    if (cyw43_arch_init()) {
-        printf("WiFi init FAILED!\n");
-        report_error(ERR_WIFI_INIT_FAIL);
-    } else {
-        printf("WiFi init OK\n");
-
-        connected_to_home = false;
-        if (has_saved_creds && home_wifi_enabled && strlen(home_ssid) > 0) {
-            printf("Connecting to home WiFi: %s\n", home_ssid);
-            cyw43_arch_enable_sta_mode();
-
-            // Use async connect with manual polling for better stability
-            int err = cyw43_arch_wifi_connect_async(
-                home_ssid, home_password,
-                get_cyw43_auth(home_auth_method));
-
-            if (err == 0) {
-                // Poll for connection status
-                uint32_t start_ms = to_ms_since_boot(get_absolute_time());
-                int status = CYW43_LINK_DOWN;
-
-                while ((to_ms_since_boot(get_absolute_time()) - start_ms) < home_timeout_ms) {
-                    status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
-
-                    if (status == CYW43_LINK_UP) {
-                        // Connected with IP address
-                        printf("Connected! IP: %s\n", ip4addr_ntoa(netif_ip4_addr(netif_list)));
-                        connected_to_home = true;
-                        break;
-                    } else if (status < 0) {
-                        // Connection failed (FAIL, NONET, or BADAUTH)
-                        printf("Connection failed (status %d)\n", status);
-                        break;
-                    }
-
-                    // Small delay to allow DHCP and other tasks to run
-                    sleep_ms(100);
-                }
 
-                if (!connected_to_home) {
-                    printf("WiFi timeout/failed (status %d), starting AP\n", status);
-                    cyw43_arch_disable_sta_mode();
-                }
-            } else {
-                printf("WiFi async connect failed (err %d), starting AP\n", err);
-                cyw43_arch_disable_sta_mode();
-            }
-        }
-
-        if (!connected_to_home) {
-            printf("Starting AP: %s\n", WIFI_AP_SSID);
-            cyw43_arch_enable_ap_mode(WIFI_AP_SSID, WIFI_AP_PASSWORD, CYW43_AUTH_WPA2_AES_PSK);
-
-            ip4_addr_t gw, mask;
-            IP4_ADDR(&gw, 192, 168, 4, 1);
-            IP4_ADDR(&mask, 255, 255, 255, 0);
-            dhcp_server_init(&dhcp_server, &gw, &mask);
-            dns_server_init(&dns_server, &gw);
-        }
-
-        rest_endpoints_init(connected_to_home);
-        httpd_init();
-        printf("HTTP server started\n");
-    }
+// Boot stages, see boot.h
 
-    // EEPROM init
+static bool boot_eeprom(void) {
     if (!eeprom_init()) {
-        printf("EEPROM init FAILED!\n");
-        report_error(ERR_EEPROM_I2C_INIT);
-    } else {
-        printf("EEPROM init OK\n");
-        error_set_eeprom_ready(true);
+        return false;
     }
+    error_set_eeprom_ready(true);
+    return true;
+}
 
-    // Neopixel init
+static bool boot_neopixel(void) {
     if (!neopixel_led_init()) {
-        printf("Neopixel init FAILED!\n");
-        report_error(ERR_NEOPIXEL_PIO_INIT);
-    } else {
-        printf("Neopixel init OK\n");
-        error_set_neopixel_ready(true);
-    }
-
-    // Display config init (load display type, rotation, brightness from EEPROM)
-    if (!display_config_init()) {
-        printf("Display config init FAILED!\n");
-    } else {
-        printf("Display config init OK\n");
+        return false;
     }
+    error_set_neopixel_ready(true);
+    return true;
+}
 
-    // Display init based on configured display type
+// Display init based on the configured display type
+static bool boot_display(void) {
 #ifdef USE_COLOR_TFT
     display_type_t display_type = display_config_get_type();
     if (display_type == DISPLAY_TYPE_TFT35 || display_type == DISPLAY_TYPE_TFT43) {
-        // TFT35/TFT43 display init
         tft35_module_init();
         // Also init rotary encoder (shared with Mini 12864)
         button_init();
-        printf("TFT35/TFT43 init OK\n");
-    } else
+        return true;
+    }
 #endif
-    {
-        // Mini 12864 display init (includes button_init and display_init)
-        if (!mini_12864_module_init()) {
-            printf("Mini 12864 init FAILED!\n");
-            report_error(ERR_DISPLAY_MUTEX_CREATE);
+    // Mini 12864 display init (includes button_init and display_init)
+    return mini_12864_module_init();
+}
+
+static bool boot_wifi_init(void) {
+    wifi_initialized = cyw43_arch_init() == 0;
+    return wifi_initialized;
+}
+
+// Join the home network, or start the access point if there is none or it cannot be joined in time
+static bool boot_wifi_connect(void) {
+    if (!wifi_initialized) {
+        return false;
+    }
+
+    bool has_saved_creds = wireless_config_init();
+
+    connected_to_home = false;
+    if (has_saved_creds && home_wifi_enabled && strlen(home_ssid) > 0) {
+        printf("Connecting to home WiFi: %s\n", home_ssid);
+        cyw43_arch_enable_sta_mode();
+
+        // Use async connect with manual polling for better stability
+        int err = cyw43_arch_wifi_connect_async(
+            home_ssid, home_password,
+            get_cyw43_auth(home_auth_method));
+
+        if (err == 0) {
+            // Poll for connection status, the rest of the firmware is already running
+            uint32_t start_ms = to_ms_since_boot(get_absolute_time());
+            int status = CYW43_LINK_DOWN;
+
+            while ((to_ms_since_boot(get_absolute_time()) - start_ms) < home_timeout_ms) {
+                status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+
+                if (status == CYW43_LINK_UP) {
+                    // Connected with IP address
+                    printf("Connected! IP: %s\n", ip4addr_ntoa(netif_ip4_addr(netif_list)));
+                    connected_to_home = true;
+                    break;
+                } else if (status < 0) {
+                    // Connection failed (FAIL, NONET, or BADAUTH)
+                    printf("Connection failed (status %d)\n", status);
+                    break;
+                }
+
+                vTaskDelay(pdMS_TO_TICKS(100));
+            }
+
+            if (!connected_to_home) {
+                printf("WiFi timeout/failed (status %d), starting AP\n", status);
+                cyw43_arch_disable_sta_mode();
+            }
         } else {
-            printf("Mini 12864 init OK\n");
+            printf("WiFi async connect failed (err %d), starting AP\n", err);
+            cyw43_arch_disable_sta_mode();
         }
     }
 
-    // Scale init
-    if (!scale_init()) {
-        printf("Scale init FAILED!\n");
-        report_error(ERR_SCALE_UART_INIT);
-    } else {
-        printf("Scale init OK\n");
+    if (!connected_to_home) {
+        printf("Starting AP: %s\n", WIFI_AP_SSID);
+        cyw43_arch_enable_ap_mode(WIFI_AP_SSID, WIFI_AP_PASSWORD, CYW43_AUTH_WPA2_AES_PSK);
+
+        ip4_addr_t gw, mask;
+        IP4_ADDR(&gw, 192, 168, 4, 1);
+        IP4_ADDR(&mask, 255, 255, 255, 0);
+        cyw43_arch_lwip_begin();
+        dhcp_server_init(&dhcp_server, &gw, &mask);
+        dns_server_init(&dns_server, &gw);
+        cyw43_arch_lwip_end();
     }
 
-    // Profile init
-    if (!profile_data_init()) {
-        printf("Profile init FAILED!\n");
-        report_error(ERR_PROFILE_EEPROM_READ);
-    } else {
-        printf("Profile init OK\n");
-    }
+    return true;
+}
 
-    // Charge mode init
-    if (!charge_mode_config_init()) {
-        printf("Charge mode init FAILED!\n");
-        report_error(ERR_CHARGE_EEPROM_READ);
-    } else {
-        printf("Charge mode init OK\n");
+static bool boot_http(void) {
+    if (!wifi_initialized) {
+        return false;
     }
 
-    // Servo init
-    if (!servo_gate_init()) {
-        printf("Servo init FAILED!\n");
-        report_error(ERR_SERVO_TASK_CREATE);
-    } else {
-        printf("Servo init OK\n");
-    }
+    rest_endpoints_init(connected_to_home);
+    cyw43_arch_lwip_begin();
+    httpd_init();
+    cyw43_arch_lwip_end();
 
     error_set_wifi_ready(true);
+    return true;
+}
+
+// The graph: stages run in the listed order within their context, after the stages they depend on
+static const boot_stage_t boot_stages[] = {
+    {BOOT_STAGE_EEPROM,         BOOT_CONTEXT_MAIN,      boot_eeprom,                0,                                          ERR_EEPROM_I2C_INIT},
+    {BOOT_STAGE_NEOPIXEL,       BOOT_CONTEXT_MAIN,      boot_neopixel,              BOOT_DEP(EEPROM),                           ERR_NEOPIXEL_PIO_INIT},
+    {BOOT_STAGE_DISPLAY_CONFIG, BOOT_CONTEXT_MAIN,      display_config_init,        BOOT_DEP(EEPROM),                           ERR_NONE},
+    {BOOT_STAGE_DISPLAY,        BOOT_CONTEXT_MAIN,      boot_display,               BOOT_DEP(DISPLAY_CONFIG),                   ERR_DISPLAY_MUTEX_CREATE},
+    {BOOT_STAGE_SCALE,          BOOT_CONTEXT_MAIN,      scale_init,                 BOOT_DEP(EEPROM),                           ERR_SCALE_UART_INIT},
+    {BOOT_STAGE_PROFILE,        BOOT_CONTEXT_MAIN,      profile_data_init,          BOOT_DEP(EEPROM),                           ERR_PROFILE_EEPROM_READ},
+    {BOOT_STAGE_CHARGE_MODE,    BOOT_CONTEXT_MAIN,      charge_mode_config_init,    BOOT_DEP(PROFILE) | BOOT_DEP(SCALE),        ERR_CHARGE_EEPROM_READ},
+    {BOOT_STAGE_SERVO,          BOOT_CONTEXT_MAIN,      servo_gate_init,            BOOT_DEP(EEPROM),                           ERR_SERVO_TASK_CREATE},
+    {BOOT_STAGE_SCHEDULER,      BOOT_CONTEXT_MAIN,      NULL,                       0,                                          ERR_NONE},
+    // WiFi associates while the UI is already running
+    {BOOT_STAGE_WIFI_INIT,      BOOT_CONTEXT_NETWORK,   boot_wifi_init,             0,                                          ERR_WIFI_INIT_FAIL},
+    {BOOT_STAGE_WIFI_CONNECT,   BOOT_CONTEXT_NETWORK,   boot_wifi_connect,          BOOT_DEP(WIFI_INIT),                        ERR_NONE},
+    // REST handlers read the state of every module
+    {BOOT_STAGE_HTTP,           BOOT_CONTEXT_NETWORK,   boot_http,                  BOOT_DEP(WIFI_CONNECT) | BOOT_DEP(SCHEDULER), ERR_NONE},
+    // The driver UART is polled, blocking is fine here. After the cyw43 init, which claims its PIO first
+    {BOOT_STAGE_MOTORS,         BOOT_CONTEXT_MOTORS,    motors_boot,                BOOT_DEP(EEPROM) | BOOT_DEP(WIFI_INIT),     ERR_NONE},
+};
+
+
+// WiFi task: brings up the network, then handles reboot requests
+void simple_wifi_task(void *params) {
+    (void)params;
+    printf("Simple WiFi task started\n");
+
+    boot_run(BOOT_CONTEXT_NETWORK);
+
+    while (1) {
+        if (need_reboot) {
+            printf("Rebooting...\n");
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            watchdog_reboot(0, 0, 0);
+            while(1);
+        }
+        vTaskDelay(pdMS_TO_TICKS(500));
+    }
+}
+
+// Motor Init task, deleted once the motors are up
+static void motor_init_task(void *params) {
+    (void)params;
+
+    boot_run(BOOT_CONTEXT_MOTORS);
+    vTaskDelete(NULL);
+}
+
+int main()
+{
+    stdio_init_all();
+    error_system_init();
+    deferred_log_init();
+    metrics_init();
+    boot_init(boot_stages, count_of(boot_stages));
+
+    printf("\n=== OpenTrickler v1.17 ===\n");
+
+    // Hardware that does not need the network, the UI can start right after
+    boot_run(BOOT_CONTEXT_MAIN);
 
     // Create FreeRTOS tasks
     // WiFi task MUST be pinned to core 0 for stability with cyw43 driver
-    TaskHandle_t wifi_task_handle;
-    xTaskCreate(simple_wifi_task, "WiFi Task", 1024, NULL, 1, &wifi_task_handle);
+    static StackType_t wifi_task_stack[1024];
+    static StaticTask_t wifi_task_buffer;
+    TaskHandle_t wifi_task_handle = xTaskCreateStatic(simple_wifi_task, "WiFi Task", 1024, NULL, 1, wifi_task_stack, &wifi_task_buffer);
     vTaskCoreAffinitySet(wifi_task_handle, (1 << 0));  // Pin to core 0
 
-    // Create UI task based on display type
+    // Create UI task based on display type, only one of them runs so they share the stack
+    static StackType_t ui_task_stack[4096];
+    static StaticTask_t ui_task_buffer;
 #ifdef USE_COLOR_TFT
+    display_type_t display_type = display_config_get_type();
     if (display_type == DISPLAY_TYPE_TFT35 || display_type == DISPLAY_TYPE_TFT43) {
-        xTaskCreate(tft35_lvgl_task, "LVGL Task", 4096, NULL, 2, NULL);
+        xTaskCreateStatic(tft35_lvgl_task, "LVGL Task", 4096, NULL, 2, ui_task_stack, &ui_task_buffer);
     } else
 #endif
     {
-        xTaskCreate(menu_task, "Menu Task", 4096, NULL, 2, NULL);
+        xTaskCreateStatic(menu_task, "Menu Task", 4096, NULL, 2, ui_task_stack, &ui_task_buffer);
     }
+    // Deletes itself once the motors are up, the heap gets the stack back
     xTaskCreate(motor_init_task, "Motor Init", 2048, NULL, 3, NULL);
 
     printf("Starting FreeRTOS scheduler\n");
@@ -0,0 +1,153 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <event_groups.h>
+#include <stdio.h>
+#include "pico/time.h"
+#include "hardware/sync.h"
+
+#include "boot.h"
+
+
+// Event groups have 24 usable bits with a 32 bit tick
+_Static_assert(BOOT_NUM_STAGES <= 24, "Too many boot stages for the event group");
+
+
+typedef struct {
+    uint32_t start_us;                  // Since power on
+    uint32_t duration_us;
+    uint8_t core;
+    volatile uint8_t state;             // boot_stage_state_t, written last
+} boot_stage_record_t;
+
+
+#define BOOT_STAGE_LABEL(name, label)   label,
+
+static const char * const boot_stage_labels[BOOT_NUM_STAGES] = {
+    BOOT_STAGES(BOOT_STAGE_LABEL)
+};
+
+#undef BOOT_STAGE_LABEL
+
+
+static const boot_stage_t * boot_stages = NULL;
+static size_t boot_num_stages = 0;
+static boot_stage_record_t boot_records[BOOT_NUM_STAGES];
+
+// One bit per stage, set when the stage is done (or failed)
+static EventGroupHandle_t boot_done = NULL;
+static StaticEventGroup_t boot_done_buffer;
+
+
+bool boot_init(const boot_stage_t * stages, size_t num_stages) {
+    boot_stages = stages;
+    boot_num_stages = num_stages;
+
+    boot_done = xEventGroupCreateStatic(&boot_done_buffer);
+    return boot_done != NULL;
+}
+
+
+static void _record(boot_stage_id_t id, uint32_t start_us, boot_stage_state_t state) {
+    boot_stage_record_t * record = &boot_records[id];
+    record->start_us = start_us;
+    record->duration_us = time_us_32() - start_us;
+    record->core = get_core_num();
+    __dmb();
+    record->state = state;
+
+    xEventGroupSetBits(boot_done, 1u << id);
+}
+
+
+static void _run_stage(const boot_stage_t * stage) {
+    if (stage->depends) {
+        if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+            xEventGroupWaitBits(boot_done, stage->depends, pdFALSE, pdTRUE, portMAX_DELAY);
+        }
+        else if ((xEventGroupGetBits(boot_done) & stage->depends) != stage->depends) {
+            // The table lists a main() stage before one it depends on
+            printf("Boot: %s runs before its dependencies\n", boot_stage_labels[stage->id]);
+        }
+    }
+
+    uint32_t start_us = time_us_32();
+    boot_records[stage->id].start_us = start_us;
+    boot_records[stage->id].state = BOOT_STAGE_RUNNING;
+
+    bool is_ok = stage->init();
+    _record(stage->id, start_us, is_ok ? BOOT_STAGE_OK : BOOT_STAGE_FAILED);
+
+    printf("Boot: %s %s in %lu ms\n", boot_stage_labels[stage->id], is_ok ? "OK" : "FAILED",
+           (unsigned long) (boot_records[stage->id].duration_us / 1000));
+    if (!is_ok && stage->error != ERR_NONE) {
+        report_error(stage->error);
+    }
+}
+
+
+void boot_run(boot_context_t context) {
+    for (size_t idx = 0; idx < boot_num_stages; idx += 1) {
+        const boot_stage_t * stage = &boot_stages[idx];
+        if (stage->context != context) {
+            continue;
+        }
+
+        if (stage->init) {
+            _run_stage(stage);
+        }
+        else {
+            uint32_t now_us = time_us_32();
+            printf("Boot: %s at %lu ms\n", boot_stage_labels[stage->id], (unsigned long) (now_us / 1000));
+            _record(stage->id, now_us, BOOT_STAGE_OK);
+        }
+    }
+}
+
+
+bool http_rest_boot(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // None
+    //
+    // Response
+    // t (int): Time since power on (ms)
+    // s (array): Stages in the order they are listed, each
+    //      n (str): Name
+    //      x (int): Context, 0: main, 1: network task, 2: motor task
+    //      c (int): Core it ran on
+    //      r (int): State, 0: pending, 1: running, 2: OK, 3: failed
+    //      s (int): Start, time since power on (us)
+    //      d (int): Duration (us), 0 unless done
+    //
+    // The cursor is the index of the next stage to write
+    json_writer_t * json = &response->json;
+
+    if (response->part == 0) {
+        json_begin_object(json);
+        json_add_uint(json, "t", to_ms_since_boot(get_absolute_time()));
+        json_add_array(json, "s");
+        return true;
+    }
+
+    const boot_stage_t * stage = &boot_stages[response->cursor];
+    const boot_stage_record_t * record = &boot_records[stage->id];
+    uint8_t state = record->state;
+    __dmb();
+
+    json_begin_object(json);
+    json_add_string(json, "n", boot_stage_labels[stage->id]);
+    json_add_uint(json, "x", stage->context);
+    json_add_uint(json, "c", record->core);
+    json_add_uint(json, "r", state);
+    json_add_uint(json, "s", record->start_us);
+    json_add_uint(json, "d", state >= BOOT_STAGE_OK ? record->duration_us : 0);
+    json_end_object(json);
+
+    response->cursor += 1;
+    if (response->cursor < boot_num_stages) {
+        return true;
+    }
+
+    json_end_array(json);
+    json_end_object(json);
+    return false;
+}
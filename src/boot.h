@@ -0,0 +1,96 @@
+#ifndef BOOT_H_
+#define BOOT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "error.h"
+#include "http_rest.h"
+
+// Boot sequence
+//
+// Every init step is a stage with the stages it depends on. Stages run in one of a few contexts: main()
+// brings up the hardware before the scheduler starts, so the UI task has everything it needs the moment
+// it runs, while the network (WiFi association can take seconds) and the motors (the drivers are polled
+// over UART) come up in tasks of their own. A stage in a task waits until its dependencies are done,
+// wherever they ran.
+//
+// The start and duration of every stage are kept for GET /rest/boot.
+
+
+//  X(name, label)
+#define BOOT_STAGES(X) \
+    X(EEPROM,           "eeprom") \
+    X(NEOPIXEL,         "neopixel") \
+    X(DISPLAY_CONFIG,   "display_config") \
+    X(DISPLAY,          "display") \
+    X(SCALE,            "scale") \
+    X(PROFILE,          "profile") \
+    X(CHARGE_MODE,      "charge_mode") \
+    X(SERVO,            "servo") \
+    X(SCHEDULER,        "scheduler") \
+    X(WIFI_INIT,        "wifi_init") \
+    X(WIFI_CONNECT,     "wifi_connect") \
+    X(HTTP,             "http") \
+    X(MOTORS,           "motors")
+
+
+#define BOOT_STAGE_ID(name, label)      BOOT_STAGE_##name,
+
+typedef enum {
+    BOOT_STAGES(BOOT_STAGE_ID)
+    BOOT_NUM_STAGES,
+} boot_stage_id_t;
+
+#undef BOOT_STAGE_ID
+
+#define BOOT_DEP(name)                  (1u << BOOT_STAGE_##name)
+
+
+// Where a stage runs
+typedef enum {
+    BOOT_CONTEXT_MAIN = 0,              // main(), before the scheduler starts
+    BOOT_CONTEXT_NETWORK,               // WiFi task, pinned to core 0
+    BOOT_CONTEXT_MOTORS,                // Motor Init task, deleted when done
+} boot_context_t;
+
+typedef enum {
+    BOOT_STAGE_PENDING = 0,
+    BOOT_STAGE_RUNNING,
+    BOOT_STAGE_OK,
+    BOOT_STAGE_FAILED,
+} boot_stage_state_t;
+
+typedef struct {
+    boot_stage_id_t id;
+    boot_context_t context;
+    bool (*init)(void);                 // NULL for a mark, e.g., the scheduler start
+    uint32_t depends;                   // BOOT_DEP() of the stages that shall be done first
+    error_code_t error;                 // Reported when init fails, ERR_NONE if it reports itself
+} boot_stage_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Keep the stage table, called first in main().
+*/
+bool boot_init(const boot_stage_t * stages, size_t num_stages);
+
+/**
+ * Run the stages of a context in table order. Failed stages count as done, the stages depending on
+ * them still run (and fail on their own if they have to).
+*/
+void boot_run(boot_context_t context);
+
+// REST
+bool http_rest_boot(rest_response_t *response, int num_params, char *params[], char *values[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // BOOT_H_
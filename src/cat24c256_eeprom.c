@@ -34,7 +34,7 @@ void cat24c256_eeprom_init() {
 bool _cat24c256_write_page(uint16_t data_addr, uint8_t * data, size_t len){
     // Fixed buffer to avoid VLA stack overflow - max is PAGE_SIZE + 2 bytes for address
     if (len > PAGE_SIZE) {
-        report_error(ERR_EEPROM_INVALID_SIZE);
+        report_error_context(ERR_EEPROM_INVALID_SIZE, len);
         return false;
     }
 
@@ -81,7 +81,7 @@ bool cat24c256_read(uint16_t data_addr, uint8_t * data, size_t len) {
 
     int write_ret = i2c_write_blocking(EEPROM_I2C, EEPROM_ADDR, buf, 2, true);
     if (write_ret == PICO_ERROR_GENERIC) {
-        report_error(ERR_EEPROM_WRITE_FAIL);
+        report_error_context(ERR_EEPROM_WRITE_FAIL, data_addr);
         return false;
     }
 
@@ -100,7 +100,7 @@ bool cat24c256_eeprom_erase() {
     for (size_t page=0; page < 512; page++) {
         size_t page_offset = page * PAGE_SIZE;
         if (!cat24c256_write(page_offset, dummy_buffer, PAGE_SIZE)) {
-            report_error(ERR_EEPROM_WRITE_FAIL);
+            report_error_context(ERR_EEPROM_WRITE_FAIL, page_offset);
             all_ok = false;
         }
     }
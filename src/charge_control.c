@@ -0,0 +1,42 @@
+#include <math.h>
+
+#include "charge_control.h"
+
+
+float charge_control_speed(const charge_control_gains_t * gains, float error, float integral, float derivative) {
+    float new_p = gains->kp * error;
+    float new_i = gains->ki * integral;
+    float new_d = gains->kd * derivative;
+
+    return fmaxf(gains->min_speed, fminf(new_p + new_i + new_d, gains->max_speed));
+}
+
+
+float charge_control_gate_opening(float error, float start_error, float stop_error, float min_opening) {
+    if (start_error <= stop_error) {
+        return 1.0f;
+    }
+
+    // 1.0 at the start error, 0.0 at the coarse stop threshold
+    float position = fminf(fmaxf((error - stop_error) / (start_error - stop_error), 0.0f), 1.0f);
+    min_opening = fminf(fmaxf(min_opening, 0.0f), 1.0f);
+    float opening = min_opening + (1.0f - min_opening) * position;
+
+    return roundf(opening / CHARGE_CONTROL_GATE_OPENING_STEP) * CHARGE_CONTROL_GATE_OPENING_STEP;
+}
+
+
+uint32_t charge_control_outcome(float error, float fine_stop_threshold) {
+    if (error <= -fine_stop_threshold) {
+        return CHARGE_CONTROL_EVENT_OVER_CHARGE;
+    }
+    if (error >= fine_stop_threshold) {
+        return CHARGE_CONTROL_EVENT_UNDER_CHARGE;
+    }
+    return 0;
+}
+
+
+uint32_t charge_control_record_outcome(uint32_t events, uint32_t outcome) {
+    return (events & ~CHARGE_CONTROL_OUTCOME_EVENTS) | (outcome & CHARGE_CONTROL_OUTCOME_EVENTS);
+}
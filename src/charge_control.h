@@ -0,0 +1,70 @@
+#ifndef CHARGE_CONTROL_H_
+#define CHARGE_CONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Charge control law
+//
+// The trickler speeds and the servo gate opening, computed from the error (target - weight) on every
+// scale measurement. Nothing is kept here: charge_mode.cpp owns the integral and the last error, so the
+// same law runs on the device and in the host tests and benchmarks.
+
+
+// Servo gate flow control in the coarse phase
+//
+// The gate is wide open while the error is above the profile's gate_flow_start_error, then closes
+// linearly down to gate_flow_min_opening at the coarse stop threshold, so less powder is in flight when
+// the coarse trickler stops. The coarse speed limit follows the opening, the motor never feeds more than
+// the gate passes. Openings are quantised to steps so the gate is not moved on every measurement.
+#define CHARGE_CONTROL_GATE_OPENING_STEP    0.05f
+
+
+// Outcome of a settled charge, bits of the charge mode event (s3 of /rest/charge_mode_state). A normal
+// charge has no event.
+#define CHARGE_CONTROL_EVENT_UNDER_CHARGE   (1u << 1)
+#define CHARGE_CONTROL_EVENT_OVER_CHARGE    (1u << 2)
+#define CHARGE_CONTROL_OUTCOME_EVENTS       (CHARGE_CONTROL_EVENT_UNDER_CHARGE | CHARGE_CONTROL_EVENT_OVER_CHARGE)
+
+
+typedef struct {
+    float kp;
+    float ki;
+    float kd;
+    float min_speed;                    // rev/s, also the speed while the output is below it
+    float max_speed;
+} charge_control_gains_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * PID output clamped to the speed range of the trickler
+*/
+float charge_control_speed(const charge_control_gains_t * gains, float error, float integral, float derivative);
+
+/**
+ * Gate opening (0: closed, 1: open) for the error in the coarse phase, 1 if start_error is not above
+ * stop_error (the coarse stop threshold)
+*/
+float charge_control_gate_opening(float error, float start_error, float stop_error, float min_opening);
+
+/**
+ * Outcome event of a settled charge with the error, 0 if it is within the fine stop threshold
+*/
+uint32_t charge_control_outcome(float error, float fine_stop_threshold);
+
+/**
+ * Event mask after a charge has settled with the outcome. The outcome of the previous charge is replaced,
+ * other events are kept.
+*/
+uint32_t charge_control_record_outcome(uint32_t events, uint32_t outcome);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // CHARGE_CONTROL_H_
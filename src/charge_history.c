@@ -0,0 +1,211 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hardware/sync.h"
+
+#include "charge_history.h"
+
+
+#define CHARGE_HISTORY_BUCKETS_PER_PART     32
+
+
+static charge_history_bucket_t charge_history_buckets[CHARGE_HISTORY_BUCKETS];
+static charge_history_info_t charge_history_info = {
+    .bucket_ms = CHARGE_HISTORY_BUCKET_MS,
+    .target = NAN,
+    .coarse_stop = NAN,
+    .fine_stop = NAN,
+};
+static TickType_t charge_history_start_tick;
+static float charge_history_last_weight = NAN;
+
+static spin_lock_t * charge_history_lock = NULL;    // The history is read from the lwIP interrupt
+
+
+bool charge_history_init() {
+    charge_history_lock = spin_lock_instance(spin_lock_claim_unused(true));
+    return true;
+}
+
+
+void charge_history_start(float target, float coarse_stop_threshold, float fine_stop_threshold) {
+    if (charge_history_lock == NULL) {
+        return;
+    }
+
+    uint32_t irq_state = spin_lock_blocking(charge_history_lock);
+    charge_history_info.revision += 1;
+    charge_history_info.count = 0;
+    charge_history_info.bucket_ms = CHARGE_HISTORY_BUCKET_MS;
+    charge_history_info.target = target;
+    charge_history_info.coarse_stop = target - coarse_stop_threshold;
+    charge_history_info.fine_stop = target - fine_stop_threshold;
+    charge_history_start_tick = xTaskGetTickCount();
+    charge_history_last_weight = NAN;
+    charge_history_info.active = true;
+    spin_unlock(charge_history_lock, irq_state);
+}
+
+
+void charge_history_stop() {
+    charge_history_info.active = false;
+}
+
+
+// Merge neighbouring buckets in pairs, the bucket width doubles
+static void _merge(void) {
+    uint16_t count = 0;
+
+    for (uint16_t idx = 0; idx < charge_history_info.count; idx += 2) {
+        charge_history_bucket_t bucket = charge_history_buckets[idx];
+        if (idx + 1 < charge_history_info.count) {
+            bucket.min = fminf(bucket.min, charge_history_buckets[idx + 1].min);
+            bucket.max = fmaxf(bucket.max, charge_history_buckets[idx + 1].max);
+        }
+        charge_history_buckets[count] = bucket;
+        count += 1;
+    }
+
+    charge_history_info.count = count;
+    charge_history_info.bucket_ms *= 2;
+    charge_history_info.revision += 1;
+}
+
+
+void charge_history_add(float weight) {
+    if (!charge_history_info.active || !isfinite(weight)) {
+        return;
+    }
+
+    uint32_t elapsed_ms = (xTaskGetTickCount() - charge_history_start_tick) * portTICK_PERIOD_MS;
+
+    uint32_t irq_state = spin_lock_blocking(charge_history_lock);
+    uint32_t idx = elapsed_ms / charge_history_info.bucket_ms;
+    while (idx >= CHARGE_HISTORY_BUCKETS) {
+        _merge();
+        idx = elapsed_ms / charge_history_info.bucket_ms;
+    }
+
+    // Buckets without a measurement hold the last weight, the scale has not reported a change. Before the
+    // first sample of this charge there is no last weight and the gap takes the first one.
+    float fill_weight = isfinite(charge_history_last_weight) ? charge_history_last_weight : weight;
+    while (charge_history_info.count < idx) {
+        charge_history_buckets[charge_history_info.count].min = fill_weight;
+        charge_history_buckets[charge_history_info.count].max = fill_weight;
+        charge_history_info.count += 1;
+    }
+
+    charge_history_bucket_t * bucket = &charge_history_buckets[idx];
+    if (charge_history_info.count == idx) {
+        bucket->min = weight;
+        bucket->max = weight;
+        charge_history_info.count += 1;
+    }
+    else {
+        bucket->min = fminf(bucket->min, weight);
+        bucket->max = fmaxf(bucket->max, weight);
+    }
+    charge_history_last_weight = weight;
+    spin_unlock(charge_history_lock, irq_state);
+}
+
+
+uint16_t charge_history_read(charge_history_info_t * info, uint16_t first, charge_history_bucket_t * buckets, uint16_t max_buckets) {
+    if (charge_history_lock == NULL) {
+        *info = charge_history_info;
+        return 0;
+    }
+
+    uint32_t irq_state = spin_lock_blocking(charge_history_lock);
+    *info = charge_history_info;
+
+    uint16_t num_buckets = 0;
+    if (first < info->count) {
+        num_buckets = info->count - first;
+        if (num_buckets > max_buckets) {
+            num_buckets = max_buckets;
+        }
+        memcpy(buckets, &charge_history_buckets[first], num_buckets * sizeof(charge_history_bucket_t));
+    }
+    spin_unlock(charge_history_lock, irq_state);
+
+    return num_buckets;
+}
+
+
+bool http_rest_charge_history(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // r (int): Revision the client has, e.g., the r of the previous response. Default: none
+    // s (int): First bucket the client needs, e.g., the n of the previous response minus 1. Ignored
+    //          unless r is the current revision. Default: 0
+    //
+    // Response
+    // r (int): Revision, the buckets before s are unchanged as long as it is the same
+    // w (int): Bucket width (ms)
+    // a (bool): A charge is being recorded
+    // t (float): Target weight
+    // c (float): Coarse trickler stop weight
+    // f (float): Fine trickler stop weight
+    // s (int): Index of the first bucket in b
+    // b (array): [min, max] per bucket, oldest first
+    // n (int): Number of buckets, 0 if they were merged while the response was sent (start over)
+    //
+    // The cursor is the next bucket to write, the revision of part 0 is kept in the upper 16 bits
+    json_writer_t * json = &response->json;
+
+    charge_history_info_t info;
+    charge_history_bucket_t buckets[CHARGE_HISTORY_BUCKETS_PER_PART];
+
+    if (response->part == 0) {
+        charge_history_read(&info, 0, buckets, 0);
+
+        uint32_t first = 0;
+        bool same_revision = false;
+        for (int idx = 0; idx < num_params; idx += 1) {
+            if (strcmp(params[idx], "r") == 0) {
+                same_revision = strtoul(values[idx], NULL, 10) == info.revision;
+            }
+            else if (strcmp(params[idx], "s") == 0) {
+                first = strtoul(values[idx], NULL, 10);
+            }
+        }
+        if (!same_revision || first > info.count) {
+            first = 0;
+        }
+
+        json_begin_object(json);
+        json_add_uint(json, "r", info.revision);
+        json_add_uint(json, "w", info.bucket_ms);
+        json_add_bool(json, "a", info.active);
+        json_add_float(json, "t", info.target, 3);
+        json_add_float(json, "c", info.coarse_stop, 3);
+        json_add_float(json, "f", info.fine_stop, 3);
+        json_add_uint(json, "s", first);
+        json_add_array(json, "b");
+        response->cursor = (info.revision << 16) | first;
+        return true;
+    }
+
+    uint16_t first = response->cursor & 0xFFFF;
+    uint16_t num_buckets = charge_history_read(&info, first, buckets, CHARGE_HISTORY_BUCKETS_PER_PART);
+    for (uint16_t idx = 0; idx < num_buckets; idx += 1) {
+        json_begin_array(json);
+        json_float(json, buckets[idx].min, 3);
+        json_float(json, buckets[idx].max, 3);
+        json_end_array(json);
+    }
+    response->cursor += num_buckets;
+
+    if (num_buckets == CHARGE_HISTORY_BUCKETS_PER_PART) {
+        return true;
+    }
+
+    bool merged = (response->cursor >> 16) != (info.revision & 0xFFFF);
+    json_end_array(json);
+    json_add_uint(json, "n", merged ? 0 : first + num_buckets);
+    json_end_object(json);
+
+    return false;
+}
@@ -0,0 +1,77 @@
+#ifndef CHARGE_HISTORY_H_
+#define CHARGE_HISTORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "http_rest.h"
+
+// Decimated weight history of the current charge
+//
+// Every scale measurement from the start of a charge until the cup is removed is folded into a fixed
+// number of time buckets, each keeping the lowest and highest weight seen. When the buckets are full,
+// neighbours are merged in pairs and the bucket width doubles, so the whole charge is always covered
+// by at most CHARGE_HISTORY_BUCKETS buckets.
+//
+// Readers keep the revision and the number of buckets they have. Only the last bucket they have may
+// still change, so a reader only fetches from there on. The revision changes when a charge starts or
+// the buckets are merged, readers then start over from bucket 0.
+//
+// The TFT charge screen and GET /rest/charge_history (html/plot_weight.html) read the same buffer.
+
+
+#define CHARGE_HISTORY_BUCKETS          128
+#define CHARGE_HISTORY_BUCKET_MS        100         // Initial bucket width, covers 12.8 s before the first merge
+
+
+typedef struct {
+    float min;
+    float max;
+} charge_history_bucket_t;
+
+typedef struct {
+    uint32_t revision;
+    uint16_t count;                 // Buckets written, the last one may still change
+    uint32_t bucket_ms;
+    bool active;                    // Measurements are being recorded
+    float target;                   // Target weight, NaN before the first charge
+    float coarse_stop;              // Weight at which the coarse trickler stops
+    float fine_stop;                // Weight at which the fine trickler stops
+} charge_history_info_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool charge_history_init(void);
+
+/**
+ * Start recording a new charge, the previous one is discarded.
+*/
+void charge_history_start(float target, float coarse_stop_threshold, float fine_stop_threshold);
+
+/**
+ * Stop recording, the history is kept until the next charge starts.
+*/
+void charge_history_stop(void);
+
+/**
+ * Add a scale measurement, ignored unless recording. Called from the scale task.
+*/
+void charge_history_add(float weight);
+
+/**
+ * Copy the info and up to max_buckets buckets from first on, returns the number of buckets copied.
+ * Both are taken at the same time, so the buckets match the info.
+*/
+uint16_t charge_history_read(charge_history_info_t * info, uint16_t first, charge_history_bucket_t * buckets, uint16_t max_buckets);
+
+// REST
+bool http_rest_charge_history(rest_response_t *response, int num_params, char *params[], char *values[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // CHARGE_HISTORY_H_
@@ -8,6 +8,7 @@
 #include <semphr.h>
 #include <u8g2.h>
 #include <math.h>
+#include "pico/time.h"
 
 #include "app.h"
 #include "FloatRingBuffer.h"
@@ -22,6 +23,13 @@
 #include "common.h"
 #include "servo_gate.h"
 #include "ai_tuning.h"
+#include "rest_param.h"
+#include "deferred_log.h"
+#include "metrics.h"
+#include "ui_events.h"
+#include "charge_history.h"
+#include "trace.h"
+#include "charge_control.h"
 
 
 uint8_t charge_weight_digits[] = {0, 0, 0, 0, 0};
@@ -62,6 +70,8 @@ const eeprom_charge_mode_data_t default_charge_mode_data = {
 
 // Configures
 TaskHandle_t scale_measurement_render_task_handler = NULL;
+static StackType_t scale_measurement_render_task_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t scale_measurement_render_task_buffer;
 static char title_string[30];
 
 static TickType_t charge_start_tick = 0;
@@ -76,8 +86,8 @@ extern neopixel_led_config_t neopixel_led_config;
 // Definitions
 typedef enum {
     CHARGE_MODE_EVENT_NO_EVENT = (1 << 0),
-    CHARGE_MODE_EVENT_UNDER_CHARGE = (1 << 1),
-    CHARGE_MODE_EVENT_OVER_CHARGE = (1 << 2),
+    CHARGE_MODE_EVENT_UNDER_CHARGE = CHARGE_CONTROL_EVENT_UNDER_CHARGE,
+    CHARGE_MODE_EVENT_OVER_CHARGE = CHARGE_CONTROL_EVENT_OVER_CHARGE,
 } ChargeModeEventBit_t;
 
 
@@ -92,19 +102,67 @@ static void format_elapsed_time(char *buffer, size_t len, TickType_t start_tick)
 }
 
 
+// Servo gate opening in the coarse phase, see charge_control.h
+static float coarse_gate_flow_opening(const profile_t * profile, float error) {
+    if (servo_gate.gate_state == GATE_DISABLED) {
+        return 1.0f;
+    }
+
+    return charge_control_gate_opening(error,
+                                       profile->gate_flow_start_error,
+                                       charge_mode_config.eeprom_charge_mode_data.coarse_stop_threshold,
+                                       profile->gate_flow_min_opening);
+}
+
+
+// Tell the TFT UI about a state change, with the target weight
+static void publish_charge_state(charge_mode_state_t state) {
+    ui_events_publish(UI_EVENT_CHARGE_STATE, (uint8_t) state, charge_mode_config.target_charge_weight);
+}
+
+
+// Report the outcome of the charge to the REST, SSE and WebSocket clients, see charge_mode_take_events().
+// It replaces the outcome of the previous charge, a normal charge only clears it.
+static void _report_outcome(uint32_t outcome) {
+    charge_mode_config.charge_mode_event = charge_control_record_outcome(charge_mode_config.charge_mode_event, outcome);
+    if (outcome != 0) {
+        charge_mode_config.charge_mode_event_seq += 1;
+    }
+}
+
+
 void scale_measurement_render_task(void *p) {
     char current_weight_string[WEIGHT_STRING_LEN];
     char time_buffer[16];
 
     u8g2_t *display_handler = get_display_handler();
+    uint8_t screen_width = u8g2_GetDisplayWidth(display_handler);
 
-    while (true) {
-        TickType_t last_render_tick = xTaskGetTickCount();
-
-        u8g2_ClearBuffer(display_handler);
+    // Title on the left, timer on the right edge (5 px padding), weight and profile name below
+    display_field_t title_field, timer_field, weight_field, profile_field;
+    display_field_init(&title_field, u8g2_font_helvB08_tr, 5, 10, DISPLAY_ALIGN_LEFT);
+    display_field_init(&timer_field, u8g2_font_helvB08_tr, screen_width - 5, 10, DISPLAY_ALIGN_RIGHT);
+    display_field_init(&weight_field, u8g2_font_profont22_tf, 26, 35, DISPLAY_ALIGN_LEFT);
+    display_field_init(&profile_field, u8g2_font_helvR08_tr, 5, 61, DISPLAY_ALIGN_LEFT);
 
-        // Set font for title and timer
-        u8g2_SetFont(display_handler, u8g2_font_helvB08_tr);
+    while (true) {
+        // The timer runs while charging, otherwise only redraw on a change
+        TickType_t timeout = (charge_mode_config.charge_mode_state == CHARGE_MODE_WAIT_FOR_COMPLETE) ? pdMS_TO_TICKS(20) : portMAX_DELAY;
+        uint32_t notified = display_wait_for_change(timeout);
+        uint32_t render_start_us = time_us_32();
+
+        bool redraw = notified & DISPLAY_NOTIFY_REDRAW;
+        if (redraw) {
+            u8g2_ClearBuffer(display_handler);
+
+            // Draw line under title
+            u8g2_DrawHLine(display_handler, 0, 13, screen_width);
+
+            title_field.valid = false;
+            timer_field.valid = false;
+            weight_field.valid = false;
+            profile_field.valid = false;
+        }
 
         // Format the timer string based on current state
         if (charge_mode_config.charge_mode_state == CHARGE_MODE_WAIT_FOR_COMPLETE) {
@@ -117,18 +175,11 @@ void scale_measurement_render_task(void *p) {
             snprintf(time_buffer, sizeof(time_buffer), "--.- s");
         }
 
-        // Calculate x positions
-        uint8_t screen_width = u8g2_GetDisplayWidth(display_handler);
-        uint8_t time_width = u8g2_GetStrWidth(display_handler, time_buffer);
-
-        // Draw title on left
-        u8g2_DrawStr(display_handler, 5, 10, title_string);
-
-        // Draw timer on right edge
-        u8g2_DrawStr(display_handler, screen_width - time_width - 5, 10, time_buffer);  // 5 px padding from edge
-
-        // Draw line under title
-        u8g2_DrawHLine(display_handler, 0, 13, screen_width);
+        // A long title may run into the timer, which is then drawn again on top
+        if (display_field_update(display_handler, &title_field, title_string, !redraw)) {
+            timer_field.valid = false;
+        }
+        display_field_update(display_handler, &timer_field, time_buffer, !redraw);
 
         // Current weight (only show values > -1.0)
         memset(current_weight_string, 0x0, sizeof(current_weight_string));
@@ -138,37 +189,32 @@ void scale_measurement_render_task(void *p) {
         } else {
             strcpy(current_weight_string, "---");
         }
-
-        // Draw current weight value
-        u8g2_SetFont(display_handler, u8g2_font_profont22_tf);
-        u8g2_DrawStr(display_handler, 26, 35, current_weight_string);
+        display_field_update(display_handler, &weight_field, current_weight_string, !redraw);
 
         // Draw profile name
         profile_t *current_profile = profile_get_selected();
-        u8g2_SetFont(display_handler, u8g2_font_helvR08_tr);
-        u8g2_DrawStr(display_handler, 5, 61, current_profile->name);
+        display_field_update(display_handler, &profile_field, current_profile->name, !redraw);
 
-        u8g2_SendBuffer(display_handler);
+        if (redraw) {
+            u8g2_SendBuffer(display_handler);
+        }
 
-        vTaskDelayUntil(&last_render_tick, pdMS_TO_TICKS(20));
+        metrics_record_display_render(time_us_32() - render_start_us);
     }
 }
 
 
 void charge_mode_wait_for_zero() {
-    // Set colour to not ready
-    neopixel_led_set_colour(
-        neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.mini12864_backlight_colour,
-        charge_mode_config.eeprom_charge_mode_data.neopixel_not_ready_colour, 
-        charge_mode_config.eeprom_charge_mode_data.neopixel_not_ready_colour, 
-        true
-    );
+    // Pulse the not ready colour until the scale settles
+    neopixel_led_pulse(charge_mode_config.eeprom_charge_mode_data.neopixel_not_ready_colour);
     
     // Wait for 5 measurements and wait for stable
-    FloatRingBuffer data_buffer(10);
+    StaticFloatRingBuffer<10> data_buffer;
 
     // Update current status
     snprintf(title_string, sizeof(title_string), "Waiting for Zero");
+    display_notify(DISPLAY_NOTIFY_CHANGE);
+    publish_charge_state(CHARGE_MODE_WAIT_FOR_ZERO);
 
     // Stop condition: 10 stable measurements in 200ms apart (2 seconds minimum)
     while (true) {
@@ -208,6 +254,10 @@ void charge_mode_wait_for_zero() {
 void charge_mode_wait_for_complete() {
 
     charge_start_tick = xTaskGetTickCount();
+    TRACE(CHARGE_START, trace_fixed(charge_mode_config.target_charge_weight, 1000));
+    charge_history_start(charge_mode_config.target_charge_weight,
+                         charge_mode_config.eeprom_charge_mode_data.coarse_stop_threshold,
+                         charge_mode_config.eeprom_charge_mode_data.fine_stop_threshold);
     TickType_t coarse_end_tick = 0;  // Track when coarse phase ends
     TickType_t fine_start_tick = 0;  // Track when fine phase starts
 
@@ -215,13 +265,8 @@ void charge_mode_wait_for_complete() {
     float coarse_kp_used = 0, coarse_kd_used = 0;
     float fine_kp_used = 0, fine_kd_used = 0;
 
-    // Set colour to under charge
-    neopixel_led_set_colour(
-        neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.mini12864_backlight_colour,
-        charge_mode_config.eeprom_charge_mode_data.neopixel_under_charge_colour, 
-        charge_mode_config.eeprom_charge_mode_data.neopixel_under_charge_colour, 
-        true
-    );
+    // Set colour to under charge, the PWM OUT chain fills up towards the target
+    neopixel_led_progress(charge_mode_config.eeprom_charge_mode_data.neopixel_under_charge_colour, 0.0f);
 
     // If the servo gate is used then it has to be opened
     if (servo_gate.gate_state != GATE_DISABLED) {
@@ -235,6 +280,8 @@ void charge_mode_wait_for_complete() {
     snprintf(title_string, sizeof(title_string), 
              "Target: %s", 
              target_weight_string);
+    display_notify(DISPLAY_NOTIFY_CHANGE);
+    publish_charge_state(CHARGE_MODE_WAIT_FOR_COMPLETE);
 
     // Read trickling parameter from the current profile
     profile_t * current_profile = profile_get_selected();
@@ -255,11 +302,12 @@ void charge_mode_wait_for_complete() {
     TickType_t last_sample_tick = xTaskGetTickCount();
     TickType_t current_sample_tick = last_sample_tick;
     bool should_coarse_trickler_move = true;
+    float gate_opening = 1.0f;      // Last opening sent to the servo gate
 
     // Phase 2 precharge: Fill pan to coarse threshold using tuned coarse PID from Phase 1
     ai_motor_mode_t initial_motor_mode = ai_tuning_get_motor_mode();
     if (initial_motor_mode == AI_MOTOR_MODE_FINE_ONLY) {
-        printf("AI Tuning Phase 2: Precharging with tuned coarse PID...\n");
+        DLOG0(CHARGE_PRECHARGE_START);
 
         // Get the tuned coarse params from Phase 1
         ai_tuning_session_t* session = ai_tuning_get_session();
@@ -283,7 +331,7 @@ void charge_mode_wait_for_complete() {
 
             if (precharge_error < charge_mode_config.eeprom_charge_mode_data.coarse_stop_threshold) {
                 motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
-                printf("AI Tuning Phase 2: Precharge complete at %.3f\n", current_weight);
+                DLOG1(CHARGE_PRECHARGE_DONE, DLOG_F(current_weight));
                 break;
             }
 
@@ -293,11 +341,11 @@ void charge_mode_wait_for_complete() {
             precharge_integral += precharge_error;
             float derivative = (dt_ms > 0.0f) ? (precharge_error - precharge_last_error) / dt_ms : 0.0f;
 
-            float new_p = tuned_coarse_kp * precharge_error;
-            float new_i = current_profile->coarse_ki * precharge_integral;
-            float new_d = tuned_coarse_kd * derivative;
-            float new_speed = fmax(coarse_trickler_min_speed,
-                                   fmin(new_p + new_i + new_d, coarse_trickler_max_speed));
+            charge_control_gains_t precharge_gains = {
+                tuned_coarse_kp, current_profile->coarse_ki, tuned_coarse_kd,
+                coarse_trickler_min_speed, coarse_trickler_max_speed,
+            };
+            float new_speed = charge_control_speed(&precharge_gains, precharge_error, precharge_integral, derivative);
             motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, new_speed);
 
             precharge_last_tick = now;
@@ -334,6 +382,12 @@ void charge_mode_wait_for_complete() {
         current_sample_tick = xTaskGetTickCount();
 
         float error = charge_mode_config.target_charge_weight - current_weight;
+        TRACE(CONTROL_STEP, trace_fixed(error, 1000));
+
+        if (charge_mode_config.target_charge_weight > 0.0f) {
+            neopixel_led_progress(charge_mode_config.eeprom_charge_mode_data.neopixel_under_charge_colour,
+                                  current_weight / charge_mode_config.target_charge_weight);
+        }
 
         // Check if AI tuning is active and get motor mode
         bool ai_tuning_active = ai_tuning_is_active();
@@ -349,6 +403,11 @@ void charge_mode_wait_for_complete() {
             fine_kd = current_profile->fine_kd;
         }
 
+        charge_control_gains_t fine_gains = {
+            fine_kp, current_profile->fine_ki, fine_kd,
+            fine_trickler_min_speed, fine_trickler_max_speed,
+        };
+
         // Track params used for telemetry
         coarse_kp_used = coarse_kp;
         coarse_kd_used = coarse_kd;
@@ -383,10 +442,17 @@ void charge_mode_wait_for_complete() {
             // Phase 1: Only coarse runs, fine is OFF
             motor_set_speed(SELECT_FINE_TRICKLER_MOTOR, 0);
 
-            float new_p = coarse_kp * error;
-            float new_i = current_profile->coarse_ki * integral;
-            float new_d = coarse_kd * derivative;
-            float new_speed = fmax(coarse_trickler_min_speed, fmin(new_p + new_i + new_d, coarse_trickler_max_speed));
+            float opening = coarse_gate_flow_opening(current_profile, error);
+            if (opening != gate_opening) {
+                servo_gate_set_opening(opening);
+                gate_opening = opening;
+            }
+
+            charge_control_gains_t coarse_gains = {
+                coarse_kp, current_profile->coarse_ki, coarse_kd,
+                coarse_trickler_min_speed, fmaxf(coarse_trickler_min_speed, coarse_trickler_max_speed * opening),
+            };
+            float new_speed = charge_control_speed(&coarse_gains, error, integral, derivative);
             motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, new_speed);
         }
         else if (motor_mode == AI_MOTOR_MODE_FINE_ONLY) {
@@ -394,10 +460,7 @@ void charge_mode_wait_for_complete() {
             // (Precharge should have filled to near threshold before this)
             motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
 
-            float new_p = fine_kp * error;
-            float new_i = current_profile->fine_ki * integral;
-            float new_d = fine_kd * derivative;
-            float new_speed = fmax(fine_trickler_min_speed, fmin(new_p + new_i + new_d, fine_trickler_max_speed));
+            float new_speed = charge_control_speed(&fine_gains, error, integral, derivative);
             motor_set_speed(SELECT_FINE_TRICKLER_MOTOR, new_speed);
         }
         else {
@@ -412,22 +475,33 @@ void charge_mode_wait_for_complete() {
                     motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
                     coarse_end_tick = xTaskGetTickCount();
                     fine_start_tick = coarse_end_tick;
+
+                    // The fine trickler runs with the gate open
+                    if (gate_opening < 1.0f) {
+                        servo_gate_set_opening(1.0f);
+                        gate_opening = 1.0f;
+                    }
                 } else {
+                    // Restrict the gate near the coarse stop threshold
+                    float opening = coarse_gate_flow_opening(current_profile, error);
+                    if (opening != gate_opening) {
+                        servo_gate_set_opening(opening);
+                        gate_opening = opening;
+                    }
+
                     // Run coarse motor
-                    float new_p = coarse_kp * error;
-                    float new_i = current_profile->coarse_ki * integral;
-                    float new_d = coarse_kd * derivative;
-                    float new_speed = fmax(coarse_trickler_min_speed, fmin(new_p + new_i + new_d, coarse_trickler_max_speed));
+                    charge_control_gains_t coarse_gains = {
+                        coarse_kp, current_profile->coarse_ki, coarse_kd,
+                        coarse_trickler_min_speed, fmaxf(coarse_trickler_min_speed, coarse_trickler_max_speed * opening),
+                    };
+                    float new_speed = charge_control_speed(&coarse_gains, error, integral, derivative);
                     motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, new_speed);
                 }
             } else {
                 // Fine phase - coarse motor OFF
                 motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
 
-                float new_p = fine_kp * error;
-                float new_i = current_profile->fine_ki * integral;
-                float new_d = fine_kd * derivative;
-                float new_speed = fmax(fine_trickler_min_speed, fmin(new_p + new_i + new_d, fine_trickler_max_speed));
+                float new_speed = charge_control_speed(&fine_gains, error, integral, derivative);
                 motor_set_speed(SELECT_FINE_TRICKLER_MOTOR, new_speed);
             }
         }
@@ -441,6 +515,7 @@ void charge_mode_wait_for_complete() {
     TickType_t now = xTaskGetTickCount();
     TickType_t elapsed_ticks = now - charge_start_tick;
     last_charge_elapsed_seconds = (float)(elapsed_ticks * portTICK_PERIOD_MS) / 1000.0f;
+    ui_events_publish(UI_EVENT_CHARGE_TIME, 0, last_charge_elapsed_seconds);
 
     // Calculate timing for AI tuning telemetry
     float coarse_time_ms = 0.0f;
@@ -462,6 +537,10 @@ void charge_mode_wait_for_complete() {
         fine_time_ms = (float)((now - fine_start_tick) * portTICK_PERIOD_MS);
     }
 
+    metrics_record_charge(profile_get_selected_idx(), coarse_time_ms, fine_time_ms, total_time_ms,
+                          scale_get_current_measurement() - charge_mode_config.target_charge_weight);
+    TRACE(CHARGE_DONE, trace_fixed(scale_get_current_measurement() - charge_mode_config.target_charge_weight, 1000));
+
     // Record telemetry if AI tuning is active
     if (ai_tuning_is_active()) {
         // Get final weight for accuracy calculation
@@ -486,8 +565,7 @@ void charge_mode_wait_for_complete() {
 
         ai_tuning_record_drop(&telemetry);
 
-        printf("AI Tuning: Recorded drop %d - overthrow=%.3f (%.2f%%), time=%.1fms\n",
-               telemetry.drop_number, overthrow, overthrow_percent, total_time_ms);
+        DLOG4(CHARGE_TUNING_DROP, telemetry.drop_number, DLOG_F(overthrow), DLOG_F(overthrow_percent), DLOG_F(total_time_ms));
     }
     else {
         // Not in tuning mode - record charge for ML learning
@@ -535,53 +613,47 @@ void charge_mode_wait_for_complete() {
 void charge_mode_wait_for_cup_removal() {
     // Update current status
     snprintf(title_string, sizeof(title_string), "Remove Cup");
+    display_notify(DISPLAY_NOTIFY_CHANGE);
+    publish_charge_state(CHARGE_MODE_WAIT_FOR_CUP_REMOVAL);
 
-    FloatRingBuffer data_buffer(5);
+    StaticFloatRingBuffer<5> data_buffer;
 
     // Post charge analysis (while waiting for removal of the cup)
     vTaskDelay(pdMS_TO_TICKS(1000));  // Wait for other tasks to complete
 
+    // The history ends once the charge has settled
+    charge_history_stop();
+
     // Take current measurement
     float current_measurement = scale_get_current_measurement();
     float error = charge_mode_config.target_charge_weight - current_measurement;
+    uint32_t outcome = charge_control_outcome(error, charge_mode_config.eeprom_charge_mode_data.fine_stop_threshold);
+    _report_outcome(outcome);
 
     // Update LED colour before moving to the next stage
     // Over charged
-    if (error <= -charge_mode_config.eeprom_charge_mode_data.fine_stop_threshold) {
+    if (outcome == CHARGE_MODE_EVENT_OVER_CHARGE) {
         neopixel_led_set_colour(
             neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.mini12864_backlight_colour,
             charge_mode_config.eeprom_charge_mode_data.neopixel_over_charge_colour, 
-            charge_mode_config.eeprom_charge_mode_data.neopixel_over_charge_colour, 
-            true
+            charge_mode_config.eeprom_charge_mode_data.neopixel_over_charge_colour
         );
-
-        // Set over charge
-        charge_mode_config.charge_mode_event |= CHARGE_MODE_EVENT_OVER_CHARGE;
     }
     // Under charged
-    else if (error >= charge_mode_config.eeprom_charge_mode_data.fine_stop_threshold) {
+    else if (outcome == CHARGE_MODE_EVENT_UNDER_CHARGE) {
         neopixel_led_set_colour(
             neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.mini12864_backlight_colour, 
             charge_mode_config.eeprom_charge_mode_data.neopixel_under_charge_colour, 
-            charge_mode_config.eeprom_charge_mode_data.neopixel_under_charge_colour, 
-            true
+            charge_mode_config.eeprom_charge_mode_data.neopixel_under_charge_colour
         );
-
-        // Set under charge flag
-        charge_mode_config.charge_mode_event |= CHARGE_MODE_EVENT_UNDER_CHARGE;
-
     }
     // Normal
     else {
         neopixel_led_set_colour(
             neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.mini12864_backlight_colour, 
             charge_mode_config.eeprom_charge_mode_data.neopixel_normal_charge_colour, 
-            charge_mode_config.eeprom_charge_mode_data.neopixel_normal_charge_colour, 
-            true
+            charge_mode_config.eeprom_charge_mode_data.neopixel_normal_charge_colour
         );
-
-        // Clear over and under charge bit
-        charge_mode_config.charge_mode_event &= ~(CHARGE_MODE_EVENT_UNDER_CHARGE | CHARGE_MODE_EVENT_OVER_CHARGE);
     }
 
     // Stop condition: 5 stable measurements in 300ms apart (1.5 seconds minimum)
@@ -618,8 +690,7 @@ void charge_mode_wait_for_cup_removal() {
     // Reset LED to default colour
     neopixel_led_set_colour(neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.mini12864_backlight_colour,
                             neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led1_colour,
-                            neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led2_colour,
-                            true);
+                            neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led2_colour);
 
     charge_mode_config.charge_mode_state = CHARGE_MODE_WAIT_FOR_CUP_RETURN;
 }
@@ -629,14 +700,15 @@ void charge_mode_wait_for_cup_return() {
     neopixel_led_set_colour(
         neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.mini12864_backlight_colour, 
         charge_mode_config.eeprom_charge_mode_data.neopixel_not_ready_colour, 
-        charge_mode_config.eeprom_charge_mode_data.neopixel_not_ready_colour, 
-        true
+        charge_mode_config.eeprom_charge_mode_data.neopixel_not_ready_colour
     );
 
     snprintf(title_string, sizeof(title_string), "Return Cup");
+    display_notify(DISPLAY_NOTIFY_CHANGE);
+    publish_charge_state(CHARGE_MODE_WAIT_FOR_CUP_RETURN);
 
 
-    FloatRingBuffer data_buffer(5);
+    StaticFloatRingBuffer<5> data_buffer;
 
     while (true) {
         TickType_t last_sample_tick = xTaskGetTickCount();
@@ -698,11 +770,13 @@ uint8_t charge_mode_menu(bool charge_mode_skip_user_input) {
     if (scale_measurement_render_task_handler == NULL) {
         // The render task shall have lower priority than the current one
         UBaseType_t current_task_priority = uxTaskPriorityGet(xTaskGetCurrentTaskHandle());
-        xTaskCreate(scale_measurement_render_task, "Scale Measurement Render Task", configMINIMAL_STACK_SIZE, NULL, current_task_priority - 1, &scale_measurement_render_task_handler);
+        scale_measurement_render_task_handler = xTaskCreateStatic(scale_measurement_render_task, "Scale Measurement Render Task", configMINIMAL_STACK_SIZE, NULL, current_task_priority - 1,
+                                                                  scale_measurement_render_task_stack, &scale_measurement_render_task_buffer);
     }
     else {
         vTaskResume(scale_measurement_render_task_handler);
     }
+    display_set_render_task(scale_measurement_render_task_handler);
 
     // Enable motor on entering the charge mode
     motor_enable(SELECT_COARSE_TRICKLER_MOTOR, true);
@@ -735,10 +809,12 @@ uint8_t charge_mode_menu(bool charge_mode_skip_user_input) {
     // Reset LED to default colour
     neopixel_led_set_colour(neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.mini12864_backlight_colour,
                             neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led1_colour,
-                            neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led2_colour,
-                            true);
+                            neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led2_colour);
 
     // vTaskDelete(scale_measurement_render_handler);
+    display_set_render_task(NULL);
+    publish_charge_state(CHARGE_MODE_EXIT);
+    charge_history_stop();
     vTaskSuspend(scale_measurement_render_task_handler);
 
     // Diable motors on exiting the mode
@@ -752,6 +828,8 @@ uint8_t charge_mode_menu(bool charge_mode_skip_user_input) {
 bool charge_mode_config_init(void) {
     bool is_ok = true;
 
+    charge_history_init();
+
     // Read charge mode config from EEPROM
     memset(&charge_mode_config, 0x0, sizeof(charge_mode_config));
     is_ok = eeprom_read(EEPROM_CHARGE_MODE_BASE_ADDR, (uint8_t *)&charge_mode_config.eeprom_charge_mode_data, sizeof(eeprom_charge_mode_data_t));
@@ -787,172 +865,111 @@ bool charge_mode_config_save(void) {
 
 
 
-bool http_rest_charge_mode_config(struct fs_file *file, int num_params, char *params[], char *values[]) {
-    // Mappings
-    // c1 (str): neopixel_normal_charge_colour
-    // c2 (str): neopixel_under_charge_colour
-    // c3 (str): neopixel_over_charge_colour
-    // c4 (str): neopixel_not_ready_colour
-
-    // c5 (float): coarse_stop_threshold
-    // c6 (float): fine_stop_threshold
-    // c7 (float): set_point_sd_margin
-    // c8 (float): set_point_mean_margin
-    // c9 (int): decimal point enum
-    // c10 (bool): precharge_enable
-    // c11 (int): precharge_time_ms
-    // c12 (float): precharge_speed_rps
+// Mappings
+// c1 (str): neopixel_normal_charge_colour
+// c2 (str): neopixel_under_charge_colour
+// c3 (str): neopixel_over_charge_colour
+// c4 (str): neopixel_not_ready_colour
+
+// c5 (float): coarse_stop_threshold
+// c6 (float): fine_stop_threshold
+// c7 (float): set_point_sd_margin
+// c8 (float): set_point_mean_margin
+// c9 (int): decimal point enum
+// c10 (bool): precharge_enable
+// c11 (int): precharge_time_ms
+// c12 (float): precharge_speed_rps
+// c13 (int): coarse_time_target_ms
+// c14 (int): total_time_target_ms
+
+// ee (bool): save to eeprom
+static const rest_param_t charge_mode_config_params[] = {
+    REST_PARAM_ENTRY("c1", eeprom_charge_mode_data_t, neopixel_normal_charge_colour, REST_PARAM_COLOUR, 0, 0.0f, 4294967295.0f),
+    REST_PARAM_ENTRY("c2", eeprom_charge_mode_data_t, neopixel_under_charge_colour, REST_PARAM_COLOUR, 0, 0.0f, 4294967295.0f),
+    REST_PARAM_ENTRY("c3", eeprom_charge_mode_data_t, neopixel_over_charge_colour, REST_PARAM_COLOUR, 0, 0.0f, 4294967295.0f),
+    REST_PARAM_ENTRY("c4", eeprom_charge_mode_data_t, neopixel_not_ready_colour, REST_PARAM_COLOUR, 0, 0.0f, 4294967295.0f),
+    REST_PARAM_ENTRY("c5", eeprom_charge_mode_data_t, coarse_stop_threshold, REST_PARAM_FLOAT, 3, -100.0f, 100.0f),
+    REST_PARAM_ENTRY("c6", eeprom_charge_mode_data_t, fine_stop_threshold, REST_PARAM_FLOAT, 3, -100.0f, 100.0f),
+    REST_PARAM_ENTRY("c7", eeprom_charge_mode_data_t, set_point_sd_margin, REST_PARAM_FLOAT, 3, 0.0f, 100.0f),
+    REST_PARAM_ENTRY("c8", eeprom_charge_mode_data_t, set_point_mean_margin, REST_PARAM_FLOAT, 3, 0.0f, 100.0f),
+    REST_PARAM_ENTRY("c9", eeprom_charge_mode_data_t, decimal_places, REST_PARAM_ENUM, 0, DP_2, DP_3),
+    REST_PARAM_ENTRY("c10", eeprom_charge_mode_data_t, precharge_enable, REST_PARAM_BOOL, 0, 0, 1),
+    REST_PARAM_ENTRY("c11", eeprom_charge_mode_data_t, precharge_time_ms, REST_PARAM_UINT32, 0, 0, 60000),
+    REST_PARAM_ENTRY("c12", eeprom_charge_mode_data_t, precharge_speed_rps, REST_PARAM_FLOAT, 3, 0.0f, 100.0f),
+    REST_PARAM_ENTRY("c13", eeprom_charge_mode_data_t, coarse_time_target_ms, REST_PARAM_UINT32, 0, 0, 600000),
+    REST_PARAM_ENTRY("c14", eeprom_charge_mode_data_t, total_time_target_ms, REST_PARAM_UINT32, 0, 0, 600000),
+};
+static rest_param_schema_t charge_mode_config_schema = REST_PARAM_SCHEMA(charge_mode_config_params);
 
-    // ee (bool): save to eeprom
 
-    static char charge_mode_json_buffer[320];
-    bool save_to_eeprom = false;
+bool http_rest_charge_mode_config(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    rest_param_result_t result = rest_param_apply(&charge_mode_config_schema, &charge_mode_config.eeprom_charge_mode_data, num_params, params, values);
 
-    // Control
-    for (int idx = 0; idx < num_params; idx += 1) {
-        if (strcmp(params[idx], "c5") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.coarse_stop_threshold = strtof(values[idx], NULL);
-        }
-        else if (strcmp(params[idx], "c6") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.fine_stop_threshold = strtof(values[idx], NULL);
-        }
-        else if (strcmp(params[idx], "c7") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.set_point_sd_margin = strtof(values[idx], NULL);
-        }
-        else if (strcmp(params[idx], "c8") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.set_point_mean_margin = strtof(values[idx], NULL);
-        }
-        else if (strcmp(params[idx], "c9") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.decimal_places = (decimal_places_t) atoi(values[idx]);
-        }
-        
-        // Pre charge related settings
-        else if (strcmp(params[idx], "c10") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.precharge_enable = string_to_boolean(values[idx]);
-        }
-        else if (strcmp(params[idx], "c11") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.precharge_time_ms = strtol(values[idx], NULL, 10);
-        }
-        else if (strcmp(params[idx], "c12") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.precharge_speed_rps = strtof(values[idx], NULL);
-        }
-
-        // AI Tuning time targets
-        else if (strcmp(params[idx], "c13") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.coarse_time_target_ms = strtol(values[idx], NULL, 10);
-        }
-        else if (strcmp(params[idx], "c14") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.total_time_target_ms = strtol(values[idx], NULL, 10);
-        }
-
-        // LED related settings
-        else if (strcmp(params[idx], "c1") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.neopixel_normal_charge_colour._raw_colour = hex_string_to_decimal(values[idx]);
-        }
-        else if (strcmp(params[idx], "c2") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.neopixel_under_charge_colour._raw_colour = hex_string_to_decimal(values[idx]);
-        }
-        else if (strcmp(params[idx], "c3") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.neopixel_over_charge_colour._raw_colour = hex_string_to_decimal(values[idx]);
-        }
-        else if (strcmp(params[idx], "c4") == 0) {
-            charge_mode_config.eeprom_charge_mode_data.neopixel_not_ready_colour._raw_colour = hex_string_to_decimal(values[idx]);
-        }
-        else if (strcmp(params[idx], "ee") == 0) {
-            save_to_eeprom = string_to_boolean(values[idx]);
-        }
-    }
-    
     // Perform action
-    if (save_to_eeprom) {
+    if (result.save) {
         charge_mode_config_save();
     }
 
     // Response
-    snprintf(charge_mode_json_buffer,
-             sizeof(charge_mode_json_buffer),
-             "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n"
-             "{\"c1\":\"#%06lx\",\"c2\":\"#%06lx\",\"c3\":\"#%06lx\",\"c4\":\"#%06lx\","
-             "\"c5\":%.3f,\"c6\":%.3f,\"c7\":%.3f,\"c8\":%.3f,\"c9\":%d,\"c10\":%s,\"c11\":%ld,\"c12\":%0.3f,"
-             "\"c13\":%ld,\"c14\":%ld}",
-             charge_mode_config.eeprom_charge_mode_data.neopixel_normal_charge_colour._raw_colour,
-             charge_mode_config.eeprom_charge_mode_data.neopixel_under_charge_colour._raw_colour,
-             charge_mode_config.eeprom_charge_mode_data.neopixel_over_charge_colour._raw_colour,
-             charge_mode_config.eeprom_charge_mode_data.neopixel_not_ready_colour._raw_colour,
-             charge_mode_config.eeprom_charge_mode_data.coarse_stop_threshold,
-             charge_mode_config.eeprom_charge_mode_data.fine_stop_threshold,
-             charge_mode_config.eeprom_charge_mode_data.set_point_sd_margin,
-             charge_mode_config.eeprom_charge_mode_data.set_point_mean_margin,
-             charge_mode_config.eeprom_charge_mode_data.decimal_places,
-             boolean_to_string(charge_mode_config.eeprom_charge_mode_data.precharge_enable),
-             charge_mode_config.eeprom_charge_mode_data.precharge_time_ms,
-             charge_mode_config.eeprom_charge_mode_data.precharge_speed_rps,
-             charge_mode_config.eeprom_charge_mode_data.coarse_time_target_ms,
-             charge_mode_config.eeprom_charge_mode_data.total_time_target_ms);
-
-    size_t data_length = strlen(charge_mode_json_buffer);
-    file->data = charge_mode_json_buffer;
-    file->len = data_length;
-    file->index = data_length;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+    rest_param_to_json(&charge_mode_config_schema, &charge_mode_config.eeprom_charge_mode_data, &result, &response->json);
 
-    return true;
+    return false;
 }
 
 
-bool http_rest_charge_mode_state(struct fs_file *file, int num_params, char *params[], char *values[]) {
-    // Mappings
-    // s0 (float): Charge weight set point (unitless)
-    // s1 (float): Current weight (unitless)
-    // s2 (charge_mode_state_t | int): Charge mode state
-    // s3 (uint32_t): Charge mode event
-    // s4 (string): Profile Name
-    // s5 (string): Elapsed time in seconds, live during charging
+void charge_mode_request_state(charge_mode_state_t new_state) {
+    // Exit
+    if (new_state == CHARGE_MODE_EXIT && charge_mode_config.charge_mode_state != CHARGE_MODE_EXIT) {
+        ButtonEncoderEvent_t button_event = BUTTON_RST_PRESSED;
+        xQueueSend(encoder_event_queue, &button_event, portMAX_DELAY);
+    }
+    // Enter
+    else if (new_state == CHARGE_MODE_WAIT_FOR_ZERO && charge_mode_config.charge_mode_state == CHARGE_MODE_EXIT) {
+        // Set exit_status for the menu
+        exit_state = APP_STATE_ENTER_CHARGE_MODE_FROM_REST;
+
+        // Then signal the menu to stop
+        ButtonEncoderEvent_t button_event = OVERRIDE_FROM_REST;
+        xQueueSend(encoder_event_queue, &button_event, portMAX_DELAY);
+    }
 
-    static char charge_mode_json_buffer[160];  // Increased to fit s5
-    char elapsed_time_buffer[16] = {0};
+    charge_mode_config.charge_mode_state = new_state;
+}
 
-    // Control
-    for (int idx = 0; idx < num_params; idx += 1) {
-        if (strcmp(params[idx], "s0") == 0) {
-            charge_mode_config.target_charge_weight = strtof(values[idx], NULL);
-        }
-        else if (strcmp(params[idx], "s2") == 0) {
-            charge_mode_state_t new_state = (charge_mode_state_t) atoi(values[idx]);
 
-            // Exit
-            if (new_state == CHARGE_MODE_EXIT && charge_mode_config.charge_mode_state != CHARGE_MODE_EXIT) {
-                ButtonEncoderEvent_t button_event = BUTTON_RST_PRESSED;
-                xQueueSend(encoder_event_queue, &button_event, portMAX_DELAY);
-            }
-            // Enter
-            else if (new_state == CHARGE_MODE_WAIT_FOR_ZERO && charge_mode_config.charge_mode_state == CHARGE_MODE_EXIT) {
-                // Set exit_status for the menu
-                exit_state = APP_STATE_ENTER_CHARGE_MODE_FROM_REST;
-
-                // Then signal the menu to stop
-                ButtonEncoderEvent_t button_event = OVERRIDE_FROM_REST;
-                xQueueSend(encoder_event_queue, &button_event, portMAX_DELAY);
-            }
+uint32_t charge_mode_take_events(uint32_t * event_seq) {
+    // The sequence is read before the flags, it is written after them
+    uint32_t seq = charge_mode_config.charge_mode_event_seq;
+    uint32_t events = (seq != *event_seq) ? charge_mode_config.charge_mode_event : 0;
+    *event_seq = seq;
+
+    return events;
+}
 
-            charge_mode_config.charge_mode_state = new_state;
-        }
-    }
+
+void charge_mode_state_to_json(json_writer_t * json, uint32_t * event_seq) {
+    json_begin_object(json);
+    json_add_float(json, "s0", charge_mode_config.target_charge_weight, 3);
 
     // Handle the special case
     float current_measurement = scale_get_current_measurement();
-    char weight_string[16];
     if (isnanf(current_measurement)) {
-        snprintf(weight_string, sizeof(weight_string), "\"nan\"");
+        json_add_string(json, "s1", "nan");
     }
     else if (isinff(current_measurement)) {
-        snprintf(weight_string, sizeof(weight_string), "\"inf\"");
+        json_add_string(json, "s1", "inf");
     }
     else {
-        snprintf(weight_string, sizeof(weight_string), "%0.3f", current_measurement);
+        json_add_float(json, "s1", current_measurement, 3);
     }
 
+    json_add_int(json, "s2", (int) charge_mode_config.charge_mode_state);
+    uint32_t seq = charge_mode_config.charge_mode_event_seq;
+    json_add_uint(json, "s3", charge_mode_take_events(event_seq));
+    json_add_string(json, "s4", profile_get_selected()->name);
+
     // Format elapsed time
+    char elapsed_time_buffer[16] = {0};
     if (charge_mode_config.charge_mode_state == CHARGE_MODE_WAIT_FOR_COMPLETE) {
         TickType_t now = xTaskGetTickCount();
         float elapsed_seconds = (float)((now - charge_start_tick) * portTICK_PERIOD_MS) / 1000.0f;
@@ -960,28 +977,49 @@ bool http_rest_charge_mode_state(struct fs_file *file, int num_params, char *par
     } else {
         snprintf(elapsed_time_buffer, sizeof(elapsed_time_buffer), "%.2f", last_charge_elapsed_seconds);
     }
+    json_add_string(json, "s5", elapsed_time_buffer);
+    json_add_uint(json, "s6", seq);
+
+    json_end_object(json);
+}
+
+
+bool http_rest_charge_mode_state(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // s0 (float): Charge weight set point (unitless)
+    // s1 (float): Current weight (unitless)
+    // s2 (charge_mode_state_t | int): Charge mode state
+    // s3 (uint32_t): Charge mode event
+    // s4 (string): Profile Name
+    // s5 (string): Elapsed time in seconds, live during charging
+    // s6 (uint32_t): Event sequence number. Pass back the last one seen to get s3 once per event; without
+    //                it, events are delivered once to polling clients as a whole.
+
+    // Events seen by the polling clients that do not send s6
+    static uint32_t poll_event_seq = 0;
+    uint32_t event_seq = poll_event_seq;
+    bool has_event_seq = false;
+
+    // Control
+    for (int idx = 0; idx < num_params; idx += 1) {
+        if (strcmp(params[idx], "s0") == 0) {
+            charge_mode_config.target_charge_weight = strtof(values[idx], NULL);
+        }
+        else if (strcmp(params[idx], "s2") == 0) {
+            charge_mode_request_state((charge_mode_state_t) atoi(values[idx]));
+        }
+        else if (strcmp(params[idx], "s6") == 0) {
+            event_seq = strtoul(values[idx], NULL, 10);
+            has_event_seq = true;
+        }
+    }
 
     // Response
-    snprintf(charge_mode_json_buffer, 
-             sizeof(charge_mode_json_buffer),
-             "%s"
-             "{\"s0\":%0.3f,\"s1\":%s,\"s2\":%d,\"s3\":%lu,\"s4\":\"%s\",\"s5\":\"%s\"}",
-             http_json_header,
-             charge_mode_config.target_charge_weight,
-             weight_string,
-             (int) charge_mode_config.charge_mode_state,
-             charge_mode_config.charge_mode_event,
-             profile_get_selected()->name,
-             elapsed_time_buffer);
-
-    // Clear events
-    charge_mode_config.charge_mode_event = 0;
-
-    size_t data_length = strlen(charge_mode_json_buffer);
-    file->data = charge_mode_json_buffer;
-    file->len = data_length;
-    file->index = data_length;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+    charge_mode_state_to_json(&response->json, &event_seq);
 
-    return true;
+    if (!has_event_seq) {
+        poll_event_seq = event_seq;
+    }
+
+    return false;
 }
\ No newline at end of file
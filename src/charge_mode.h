@@ -51,6 +51,7 @@ typedef struct {
     eeprom_charge_mode_data_t eeprom_charge_mode_data;
     float target_charge_weight;
     uint32_t charge_mode_event;
+    uint32_t charge_mode_event_seq;         // Incremented on every new event, see charge_mode_state_to_json()
     charge_mode_state_t charge_mode_state;
 } charge_mode_config_t;
 
@@ -65,9 +66,22 @@ extern "C" {
 
 bool charge_mode_config_save(void);
 
+// Start (CHARGE_MODE_WAIT_FOR_ZERO) or stop (CHARGE_MODE_EXIT) the charge mode from a remote interface
+void charge_mode_request_state(charge_mode_state_t new_state);
+
+/**
+ * Events raised since the consumer has seen event_seq, 0 if none. event_seq is advanced to the current
+ * event. Every consumer keeps its own event_seq, so the events are delivered once to each of them and
+ * nothing shared is cleared.
+*/
+uint32_t charge_mode_take_events(uint32_t * event_seq);
+
+// Writes the charge mode state object (same keys as /rest/charge_mode_state), s3 as charge_mode_take_events()
+void charge_mode_state_to_json(json_writer_t * json, uint32_t * event_seq);
+
 // REST interface
-bool http_rest_charge_mode_config(struct fs_file *file, int num_params, char *params[], char *values[]);
-bool http_rest_charge_mode_state(struct fs_file *file, int num_params, char *params[], char *values[]);
+bool http_rest_charge_mode_config(rest_response_t *response, int num_params, char *params[], char *values[]);
+bool http_rest_charge_mode_state(rest_response_t *response, int num_params, char *params[], char *values[]);
 
 
 #ifdef __cplusplus
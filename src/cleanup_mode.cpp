@@ -4,6 +4,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include "pico/time.h"
 #include "app.h"
 #include "u8g2.h"
 #include "mini_12864_module.h"
@@ -14,6 +15,8 @@
 #include "charge_mode.h"
 #include "cleanup_mode.h"
 #include "servo_gate.h"
+#include "metrics.h"
+#include "ui_events.h"
 
 
 // Memory from other modules
@@ -29,64 +32,82 @@ cleanup_mode_config_t cleanup_mode_config;
 
 static char title_string[30];
 TaskHandle_t cleanup_render_task_handler = NULL;
+static StackType_t cleanup_render_task_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t cleanup_render_task_buffer;
 
 
 void cleanup_render_task(void *p) {
     char buf[32];
     float prev_weight = 0;
+    float flow_rate = 0;
+    TickType_t prev_measurement_tick = xTaskGetTickCount();
 
     u8g2_t * display_handler = get_display_handler();
 
+    display_field_t title_field, weight_field, flow_field, speed_field, gate_field;
+    display_field_init(&title_field, u8g2_font_helvB08_tr, 5, 10, DISPLAY_ALIGN_LEFT);
+    display_field_init(&weight_field, u8g2_font_profont11_tf, 5, 25, DISPLAY_ALIGN_LEFT);
+    display_field_init(&flow_field, u8g2_font_profont11_tf, 5, 35, DISPLAY_ALIGN_LEFT);
+    display_field_init(&speed_field, u8g2_font_profont11_tf, 5, 45, DISPLAY_ALIGN_LEFT);
+    display_field_init(&gate_field, u8g2_font_profont11_tf, 5, 55, DISPLAY_ALIGN_LEFT);
+
     while (true) {
-        TickType_t last_render_tick = xTaskGetTickCount();
+        uint32_t notified = display_wait_for_change(portMAX_DELAY);
+        uint32_t render_start_us = time_us_32();
 
-        u8g2_ClearBuffer(display_handler);
+        bool redraw = notified & DISPLAY_NOTIFY_REDRAW;
+        if (redraw) {
+            u8g2_ClearBuffer(display_handler);
 
-        // Draw title
-        if (strlen(title_string)) {
-            u8g2_SetFont(display_handler, u8g2_font_helvB08_tr);
-            u8g2_DrawStr(display_handler, 5, 10, title_string);
+            // Draw line
+            u8g2_DrawHLine(display_handler, 0, 13, u8g2_GetDisplayWidth(display_handler));
+
+            title_field.valid = false;
+            weight_field.valid = false;
+            flow_field.valid = false;
+            speed_field.valid = false;
+            gate_field.valid = false;
         }
 
-        // Draw line
-        u8g2_DrawHLine(display_handler, 0, 13, u8g2_GetDisplayWidth(display_handler));
+        // Draw title
+        display_field_update(display_handler, &title_field, title_string, !redraw);
 
         // Draw charge weight
         float current_weight = scale_get_current_measurement();
-        memset(buf, 0x0, sizeof(buf));
         
         // Convert to weight string with given decimal places
         char weight_string[WEIGHT_STRING_LEN];
         float_to_string(weight_string, sizeof(weight_string), current_weight, charge_mode_config.eeprom_charge_mode_data.decimal_places);
 
-        sprintf(buf, "Weight: %s", weight_string);
-        u8g2_SetFont(display_handler, u8g2_font_profont11_tf);
-        u8g2_DrawStr(display_handler, 5, 25, buf);
+        snprintf(buf, sizeof(buf), "Weight: %s", weight_string);
+        display_field_update(display_handler, &weight_field, buf, !redraw);
 
-        // Draw flow rate
-        float weight_diff = current_weight - prev_weight;
-        prev_weight = current_weight;
-        float flow_rate = weight_diff / 0.02;  // 20 ms per sampling period, see below
+        // Draw flow rate, over the time between two measurements
+        if (notified & DISPLAY_NOTIFY_MEASUREMENT) {
+            TickType_t now = xTaskGetTickCount();
+            float elapsed_seconds = (float) ((now - prev_measurement_tick) * portTICK_PERIOD_MS) / 1000.0f;
+            if (elapsed_seconds > 0) {
+                flow_rate = (current_weight - prev_weight) / elapsed_seconds;
+            }
+            prev_weight = current_weight;
+            prev_measurement_tick = now;
+        }
 
-        memset(buf, 0x0, sizeof(buf));
-        sprintf(buf, "Flow: %0.3f/s", flow_rate);
-        u8g2_SetFont(display_handler, u8g2_font_profont11_tf);
-        u8g2_DrawStr(display_handler, 5, 35, buf);
+        snprintf(buf, sizeof(buf), "Flow: %0.3f/s", flow_rate);
+        display_field_update(display_handler, &flow_field, buf, !redraw);
 
         // Draw current motor speed
-        memset(buf, 0x0, sizeof(buf));
-        sprintf(buf, "Speed: %0.3f", cleanup_mode_config.trickler_speed);
-        u8g2_SetFont(display_handler, u8g2_font_profont11_tf);
-        u8g2_DrawStr(display_handler, 5, 45, buf);
+        snprintf(buf, sizeof(buf), "Speed: %0.3f", cleanup_mode_config.trickler_speed);
+        display_field_update(display_handler, &speed_field, buf, !redraw);
 
-        memset(buf, 0x0, sizeof(buf));
-        sprintf(buf, "Servo Gate: %s", gate_state_to_string(servo_gate.gate_state));
-        u8g2_SetFont(display_handler, u8g2_font_profont11_tf);
-        u8g2_DrawStr(display_handler, 5, 55, buf);
+        snprintf(buf, sizeof(buf), "Servo Gate: %s", gate_state_to_string(servo_gate.gate_state));
+        display_field_update(display_handler, &gate_field, buf, !redraw);
 
-        u8g2_SendBuffer(display_handler);
+        if (redraw) {
+            u8g2_SendBuffer(display_handler);
+        }
 
-        vTaskDelayUntil(&last_render_tick, pdMS_TO_TICKS(20));
+        metrics_record_display_render(time_us_32() - render_start_us);
     }
 }
 
@@ -96,11 +117,12 @@ uint8_t cleanup_mode_menu() {
     if (cleanup_render_task_handler == NULL) {
         // The render task shall have lower priority than the current one
         UBaseType_t current_task_priority = uxTaskPriorityGet(xTaskGetCurrentTaskHandle());
-        xTaskCreate(cleanup_render_task, "Cleanup Render Task", configMINIMAL_STACK_SIZE, NULL, current_task_priority - 1, &cleanup_render_task_handler);
+        cleanup_render_task_handler = xTaskCreateStatic(cleanup_render_task, "Cleanup Render Task", configMINIMAL_STACK_SIZE, NULL, current_task_priority - 1, cleanup_render_task_stack, &cleanup_render_task_buffer);
     }
     else {
         vTaskResume(cleanup_render_task_handler);
     }
+    display_set_render_task(cleanup_render_task_handler);
 
     // Initialize the cleanup mode config
     memset(&cleanup_mode_config, 0x0, sizeof(cleanup_mode_config));
@@ -119,6 +141,7 @@ uint8_t cleanup_mode_menu() {
 
     // Update current status
     snprintf(title_string, sizeof(title_string), "Adjust Speed");
+    display_notify(DISPLAY_NOTIFY_CHANGE);
 
     bool quit = false;
     while (!quit) {
@@ -150,7 +173,9 @@ uint8_t cleanup_mode_menu() {
             default:
                 break;
         }
-        
+
+        display_notify(DISPLAY_NOTIFY_CHANGE);
+        ui_events_publish(UI_EVENT_CLEANUP_SPEED, 0, cleanup_mode_config.trickler_speed);
     }
 
     motor_enable(SELECT_COARSE_TRICKLER_MOTOR, false);
@@ -158,6 +183,7 @@ uint8_t cleanup_mode_menu() {
 
     cleanup_mode_config.cleanup_mode_state = CLEANUP_MODE_EXIT;
 
+    display_set_render_task(NULL);
     vTaskSuspend(cleanup_render_task_handler);
     return 1;  // Return backs to the main menu view
 }
@@ -196,6 +222,7 @@ bool http_rest_cleanup_mode_state(struct fs_file *file, int num_params, char *pa
         else if (strcmp(params[idx], "s1") == 0) {
             cleanup_mode_config.trickler_speed = strtof(values[idx], NULL);
             motor_set_speed(SELECT_BOTH_MOTOR, cleanup_mode_config.trickler_speed);
+            ui_events_publish(UI_EVENT_CLEANUP_SPEED, 0, cleanup_mode_config.trickler_speed);
         }
     }
 
@@ -8,6 +8,7 @@
 
 
 const char * http_json_header = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n";
+const char * http_event_stream_header = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n\r\n";
 
 
 void delay_ms(uint32_t ms, BaseType_t scheduler_state) {
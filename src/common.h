@@ -19,6 +19,9 @@ extern "C" {
 // "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n"
 extern const char * http_json_header;
 
+// "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n\r\n"
+extern const char * http_event_stream_header;
+
 typedef struct {
     PIO pio;
     int sm;
@@ -0,0 +1,338 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "deferred_log.h"
+#include "error.h"
+
+
+// How often the drain task empties the rings
+#define DEFERRED_LOG_DRAIN_PERIOD_MS    20
+
+// Longest formatted line
+#define DEFERRED_LOG_LINE_SIZE          128
+
+// Lines per /rest/log response part
+#define DEFERRED_LOG_LINES_PER_PART     4
+
+#define DEFERRED_LOG_FLAG_TEXT          (1 << 0)        // args hold copied text
+
+
+typedef struct {
+    uint32_t time_us;
+    uint16_t id;
+    uint8_t core;
+    uint8_t flags;
+    union {
+        uintptr_t args[DEFERRED_LOG_MAX_ARGS];
+        char text[DEFERRED_LOG_TEXT_SIZE];      // Not necessarily NUL terminated
+    };
+} deferred_log_record_t;
+
+
+// Single producer (the owning core, with interrupts disabled) and single consumer (the drain task)
+typedef struct {
+    deferred_log_record_t records[DEFERRED_LOG_RING_SIZE];
+    volatile uint32_t head;     // Written by the producer
+    volatile uint32_t tail;     // Written by the consumer
+    volatile uint32_t dropped;
+} deferred_log_ring_t;
+
+
+#define DEFERRED_LOG_FORMAT(name, level, format)    format,
+#define DEFERRED_LOG_LEVEL(name, level, format)     level,
+
+static const char * const deferred_log_formats[DLOG_NUM_IDS] = {
+    DEFERRED_LOG_FORMATS(DEFERRED_LOG_FORMAT)
+};
+
+static const uint8_t deferred_log_levels[DLOG_NUM_IDS] = {
+    DEFERRED_LOG_FORMATS(DEFERRED_LOG_LEVEL)
+};
+
+#undef DEFERRED_LOG_FORMAT
+#undef DEFERRED_LOG_LEVEL
+
+static const char deferred_log_level_chars[] = "DIWE";
+
+static deferred_log_ring_t deferred_log_rings[NUM_CORES];
+
+// Most recent records for /rest/log, seq counts all records ever added. /rest/log runs in the lwIP
+// interrupt, so the history is guarded by a spin lock rather than a FreeRTOS critical section.
+static deferred_log_record_t deferred_log_history[DEFERRED_LOG_HISTORY_SIZE];
+static uint32_t deferred_log_history_seq = 0;
+static spin_lock_t * deferred_log_history_lock;
+
+static StackType_t deferred_log_task_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t deferred_log_task_buffer;
+
+
+static inline deferred_log_record_t * _reserve(uint32_t * irq_state) {
+    *irq_state = save_and_disable_interrupts();
+
+    deferred_log_ring_t * ring = &deferred_log_rings[get_core_num()];
+    uint32_t head = ring->head;
+    if (head - ring->tail >= DEFERRED_LOG_RING_SIZE) {
+        ring->dropped += 1;
+        restore_interrupts(*irq_state);
+        return NULL;
+    }
+
+    return &ring->records[head & (DEFERRED_LOG_RING_SIZE - 1)];
+}
+
+
+static inline void _commit(deferred_log_record_t * record, uint16_t id, uint8_t flags, uint32_t irq_state) {
+    uint8_t core = get_core_num();
+    record->time_us = time_us_32();
+    record->id = id;
+    record->core = core;
+    record->flags = flags;
+
+    // Record before head, the drain task runs on either core
+    __dmb();
+    deferred_log_rings[core].head += 1;
+
+    restore_interrupts(irq_state);
+}
+
+
+void __time_critical_func(deferred_log_write)(uint16_t id, uintptr_t a0, uintptr_t a1, uintptr_t a2, uintptr_t a3) {
+    uint32_t irq_state;
+    deferred_log_record_t * record = _reserve(&irq_state);
+    if (record == NULL) {
+        return;
+    }
+
+    record->args[0] = a0;
+    record->args[1] = a1;
+    record->args[2] = a2;
+    record->args[3] = a3;
+
+    _commit(record, id, 0, irq_state);
+}
+
+
+void __time_critical_func(deferred_log_write_text)(uint16_t id, const char * text) {
+    uint32_t irq_state;
+    deferred_log_record_t * record = _reserve(&irq_state);
+    if (record == NULL) {
+        return;
+    }
+
+    strncpy(record->text, text, DEFERRED_LOG_TEXT_SIZE);
+
+    _commit(record, id, DEFERRED_LOG_FLAG_TEXT, irq_state);
+}
+
+
+// Format one conversion (spec is e.g., "%.3f") with its argument
+static int _format_arg(char * buf, size_t len, const char * spec, char conversion, const deferred_log_record_t * record, uint8_t arg_idx) {
+    if (record->flags & DEFERRED_LOG_FLAG_TEXT) {
+        char text[DEFERRED_LOG_TEXT_SIZE + 1];
+        memcpy(text, record->text, DEFERRED_LOG_TEXT_SIZE);
+        text[DEFERRED_LOG_TEXT_SIZE] = 0;
+        return snprintf(buf, len, spec, text);
+    }
+
+    uintptr_t arg = arg_idx < DEFERRED_LOG_MAX_ARGS ? record->args[arg_idx] : 0;
+
+    switch (conversion) {
+        case 'f':
+        case 'e':
+        case 'g': {
+            uint32_t bits = (uint32_t) arg;
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return snprintf(buf, len, spec, (double) value);
+        }
+        case 'd':
+        case 'i':
+            return snprintf(buf, len, spec, (int) (int32_t) arg);
+        case 's':
+            return snprintf(buf, len, spec, arg ? (const char *) arg : "");
+        default:
+            return snprintf(buf, len, spec, (unsigned) arg);
+    }
+}
+
+
+// Returns the line length, the line is truncated to the buffer
+static size_t _format_record(char * buf, size_t size, const deferred_log_record_t * record) {
+    const char * format = record->id < DLOG_NUM_IDS ? deferred_log_formats[record->id] : "Unknown log format";
+    char level = deferred_log_level_chars[record->id < DLOG_NUM_IDS ? deferred_log_levels[record->id] : DLOG_ERROR];
+
+    size_t len = snprintf(buf, size, "%lu.%06lu %u %c ",
+                          (unsigned long) (record->time_us / 1000000), (unsigned long) (record->time_us % 1000000),
+                          record->core, level);
+    uint8_t arg_idx = 0;
+
+    while (*format && len < size - 1) {
+        if (format[0] != '%' || format[1] == '%') {
+            buf[len++] = format[0];
+            format += (format[0] == '%') ? 2 : 1;
+            continue;
+        }
+
+        // Conversion specification: flags, width and precision up to the conversion character
+        size_t spec_len = strcspn(format + 1, "diuxXcfegs") + 2;
+        char spec[12];
+        if (spec_len >= sizeof(spec) || format[spec_len - 1] == 0) {
+            break;
+        }
+        memcpy(spec, format, spec_len);
+        spec[spec_len] = 0;
+
+        int n = _format_arg(buf + len, size - len, spec, format[spec_len - 1], record, arg_idx++);
+        if (n > 0) {
+            len += n;
+        }
+        format += spec_len;
+    }
+
+    len = len < size - 1 ? len : size - 1;
+    buf[len] = 0;
+    return len;
+}
+
+
+// Pop the oldest record of all cores, returns false when the rings are empty
+static bool _pop_oldest(deferred_log_record_t * record) {
+    deferred_log_ring_t * oldest = NULL;
+
+    for (uint8_t core = 0; core < NUM_CORES; core += 1) {
+        deferred_log_ring_t * ring = &deferred_log_rings[core];
+        if (ring->head == ring->tail) {
+            continue;
+        }
+        __dmb();
+        const deferred_log_record_t * next = &ring->records[ring->tail & (DEFERRED_LOG_RING_SIZE - 1)];
+        if (oldest == NULL ||
+            (int32_t) (next->time_us - oldest->records[oldest->tail & (DEFERRED_LOG_RING_SIZE - 1)].time_us) < 0) {
+            oldest = ring;
+        }
+    }
+
+    if (oldest == NULL) {
+        return false;
+    }
+
+    *record = oldest->records[oldest->tail & (DEFERRED_LOG_RING_SIZE - 1)];
+    __dmb();
+    oldest->tail += 1;
+
+    return true;
+}
+
+
+void deferred_log_task(void *p) {
+    char line[DEFERRED_LOG_LINE_SIZE];
+    deferred_log_record_t record;
+
+    while (true) {
+        while (_pop_oldest(&record)) {
+            uint32_t irq_state = spin_lock_blocking(deferred_log_history_lock);
+            deferred_log_history[deferred_log_history_seq & (DEFERRED_LOG_HISTORY_SIZE - 1)] = record;
+            deferred_log_history_seq += 1;
+            spin_unlock(deferred_log_history_lock, irq_state);
+
+            if (record.id < DLOG_NUM_IDS && deferred_log_levels[record.id] >= DEFERRED_LOG_PRINT_LEVEL) {
+                // May block on USB, only this task waits
+                _format_record(line, sizeof(line), &record);
+                printf("%s\n", line);
+            }
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(DEFERRED_LOG_DRAIN_PERIOD_MS));
+    }
+}
+
+
+bool deferred_log_init() {
+    deferred_log_history_lock = spin_lock_instance(spin_lock_claim_unused(true));
+
+    // Records can be written before init, they are drained once the scheduler runs
+    TaskHandle_t task_handle = xTaskCreateStatic(deferred_log_task, "Log Task", configMINIMAL_STACK_SIZE, NULL, 1,
+                                                 deferred_log_task_stack, &deferred_log_task_buffer);
+    if (task_handle == NULL) {
+        report_error(ERR_REST_TASK_CREATE);
+        return false;
+    }
+
+    return true;
+}
+
+
+// Copy a history record, returns false if it has been overwritten (or not written yet)
+static bool _history_get(uint32_t seq, deferred_log_record_t * record) {
+    uint32_t irq_state = spin_lock_blocking(deferred_log_history_lock);
+    bool valid = (deferred_log_history_seq - seq - 1) < DEFERRED_LOG_HISTORY_SIZE;
+    if (valid) {
+        *record = deferred_log_history[seq & (DEFERRED_LOG_HISTORY_SIZE - 1)];
+    }
+    spin_unlock(deferred_log_history_lock, irq_state);
+
+    return valid;
+}
+
+
+bool http_rest_log(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // s (int): Sequence number to start from, e.g., the n of the previous response. Default: oldest kept
+    //
+    // Response
+    // l (array): Log lines "<seconds> <core> <level> <text>", oldest first
+    // n (int): Sequence number of the next record
+    // d0 (int): Records dropped on core 0 as the ring was full
+    // d1 (int): Records dropped on core 1
+    //
+    // The cursor is the sequence number of the next line to write
+    json_writer_t * json = &response->json;
+
+    uint32_t end_seq = deferred_log_history_seq;
+
+    if (response->part == 0) {
+        uint32_t start_seq = end_seq > DEFERRED_LOG_HISTORY_SIZE ? end_seq - DEFERRED_LOG_HISTORY_SIZE : 0;
+
+        for (int idx = 0; idx < num_params; idx += 1) {
+            if (strcmp(params[idx], "s") == 0) {
+                uint32_t seq = strtoul(values[idx], NULL, 10);
+                if (seq > start_seq && seq <= end_seq) {
+                    start_seq = seq;
+                }
+            }
+        }
+
+        json_begin_object(json);
+        json_add_array(json, "l");
+        response->cursor = start_seq;
+        return true;
+    }
+
+    char line[DEFERRED_LOG_LINE_SIZE];
+    deferred_log_record_t record;
+
+    for (uint8_t count = 0; count < DEFERRED_LOG_LINES_PER_PART && response->cursor < end_seq; count += 1) {
+        if (_history_get(response->cursor, &record)) {
+            _format_record(line, sizeof(line), &record);
+            json_string(json, line);
+        }
+        response->cursor += 1;
+    }
+
+    if (response->cursor < end_seq) {
+        return true;
+    }
+
+    json_end_array(json);
+    json_add_uint(json, "n", response->cursor);
+    json_add_uint(json, "d0", deferred_log_rings[0].dropped);
+    json_add_uint(json, "d1", deferred_log_rings[1].dropped);
+    json_end_object(json);
+
+    return false;
+}
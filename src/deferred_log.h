@@ -0,0 +1,132 @@
+#ifndef DEFERRED_LOG_H_
+#define DEFERRED_LOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "http_rest.h"
+
+// Deferred logger
+//
+// printf over USB CDC blocks when the host is not draining, which stalls the caller (HTTP server,
+// control loops). Instead, the call site only writes a small binary record (format ID, timestamp and up to
+// DEFERRED_LOG_MAX_ARGS word sized arguments) into a ring owned by the current core, with interrupts disabled
+// for the few cycles of the copy. A low priority task formats the records, prints them and keeps the most
+// recent ones for /rest/log.
+//
+// Formats are declared once in DEFERRED_LOG_FORMATS below. %d, %i, %u, %x, %c take an integer argument,
+// %f, %e, %g take DLOG_F(float), and %s takes a string that outlives the record (e.g., a literal). Text
+// that does not outlive the call (e.g., a request URI) is copied into the record with DLOG_TEXT, its
+// format has a single %s and no other argument.
+
+
+#define DEFERRED_LOG_MAX_ARGS           4
+#define DEFERRED_LOG_TEXT_SIZE          24          // Longest DLOG_TEXT, longer text is truncated
+#define DEFERRED_LOG_RING_SIZE          64          // Records per core, power of 2
+#define DEFERRED_LOG_HISTORY_SIZE       32          // Records kept for /rest/log, power of 2
+
+typedef enum {
+    DLOG_DEBUG = 0,
+    DLOG_INFO,
+    DLOG_WARN,
+    DLOG_ERROR,
+} deferred_log_level_t;
+
+// Records below this level are compiled out
+#ifndef DEFERRED_LOG_MIN_LEVEL
+#define DEFERRED_LOG_MIN_LEVEL          DLOG_DEBUG
+#endif
+
+// Records below this level are only kept for /rest/log, not printed
+#ifndef DEFERRED_LOG_PRINT_LEVEL
+#define DEFERRED_LOG_PRINT_LEVEL        DLOG_INFO
+#endif
+
+
+//  X(name, level, format)
+#define DEFERRED_LOG_FORMATS(X) \
+    X(HTTP_REQUEST,             DLOG_DEBUG, "HTTP request: '%s'") \
+    X(HTTP_NOT_FOUND,           DLOG_INFO,  "No handler for '%s' - returning 404") \
+    X(HTTP_PART_TOO_LARGE,      DLOG_WARN,  "Response part %u exceeds chunk size") \
+    X(HTTP_REQUEST_TOO_LARGE,   DLOG_WARN,  "HTTP request too large, returning %u") \
+    X(CHARGE_PRECHARGE_START,   DLOG_INFO,  "AI Tuning Phase 2: Precharging with tuned coarse PID...") \
+    X(CHARGE_PRECHARGE_DONE,    DLOG_INFO,  "AI Tuning Phase 2: Precharge complete at %.3f") \
+    X(CHARGE_TUNING_DROP,       DLOG_INFO,  "AI Tuning: Recorded drop %d - overthrow=%.3f (%.2f%%), time=%.1fms") \
+    X(AI_DROP_DONE,             DLOG_INFO,  "Drop %d completed (score: %.1f), time: %.0f ms (coarse: %.0f ms)") \
+    X(AI_DROP_COARSE,           DLOG_INFO,  "  Coarse: Kp=%.3f, Kd=%.3f (range 0-1)") \
+    X(AI_DROP_FINE,             DLOG_INFO,  "  Fine:   Kp=%.2f, Kd=%.2f (range 0-10)") \
+    X(AI_DROP_OVERTHROW,        DLOG_INFO,  "  Overthrow: %.3f gr (%.2f%%)") \
+    X(AI_PHASE1_DROP,           DLOG_INFO,  "Phase 1 [%s]: overthrow=%.3f (thr=%.3f), time=%.0fms") \
+    X(AI_PHASE2_DROP,           DLOG_INFO,  "Phase 2 [%s]: overthrow=%.2f%% (max=%.1f%%), time=%.0fms") \
+    X(AI_KP_BACK_OFF,           DLOG_INFO,  "  Overthrow! Back off Kp to %.3f, step=%.3f") \
+    X(AI_KP_CONVERGED,          DLOG_INFO,  "  Kp converged at %.3f, tuning Kd...") \
+    X(AI_KP_INCREASE,           DLOG_INFO,  "  No overthrow, Kp -> %.3f") \
+    X(AI_KP_MAX,                DLOG_INFO,  "  Hit max Kp, switching to Kd tuning") \
+    X(AI_KD_CHANGE,             DLOG_INFO,  "  %s, Kd -> %.3f") \
+    X(AI_KD_OVERTHROW,          DLOG_INFO,  "  Overthrow high (%.2f%%), Kd -> %.3f") \
+    X(AI_KD_MAX,                DLOG_INFO,  "  Hit max Kd, starting GP refinement...") \
+    X(AI_TIME_SLOW,             DLOG_INFO,  "  Time slow (%.0fms), Kp -> %.3f") \
+    X(AI_GP_START,              DLOG_INFO,  "  Adaptive %s tuning found baseline, starting GP refinement") \
+    X(AI_ML_DROP,               DLOG_DEBUG, "AI ML: Recorded drop #%d (overthrow=%.3f, time=%.0fms)") \
+    X(TFT_FULL_REFRESH,         DLOG_INFO,  "TFT: %s at %u kHz, full screen refresh %u us")
+
+
+#define DEFERRED_LOG_ID(name, level, format)        DLOG_ID_##name,
+#define DEFERRED_LOG_LEVEL(name, level, format)     DLOG_LEVEL_##name = level,
+
+typedef enum {
+    DEFERRED_LOG_FORMATS(DEFERRED_LOG_ID)
+    DLOG_NUM_IDS,
+} deferred_log_id_t;
+
+enum {
+    DEFERRED_LOG_FORMATS(DEFERRED_LOG_LEVEL)
+};
+
+#undef DEFERRED_LOG_ID
+#undef DEFERRED_LOG_LEVEL
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool deferred_log_init(void);
+
+void deferred_log_write(uint16_t id, uintptr_t a0, uintptr_t a1, uintptr_t a2, uintptr_t a3);
+
+void deferred_log_write_text(uint16_t id, const char * text);
+
+static inline uint32_t deferred_log_float(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// REST
+bool http_rest_log(rest_response_t *response, int num_params, char *params[], char *values[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#define DLOG_ENABLED(name)      ((int) DLOG_LEVEL_##name >= (int) DEFERRED_LOG_MIN_LEVEL)
+#define DLOG_F(value)           deferred_log_float(value)
+#define DLOG_S(value)           ((uintptr_t) (value))
+
+#define DLOG0(name) \
+    do { if (DLOG_ENABLED(name)) deferred_log_write(DLOG_ID_##name, 0, 0, 0, 0); } while (0)
+#define DLOG1(name, a0) \
+    do { if (DLOG_ENABLED(name)) deferred_log_write(DLOG_ID_##name, (uintptr_t) (a0), 0, 0, 0); } while (0)
+#define DLOG2(name, a0, a1) \
+    do { if (DLOG_ENABLED(name)) deferred_log_write(DLOG_ID_##name, (uintptr_t) (a0), (uintptr_t) (a1), 0, 0); } while (0)
+#define DLOG3(name, a0, a1, a2) \
+    do { if (DLOG_ENABLED(name)) deferred_log_write(DLOG_ID_##name, (uintptr_t) (a0), (uintptr_t) (a1), (uintptr_t) (a2), 0); } while (0)
+#define DLOG4(name, a0, a1, a2, a3) \
+    do { if (DLOG_ENABLED(name)) deferred_log_write(DLOG_ID_##name, (uintptr_t) (a0), (uintptr_t) (a1), (uintptr_t) (a2), (uintptr_t) (a3)); } while (0)
+#define DLOG_TEXT(name, text) \
+    do { if (DLOG_ENABLED(name)) deferred_log_write_text(DLOG_ID_##name, text); } while (0)
+
+
+#endif  // DEFERRED_LOG_H_
@@ -8,6 +8,7 @@
 #include <semphr.h>
 
 #include "display.h"
+#include "display_mirror.h"
 #include "http_rest.h"
 #include "error.h"
 
@@ -15,6 +16,8 @@
 // Local variables
 u8g2_t display_handler;
 SemaphoreHandle_t display_buffer_access_mutex = NULL;
+static StaticSemaphore_t display_buffer_access_mutex_buffer;
+static TaskHandle_t display_render_task = NULL;
 
 u8g2_t * get_display_handler(void) {
     return &display_handler;
@@ -26,7 +29,7 @@ void acquire_display_buffer_access() {
 
     taskENTER_CRITICAL();
     if (!mutex_initialized) {
-        display_buffer_access_mutex = xSemaphoreCreateMutex();
+        display_buffer_access_mutex = xSemaphoreCreateMutexStatic(&display_buffer_access_mutex_buffer);
         if (display_buffer_access_mutex == NULL) {
             taskEXIT_CRITICAL();
             report_error(ERR_DISPLAY_MUTEX_CREATE);
@@ -46,6 +49,95 @@ void release_display_buffer_access() {
 }
 
 
+void display_set_render_task(TaskHandle_t task) {
+    display_render_task = task;
+
+    if (task) {
+        xTaskNotify(task, DISPLAY_NOTIFY_REDRAW, eSetBits);
+    }
+}
+
+
+void display_notify(uint32_t bits) {
+    TaskHandle_t task = display_render_task;
+
+    if (task) {
+        xTaskNotify(task, bits, eSetBits);
+    }
+}
+
+
+uint32_t display_wait_for_change(TickType_t timeout_ticks) {
+    uint32_t bits = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &bits, timeout_ticks);
+
+    return bits;
+}
+
+
+void display_field_init(display_field_t * field, const uint8_t * font, u8g2_uint_t x, u8g2_uint_t y, display_align_t align) {
+    memset(field, 0x0, sizeof(display_field_t));
+    field->font = font;
+    field->x = x;
+    field->y = y;
+    field->align = align;
+}
+
+
+bool display_field_update(u8g2_t * u8g2, display_field_t * field, const char * text, bool send) {
+    if (field->valid && strncmp(field->text, text, sizeof(field->text)) == 0) {
+        return false;
+    }
+
+    u8g2_SetFont(u8g2, field->font);
+    u8g2_uint_t width = u8g2_GetStrWidth(u8g2, text);
+    u8g2_uint_t left = (field->align == DISPLAY_ALIGN_RIGHT) ? field->x - width : field->x;
+
+    // Area covering the previous and the new text, the descent is negative
+    int area_left = left;
+    int area_right = left + width;
+    if (field->valid && field->drawn_left < area_left) {
+        area_left = field->drawn_left;
+    }
+    if (field->valid && field->drawn_left + field->drawn_width > area_right) {
+        area_right = field->drawn_left + field->drawn_width;
+    }
+
+    int area_top = field->y - u8g2_GetAscent(u8g2);
+    int area_bottom = field->y - u8g2_GetDescent(u8g2);
+    if (area_top < 0) {
+        area_top = 0;
+    }
+    if (area_bottom >= u8g2_GetDisplayHeight(u8g2)) {
+        area_bottom = u8g2_GetDisplayHeight(u8g2) - 1;
+    }
+
+    if (area_right > area_left) {
+        u8g2_SetDrawColor(u8g2, 0);
+        u8g2_DrawBox(u8g2, area_left, area_top, area_right - area_left, area_bottom - area_top + 1);
+        u8g2_SetDrawColor(u8g2, 1);
+    }
+    u8g2_DrawStr(u8g2, left, field->y, text);
+
+    strncpy(field->text, text, sizeof(field->text) - 1);
+    field->text[sizeof(field->text) - 1] = 0;
+    field->drawn_left = left;
+    field->drawn_width = width;
+    field->valid = true;
+
+    if (send && area_right > area_left) {
+        uint8_t tile_left = area_left / 8;
+        uint8_t tile_top = area_top / 8;
+        uint8_t tile_width = (area_right - 1) / 8 - tile_left + 1;
+        uint8_t tile_height = area_bottom / 8 - tile_top + 1;
+        u8g2_UpdateDisplayArea(u8g2, tile_left, tile_top, tile_width, tile_height);
+        display_mirror_capture_u8g2_area(u8g2, tile_left, tile_top, tile_width, tile_height);
+    }
+
+    return true;
+}
+
+
 /* u8g2 buffer structure can be decoded according to the description here: 
     https://github.com/olikraus/u8g2/wiki/u8g2reference#memory-structure-for-controller-with-u8x8-support
 
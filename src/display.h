@@ -2,8 +2,42 @@
 #define DISPLAY_H_
 
 #include <u8g2.h>
+#include <FreeRTOS.h>
+#include <task.h>
 #include "http_rest.h"
 
+// Field based rendering
+//
+// A render task draws the static parts of its screen once, then only redraws the text fields whose
+// content changed and sends the tiles they cover with u8g2_UpdateDisplayArea() instead of the full
+// buffer. Between renders the task sleeps in display_wait_for_change() until display_notify() is
+// called, e.g., on a new scale measurement.
+
+#define DISPLAY_FIELD_TEXT_SIZE     32
+
+// Notification bits
+#define DISPLAY_NOTIFY_CHANGE       (1 << 0)        // Something shown on the screen has changed
+#define DISPLAY_NOTIFY_MEASUREMENT  (1 << 1)        // A new scale measurement is available
+#define DISPLAY_NOTIFY_REDRAW       (1 << 2)        // The screen has to be drawn from scratch
+
+
+typedef enum {
+    DISPLAY_ALIGN_LEFT = 0,
+    DISPLAY_ALIGN_RIGHT,                            // x is the right edge of the text
+} display_align_t;
+
+typedef struct {
+    const uint8_t * font;
+    u8g2_uint_t x;
+    u8g2_uint_t y;                                  // Baseline
+    display_align_t align;
+    bool valid;                                     // text is on the screen, cleared on redraw
+    u8g2_uint_t drawn_left;
+    u8g2_uint_t drawn_width;
+    char text[DISPLAY_FIELD_TEXT_SIZE];
+} display_field_t;
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -12,6 +46,28 @@ u8g2_t *get_display_handler(void);
 void acquire_display_buffer_access(void);
 void release_display_buffer_access(void);
 
+/**
+ * Set the task that renders the current screen (NULL when none), it is notified with
+ * DISPLAY_NOTIFY_REDRAW.
+*/
+void display_set_render_task(TaskHandle_t task);
+
+void display_notify(uint32_t bits);
+
+/**
+ * Called by the render task, returns the notified bits (0 on timeout).
+*/
+uint32_t display_wait_for_change(TickType_t timeout_ticks);
+
+void display_field_init(display_field_t * field, const uint8_t * font, u8g2_uint_t x, u8g2_uint_t y, display_align_t align);
+
+/**
+ * Draw the field into the buffer if the text has changed (or the field is not valid). The area of the
+ * previous and the new text is cleared first. With send, the tiles of the area are sent to the display,
+ * otherwise the caller sends the buffer. Returns true if the field has been drawn.
+*/
+bool display_field_update(u8g2_t * u8g2, display_field_t * field, const char * text, bool send);
+
 // REST
 bool http_get_display_buffer(struct fs_file *file, int num_params, char *params[], char *values[]);
 
@@ -0,0 +1,360 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hardware/sync.h"
+
+#include "display_mirror.h"
+#include "rest_event_stream.h"
+
+
+#define DISPLAY_MIRROR_MAX_TILES            160
+#define DISPLAY_MIRROR_U8G2_BUFFER_SIZE     1024        // 128 x 64, 1 bit per pixel
+#define DISPLAY_MIRROR_RGB332_MAX_TILES     150         // 480 x 320 at DISPLAY_MIRROR_TFT_SCALE
+#define DISPLAY_MIRROR_MAX_TILE_BYTES       (DISPLAY_MIRROR_TFT_TILE_SIZE * DISPLAY_MIRROR_TFT_TILE_SIZE)
+
+// Longest HTTP response, a full Mini 12864 frame fits in one
+#define DISPLAY_MIRROR_HTTP_BUFFER_SIZE     2048
+
+
+typedef struct {
+    display_mirror_format_t format;
+    uint16_t width;                 // Shadow size in pixels
+    uint16_t height;
+    uint8_t tile_size;
+    uint16_t tiles_x;
+    uint16_t num_tiles;
+    uint16_t tile_bytes;
+    uint8_t * shadow;               // Tile by tile, tile_bytes each
+    uint32_t tile_frame[DISPLAY_MIRROR_MAX_TILES];  // Frame in which the tile last changed
+    volatile uint32_t frame;
+    bool pending;                   // RGB565: tiles changed since the last completed refresh
+    u8x8_msg_cb display_cb;         // u8g2: the wrapped display callback
+    spin_lock_t * lock;             // The shadow is read from the lwIP interrupt
+} display_mirror_t;
+
+
+static display_mirror_t display_mirror = {
+    .format = DISPLAY_MIRROR_FORMAT_NONE,
+};
+
+static uint8_t display_mirror_u8g2_shadow[DISPLAY_MIRROR_U8G2_BUFFER_SIZE];
+#ifdef USE_COLOR_TFT
+static uint8_t display_mirror_rgb332_shadow[DISPLAY_MIRROR_RGB332_MAX_TILES * DISPLAY_MIRROR_MAX_TILE_BYTES];
+#endif
+
+
+static void _init(display_mirror_format_t format, uint16_t width, uint16_t height, uint8_t tile_size, uint16_t tile_bytes, uint8_t * shadow) {
+    display_mirror.width = width;
+    display_mirror.height = height;
+    display_mirror.tile_size = tile_size;
+    display_mirror.tiles_x = (width + tile_size - 1) / tile_size;
+    display_mirror.num_tiles = display_mirror.tiles_x * ((height + tile_size - 1) / tile_size);
+    display_mirror.tile_bytes = tile_bytes;
+    display_mirror.shadow = shadow;
+
+    // Every tile is part of frame 1, so f=0 returns the full frame
+    display_mirror.frame = 1;
+    for (uint16_t tile = 0; tile < display_mirror.num_tiles; tile += 1) {
+        display_mirror.tile_frame[tile] = 1;
+    }
+
+    if (display_mirror.lock == NULL) {
+        display_mirror.lock = spin_lock_instance(spin_lock_claim_unused(true));
+    }
+    display_mirror.format = format;
+}
+
+
+/*
+  Mini 12864 (u8g2)
+*/
+// Capture the tiles in the given range (in tiles, clipped to the display)
+static void _capture_u8g2(u8g2_t * u8g2, uint16_t tile_x, uint16_t tile_y, uint16_t tile_w, uint16_t tile_h) {
+    // A full buffer is already stored tile by tile
+    const uint8_t * buffer = u8g2_GetBufferPtr(u8g2);
+    uint16_t tiles_y = display_mirror.num_tiles / display_mirror.tiles_x;
+    uint16_t x_end = (tile_x + tile_w < display_mirror.tiles_x) ? tile_x + tile_w : display_mirror.tiles_x;
+    uint16_t y_end = (tile_y + tile_h < tiles_y) ? tile_y + tile_h : tiles_y;
+    bool changed = false;
+
+    uint32_t irq_state = spin_lock_blocking(display_mirror.lock);
+    uint32_t next_frame = display_mirror.frame + 1;
+    for (uint16_t y = tile_y; y < y_end; y += 1) {
+        for (uint16_t x = tile_x; x < x_end; x += 1) {
+            uint16_t tile = y * display_mirror.tiles_x + x;
+            const uint8_t * src = buffer + tile * display_mirror.tile_bytes;
+            uint8_t * dst = display_mirror.shadow + tile * display_mirror.tile_bytes;
+            if (memcmp(src, dst, display_mirror.tile_bytes) != 0) {
+                memcpy(dst, src, display_mirror.tile_bytes);
+                display_mirror.tile_frame[tile] = next_frame;
+                changed = true;
+            }
+        }
+    }
+    if (changed) {
+        display_mirror.frame = next_frame;
+    }
+    spin_unlock(display_mirror.lock, irq_state);
+
+    if (changed) {
+        rest_event_stream_notify();
+    }
+}
+
+
+static uint8_t _u8g2_display_cb(u8x8_t * u8x8, uint8_t msg, uint8_t arg_int, void * arg_ptr) {
+    uint8_t result = display_mirror.display_cb(u8x8, msg, arg_int, arg_ptr);
+
+    // Sent at the end of u8g2_SendBuffer(), the buffer holds a complete frame
+    if (msg == U8X8_MSG_DISPLAY_REFRESH) {
+        _capture_u8g2((u8g2_t *) u8x8, 0, 0, display_mirror.tiles_x, display_mirror.num_tiles / display_mirror.tiles_x);
+    }
+
+    return result;
+}
+
+
+void display_mirror_attach_u8g2(u8g2_t * u8g2) {
+    uint16_t width = u8g2_GetBufferTileWidth(u8g2) * 8;
+    uint16_t height = u8g2_GetBufferTileHeight(u8g2) * 8;
+    if ((size_t) width * height / 8 > sizeof(display_mirror_u8g2_shadow)) {
+        printf("Display too large to mirror\n");
+        return;
+    }
+
+    _init(DISPLAY_MIRROR_FORMAT_U8G2_TILE, width, height, 8, 8, display_mirror_u8g2_shadow);
+
+    display_mirror.display_cb = u8g2->u8x8.display_cb;
+    u8g2->u8x8.display_cb = _u8g2_display_cb;
+}
+
+
+void display_mirror_capture_u8g2_area(u8g2_t * u8g2, uint8_t tile_x, uint8_t tile_y, uint8_t tile_w, uint8_t tile_h) {
+    if (display_mirror.format != DISPLAY_MIRROR_FORMAT_U8G2_TILE) {
+        return;
+    }
+
+    _capture_u8g2(u8g2, tile_x, tile_y, tile_w, tile_h);
+}
+
+
+/*
+  Colour TFT (LVGL)
+*/
+bool display_mirror_init_rgb565(uint16_t width, uint16_t height) {
+#ifdef USE_COLOR_TFT
+    uint16_t shadow_width = width / DISPLAY_MIRROR_TFT_SCALE;
+    uint16_t shadow_height = height / DISPLAY_MIRROR_TFT_SCALE;
+    uint16_t tiles = ((shadow_width + DISPLAY_MIRROR_TFT_TILE_SIZE - 1) / DISPLAY_MIRROR_TFT_TILE_SIZE) *
+                     ((shadow_height + DISPLAY_MIRROR_TFT_TILE_SIZE - 1) / DISPLAY_MIRROR_TFT_TILE_SIZE);
+    if (tiles > DISPLAY_MIRROR_RGB332_MAX_TILES) {
+        printf("Display too large to mirror\n");
+        return false;
+    }
+
+    _init(DISPLAY_MIRROR_FORMAT_RGB332, shadow_width, shadow_height, DISPLAY_MIRROR_TFT_TILE_SIZE,
+          DISPLAY_MIRROR_MAX_TILE_BYTES, display_mirror_rgb332_shadow);
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+static inline uint8_t _rgb565_to_rgb332(uint16_t colour) {
+    return ((colour >> 8) & 0xE0) | ((colour >> 6) & 0x1C) | ((colour >> 3) & 0x03);
+}
+
+
+void display_mirror_capture_area(int32_t x1, int32_t y1, int32_t x2, int32_t y2, const uint16_t * pixels, bool last) {
+    if (display_mirror.format != DISPLAY_MIRROR_FORMAT_RGB332) {
+        return;
+    }
+
+    const int32_t scale = DISPLAY_MIRROR_TFT_SCALE;
+    const uint8_t tile_size = display_mirror.tile_size;
+    int32_t area_width = x2 - x1 + 1;
+
+    // Shadow pixels whose source pixel is in the area
+    int32_t sx1 = (x1 + scale - 1) / scale;
+    int32_t sy1 = (y1 + scale - 1) / scale;
+    int32_t sx2 = x2 / scale < display_mirror.width - 1 ? x2 / scale : display_mirror.width - 1;
+    int32_t sy2 = y2 / scale < display_mirror.height - 1 ? y2 / scale : display_mirror.height - 1;
+
+    for (int32_t sy = sy1; sy <= sy2; sy += 1) {
+        const uint16_t * src_row = pixels + (sy * scale - y1) * area_width - x1;
+        uint16_t tile_row = (sy / tile_size) * display_mirror.tiles_x;
+        uint8_t * dst_row = display_mirror.shadow + (sy % tile_size) * tile_size;
+
+        // One row at a time keeps interrupts enabled most of the time
+        uint32_t irq_state = spin_lock_blocking(display_mirror.lock);
+        uint32_t next_frame = display_mirror.frame + 1;
+        for (int32_t sx = sx1; sx <= sx2; sx += 1) {
+            uint8_t value = _rgb565_to_rgb332(src_row[sx * scale]);
+            uint16_t tile = tile_row + sx / tile_size;
+            uint8_t * dst = dst_row + tile * display_mirror.tile_bytes + sx % tile_size;
+            if (*dst != value) {
+                *dst = value;
+                display_mirror.tile_frame[tile] = next_frame;
+                display_mirror.pending = true;
+            }
+        }
+        spin_unlock(display_mirror.lock, irq_state);
+    }
+
+    if (last && display_mirror.pending) {
+        display_mirror.pending = false;
+        display_mirror.frame += 1;
+        rest_event_stream_notify();
+    }
+}
+
+
+/*
+  Delta encoding
+*/
+// PackBits: n = 0..127 copies n + 1 literal bytes, n = 129..255 repeats the next byte 257 - n times
+static size_t _rle_encode(const uint8_t * src, size_t len, uint8_t * dst) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < len) {
+        size_t run = 1;
+        while (in + run < len && run < 128 && src[in + run] == src[in]) {
+            run += 1;
+        }
+        if (run >= 2) {
+            dst[out++] = (uint8_t) (257 - run);
+            dst[out++] = src[in];
+            in += run;
+            continue;
+        }
+
+        // Literal up to the start of the next run
+        size_t literal = 1;
+        while (in + literal < len && literal < 128 &&
+               !(in + literal + 1 < len && src[in + literal] == src[in + literal + 1])) {
+            literal += 1;
+        }
+        dst[out++] = (uint8_t) (literal - 1);
+        memcpy(dst + out, src + in, literal);
+        out += literal;
+        in += literal;
+    }
+
+    return out;
+}
+
+
+static inline void _put_u16(uint8_t * buf, uint16_t value) {
+    buf[0] = value & 0xFF;
+    buf[1] = value >> 8;
+}
+
+
+static inline void _put_u32(uint8_t * buf, uint32_t value) {
+    _put_u16(buf, value & 0xFFFF);
+    _put_u16(buf + 2, value >> 16);
+}
+
+
+uint32_t display_mirror_get_frame() {
+    return display_mirror.frame;
+}
+
+
+size_t display_mirror_encode(uint32_t since_frame, uint16_t first_tile, uint8_t * buf, size_t size) {
+    if (display_mirror.format == DISPLAY_MIRROR_FORMAT_NONE || size < DISPLAY_MIRROR_HEADER_SIZE) {
+        return 0;
+    }
+
+    // Tiles changed while encoding have a newer frame and are sent again next time
+    uint32_t frame = display_mirror.frame;
+    if (since_frame > frame) {
+        // Client from before a reboot
+        since_frame = 0;
+    }
+
+    // Tile header plus the PackBits worst case
+    size_t tile_max_len = 4 + display_mirror.tile_bytes + (display_mirror.tile_bytes + 127) / 128;
+    uint8_t tile_data[DISPLAY_MIRROR_MAX_TILE_BYTES];
+    size_t len = DISPLAY_MIRROR_HEADER_SIZE;
+    uint16_t num_tiles = 0;
+    uint16_t next_tile = 0;
+
+    for (uint16_t tile = first_tile; tile < display_mirror.num_tiles; tile += 1) {
+        uint32_t irq_state = spin_lock_blocking(display_mirror.lock);
+        bool changed = display_mirror.tile_frame[tile] > since_frame;
+        if (changed) {
+            memcpy(tile_data, display_mirror.shadow + tile * display_mirror.tile_bytes, display_mirror.tile_bytes);
+        }
+        spin_unlock(display_mirror.lock, irq_state);
+
+        if (!changed) {
+            continue;
+        }
+        if (len + tile_max_len > size) {
+            next_tile = tile;
+            break;
+        }
+
+        size_t data_len = _rle_encode(tile_data, display_mirror.tile_bytes, buf + len + 4);
+        _put_u16(buf + len, tile);
+        _put_u16(buf + len + 2, data_len);
+        len += 4 + data_len;
+        num_tiles += 1;
+    }
+
+    if (num_tiles == 0) {
+        return 0;
+    }
+
+    _put_u32(buf, frame);
+    _put_u16(buf + 4, next_tile);
+    _put_u16(buf + 6, display_mirror.width);
+    _put_u16(buf + 8, display_mirror.height);
+    buf[10] = display_mirror.format;
+    buf[11] = display_mirror.tile_size;
+    _put_u16(buf + 12, num_tiles);
+
+    return len;
+}
+
+
+bool http_display_frame(struct fs_file *file, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // f (int): Frame the client has, 0 (default) for the full frame
+    // t (int): First tile, next_tile of the previous response when it was incomplete
+    //
+    // Response: the delta (see display_mirror.h), or 304 Not Modified when no tile changed since f
+    static const char header[] = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nCache-Control: no-store\r\n\r\n";
+    static const char not_modified[] = "HTTP/1.1 304 Not Modified\r\nCache-Control: no-store\r\n\r\n";
+    static char display_frame_buffer[DISPLAY_MIRROR_HTTP_BUFFER_SIZE];
+
+    uint32_t since_frame = 0;
+    uint16_t first_tile = 0;
+    for (int idx = 0; idx < num_params; idx += 1) {
+        if (strcmp(params[idx], "f") == 0) {
+            since_frame = strtoul(values[idx], NULL, 10);
+        }
+        else if (strcmp(params[idx], "t") == 0) {
+            first_tile = strtoul(values[idx], NULL, 10);
+        }
+    }
+
+    size_t len = display_mirror_encode(since_frame, first_tile, (uint8_t *) display_frame_buffer + sizeof(header) - 1,
+                                       sizeof(display_frame_buffer) - (sizeof(header) - 1));
+    if (len == 0) {
+        file->data = not_modified;
+        file->len = sizeof(not_modified) - 1;
+    }
+    else {
+        memcpy(display_frame_buffer, header, sizeof(header) - 1);
+        file->data = display_frame_buffer;
+        file->len = sizeof(header) - 1 + len;
+    }
+    file->index = file->len;
+    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+
+    return true;
+}
@@ -0,0 +1,90 @@
+#ifndef DISPLAY_MIRROR_H_
+#define DISPLAY_MIRROR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <u8g2.h>
+#include "http_rest.h"
+
+// Versioned display mirror
+//
+// The displayed frame is kept as a shadow split into tiles. Each tile remembers the frame number in
+// which it last changed, so a client that has frame N only receives the tiles changed since N:
+//   - GET /display_frame?f=N returns the delta, or 304 Not Modified when nothing changed
+//   - WebSocket clients subscribed to WS_TOPIC_DISPLAY are pushed the delta on change
+//
+// Mini 12864: the u8g2 buffer is compared to the shadow on every u8g2_SendBuffer(). Tiles are the
+// u8g2 tiles (8 x 8 pixels, 8 bytes, one byte per column, LSB on top).
+// TFT: the areas flushed by LVGL are sampled into a half resolution RGB332 shadow. Tiles are
+// 16 x 16 pixels of the shadow, one byte per pixel, row by row.
+//
+// Delta format, little-endian:
+//   u32 frame          Frame the client has once all tiles are applied
+//   u16 next_tile      0 when complete, otherwise request again with the same f and t=next_tile
+//   u16 width, height  Shadow size in pixels
+//   u8 format          display_mirror_format_t
+//   u8 tile_size       Tile width and height in pixels
+//   u16 num_tiles
+//   Per tile: u16 tile index (row major), u16 data length, tile data as PackBits RLE
+
+
+#define DISPLAY_MIRROR_HEADER_SIZE      14
+#define DISPLAY_MIRROR_TFT_SCALE        2           // TFT shadow is 1/2 of the display in each direction
+#define DISPLAY_MIRROR_TFT_TILE_SIZE    16
+
+
+typedef enum {
+    DISPLAY_MIRROR_FORMAT_NONE = 0xFF,
+    DISPLAY_MIRROR_FORMAT_U8G2_TILE = 0,
+    DISPLAY_MIRROR_FORMAT_RGB332 = 1,
+} display_mirror_format_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Mirror a u8g2 full buffer display. The display callback is wrapped so the buffer is captured on
+ * every u8g2_SendBuffer().
+*/
+void display_mirror_attach_u8g2(u8g2_t * u8g2);
+
+/**
+ * Capture an area sent with u8g2_UpdateDisplayArea() (in tiles), which does not end with the refresh
+ * message the wrapped callback captures on.
+*/
+void display_mirror_capture_u8g2_area(u8g2_t * u8g2, uint8_t tile_x, uint8_t tile_y, uint8_t tile_w, uint8_t tile_h);
+
+/**
+ * Mirror an RGB565 display of the given size, fed by display_mirror_capture_area().
+*/
+bool display_mirror_init_rgb565(uint16_t width, uint16_t height);
+
+/**
+ * Sample a flushed RGB565 area (inclusive coordinates) into the shadow. last is true for the last
+ * area of a refresh, the frame number advances then.
+*/
+void display_mirror_capture_area(int32_t x1, int32_t y1, int32_t x2, int32_t y2, const uint16_t * pixels, bool last);
+
+/**
+ * Current frame number, starts at 1
+*/
+uint32_t display_mirror_get_frame(void);
+
+/**
+ * Encode the tiles changed since frame since_frame, starting at tile index first_tile, into buf.
+ * Returns the delta length, 0 if there is nothing to send (or no display is mirrored).
+*/
+size_t display_mirror_encode(uint32_t since_frame, uint16_t first_tile, uint8_t * buf, size_t size);
+
+// REST
+bool http_display_frame(struct fs_file *file, int num_params, char *params[], char *values[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // DISPLAY_MIRROR_H_
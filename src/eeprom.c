@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "pico/time.h"
 #include "hardware/regs/rosc.h"
 #include "hardware/regs/addressmap.h"
 
@@ -21,14 +22,14 @@
 #include "mini_12864_module.h"
 #include "profile.h"
 #include "system_control.h"
+#include "metrics.h"
+#include "trace.h"
+#include "hal_pico.h"
 
 
-extern bool cat24c256_eeprom_erase();
-extern void cat24c256_eeprom_init();
-extern bool cat24c256_write(uint16_t data_addr, uint8_t * data, size_t len);
-extern bool cat24c256_read(uint16_t data_addr, uint8_t * data, size_t len);
+#define EEPROM_MAX_SAVE_HANDLERS    16
 
-// Linked list implementation
+// Linked list implementation, the nodes come from a fixed pool
 typedef struct _eeprom_save_handler_node {
     eeprom_save_handler_t function_handler;
     struct _eeprom_save_handler_node * next;
@@ -36,7 +37,10 @@ typedef struct _eeprom_save_handler_node {
 
 // Singleton variables
 SemaphoreHandle_t eeprom_access_mutex = NULL;
+static StaticSemaphore_t eeprom_access_mutex_buffer;
 eeprom_metadata_t metadata;
+static _eeprom_save_handler_node_t eeprom_save_handler_nodes[EEPROM_MAX_SAVE_HANDLERS];
+static size_t eeprom_save_handler_count = 0;
 static _eeprom_save_handler_node_t * eeprom_save_handler_head = NULL;
 
 
@@ -55,11 +59,11 @@ uint32_t rnd(void){
 
 
 void eeprom_register_handler(eeprom_save_handler_t handler) {
-    _eeprom_save_handler_node_t * new_node = malloc(sizeof(_eeprom_save_handler_node_t));
-    if (new_node == NULL) {
+    if (eeprom_save_handler_count >= EEPROM_MAX_SAVE_HANDLERS) {
         report_error(ERR_EEPROM_HANDLER_ALLOC);
         return;
     }
+    _eeprom_save_handler_node_t * new_node = &eeprom_save_handler_nodes[eeprom_save_handler_count++];
     new_node->function_handler = handler;
 
     // Append to the head
@@ -79,7 +83,7 @@ uint8_t eeprom_save_all() {
 
 
 uint8_t eeprom_erase(bool reboot) {
-    cat24c256_eeprom_erase();
+    hal_eeprom_erase();
 
     if (reboot) {
         software_reboot();
@@ -91,14 +95,14 @@ uint8_t eeprom_erase(bool reboot) {
 
 bool eeprom_init(void) {
     bool is_ok = true;
-    eeprom_access_mutex = xSemaphoreCreateMutex();
+    eeprom_access_mutex = xSemaphoreCreateMutexStatic(&eeprom_access_mutex_buffer);
 
     if (eeprom_access_mutex == NULL) {
         printf("Unable to create EEPROM mutex\n");
         return false;
     }
     
-    cat24c256_eeprom_init();
+    hal_eeprom_init();
 
     // Read data revision, if match then move forward
     is_ok = eeprom_read(EEPROM_METADATA_BASE_ADDR, (uint8_t *) &metadata, sizeof(eeprom_metadata_t));
@@ -157,7 +161,7 @@ bool eeprom_read(uint16_t data_addr, uint8_t * data, size_t len) {
 
     _take_mutex(scheduler_state);
 
-    is_ok = cat24c256_read(data_addr, data, len);
+    is_ok = hal_eeprom_read(data_addr, data, len);
 
     _give_mutex(scheduler_state);
 
@@ -171,7 +175,11 @@ bool eeprom_write(uint16_t data_addr, uint8_t * data, size_t len) {
 
     _take_mutex(scheduler_state);
 
-    is_ok = cat24c256_write(data_addr, data, len);
+    uint32_t start_us = time_us_32();
+    TRACE(EEPROM_WRITE_START, len);
+    is_ok = hal_eeprom_write(data_addr, data, len);
+    TRACE(EEPROM_WRITE_END, len);
+    metrics_record_eeprom_write(len, time_us_32() - start_us);
 
     _give_mutex(scheduler_state);
 
@@ -181,7 +189,7 @@ bool eeprom_write(uint16_t data_addr, uint8_t * data, size_t len) {
 
 bool eeprom_get_board_id(char ** board_id_buffer, size_t bytes_to_copy) {
     if (bytes_to_copy > sizeof(metadata.unique_id)) {
-        report_error(ERR_EEPROM_INVALID_SIZE);
+        report_error_context(ERR_EEPROM_INVALID_SIZE, bytes_to_copy);
         return false;
     }
 
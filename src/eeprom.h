@@ -21,7 +21,8 @@
 #define EEPROM_TFT35_CONFIG_BASE_ADDR          11 * 1024       // 11K - TFT35 display settings
 #define EEPROM_AI_TUNING_HISTORY_BASE_ADDR     12 * 1024       // 12K - AI tuning ML history
 #define EEPROM_DISPLAY_CONFIG_BASE_ADDR        13 * 1024       // 13K - Display type selection
-// 14K-31K: Reserved for future use
+#define EEPROM_ERROR_LOG_BASE_ADDR             14 * 1024       // 14K - Error log of the last boot
+// 15K-31K: Reserved for future use
 
 #define EEPROM_METADATA_REV                     2              // 16 byte 
 
@@ -2,10 +2,14 @@
 #include <string.h>
 #include <FreeRTOS.h>
 #include <task.h>
+#include "pico/time.h"
+#include "hardware/sync.h"
 
 #include "error.h"
 #include "display.h"
 #include "neopixel_led.h"
+#include "eeprom.h"
+#include "rest_event_stream.h"
 
 // Error system state
 static error_system_state_t error_state = {
@@ -15,15 +19,48 @@ static error_system_state_t error_state = {
     .wifi_ready = false,
 };
 
-// Error log circular buffer
-static error_code_t error_log[ERROR_LOG_SIZE];
+// Error log circular buffer, written by the error task and read from the lwIP interrupt as well, so it
+// is guarded by a spin lock rather than a FreeRTOS critical section
+static error_record_t error_log[ERROR_LOG_SIZE];
 static uint8_t error_log_count = 0;
 static uint8_t error_log_write_idx = 0;
+static spin_lock_t * error_log_lock;
 
 // Last error that occurred
 static error_code_t last_error = ERR_NONE;
 static bool error_occurred = false;
 
+// Reported errors waiting for the error task. Single producer (the owning core, with interrupts
+// disabled) and single consumer (the error task).
+typedef struct {
+    error_record_t records[ERROR_RING_SIZE];
+    volatile uint32_t head;     // Written by the producer
+    volatile uint32_t tail;     // Written by the consumer
+    volatile uint32_t dropped;
+} error_ring_t;
+
+static error_ring_t error_rings[NUM_CORES];
+
+// Error log as saved in the EEPROM, oldest first
+typedef struct {
+    uint16_t revision;
+    uint8_t count;
+    uint8_t reserved;
+    error_record_t records[ERROR_LOG_SIZE];
+} eeprom_error_log_t;
+
+static eeprom_error_log_t error_eeprom_buffer;      // As in the EEPROM, read and written by the error task only
+static eeprom_error_log_t error_persist_buffer;     // Log to be saved, compared with the one in the EEPROM
+static error_record_t error_previous_log[ERROR_LOG_SIZE];   // Of the previous boot, oldest first
+static volatile uint8_t error_previous_count = 0;
+static bool error_previous_loaded = false;
+static volatile bool error_persist_pending = false;
+static TickType_t error_persist_tick;
+
+static TaskHandle_t error_task_handle = NULL;
+static StackType_t error_task_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t error_task_buffer;
+
 // Error LED color (red)
 #define ERROR_LED_COLOR 0xFF0000
 
@@ -32,6 +69,21 @@ static bool error_occurred = false;
 #define ERROR_LINE_HEIGHT 8
 #define ERROR_MAX_DISPLAY_LINES 5
 
+// The error task also wakes up this often, e.g., for a pending EEPROM save
+#define ERROR_TASK_PERIOD_MS 1000
+
+// The log is saved at most this often, an error burst costs one EEPROM write. While errors keep coming
+// the interval doubles up to the maximum, so a recurring error does not wear out the EEPROM.
+#define ERROR_PERSIST_INTERVAL_MS 5000
+#define ERROR_PERSIST_MAX_INTERVAL_MS 600000
+
+static uint32_t error_persist_interval_ms = ERROR_PERSIST_INTERVAL_MS;
+static bool error_persist_failed = false;      // Not saved again until reboot
+
+#define ERROR_LOG_EEPROM_REV 1
+
+static void error_task(void *p);
+
 void error_system_init(void) {
     error_state.eeprom_ready = false;
     error_state.neopixel_ready = false;
@@ -42,6 +94,15 @@ void error_system_init(void) {
     error_log_count = 0;
     error_log_write_idx = 0;
     memset(error_log, 0, sizeof(error_log));
+    error_log_lock = spin_lock_instance(spin_lock_claim_unused(true));
+
+    // Errors reported before the scheduler starts wait in the rings until the task runs
+    error_task_handle = xTaskCreateStatic(error_task, "Error Task", configMINIMAL_STACK_SIZE, NULL, 1,
+                                          error_task_stack, &error_task_buffer);
+    if (error_task_handle == NULL) {
+        // Nothing would render the error, say it here
+        printf("ERROR: Unable to create the error task\n");
+    }
 }
 
 void error_set_eeprom_ready(bool ready) {
@@ -60,8 +121,7 @@ void error_set_wifi_ready(bool ready) {
     error_state.wifi_ready = ready;
 }
 
-// Get short category string (max 3 chars)
-static const char* error_get_short_category(error_code_t code) {
+const char* error_code_to_category(error_code_t code) {
     if (code >= 100 && code < 200) return "EEP";
     if (code >= 200 && code < 300) return "DSP";
     if (code >= 300 && code < 400) return "LED";
@@ -93,10 +153,15 @@ const char* error_code_to_string(error_code_t code) {
         case ERR_DISPLAY_MUTEX_CREATE: return "Display mutex";
         case ERR_DISPLAY_INIT_FAIL: return "Display init";
         case ERR_DISPLAY_TASK_CREATE: return "Display task";
+        case ERR_DISPLAY_QUEUE_CREATE: return "Display queue";
+        case ERR_DISPLAY_FLUSH_TIMEOUT: return "Display flush";
+        case ERR_DISPLAY_BUS_TIMEOUT: return "Display bus";
 
         // Neopixel
         case ERR_NEOPIXEL_MUTEX_CREATE: return "Neopixel mutex";
         case ERR_NEOPIXEL_PIO_INIT: return "Neopixel PIO";
+        case ERR_NEOPIXEL_DMA_CLAIM: return "Neopixel DMA";
+        case ERR_NEOPIXEL_TIMER_CREATE: return "Neopixel timer";
 
         // WiFi
         case ERR_WIFI_INIT_FAIL: return "WiFi init";
@@ -123,6 +188,8 @@ const char* error_code_to_string(error_code_t code) {
         case ERR_SERVO_QUEUE_CREATE: return "Servo queue";
         case ERR_SERVO_SEMAPHORE_CREATE: return "Servo sema";
         case ERR_SERVO_TASK_CREATE: return "Servo task";
+        case ERR_SERVO_DMA_CLAIM: return "Servo DMA";
+        case ERR_SERVO_QUEUE_FULL: return "Servo queue full";
 
         // Profile
         case ERR_PROFILE_EEPROM_READ: return "Profile read";
@@ -135,6 +202,7 @@ const char* error_code_to_string(error_code_t code) {
         // REST
         case ERR_REST_QUEUE_CREATE: return "REST queue";
         case ERR_REST_ALLOC_FAIL: return "REST alloc";
+        case ERR_REST_TASK_CREATE: return "REST task";
 
         // Memory
         case ERR_MEMORY_ALLOC: return "Memory alloc";
@@ -165,12 +233,30 @@ static const char* error_get_category(error_code_t code) {
 }
 
 // Add error to log buffer
-static void error_log_add(error_code_t code) {
-    error_log[error_log_write_idx] = code;
+static void error_log_add(const error_record_t * record) {
+    uint32_t irq_state = spin_lock_blocking(error_log_lock);
+    error_log[error_log_write_idx] = *record;
     error_log_write_idx = (error_log_write_idx + 1) % ERROR_LOG_SIZE;
     if (error_log_count < ERROR_LOG_SIZE) {
         error_log_count++;
     }
+    last_error = (error_code_t) record->code;
+    error_occurred = true;
+    spin_unlock(error_log_lock, irq_state);
+}
+
+// Copy the log, oldest first, returns the count
+static uint8_t error_log_copy(error_record_t records[ERROR_LOG_SIZE]) {
+    uint32_t irq_state = spin_lock_blocking(error_log_lock);
+    uint8_t count = error_log_count;
+    for (uint8_t i = 0; i < count; i++) {
+        // Account for the circular buffer
+        int log_idx = (count < ERROR_LOG_SIZE) ? i : (error_log_write_idx + i) % ERROR_LOG_SIZE;
+        records[i] = error_log[log_idx];
+    }
+    spin_unlock(error_log_lock, irq_state);
+
+    return count;
 }
 
 // Update display with scrolling error list
@@ -184,6 +270,9 @@ static void error_update_display(void) {
         return;
     }
 
+    error_record_t records[ERROR_LOG_SIZE];
+    uint8_t count = error_log_copy(records);
+
     acquire_display_buffer_access();
 
     u8g2_ClearBuffer(display);
@@ -191,7 +280,7 @@ static void error_update_display(void) {
     // Title with error count
     u8g2_SetFont(display, u8g2_font_helvB08_tr);
     char title[20];
-    snprintf(title, sizeof(title), "ERRORS (%d)", error_log_count);
+    snprintf(title, sizeof(title), "ERRORS (%d)", count);
     u8g2_DrawStr(display, 5, 10, title);
 
     // Line under title
@@ -200,35 +289,16 @@ static void error_update_display(void) {
     // Show most recent errors (newest at bottom, scrolls up)
     u8g2_SetFont(display, u8g2_font_4x6_tf);  // Tiny fixed-width font, ~25 chars/row
 
-    uint8_t lines_to_show = (error_log_count < ERROR_MAX_DISPLAY_LINES)
-                            ? error_log_count
-                            : ERROR_MAX_DISPLAY_LINES;
-
-    // Calculate starting index for oldest error to display
-    int start_idx;
-    if (error_log_count <= ERROR_MAX_DISPLAY_LINES) {
-        // Show all errors from beginning
-        start_idx = 0;
-    } else {
-        // Show most recent ERROR_MAX_DISPLAY_LINES errors
-        start_idx = error_log_count - ERROR_MAX_DISPLAY_LINES;
-    }
+    uint8_t lines_to_show = (count < ERROR_MAX_DISPLAY_LINES) ? count : ERROR_MAX_DISPLAY_LINES;
+    uint8_t start_idx = count - lines_to_show;
 
     for (uint8_t i = 0; i < lines_to_show; i++) {
-        // Get error from log (accounting for circular buffer)
-        int log_idx;
-        if (error_log_count < ERROR_LOG_SIZE) {
-            log_idx = start_idx + i;
-        } else {
-            log_idx = (error_log_write_idx + start_idx + i) % ERROR_LOG_SIZE;
-        }
-
-        error_code_t code = error_log[log_idx];
+        error_code_t code = (error_code_t) records[start_idx + i].code;
 
         // Format: "EEP:105 EEPROM alloc"
         char line[32];
         snprintf(line, sizeof(line), "%s:%d %s",
-                 error_get_short_category(code),
+                 error_code_to_category(code),
                  (int)code,
                  error_code_to_string(code));
 
@@ -241,35 +311,217 @@ static void error_update_display(void) {
     release_display_buffer_access();
 }
 
-void report_error(error_code_t code) {
+
+static void error_wake_task(bool in_isr) {
+    if (error_task_handle == NULL || xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return;
+    }
+
+    if (in_isr) {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(error_task_handle, &higher_priority_task_woken);
+        portYIELD_FROM_ISR(higher_priority_task_woken);
+    }
+    else {
+        xTaskNotifyGive(error_task_handle);
+    }
+}
+
+
+void report_error_context(error_code_t code, uint32_t context) {
     if (code == ERR_NONE) {
         return;
     }
 
-    // Store error
-    last_error = code;
-    error_occurred = true;
+    bool in_isr = portCHECK_IF_IN_ISR();
+    const char * task_name = NULL;
+    if (!in_isr && xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        task_name = pcTaskGetName(NULL);
+    }
+    uint32_t time_ms = to_ms_since_boot(get_absolute_time());
+
+    uint32_t irq_state = save_and_disable_interrupts();
+
+    uint8_t core = get_core_num();
+    error_ring_t * ring = &error_rings[core];
+    uint32_t head = ring->head;
+    if (head - ring->tail >= ERROR_RING_SIZE) {
+        ring->dropped += 1;
+        restore_interrupts(irq_state);
+        return;
+    }
+
+    error_record_t * record = &ring->records[head & (ERROR_RING_SIZE - 1)];
+    record->time_ms = time_ms;
+    record->context = context;
+    record->code = (uint16_t) code;
+    record->core = core;
+    record->flags = in_isr ? ERROR_FLAG_ISR : 0;
+    if (task_name) {
+        strncpy(record->task, task_name, ERROR_TASK_NAME_SIZE - 1);
+        record->task[ERROR_TASK_NAME_SIZE - 1] = '\0';
+    }
+    else {
+        record->task[0] = '\0';
+    }
+
+    // Record before head, the error task runs on either core
+    __dmb();
+    ring->head = head + 1;
+
+    restore_interrupts(irq_state);
+
+    error_wake_task(in_isr);
+}
+
+
+void report_error(error_code_t code) {
+    report_error_context(code, 0);
+}
+
+
+// Pop the oldest record of all cores, returns false when the rings are empty
+static bool error_pop_oldest(error_record_t * record) {
+    error_ring_t * oldest = NULL;
+
+    for (uint8_t core = 0; core < NUM_CORES; core++) {
+        error_ring_t * ring = &error_rings[core];
+        if (ring->head == ring->tail) {
+            continue;
+        }
+        __dmb();
+        const error_record_t * next = &ring->records[ring->tail & (ERROR_RING_SIZE - 1)];
+        if (oldest == NULL ||
+            (int32_t) (next->time_ms - oldest->records[oldest->tail & (ERROR_RING_SIZE - 1)].time_ms) < 0) {
+            oldest = ring;
+        }
+    }
+
+    if (oldest == NULL) {
+        return false;
+    }
+
+    *record = oldest->records[oldest->tail & (ERROR_RING_SIZE - 1)];
+    __dmb();
+    oldest->tail += 1;
+
+    return true;
+}
+
 
-    // Add to error log
-    error_log_add(code);
+// Keep the log of the previous boot, then start over with the log of this boot
+static void error_load_previous(void) {
+    error_previous_loaded = true;
+
+    bool is_ok = eeprom_read(EEPROM_ERROR_LOG_BASE_ADDR, (uint8_t *) &error_eeprom_buffer, sizeof(error_eeprom_buffer));
+    if (!is_ok || error_eeprom_buffer.revision != ERROR_LOG_EEPROM_REV || error_eeprom_buffer.count > ERROR_LOG_SIZE) {
+        return;
+    }
+
+    if (error_eeprom_buffer.count > 0) {
+        memcpy(error_previous_log, error_eeprom_buffer.records, sizeof(error_previous_log));
+        // Records before count, /rest/errors may read them from the other core
+        __dmb();
+        error_previous_count = error_eeprom_buffer.count;
+
+        printf("Previous boot reported %d error(s), see /rest/errors\n", error_previous_count);
+        error_persist_pending = true;
+    }
+}
+
+
+static void error_persist(void) {
+    TickType_t now = xTaskGetTickCount();
+
+    // Back to back saves mean the errors keep coming, wait longer for the next one
+    if ((now - error_persist_tick) < pdMS_TO_TICKS(2 * error_persist_interval_ms)) {
+        error_persist_interval_ms *= 2;
+        if (error_persist_interval_ms > ERROR_PERSIST_MAX_INTERVAL_MS) {
+            error_persist_interval_ms = ERROR_PERSIST_MAX_INTERVAL_MS;
+        }
+    }
+    else {
+        error_persist_interval_ms = ERROR_PERSIST_INTERVAL_MS;
+    }
+    error_persist_pending = false;
+    error_persist_tick = now;
+
+    memset(&error_persist_buffer, 0, sizeof(error_persist_buffer));
+    error_persist_buffer.revision = ERROR_LOG_EEPROM_REV;
+    error_persist_buffer.count = error_log_copy(error_persist_buffer.records);
+
+    if (memcmp(&error_persist_buffer, &error_eeprom_buffer, sizeof(error_persist_buffer)) == 0) {
+        return;
+    }
+
+    // The EEPROM driver reports the failure, which would make the log pending again. Give up for this boot.
+    if (!eeprom_write(EEPROM_ERROR_LOG_BASE_ADDR, (uint8_t *) &error_persist_buffer, sizeof(error_persist_buffer))) {
+        printf("Unable to write error log to %x, not saved again until reboot\n", EEPROM_ERROR_LOG_BASE_ADDR);
+        error_persist_failed = true;
+        return;
+    }
+    error_eeprom_buffer = error_persist_buffer;
+}
+
+
+static void error_render(const error_record_t * record) {
+    error_code_t code = (error_code_t) record->code;
 
     // 1. Always log to printf (USB serial) - available from boot
-    printf("ERROR [%s] %d: %s\n",
+    printf("ERROR [%s] %d: %s (%lu ms, core %d, %s, context 0x%08lx)\n",
            error_get_category(code),
            (int)code,
-           error_code_to_string(code));
-
-    // 2. Set LED to red if neopixel is ready
-    if (error_state.neopixel_ready) {
-        // Set all LEDs to red to indicate error
-        _neopixel_led_set_colour(ERROR_LED_COLOR, ERROR_LED_COLOR, ERROR_LED_COLOR);
+           error_code_to_string(code),
+           (unsigned long) record->time_ms,
+           record->core,
+           (record->flags & ERROR_FLAG_ISR) ? "interrupt" : (record->task[0] ? record->task : "main"),
+           (unsigned long) record->context);
+
+    // 2. Push to event stream and WebSocket subscribers
+    if (error_state.wifi_ready) {
+        rest_event_stream_publish_error(record);
     }
+}
+
+
+static void error_task(void *p) {
+    error_record_t record;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ERROR_TASK_PERIOD_MS));
 
-    // 3. Update display with scrolling error list
-    error_update_display();
+        // The saved log is replaced with the one of this boot, read it first
+        if (!error_previous_loaded && error_state.eeprom_ready) {
+            error_load_previous();
+        }
+
+        bool has_new_errors = false;
+        while (error_pop_oldest(&record)) {
+            error_log_add(&record);
+            error_render(&record);
+            has_new_errors = true;
+        }
+
+        if (has_new_errors) {
+            // 3. Set LED to red if neopixel is ready
+            if (error_state.neopixel_ready) {
+                // Set all LEDs to red to indicate error, held over the animations until the errors are cleared
+                rgbw_u32_t error_colour = {._raw_colour = ERROR_LED_COLOR};
+                neopixel_led_set_error(error_colour);
+            }
 
-    // 4. WiFi/REST notification could be added here
-    // if (error_state.wifi_ready) { ... }
+            // 4. Update display with scrolling error list
+            error_update_display();
+
+            error_persist_pending = true;
+        }
+
+        // 5. Save the log for the next boot
+        if (error_persist_pending && error_previous_loaded && !error_persist_failed &&
+            (xTaskGetTickCount() - error_persist_tick) >= pdMS_TO_TICKS(error_persist_interval_ms)) {
+            error_persist();
+        }
+    }
 }
 
 error_code_t error_get_last(void) {
@@ -277,10 +529,19 @@ error_code_t error_get_last(void) {
 }
 
 void error_clear_last(void) {
+    uint32_t irq_state = spin_lock_blocking(error_log_lock);
     last_error = ERR_NONE;
     error_occurred = false;
     error_log_count = 0;
     error_log_write_idx = 0;
+    spin_unlock(error_log_lock, irq_state);
+
+    // Back to the current animation
+    if (error_state.neopixel_ready) {
+        neopixel_led_clear_error();
+    }
+
+    error_persist_pending = true;
 }
 
 bool error_has_occurred(void) {
@@ -291,18 +552,51 @@ uint8_t error_get_count(void) {
     return error_log_count;
 }
 
+bool error_get_record_at(uint8_t index, error_record_t * record) {
+    uint32_t irq_state = spin_lock_blocking(error_log_lock);
+    bool valid = index < error_log_count;
+    if (valid) {
+        // Calculate actual index in circular buffer
+        int log_idx;
+        if (error_log_count < ERROR_LOG_SIZE) {
+            log_idx = index;
+        } else {
+            log_idx = (error_log_write_idx + index) % ERROR_LOG_SIZE;
+        }
+        *record = error_log[log_idx];
+    }
+    spin_unlock(error_log_lock, irq_state);
+
+    return valid;
+}
+
 error_code_t error_get_at(uint8_t index) {
-    if (index >= error_log_count) {
+    error_record_t record;
+    if (!error_get_record_at(index, &record)) {
         return ERR_NONE;
     }
 
-    // Calculate actual index in circular buffer
-    int log_idx;
-    if (error_log_count < ERROR_LOG_SIZE) {
-        log_idx = index;
-    } else {
-        log_idx = (error_log_write_idx + index) % ERROR_LOG_SIZE;
+    return (error_code_t) record.code;
+}
+
+uint8_t error_get_previous_count(void) {
+    return error_previous_count;
+}
+
+bool error_get_previous_at(uint8_t index, error_record_t * record) {
+    if (index >= error_previous_count) {
+        return false;
     }
 
-    return error_log[log_idx];
+    __dmb();
+    *record = error_previous_log[index];
+    return true;
+}
+
+uint32_t error_get_dropped(void) {
+    uint32_t dropped = 0;
+    for (uint8_t core = 0; core < NUM_CORES; core++) {
+        dropped += error_rings[core].dropped;
+    }
+    return dropped;
 }
@@ -21,10 +21,15 @@ typedef enum {
     ERR_DISPLAY_MUTEX_CREATE = 200,
     ERR_DISPLAY_INIT_FAIL,
     ERR_DISPLAY_TASK_CREATE,
+    ERR_DISPLAY_QUEUE_CREATE,
+    ERR_DISPLAY_FLUSH_TIMEOUT,
+    ERR_DISPLAY_BUS_TIMEOUT,
 
     // Neopixel LED errors (3xx)
     ERR_NEOPIXEL_MUTEX_CREATE = 300,
     ERR_NEOPIXEL_PIO_INIT,
+    ERR_NEOPIXEL_DMA_CLAIM,
+    ERR_NEOPIXEL_TIMER_CREATE,
 
     // Wireless errors (4xx)
     ERR_WIFI_INIT_FAIL = 400,
@@ -51,6 +56,8 @@ typedef enum {
     ERR_SERVO_QUEUE_CREATE = 700,
     ERR_SERVO_SEMAPHORE_CREATE,
     ERR_SERVO_TASK_CREATE,
+    ERR_SERVO_DMA_CLAIM,
+    ERR_SERVO_QUEUE_FULL,
 
     // Profile errors (8xx)
     ERR_PROFILE_EEPROM_READ = 800,
@@ -63,6 +70,7 @@ typedef enum {
     // REST API errors (10xx)
     ERR_REST_QUEUE_CREATE = 1000,
     ERR_REST_ALLOC_FAIL,
+    ERR_REST_TASK_CREATE,
 
     // Memory errors (11xx)
     ERR_MEMORY_ALLOC = 1100,
@@ -75,6 +83,35 @@ typedef enum {
     ERR_UNKNOWN = 9999,
 } error_code_t;
 
+// Error reporting
+//
+// report_error() only writes a record (timestamp, code, core, task and a context word) into a ring owned
+// by the current core, with interrupts disabled for the few cycles of the copy, and wakes up the error
+// task. It is safe to call from any task or interrupt, before the scheduler starts as well. The error
+// task runs at a low priority and does the slow part: it prints the error, turns the LEDs red, draws the
+// error list, pushes the error to the event stream and WebSocket subscribers, and saves the log to the
+// EEPROM, so it can be read back after a reboot.
+
+
+// Maximum errors stored in log
+#define ERROR_LOG_SIZE 8
+
+// Records per core waiting for the error task, power of 2
+#define ERROR_RING_SIZE 16
+
+#define ERROR_TASK_NAME_SIZE 8
+
+#define ERROR_FLAG_ISR (1 << 0)        // Reported from an interrupt handler
+
+typedef struct {
+    uint32_t time_ms;                   // Since boot
+    uint32_t context;                   // Passed by the caller, e.g., the failing address, 0 if none
+    uint16_t code;                      // error_code_t
+    uint8_t core;
+    uint8_t flags;
+    char task[ERROR_TASK_NAME_SIZE];    // Reporting task, empty from main() or an interrupt
+} error_record_t;
+
 // Initialization state flags (what's available for error reporting)
 typedef struct {
     bool eeprom_ready;
@@ -87,7 +124,7 @@ typedef struct {
 extern "C" {
 #endif
 
-// Initialize error system (call early in main)
+// Initialize error system and create the error task (call early in main)
 void error_system_init(void);
 
 // Mark subsystems as ready for error reporting
@@ -97,12 +134,18 @@ void error_set_display_ready(bool ready);
 void error_set_wifi_ready(bool ready);
 
 // Main error reporting function
-// Reports via all available channels (printf, LED, display, etc.)
+// Queues the error for all available channels (printf, LED, display, event stream, EEPROM)
 void report_error(error_code_t code);
 
+// Same as report_error() with a context word kept with the error, e.g., the failing address
+void report_error_context(error_code_t code, uint32_t context);
+
 // Get human-readable error string
 const char* error_code_to_string(error_code_t code);
 
+// Get short category string (max 3 chars), e.g., "EEP"
+const char* error_code_to_category(error_code_t code);
+
 // Get last error (for REST API queries)
 error_code_t error_get_last(void);
 
@@ -118,8 +161,15 @@ uint8_t error_get_count(void);
 // Get error at index (0 = oldest in buffer)
 error_code_t error_get_at(uint8_t index);
 
-// Maximum errors stored in log
-#define ERROR_LOG_SIZE 8
+// Copy the record at index (0 = oldest in buffer), returns false if there is none
+bool error_get_record_at(uint8_t index, error_record_t * record);
+
+// Errors of the previous boot, read from the EEPROM (0 = oldest)
+uint8_t error_get_previous_count(void);
+bool error_get_previous_at(uint8_t index, error_record_t * record);
+
+// Errors lost as a ring was full
+uint32_t error_get_dropped(void);
 
 #ifdef __cplusplus
 }
@@ -11,6 +11,7 @@
 #include "configuration.h"
 #include "scale.h"
 #include "app.h"
+#include "scale_frame.h"
 
 const static char CMD_REQUEST_DATA_TRANSFER[] = "!p\r\n";
 const static char CMD_CALIBRATE_FUNC[] = "!q\r\n";
@@ -46,64 +47,26 @@ scale_handle_t gng_scale_handle = {
 };
 
 static float _decode_measurement_msg(gngscale_standard_data_format_t * msg) {
-    // Decode header
-    // Determine sign
-    int sign = 1;
-
-    // Check if the header contains a negative sign
-    if (msg->header[0] == '-') {
-        sign = -1;
-    }
-
-    // Decode weight information
-    char *endptr;
-    float weight = strtof(msg->data, &endptr);
-
-    if( endptr == msg->data ) {
-        // Conversion failed
-        return nanf(msg->data);
-    }
-
-    // Apply the sign
-    weight *= sign;
-
-    return weight;
+    // The header holds the sign
+    return scale_frame_parse_weight(msg->data, sizeof(msg->data), msg->header[0]);
 }
 
 //read UART
 void _gng_scale_listener_task(void *p) {
-    uint8_t string_buf_idx = 0;
     gngscale_standard_data_format_t frame;
+    scale_frame_reader_t reader;
+    scale_frame_reader_init(&reader, &frame, sizeof(frame), SCALE_FRAME_NO_HEADER);
 
     while (true) {
         // Request for a data transfer (ESC p)
-        uart_puts(SCALE_UART, CMD_REQUEST_DATA_TRANSFER);
-
-            // Read all data 
-        while (uart_is_readable(SCALE_UART)) {   
-            char ch = uart_getc(SCALE_UART);
-            frame.bytes[string_buf_idx++] = ch;
-
-            // If we have received 14 bytes then we can decode the message
-            if (string_buf_idx == sizeof(gngscale_standard_data_format_t)) {
-                // Data is ready, send to decode
-                scale_config.current_scale_measurement = _decode_measurement_msg(&frame);
-                // Signal the data is ready
-                if (scale_config.scale_measurement_ready) {
-                    xSemaphoreGive(scale_config.scale_measurement_ready);
-                }
-
-                // Reset
-                string_buf_idx = 0;
-            }
-
-            // \n is the terminator. We shall reset the receive of message on receiving any of those character.
-            if (ch =='\n') {
-                string_buf_idx = 0;
-            }
+        hal_uart_write(HAL_UART_SCALE, (const uint8_t *) CMD_REQUEST_DATA_TRANSFER, strlen(CMD_REQUEST_DATA_TRANSFER));
+
+        // Decode every frame received so far
+        while (scale_frame_read(&reader, HAL_UART_SCALE)) {
+            scale_update_measurement(_decode_measurement_msg(&frame));
         }
 
-        vTaskDelay(pdMS_TO_TICKS(250));
+        hal_delay_ms(250);
     }
 }
 
@@ -0,0 +1,47 @@
+#ifndef HAL_H_
+#define HAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Hardware abstraction layer
+//
+// Time and the UARTs, the hardware services of the modules that hold no hardware state of their own
+// (control law, scale frame parsing, ring buffers, the GP model, JSON and REST parameters), so they also
+// build for Linux with -DHOST_BUILD=ON. hal_pico.c maps the calls onto the pico-sdk and FreeRTOS,
+// host/hal_posix.c onto POSIX, with hooks for the tests to feed and inspect them.
+//
+// The GPIO, step generator, EEPROM and display services of the firmware only drivers are in hal_pico.h.
+// Modules tied to one peripheral (WiFi, lwIP, the u8g2 menus) keep calling the SDK directly.
+
+
+typedef enum {
+    HAL_UART_SCALE = 0,
+    HAL_UART_MOTOR,                     // TMC2209 single wire UART
+    HAL_NUM_UARTS,
+} hal_uart_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Time since power on
+uint32_t hal_time_us(void);
+uint32_t hal_time_ms(void);
+
+// Task delay once the scheduler runs, busy wait before
+void hal_delay_ms(uint32_t ms);
+
+// UART, configured (baud rate, pins) by its module
+bool hal_uart_is_readable(hal_uart_t uart);
+char hal_uart_getc(hal_uart_t uart);
+void hal_uart_write(hal_uart_t uart, const uint8_t * data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // HAL_H_
@@ -0,0 +1,116 @@
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+#include "hardware/spi.h"
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+
+#include "hal_pico.h"
+#include "configuration.h"
+#include "common.h"
+
+
+// CAT24C256 driver
+extern void cat24c256_eeprom_init();
+extern bool cat24c256_write(uint16_t data_addr, uint8_t * data, size_t len);
+extern bool cat24c256_read(uint16_t data_addr, uint8_t * data, size_t len);
+extern bool cat24c256_eeprom_erase();
+
+
+static uart_inst_t * _uart(hal_uart_t uart) {
+    return uart == HAL_UART_MOTOR ? MOTOR_UART : SCALE_UART;
+}
+
+
+uint32_t hal_time_us(void) {
+    return time_us_32();
+}
+
+uint32_t hal_time_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+void hal_delay_ms(uint32_t ms) {
+    delay_ms(ms, xTaskGetSchedulerState());
+}
+
+
+void hal_gpio_put(uint32_t pin, bool value) {
+    gpio_put(pin, value);
+}
+
+bool hal_gpio_get(uint32_t pin) {
+    return gpio_get(pin);
+}
+
+
+bool hal_uart_is_readable(hal_uart_t uart) {
+    return uart_is_readable(_uart(uart));
+}
+
+char hal_uart_getc(hal_uart_t uart) {
+    return uart_getc(_uart(uart));
+}
+
+void hal_uart_write(hal_uart_t uart, const uint8_t * data, size_t len) {
+    uart_write_blocking(_uart(uart), data, len);
+}
+
+
+uint32_t hal_step_clock_hz(void) {
+    // PIO runs from the system clock, read every time in case it has been changed
+    return clock_get_hz(clk_sys);
+}
+
+void hal_step_set_period(uint32_t pio_index, uint32_t sm, uint32_t high_cycles, bool block) {
+    PIO pio = pio_get_instance(pio_index);
+
+    pio_sm_clear_fifos(pio, sm);
+    if (block) {
+        pio_sm_put_blocking(pio, sm, high_cycles);
+    }
+    else {
+        pio_sm_put(pio, sm, high_cycles);
+    }
+}
+
+
+void hal_eeprom_init(void) {
+    cat24c256_eeprom_init();
+}
+
+bool hal_eeprom_read(uint16_t addr, uint8_t * data, size_t len) {
+    return cat24c256_read(addr, data, len);
+}
+
+bool hal_eeprom_write(uint16_t addr, const uint8_t * data, size_t len) {
+    return cat24c256_write(addr, (uint8_t *) data, len);
+}
+
+bool hal_eeprom_erase(void) {
+    return cat24c256_eeprom_erase();
+}
+
+
+void hal_display_write(const uint8_t * data, size_t len) {
+    spi_write_blocking(DISPLAY0_SPI, data, len);
+}
+
+void hal_display_set_pin(hal_display_pin_t pin, bool level) {
+    switch (pin) {
+        case HAL_DISPLAY_PIN_CS:
+            gpio_put(DISPLAY0_CS_PIN, level);
+            break;
+        case HAL_DISPLAY_PIN_DC:
+            gpio_put(DISPLAY0_A0_PIN, level);
+            break;
+        case HAL_DISPLAY_PIN_RESET:
+            gpio_put(DISPLAY0_RESET_PIN, level);
+            break;
+        default:
+            break;
+    }
+}
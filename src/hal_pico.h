@@ -0,0 +1,52 @@
+#ifndef HAL_PICO_H_
+#define HAL_PICO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hal.h"
+
+// Pico driver services
+//
+// The hardware services used only by the motor, EEPROM and mini 12864 drivers, which are firmware only,
+// on top of the portable ones in hal.h. hal_pico.c maps them onto the pico-sdk, there is no host
+// implementation.
+
+
+typedef enum {
+    HAL_DISPLAY_PIN_CS = 0,
+    HAL_DISPLAY_PIN_DC,                 // A0 on the mini 12864
+    HAL_DISPLAY_PIN_RESET,
+    HAL_NUM_DISPLAY_PINS,
+} hal_display_pin_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// GPIO, the pin shall be configured as an output by its module
+void hal_gpio_put(uint32_t pin, bool value);
+bool hal_gpio_get(uint32_t pin);
+
+// Step pulse generator, a PIO state machine running stepper.pio. The period is the number of high
+// cycles of the step pulse at hal_step_clock_hz(), the FIFO is flushed so it takes effect at once.
+uint32_t hal_step_clock_hz(void);
+void hal_step_set_period(uint32_t pio_index, uint32_t sm, uint32_t high_cycles, bool block);
+
+// I2C EEPROM (CAT24C256, 32 KiB)
+void hal_eeprom_init(void);
+bool hal_eeprom_read(uint16_t addr, uint8_t * data, size_t len);
+bool hal_eeprom_write(uint16_t addr, const uint8_t * data, size_t len);
+bool hal_eeprom_erase(void);
+
+// Display, SPI to the mini 12864 controller
+void hal_display_write(const uint8_t * data, size_t len);
+void hal_display_set_pin(hal_display_pin_t pin, bool level);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // HAL_PICO_H_
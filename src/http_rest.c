@@ -94,6 +94,11 @@
 #include "lwip/stats.h"
 #include "lwip/apps/fs.h"
 #include "http_rest.h"
+#include "websocket.h"
+#include "deferred_log.h"
+#include "metrics.h"
+#include "error.h"
+#include "pico/time.h"
 #include "lwip/def.h"
 
 #include "lwip/altcp.h"
@@ -110,6 +115,7 @@
 
 #include <string.h> /* memset */
 #include <stdlib.h> /* atoi */
+#include <stddef.h> /* offsetof */
 #include <stdio.h>
 
 #if LWIP_TCP && LWIP_CALLBACK_API
@@ -121,7 +127,11 @@
 #if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
 #define HTTP11_CONNECTIONKEEPALIVE  "Connection: keep-alive"
 #define HTTP11_CONNECTIONKEEPALIVE2 "Connection: Keep-Alive"
+#define HTTP11_CONNECTIONCLOSE      "Connection: close"
+#define HTTP11_CONNECTIONCLOSE2     "Connection: Close"
+#define HTTP11_VERSION              "HTTP/1.1"
 #endif
+#define HTTP11_UPGRADEWEBSOCKET     "Upgrade: websocket"
 
 #if LWIP_HTTPD_DYNAMIC_FILE_READ
 #define HTTP_IS_DYNAMIC_FILE(hs) ((hs)->buf != NULL)
@@ -133,11 +143,13 @@
 
 #ifndef HTTP_IS_DATA_VOLATILE
 /** tcp_write does not have to copy data when sent from rom-file-system directly */
-#define HTTP_IS_DATA_VOLATILE(hs)       (HTTP_IS_DYNAMIC_FILE(hs) ? TCP_WRITE_FLAG_COPY : 0)
+/** JSON responses reuse their chunk buffer, so these are copied as well */
+#define HTTP_IS_DATA_VOLATILE(hs)       ((HTTP_IS_DYNAMIC_FILE(hs) || ((hs)->response != NULL)) ? TCP_WRITE_FLAG_COPY : 0)
 #endif
-/** Default: dynamic headers are sent from ROM (non-dynamic headers are handled like file data) */
+/** Dynamic headers are sent from ROM, except headers rebuilt in the connection arena
+ * (see http_response_add_length()), the arena is reused by the next request */
 #ifndef HTTP_IS_HDR_VOLATILE
-#define HTTP_IS_HDR_VOLATILE(hs, ptr)   0
+#define HTTP_IS_HDR_VOLATILE(hs, ptr)   (http_arena_contains((hs), (ptr)) ? TCP_WRITE_FLAG_COPY : 0)
 #endif
 
 /* Return values for http_send_*() */
@@ -146,6 +158,46 @@
 #define HTTP_DATA_TO_SEND_CONTINUE 1
 #define HTTP_NO_DATA_TO_SEND       0
 
+#ifndef LWIP_HTTPD_EVENT_STREAM_MAX_CLIENTS
+/** Maximum number of concurrent text/event-stream connections. When exceeded,
+ * the oldest subscriber is closed (browsers reconnect EventSource on their own). */
+#define LWIP_HTTPD_EVENT_STREAM_MAX_CLIENTS 2
+#endif
+
+/** SSE comment line sent on idle polls so that dead subscribers time out */
+#define HTTP_EVENT_STREAM_HEARTBEAT ":\n\n"
+
+#ifndef LWIP_HTTPD_RESPONSE_CHUNK_SIZE
+/** Body bytes per chunk of a JSON handler response. Larger responses are sent
+ * with Transfer-Encoding: chunked, one chunk at a time as the send buffer drains. */
+#define LWIP_HTTPD_RESPONSE_CHUNK_SIZE 1024
+#endif
+
+/** Room in front of a chunk for the HTTP header and the chunk size line */
+#define HTTP_RESPONSE_PREFIX_SIZE   128
+/** Room after a chunk for CRLF and the terminating "0" CRLF CRLF */
+#define HTTP_RESPONSE_SUFFIX_SIZE   7
+
+#ifndef LWIP_HTTPD_ARENA_SIZE
+/** Per-connection scratch memory for the decoded URI, the CGI parameter arrays
+ * and the JSON response. Requests that do not fit are answered with an error. */
+#define LWIP_HTTPD_ARENA_SIZE 2560
+#endif
+
+#ifndef LWIP_HTTPD_MAX_KEEPALIVE_CONNS
+/** Maximum number of persistent connections kept open between requests. When
+ * exceeded, the oldest idle one is closed. */
+#define LWIP_HTTPD_MAX_KEEPALIVE_CONNS 4
+#endif
+
+#ifndef LWIP_HTTPD_KEEPALIVE_IDLE_POLLS
+/** Persistent connections without a new request for this many polls are closed */
+#define LWIP_HTTPD_KEEPALIVE_IDLE_POLLS 3
+#endif
+
+/** Longest HTTP header a REST handler may put in front of its body */
+#define HTTP_RESPONSE_MAX_HEADER_SIZE 256
+
 typedef struct {
   const char *name;
   u8_t shtml;
@@ -238,6 +290,21 @@ struct http_ssi_tag_description {
 
 #endif /* LWIP_HTTPD_SSI */
 
+/** Response of a JSON REST handler, allocated per connection while it is sent */
+struct http_response {
+  rest_response_t response;
+  rest_json_handler_t handler;
+  u8_t chunked;     /* Response did not fit into the first chunk */
+  u8_t done;        /* Handler has written its last part */
+  char chunk[HTTP_RESPONSE_PREFIX_SIZE + LWIP_HTTPD_RESPONSE_CHUNK_SIZE + HTTP_RESPONSE_SUFFIX_SIZE];
+};
+
+/** Bump allocator, everything is released at once when the request is done */
+struct http_arena {
+  u16_t used;
+  u32_t data[(LWIP_HTTPD_ARENA_SIZE + 3) / 4];
+};
+
 struct http_state {
 #if LWIP_HTTPD_KILL_OLD_ON_CONNECTIONS_EXCEEDED
   struct http_state *next;
@@ -255,17 +322,21 @@ struct http_state {
   char *buf;        /* File read buffer. */
   int buf_len;      /* Size of file read buffer, buf. */
 #endif /* LWIP_HTTPD_DYNAMIC_FILE_READ */
+  struct http_response *response; /* JSON handler response being sent */
   u32_t left;       /* Number of unsent bytes in buf. */
+  u32_t request_started_us; /* For the response time metric, 0 when no request is pending */
   u8_t retries;
+  u8_t event_stream; /* Connection stays open as text/event-stream */
 #if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
   u8_t keepalive;
+  struct pbuf *pipelined; /* Requests received while the current response is sent */
 #endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
 #if LWIP_HTTPD_SSI
   struct http_ssi_state *ssi;
 #endif /* LWIP_HTTPD_SSI */
 #if LWIP_HTTPD_CGI
-  char *params[LWIP_HTTPD_MAX_CGI_PARAMETERS]; /* Params extracted from the request URI */
-  char *param_vals[LWIP_HTTPD_MAX_CGI_PARAMETERS]; /* Values for each extracted param */
+  char **params;     /* Params extracted from the request URI (allocated from the arena) */
+  char **param_vals; /* Values for each extracted param (allocated from the arena) */
 #endif /* LWIP_HTTPD_CGI */
 #if LWIP_HTTPD_DYNAMIC_HEADERS
   const char *hdrs[NUM_FILE_HDR_STRINGS]; /* HTTP headers to be sent. */
@@ -285,6 +356,7 @@ struct http_state {
   u8_t post_finished;
 #endif /* LWIP_HTTPD_POST_MANUAL_WND */
 #endif /* LWIP_HTTPD_SUPPORT_POST*/
+  struct http_arena arena; /* Must be last, see http_state_init() */
 };
 
 #if HTTPD_USE_MEM_POOL
@@ -309,8 +381,16 @@ static err_t http_close_conn(struct altcp_pcb *pcb, struct http_state *hs);
 static err_t http_close_or_abort_conn(struct altcp_pcb *pcb, struct http_state *hs, u8_t abort_conn);
 static err_t http_find_file(struct http_state *hs, const char *uri, int is_09);
 static err_t http_init_file(struct http_state *hs, struct fs_file *file, int is_09, const char *uri, u8_t tag_check, char *params);
+static err_t http_request_too_large(struct http_state *hs, u16_t status, int is_09, const char *uri);
 static err_t http_poll(void *arg, struct altcp_pcb *pcb);
 static u8_t http_check_eof(struct altcp_pcb *pcb, struct http_state *hs);
+static void http_event_stream_subscribe(struct http_state *hs);
+static void http_event_stream_unsubscribe(struct http_state *hs);
+static u8_t http_response_next_chunk(struct altcp_pcb *pcb, struct http_state *hs);
+static u8_t http_arena_contains(struct http_state *hs, const void *ptr);
+#if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
+static void http_handle_pipelined(struct altcp_pcb *pcb, struct http_state *hs);
+#endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
 #if LWIP_HTTPD_FS_ASYNC_READ
 static void http_continue(void *connection);
 #endif /* LWIP_HTTPD_FS_ASYNC_READ */
@@ -377,11 +457,27 @@ http_remove_connection(struct http_state *hs)
   }
 }
 
+/** A persistent connection waiting for its next request */
+static u8_t
+http_is_idle_keepalive(struct http_state *hs)
+{
+#if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
+  return hs->keepalive && (hs->handle == NULL) && (hs->pipelined == NULL);
+#else /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
+  LWIP_UNUSED_ARG(hs);
+  return 0;
+#endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
+}
+
+/** Close the oldest connection, preferably one idle between requests, and
+ * event streams last as their browser reconnects with a new request. */
 static void
 http_kill_oldest_connection(u8_t ssi_required)
 {
   struct http_state *hs = http_connections;
   struct http_state *hs_free_next = NULL;
+  struct http_state *hs_idle_next = NULL;
+  struct http_state *hs_busy_next = NULL;
   while (hs && hs->next) {
 #if LWIP_HTTPD_SSI
     if (ssi_required) {
@@ -394,10 +490,20 @@ http_kill_oldest_connection(u8_t ssi_required)
 #endif /* LWIP_HTTPD_SSI */
     {
       hs_free_next = hs;
+      if (http_is_idle_keepalive(hs->next)) {
+        hs_idle_next = hs;
+      } else if (!hs->next->event_stream) {
+        hs_busy_next = hs;
+      }
     }
     LWIP_ASSERT("broken list", hs != hs->next);
     hs = hs->next;
   }
+  if (hs_idle_next != NULL) {
+    hs_free_next = hs_idle_next;
+  } else if (hs_busy_next != NULL) {
+    hs_free_next = hs_busy_next;
+  }
   if (hs_free_next != NULL) {
     LWIP_ASSERT("hs_free_next->next != NULL", hs_free_next->next != NULL);
     LWIP_ASSERT("hs_free_next->next->pcb != NULL", hs_free_next->next->pcb != NULL);
@@ -405,10 +511,29 @@ http_kill_oldest_connection(u8_t ssi_required)
     http_close_or_abort_conn(hs_free_next->next->pcb, hs_free_next->next, 1); /* this also unlinks the http_state from the list */
   }
 }
+#if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
+/** Keep at most LWIP_HTTPD_MAX_KEEPALIVE_CONNS connections open between requests */
+static void
+http_limit_keepalive_connections(void)
+{
+  u8_t idle = 0;
+  struct http_state *hs;
+  for (hs = http_connections; hs != NULL; hs = hs->next) {
+    if (http_is_idle_keepalive(hs)) {
+      idle++;
+    }
+  }
+  if (idle > LWIP_HTTPD_MAX_KEEPALIVE_CONNS) {
+    /* Never the newest connection, the one that just became idle */
+    http_kill_oldest_connection(0);
+  }
+}
+#endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
 #else /* LWIP_HTTPD_KILL_OLD_ON_CONNECTIONS_EXCEEDED */
 
 #define http_add_connection(hs)
 #define http_remove_connection(hs)
+#define http_limit_keepalive_connections()
 
 #endif /* LWIP_HTTPD_KILL_OLD_ON_CONNECTIONS_EXCEEDED */
 
@@ -445,14 +570,18 @@ http_ssi_state_free(struct http_ssi_state *ssi)
 static void
 http_state_init(struct http_state *hs)
 {
-  /* Initialize the structure. */
-  memset(hs, 0, sizeof(struct http_state));
+  /* Initialize the structure. The arena content needs no clearing. */
+  memset(hs, 0, offsetof(struct http_state, arena));
+  hs->arena.used = 0;
 #if LWIP_HTTPD_DYNAMIC_HEADERS
   /* Indicate that the headers are not yet valid */
   hs->hdr_index = NUM_FILE_HDR_STRINGS;
 #endif /* LWIP_HTTPD_DYNAMIC_HEADERS */
 }
 
+/** Connection pool and arena utilisation, see http_get_pool_stats() */
+static http_pool_stats_t http_pool_stats;
+
 /** Allocate a struct http_state. */
 static struct http_state *
 http_state_alloc(void)
@@ -467,10 +596,42 @@ http_state_alloc(void)
   if (ret != NULL) {
     http_state_init(ret);
     http_add_connection(ret);
+    http_pool_stats.connections_in_use++;
+    if (http_pool_stats.connections_in_use > http_pool_stats.connections_peak) {
+      http_pool_stats.connections_peak = http_pool_stats.connections_in_use;
+    }
+  } else {
+    http_pool_stats.connection_alloc_failures++;
+  }
+  return ret;
+}
+
+/** Allocate from the connection arena. Released by http_state_eof(). */
+static void *
+http_arena_alloc(struct http_state *hs, size_t size)
+{
+  void *ret;
+  size = LWIP_MEM_ALIGN_SIZE(size);
+  if (size > sizeof(hs->arena.data) - hs->arena.used) {
+    http_pool_stats.arena_alloc_failures++;
+    return NULL;
+  }
+  ret = (u8_t *)hs->arena.data + hs->arena.used;
+  hs->arena.used = (u16_t)(hs->arena.used + size);
+  if (hs->arena.used > http_pool_stats.arena_peak) {
+    http_pool_stats.arena_peak = hs->arena.used;
   }
   return ret;
 }
 
+/** Does ptr point into the connection arena? */
+static u8_t
+http_arena_contains(struct http_state *hs, const void *ptr)
+{
+  const u8_t *start = (const u8_t *)hs->arena.data;
+  return ((const u8_t *)ptr >= start) && ((const u8_t *)ptr < start + sizeof(hs->arena.data));
+}
+
 /** Free a struct http_state.
  * Also frees the file data if dynamic.
  */
@@ -493,6 +654,17 @@ http_state_eof(struct http_state *hs)
     hs->buf = NULL;
   }
 #endif /* LWIP_HTTPD_DYNAMIC_FILE_READ */
+  /* Sent, failed or aborted, let the handler release what it holds for the response */
+  if ((hs->response != NULL) && (hs->response->response.on_close != NULL)) {
+    hs->response->response.on_close(&hs->response->response);
+  }
+  /* Decoded URI, CGI parameters and response all live in the arena */
+  hs->response = NULL;
+#if LWIP_HTTPD_CGI
+  hs->params = NULL;
+  hs->param_vals = NULL;
+#endif /* LWIP_HTTPD_CGI */
+  hs->arena.used = 0;
 #if LWIP_HTTPD_SSI
   if (hs->ssi) {
     http_ssi_state_free(hs->ssi);
@@ -514,9 +686,17 @@ static void
 http_state_free(struct http_state *hs)
 {
   if (hs != NULL) {
+    http_event_stream_unsubscribe(hs);
+#if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
+    if (hs->pipelined != NULL) {
+      pbuf_free(hs->pipelined);
+      hs->pipelined = NULL;
+    }
+#endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
     http_state_eof(hs);
     http_remove_connection(hs);
     HTTP_FREE_HTTP_STATE(hs);
+    http_pool_stats.connections_in_use--;
   }
 }
 
@@ -654,9 +834,14 @@ http_close_conn(struct altcp_pcb *pcb, struct http_state *hs)
 static void
 http_eof(struct altcp_pcb *pcb, struct http_state *hs)
 {
+  if (hs->request_started_us != 0) {
+    metrics_record_http_response(time_us_32() - hs->request_started_us);
+  }
+
   /* HTTP/1.1 persistent connection? (Not supported for SSI) */
 #if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
   if (hs->keepalive) {
+    struct pbuf *pipelined = hs->pipelined;
     http_remove_connection(hs);
 
     http_state_eof(hs);
@@ -664,9 +849,13 @@ http_eof(struct altcp_pcb *pcb, struct http_state *hs)
     /* restore state: */
     hs->pcb = pcb;
     hs->keepalive = 1;
+    hs->pipelined = pipelined;
     http_add_connection(hs);
     /* ensure nagle doesn't interfere with sending all data as fast as possible: */
     altcp_nagle_disable(pcb);
+    /* pipelined requests are handled from http_sent(), once this response is acknowledged */
+    http_pool_stats.keepalive_responses++;
+    http_limit_keepalive_connections();
   } else
 #endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
   {
@@ -973,8 +1162,10 @@ get_http_content_length(struct http_state *hs)
     }
   }
 #if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
-  if (add_content_len) {
+  if (add_content_len && hs->keepalive) {
     hs->hdrs[HDR_STRINGS_IDX_CONTENT_LEN_KEEPALIVE] = g_psHTTPHeaderStrings[HTTP_HDR_KEEPALIVE_LEN];
+  } else if (add_content_len) {
+    hs->hdrs[HDR_STRINGS_IDX_CONTENT_LEN_KEEPALIVE] = g_psHTTPHeaderStrings[HTTP_HDR_CLOSE_LEN];
   } else {
     hs->hdrs[HDR_STRINGS_IDX_CONTENT_LEN_KEEPALIVE] = g_psHTTPHeaderStrings[HTTP_HDR_CONN_CLOSE];
     hs->keepalive = 0;
@@ -1106,6 +1297,10 @@ http_check_eof(struct altcp_pcb *pcb, struct http_state *hs)
     http_eof(pcb, hs);
     return 0;
   }
+  if (hs->response != NULL) {
+    /* JSON handler response: produce the next chunk */
+    return http_response_next_chunk(pcb, hs);
+  }
   bytes_left = fs_bytes_left(hs->handle);
   if (bytes_left <= 0) {
     /* We reached the end of the file so this request is done. */
@@ -1590,6 +1785,11 @@ http_send(struct altcp_pcb *pcb, struct http_state *hs)
     return 0;
   }
 
+  if (hs->event_stream && (hs->left == 0)) {
+    /* Initial response is out; events are pushed by http_event_stream_publish() */
+    return HTTP_NO_DATA_TO_SEND;
+  }
+
 #if LWIP_HTTPD_FS_ASYNC_READ
   /* Check if we are allowed to read from this file.
      (e.g. SSI might want to delay sending until data is available) */
@@ -1635,7 +1835,7 @@ http_send(struct altcp_pcb *pcb, struct http_state *hs)
     data_to_send = http_send_data_nonssi(pcb, hs);
   }
 
-  if ((hs->left == 0) && (fs_bytes_left(hs->handle) <= 0)) {
+  if ((hs->left == 0) && (fs_bytes_left(hs->handle) <= 0) && !hs->event_stream) {
     /* We reached the end of the file so this request is done.
      * This adds the FIN flag right into the last data segment. */
     LWIP_DEBUGF(HTTPD_DEBUG, ("End of file.\n"));
@@ -1986,7 +2186,7 @@ http_parse_request(struct pbuf *inp, struct http_state *hs, struct altcp_pcb *pc
   err_t err;
 #endif /* LWIP_HTTPD_SUPPORT_POST */
 
-  LWIP_UNUSED_ARG(pcb); /* only used for post */
+  LWIP_UNUSED_ARG(pcb); /* only used for post and websocket upgrade */
   LWIP_ASSERT("p != NULL", p != NULL);
   LWIP_ASSERT("hs != NULL", hs != NULL);
 
@@ -2084,10 +2284,14 @@ http_parse_request(struct pbuf *inp, struct http_state *hs, struct altcp_pcb *pc
         if (lwip_strnstr(data, CRLF CRLF, data_len) != NULL) {
           char *uri = sp1 + 1;
 #if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
-          /* This is HTTP/1.0 compatible: for strict 1.1, a connection
-             would always be persistent unless "close" was specified. */
-          if (!is_09 && (lwip_strnstr(data, HTTP11_CONNECTIONKEEPALIVE, data_len) ||
-                         lwip_strnstr(data, HTTP11_CONNECTIONKEEPALIVE2, data_len))) {
+          /* HTTP/1.1 connections are persistent unless "close" is specified,
+             HTTP/1.0 ones only with an explicit keep-alive. */
+          if (is_09 || lwip_strnstr(data, HTTP11_CONNECTIONCLOSE, data_len) ||
+              lwip_strnstr(data, HTTP11_CONNECTIONCLOSE2, data_len)) {
+            hs->keepalive = 0;
+          } else if ((strncmp(sp2 + 1, HTTP11_VERSION, sizeof(HTTP11_VERSION) - 1) == 0) ||
+                     lwip_strnstr(data, HTTP11_CONNECTIONKEEPALIVE, data_len) ||
+                     lwip_strnstr(data, HTTP11_CONNECTIONKEEPALIVE2, data_len)) {
             hs->keepalive = 1;
           } else {
             hs->keepalive = 0;
@@ -2119,6 +2323,13 @@ http_parse_request(struct pbuf *inp, struct http_state *hs, struct altcp_pcb *pc
           } else
 #endif /* LWIP_HTTPD_SUPPORT_POST */
           {
+            /* WebSocket upgrade: on success the pcb belongs to the websocket module */
+            char *hdrs = sp2 + 1;
+            u16_t hdrs_len = (u16_t)(data_len - (hdrs - data));
+            if (!is_09 && (lwip_strnstr(hdrs, HTTP11_UPGRADEWEBSOCKET, hdrs_len) != NULL) &&
+                websocket_upgrade(pcb, uri, hdrs, hdrs_len)) {
+              return ERR_ISCONN;
+            }
             return http_find_file(hs, uri, is_09);
           }
         }
@@ -2134,6 +2345,9 @@ http_parse_request(struct pbuf *inp, struct http_state *hs, struct altcp_pcb *pc
       (clen <= LWIP_HTTPD_REQ_QUEUELEN)) {
     /* request not fully received (too short or CRLF is missing) */
     return ERR_INPROGRESS;
+  } else if (hs->req->tot_len > LWIP_HTTPD_REQ_BUFSIZE) {
+    /* the header does not fit into the request buffer */
+    return http_request_too_large(hs, 431, 0, NULL);
   } else
 #endif /* LWIP_HTTPD_SUPPORT_REQUESTLIST */
   {
@@ -2476,6 +2690,14 @@ http_sent(void *arg, struct altcp_pcb *pcb, u16_t len)
 
   hs->retries = 0;
 
+#if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
+  if ((hs->handle == NULL) && (hs->pipelined != NULL)) {
+    /* previous response is done, continue with the next pipelined request */
+    http_handle_pipelined(pcb, hs);
+    return ERR_OK;
+  }
+#endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
+
   http_send(pcb, hs);
 
   return ERR_OK;
@@ -2516,6 +2738,31 @@ http_poll(void *arg, struct altcp_pcb *pcb)
       return ERR_OK;
     }
 
+#if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
+    if ((hs->handle == NULL) && (hs->pipelined != NULL)) {
+      http_handle_pipelined(pcb, hs);
+      return ERR_OK;
+    }
+
+    /* Persistent connection without a new request: free the slot */
+    if (http_is_idle_keepalive(hs) && (hs->retries >= LWIP_HTTPD_KEEPALIVE_IDLE_POLLS)) {
+      LWIP_DEBUGF(HTTPD_DEBUG, ("http_poll: keep-alive idle, close\n"));
+      http_pool_stats.keepalive_idle_closes++;
+      http_close_conn(pcb, hs);
+      return ERR_OK;
+    }
+#endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
+
+    if (hs->event_stream && (hs->left == 0)) {
+      /* Idle event stream: send a heartbeat, its ACK resets the retries in
+       * http_sent, so only subscribers that stopped responding time out. */
+      u16_t len = sizeof(HTTP_EVENT_STREAM_HEARTBEAT) - 1;
+      if (http_write(pcb, HTTP_EVENT_STREAM_HEARTBEAT, &len, 0) == ERR_OK) {
+        altcp_output(pcb);
+      }
+      return ERR_OK;
+    }
+
     /* If this connection has a file open, try to send some more data. If
      * it has not yet received a GET request, don't do this since it will
      * cause the connection to close immediately. */
@@ -2532,6 +2779,84 @@ http_poll(void *arg, struct altcp_pcb *pcb)
   return ERR_OK;
 }
 
+/** Parse a complete or partial request and start sending the response.
+ * Frees p.
+ */
+static void
+http_handle_request(struct altcp_pcb *pcb, struct http_state *hs, struct pbuf *p)
+{
+#if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
+  /* Only GET is supported, so a request ends with its header. Anything
+     after it is the next pipelined request. */
+  u16_t end = pbuf_memfind(p, CRLF CRLF, 4, 0);
+  if ((end != 0xFFFF) && ((u32_t)end + 4 < p->tot_len)) {
+    u16_t next_len = (u16_t)(p->tot_len - (end + 4));
+    struct pbuf *next = pbuf_alloc(PBUF_RAW, next_len, PBUF_RAM);
+    if (next != NULL) {
+      pbuf_copy_partial(p, next->payload, next_len, (u16_t)(end + 4));
+      hs->pipelined = next;
+    }
+  }
+#endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
+  err_t parsed = http_parse_request(p, hs, pcb);
+  LWIP_ASSERT("http_parse_request: unexpected return value", parsed == ERR_OK
+              || parsed == ERR_INPROGRESS || parsed == ERR_ARG || parsed == ERR_USE
+              || parsed == ERR_ISCONN);
+#if LWIP_HTTPD_SUPPORT_REQUESTLIST
+  if (parsed != ERR_INPROGRESS) {
+    /* request fully parsed or error */
+    if (hs->req != NULL) {
+      pbuf_free(hs->req);
+      hs->req = NULL;
+    }
+  }
+#endif /* LWIP_HTTPD_SUPPORT_REQUESTLIST */
+  pbuf_free(p);
+  if (parsed == ERR_OK) {
+#if LWIP_HTTPD_SUPPORT_POST
+    if (hs->post_content_len_left == 0)
+#endif /* LWIP_HTTPD_SUPPORT_POST */
+    {
+      LWIP_DEBUGF(HTTPD_DEBUG | LWIP_DBG_TRACE, ("http_recv: data %p len %"S32_F"\n", (const void *)hs->file, hs->left));
+      http_send(pcb, hs);
+    }
+  } else if (parsed == ERR_ARG) {
+    /* @todo: close on ERR_USE? */
+    http_close_conn(pcb, hs);
+  } else if (parsed == ERR_ISCONN) {
+    /* Upgraded to WebSocket, callbacks are already re-bound: only release the http state */
+    http_state_free(hs);
+  }
+}
+
+#if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
+/** Queue a request received while a response is sent. Returns 0 if there is
+ * no room, the request is dropped then. */
+static u8_t
+http_pipeline_append(struct http_state *hs, struct pbuf *p)
+{
+  if (hs->pipelined == NULL) {
+    hs->pipelined = p;
+    return 1;
+  }
+  if ((u32_t)hs->pipelined->tot_len + p->tot_len > LWIP_HTTPD_REQ_BUFSIZE) {
+    return 0;
+  }
+  pbuf_cat(hs->pipelined, p);
+  return 1;
+}
+
+/** Handle the next pipelined request, the previous response is done */
+static void
+http_handle_pipelined(struct altcp_pcb *pcb, struct http_state *hs)
+{
+  struct pbuf *p = hs->pipelined;
+  hs->pipelined = NULL;
+  hs->retries = 0;
+  http_handle_request(pcb, hs, p);
+}
+#endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
+
 /**
  * Data has been received on this pcb.
  * For HTTP 1.0, this should normally only happen once (if the request fits in one packet).
@@ -2583,33 +2908,21 @@ http_recv(void *arg, struct altcp_pcb *pcb, struct pbuf *p, err_t err)
   } else
 #endif /* LWIP_HTTPD_SUPPORT_POST */
   {
-    if (hs->handle == NULL) {
-      err_t parsed = http_parse_request(p, hs, pcb);
-      LWIP_ASSERT("http_parse_request: unexpected return value", parsed == ERR_OK
-                  || parsed == ERR_INPROGRESS || parsed == ERR_ARG || parsed == ERR_USE);
-#if LWIP_HTTPD_SUPPORT_REQUESTLIST
-      if (parsed != ERR_INPROGRESS) {
-        /* request fully parsed or error */
-        if (hs->req != NULL) {
-          pbuf_free(hs->req);
-          hs->req = NULL;
-        }
-      }
-#endif /* LWIP_HTTPD_SUPPORT_REQUESTLIST */
-      pbuf_free(p);
-      if (parsed == ERR_OK) {
-#if LWIP_HTTPD_SUPPORT_POST
-        if (hs->post_content_len_left == 0)
-#endif /* LWIP_HTTPD_SUPPORT_POST */
-        {
-          LWIP_DEBUGF(HTTPD_DEBUG | LWIP_DBG_TRACE, ("http_recv: data %p len %"S32_F"\n", (const void *)hs->file, hs->left));
-          http_send(pcb, hs);
-        }
-      } else if (parsed == ERR_ARG) {
-        /* @todo: close on ERR_USE? */
-        http_close_conn(pcb, hs);
+#if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
+    if ((hs->handle == NULL) && (hs->pipelined == NULL)) {
+      http_handle_request(pcb, hs, p);
+    } else if (hs->keepalive && http_pipeline_append(hs, p)) {
+      /* handled once the current response is done */
+      if (hs->handle == NULL) {
+        http_handle_pipelined(pcb, hs);
       }
-    } else {
+    } else
+#else /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
+    if (hs->handle == NULL) {
+      http_handle_request(pcb, hs, p);
+    } else
+#endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
+    {
       LWIP_DEBUGF(HTTPD_DEBUG, ("http_recv: already sending data\n"));
       /* already sending but still receiving data, we might want to RST here? */
       pbuf_free(p);
@@ -2776,37 +3089,401 @@ http_set_cgi_handlers(const tCGI *cgis, int num_handlers)
 //   Open Trickler Modified Code   //
 // //////////////////////////////////
 
+#define REST_MAX_ENDPOINTS      64      // Endpoints are registered once at boot, the nodes are not freed
+
 typedef struct _rest_endpoint_node{
-    char * uri;
+    const char * uri;
     rest_handler_t function_handler;
+    rest_json_handler_t json_handler;
     struct _rest_endpoint_node * next;
 } _rest_endpoint_node_t;
 
+static _rest_endpoint_node_t rest_endpoint_nodes[REST_MAX_ENDPOINTS];
+static size_t rest_endpoint_count = 0;
 static _rest_endpoint_node_t * rest_endpoint_head = NULL;
 
 
-void rest_register_handler(char * uri, rest_handler_t f) {
-    _rest_endpoint_node_t * new_node = malloc(sizeof(_rest_endpoint_node_t));
-    new_node->uri = strdup(uri);
+static void _rest_add_endpoint(char * uri, rest_handler_t f, rest_json_handler_t json_f) {
+    if (rest_endpoint_count >= REST_MAX_ENDPOINTS) {
+        report_error(ERR_REST_ALLOC_FAIL);
+        return;
+    }
+    _rest_endpoint_node_t * new_node = &rest_endpoint_nodes[rest_endpoint_count++];
+    new_node->uri = uri;    // URIs are string literals
     new_node->function_handler = f;
+    new_node->json_handler = json_f;
 
     // Add to the head
     new_node->next = rest_endpoint_head;
     rest_endpoint_head = new_node;
 }
 
-rest_handler_t rest_get_handler(const char *uri) {
-    rest_handler_t target_handler = NULL;
+static _rest_endpoint_node_t * _rest_find_endpoint(const char * uri) {
     for (_rest_endpoint_node_t * node = rest_endpoint_head; node != NULL; node = node->next) {
         if (strcmp(uri, node->uri) == 0) {
-            target_handler = node->function_handler;
+            return node;
+        }
+    }
+
+    return NULL;
+}
+
+void rest_register_handler(char * uri, rest_handler_t f) {
+    _rest_add_endpoint(uri, f, NULL);
+}
+
+void rest_register_json_handler(char * uri, rest_json_handler_t f) {
+    _rest_add_endpoint(uri, NULL, f);
+}
+
+rest_handler_t rest_get_handler(const char *uri) {
+    _rest_endpoint_node_t * node = _rest_find_endpoint(uri);
+    return node ? node->function_handler : NULL;
+}
+
+rest_json_handler_t rest_get_json_handler(const char *uri) {
+    _rest_endpoint_node_t * node = _rest_find_endpoint(uri);
+    return node ? node->json_handler : NULL;
+}
+
+/*
+  Event stream (Server-Sent Events) subscribers
+
+  A subscriber is a connection whose REST handler set FS_FILE_FLAGS_EVENT_STREAM. After the
+  initial response is sent the connection stays open, and http_event_stream_publish() pushes
+  each event to every subscriber that has room in its TCP send buffer. Slow subscribers skip
+  the event instead of queueing it, so a stalled browser never holds up the others.
+*/
+static struct http_state * event_stream_subscribers[LWIP_HTTPD_EVENT_STREAM_MAX_CLIENTS];
+
+
+// Slots are kept compact and ordered by age, the oldest subscriber is at index 0
+static void http_event_stream_subscribe(struct http_state * hs) {
+    u8_t count = http_event_stream_subscriber_count();
+
+    if (count == LWIP_HTTPD_EVENT_STREAM_MAX_CLIENTS) {
+        // Evict the oldest subscriber, closing it also unsubscribes and compacts the slots
+        struct http_state * oldest = event_stream_subscribers[0];
+        http_close_conn(oldest->pcb, oldest);
+        count -= 1;
+    }
+
+    event_stream_subscribers[count] = hs;
+    hs->event_stream = 1;
+
+    // Small events shall go out immediately
+    altcp_nagle_disable(hs->pcb);
+}
+
+
+static void http_event_stream_unsubscribe(struct http_state * hs) {
+    if (!hs->event_stream) {
+        return;
+    }
+
+    size_t idx = 0;
+    while (idx < LWIP_HTTPD_EVENT_STREAM_MAX_CLIENTS && event_stream_subscribers[idx] != hs) {
+        idx += 1;
+    }
+
+    // Shift the younger subscribers down
+    for (; idx < LWIP_HTTPD_EVENT_STREAM_MAX_CLIENTS; idx += 1) {
+        event_stream_subscribers[idx] = (idx + 1 < LWIP_HTTPD_EVENT_STREAM_MAX_CLIENTS) ? event_stream_subscribers[idx + 1] : NULL;
+    }
+
+    hs->event_stream = 0;
+}
+
+
+u8_t http_event_stream_subscriber_count(void) {
+    u8_t count = 0;
+    while (count < LWIP_HTTPD_EVENT_STREAM_MAX_CLIENTS && event_stream_subscribers[count] != NULL) {
+        count += 1;
+    }
+    return count;
+}
+
+
+void http_event_stream_publish(const char * data, u16_t len) {
+    for (size_t idx = 0; idx < LWIP_HTTPD_EVENT_STREAM_MAX_CLIENTS; idx += 1) {
+        struct http_state * hs = event_stream_subscribers[idx];
+        if (hs == NULL) {
             break;
         }
+
+        // Still sending the initial response
+        if (hs->left) {
+            continue;
+        }
+
+        // Backpressure: never split an event, drop it for this subscriber instead
+        if ((altcp_sndbuf(hs->pcb) < len) || (altcp_sndqueuelen(hs->pcb) >= TCP_SND_QUEUELEN / 2)) {
+            continue;
+        }
+
+        if (altcp_write(hs->pcb, data, len, TCP_WRITE_FLAG_COPY) == ERR_OK) {
+            altcp_output(hs->pcb);
+        }
     }
+}
+
 
-    return target_handler;
+/*
+  JSON handler responses
+
+  The handler writes through a json_writer_t straight into the chunk buffer of the connection. The
+  chunk keeps HTTP_RESPONSE_PREFIX_SIZE bytes free in front of the body, where the HTTP header (and
+  the chunk size line) is placed once the body length is known, so the body is never moved.
+
+  A response that fits into the first chunk is sent with Content-Length. Otherwise it is sent with
+  Transfer-Encoding: chunked and the handler is called for the next parts each time the previous
+  chunk has been handed to lwIP, so the response size is not limited by the chunk size.
+*/
+#define HTTP_RESPONSE_HEADER "HTTP/1.1 200 OK\r\nContent-Type: %s\r\n"
+#define HTTP_RESPONSE_DEFAULT_CONTENT_TYPE "application/json"
+
+static const char http_response_uri_too_long[] = "HTTP/1.1 414 URI Too Long\r\n"
+    "Content-Type: application/json\r\n\r\n"
+    "{\"error\":\"URI too long\"}";
+
+static const char http_response_header_too_large[] = "HTTP/1.1 431 Request Header Fields Too Large\r\n"
+    "Content-Type: application/json\r\n\r\n"
+    "{\"error\":\"Request header too large\"}";
+
+static const char http_response_part_too_large[] = "HTTP/1.1 500 Internal Server Error\r\n"
+    "Content-Type: application/json\r\n\r\n"
+    "{\"error\":\"Response part exceeds chunk size\"}";
+
+
+// Fill the chunk with as many parts as fit. Returns false if a single part does not fit into an empty chunk.
+static bool http_response_fill(struct http_response * r, int num_params, char * params[], char * values[]) {
+    json_writer_t * json = &r->response.json;
+    json_writer_set_buffer(json, r->chunk + HTTP_RESPONSE_PREFIX_SIZE, LWIP_HTTPD_RESPONSE_CHUNK_SIZE);
+
+    while (!r->done) {
+        rest_response_t saved = r->response;
+        bool more = r->handler(&r->response, num_params, params, values);
+
+        if (json_writer_overflow(json)) {
+            // Drop the incomplete part (and any cursor update), it is written again into the next chunk. A
+            // close hook it has set stays, the handler may already hold what the hook releases.
+            void (*on_close)(rest_response_t *) = r->response.on_close;
+            r->response = saved;
+            r->response.on_close = on_close;
+            if (json->len == 0) {
+                DLOG1(HTTP_PART_TOO_LARGE, r->response.part);
+                return false;
+            }
+            break;
+        }
+
+        r->response.part += 1;
+        r->done = !more;
+
+        // Request parameters only come with the first part
+        num_params = 0;
+        params = NULL;
+        values = NULL;
+    }
+
+    return true;
 }
 
+
+// Put the HTTP framing around the body in the chunk and return where it starts
+static const char * http_response_frame(struct http_response * r, bool first, u16_t * len) {
+    char prefix[HTTP_RESPONSE_PREFIX_SIZE];
+    size_t body_len = r->response.json.len;
+    const char * content_type = r->response.content_type ? r->response.content_type : HTTP_RESPONSE_DEFAULT_CONTENT_TYPE;
+    int prefix_len = 0;
+
+    if (first && r->done) {
+        prefix_len = snprintf(prefix, sizeof(prefix), HTTP_RESPONSE_HEADER "Content-Length: %u\r\n\r\n", content_type, (unsigned) body_len);
+    }
+    else {
+        if (first) {
+            r->chunked = 1;
+            prefix_len = snprintf(prefix, sizeof(prefix), HTTP_RESPONSE_HEADER "Transfer-Encoding: chunked\r\n\r\n", content_type);
+        }
+        // An empty chunk would end the response early
+        if (body_len > 0) {
+            prefix_len += snprintf(prefix + prefix_len, sizeof(prefix) - prefix_len, "%x\r\n", (unsigned) body_len);
+        }
+    }
+
+    char * start = r->chunk + HTTP_RESPONSE_PREFIX_SIZE - prefix_len;
+    memcpy(start, prefix, prefix_len);
+
+    char * end = r->chunk + HTTP_RESPONSE_PREFIX_SIZE + body_len;
+    if (r->chunked) {
+        if (body_len > 0) {
+            memcpy(end, "\r\n", 2);
+            end += 2;
+        }
+        if (r->done) {
+            memcpy(end, "0\r\n\r\n", 5);
+            end += 5;
+        }
+    }
+
+    *len = (u16_t) (end - start);
+    return start;
+}
+
+
+/*
+  Legacy handler responses
+
+  A legacy handler returns the HTTP header in front of the body, without Content-Length, so the
+  connection would have to be closed to end the response. The header lines are copied into the
+  connection arena and sent as dynamic header, followed by the Content-Length and Connection headers
+  from get_http_content_length(). The body is still sent straight from the handler buffer.
+*/
+static void http_response_add_length(struct http_state * hs, struct fs_file * file) {
+    const char * data = file->data;
+    const char * blank_line = lwip_strnstr(data, CRLF CRLF, LWIP_MIN(file->len, HTTP_RESPONSE_MAX_HEADER_SIZE));
+
+    // No header to rebuild, the connection is closed after the response
+    if ((file->flags & FS_FILE_FLAGS_HEADER_INCLUDED) == 0 || blank_line == NULL) {
+        file->flags &= ~FS_FILE_FLAGS_HEADER_PERSISTENT;
+        return;
+    }
+
+    size_t lines_len = blank_line + 2 - data;
+    if (lwip_strnstr(data, "Content-Length:", lines_len) != NULL) {
+        file->flags |= FS_FILE_FLAGS_HEADER_PERSISTENT;
+        return;
+    }
+
+    char * lines = (char *) http_arena_alloc(hs, lines_len + 1);
+    if (lines == NULL) {
+        file->flags &= ~FS_FILE_FLAGS_HEADER_PERSISTENT;
+        return;
+    }
+    memcpy(lines, data, lines_len);
+    lines[lines_len] = 0;
+
+    size_t header_len = blank_line + 4 - data;
+    file->data = data + header_len;
+    file->len -= header_len;
+    file->index = file->len;
+    file->flags |= FS_FILE_FLAGS_HEADER_PERSISTENT;
+
+    hs->hdrs[HDR_STRINGS_IDX_HTTP_STATUS] = lines;
+    hs->hdrs[HDR_STRINGS_IDX_SERVER_NAME] = NULL;
+    hs->hdrs[HDR_STRINGS_IDX_CONTENT_LEN_KEEPALIVE] = NULL;     // Set up by get_http_content_length()
+    hs->hdrs[HDR_STRINGS_IDX_CONTENT_LEN_NR] = NULL;
+    hs->hdrs[HDR_STRINGS_IDX_CONTENT_TYPE] = CRLF;              // End of the header
+    hs->hdr_index = 0;
+    hs->hdr_pos = 0;
+}
+
+
+// Returns NULL if the response does not fit into the arena next to the request URI
+static struct fs_file * http_response_start(struct http_state * hs, rest_json_handler_t handler, int num_params, char * params[], char * values[]) {
+    struct http_response * r = (struct http_response *) http_arena_alloc(hs, sizeof(struct http_response));
+    if (r == NULL) {
+        return NULL;
+    }
+
+    struct fs_file * file = &hs->file_handle;
+    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+
+    memset(r, 0, offsetof(struct http_response, chunk));
+    r->handler = handler;
+    json_writer_init(&r->response.json, NULL, 0);
+
+    if (!http_response_fill(r, num_params, params, values)) {
+        if (r->response.on_close != NULL) {
+            r->response.on_close(&r->response);
+        }
+        file->data = http_response_part_too_large;
+        file->len = sizeof(http_response_part_too_large) - 1;
+        file->index = file->len;
+        return file;
+    }
+
+    u16_t len;
+    hs->response = r;
+    file->data = http_response_frame(r, true, &len);
+    file->len = len;
+    file->index = len;
+
+    // Content-Length or chunked, the end of the response is known to the client
+    file->flags |= FS_FILE_FLAGS_HEADER_PERSISTENT;
+
+    return file;
+}
+
+
+static u8_t http_response_next_chunk(struct altcp_pcb * pcb, struct http_state * hs) {
+    struct http_response * r = hs->response;
+
+    if (r->done) {
+        http_eof(pcb, hs);
+        return 0;
+    }
+
+    // Closing the connection in the middle of a chunked response tells the client it is incomplete
+    if (!http_response_fill(r, 0, NULL, NULL)) {
+        http_close_conn(pcb, hs);
+        return 0;
+    }
+
+    u16_t len;
+    hs->file = http_response_frame(r, false, &len);
+    hs->left = len;
+
+    return 1;
+}
+
+
+void http_get_pool_stats(http_pool_stats_t * stats) {
+    *stats = http_pool_stats;
+    stats->connections_max = MEMP_NUM_PARALLEL_HTTPD_CONNS;
+    stats->arena_size = sizeof(((struct http_state *) NULL)->arena.data);
+}
+
+
+bool http_rest_http_pool(rest_response_t * response, int num_params, char * params[], char * values[]) {
+    // Mappings
+    // c0 (int): Connections in use
+    // c1 (int): Peak connections in use
+    // c2 (int): Connection pool size
+    // c3 (int): Connections refused because the pool was empty
+    // a0 (int): Arena size per connection (bytes)
+    // a1 (int): Peak arena use (bytes)
+    // a2 (int): Requests that did not fit into the arena
+    // k0 (int): Responses after which the connection stayed open (keep-alive)
+    // k1 (int): Persistent connections closed for being idle
+    // m0 (int): lwIP heap (MEM_SIZE) in use (bytes)
+    // m1 (int): Peak lwIP heap use (bytes)
+    // m2 (int): lwIP heap size (bytes)
+    http_pool_stats_t stats;
+    http_get_pool_stats(&stats);
+
+    json_writer_t * json = &response->json;
+    json_begin_object(json);
+    json_add_uint(json, "c0", stats.connections_in_use);
+    json_add_uint(json, "c1", stats.connections_peak);
+    json_add_uint(json, "c2", stats.connections_max);
+    json_add_uint(json, "c3", stats.connection_alloc_failures);
+    json_add_uint(json, "a0", stats.arena_size);
+    json_add_uint(json, "a1", stats.arena_peak);
+    json_add_uint(json, "a2", stats.arena_alloc_failures);
+    json_add_uint(json, "k0", stats.keepalive_responses);
+    json_add_uint(json, "k1", stats.keepalive_idle_closes);
+#if MEM_STATS
+    json_add_uint(json, "m0", lwip_stats.mem.used);
+    json_add_uint(json, "m1", lwip_stats.mem.max);
+    json_add_uint(json, "m2", MEM_SIZE);
+#endif
+    json_end_object(json);
+
+    return false;
+}
+
+
 /*
   Decode special characters in URI into the regular ASCII characters
 
@@ -2843,14 +3520,42 @@ void decode_uri(char * dst, const char * src) {
 }
 
 
+/*
+  Answer a request that does not fit: 414 when the URI does not fit into the connection arena, 431 when
+  the header does not fit into the request buffer. The response has no Content-Length, the connection
+  is closed after it.
+*/
+static err_t http_request_too_large(struct http_state * hs, u16_t status, int is_09, const char * uri) {
+    DLOG1(HTTP_REQUEST_TOO_LARGE, status);
+
+    struct fs_file * file = &hs->file_handle;
+    if (status == 431) {
+        file->data = http_response_header_too_large;
+        file->len = sizeof(http_response_header_too_large) - 1;
+    }
+    else {
+        file->data = http_response_uri_too_long;
+        file->len = sizeof(http_response_uri_too_long) - 1;
+    }
+    file->index = file->len;
+    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+
+    return http_init_file(hs, file, is_09, uri, 0, NULL);
+}
+
+
 static err_t http_find_file(struct http_state * hs, const char * uri, int is_09) {
     struct fs_file * file = NULL;
     char * params = NULL;
 
-    // The decoded URI will be fed to the parameter and REST handler loopup
-    // decoded_uri will be within the scope of `http_find_file` exclusively
-    char decoded_uri[strlen(uri) + 1];
-    memset(decoded_uri, 0x0, sizeof(decoded_uri));
+    // The decoded URI will be fed to the parameter and REST handler loopup. It lives in the
+    // connection arena, as the parameters point into it until the response is complete.
+    char * decoded_uri = (char *) http_arena_alloc(hs, strlen(uri) + 1);
+    hs->params = (char **) http_arena_alloc(hs, LWIP_HTTPD_MAX_CGI_PARAMETERS * sizeof(char *));
+    hs->param_vals = (char **) http_arena_alloc(hs, LWIP_HTTPD_MAX_CGI_PARAMETERS * sizeof(char *));
+    if (decoded_uri == NULL || hs->params == NULL || hs->param_vals == NULL) {
+        return http_request_too_large(hs, 414, is_09, uri);
+    }
     decode_uri(decoded_uri, uri);
 
     // First, isolate the base URI (without any parameters)
@@ -2861,15 +3566,16 @@ static err_t http_find_file(struct http_state * hs, const char * uri, int is_09)
         params += 1;
     }
 
-    printf("HTTP request: '%s'\n", decoded_uri);
+    DLOG_TEXT(HTTP_REQUEST, decoded_uri);
+    metrics_record_http_request();
+    hs->request_started_us = time_us_32() | 1;     // Never 0
 
     // Look for handler
     rest_handler_t rest_handler = rest_get_handler(decoded_uri);
+    rest_json_handler_t json_handler = rest_get_json_handler(decoded_uri);
 
-    if (rest_handler) {
-        printf("Handler found for '%s'\n", decoded_uri);
-    } else {
-        printf("No handler for '%s' - returning 404\n", decoded_uri);
+    if (!rest_handler && !json_handler) {
+        DLOG_TEXT(HTTP_NOT_FOUND, decoded_uri);
     }
 
     if (rest_handler) {
@@ -2878,6 +3584,24 @@ static err_t http_find_file(struct http_state * hs, const char * uri, int is_09)
 
         rest_handler(&hs->file_handle, http_cgi_paramcount, hs->params, hs->param_vals);
         file = &hs->file_handle;
+
+        // Keep the connection open for streaming handlers
+        if (file->flags & FS_FILE_FLAGS_EVENT_STREAM) {
+            http_event_stream_subscribe(hs);
+        }
+        else if (!is_09) {
+            http_response_add_length(hs, file);
+        }
+    }
+    else if (json_handler) {
+        // Extract parameters from the uri
+        http_cgi_paramcount = extract_uri_parameters(hs, params);
+
+        file = http_response_start(hs, json_handler, http_cgi_paramcount, hs->params, hs->param_vals);
+        if (file == NULL) {
+            // The arena only holds the request before the response, the URI took the room
+            return http_request_too_large(hs, 414, is_09, uri);
+        }
     }
 
     if (file == NULL) {
@@ -2887,7 +3611,9 @@ static err_t http_find_file(struct http_state * hs, const char * uri, int is_09)
         rest_handler(&hs->file_handle, http_cgi_paramcount, hs->params, hs->param_vals);
 
         file = &hs->file_handle;
-
+        if (!is_09) {
+            http_response_add_length(hs, file);
+        }
     }
 
     uint8_t tag_check = 0;
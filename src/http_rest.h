@@ -31,6 +31,7 @@ static const char *const g_psHTTPHeaderStrings[] = {
   "\r\n<html><body><h2>404: The requested file cannot be found.</h2></body></html>\r\n"
 #if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
   , "Connection: keep-alive\r\nContent-Length: 77\r\n\r\n<html><body><h2>404: The requested file cannot be found.</h2></body></html>\r\n"
+  , "Connection: close\r\nContent-Length: "
 #endif
 };
 
@@ -51,6 +52,7 @@ static const char *const g_psHTTPHeaderStrings[] = {
 #define DEFAULT_404_HTML        13 /* default 404 body */
 #if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
 #define DEFAULT_404_HTML_PERSISTENT 14 /* default 404 body, but including Connection: keep-alive */
+#define HTTP_HDR_CLOSE_LEN      15 /* Connection: close + Content-Length: (HTTP 1.1, not persistent) */
 #endif
 
 #define HTTP_CONTENT_TYPE(contenttype) "Content-Type: " contenttype "\r\n\r\n"
@@ -127,6 +129,7 @@ static const char *const g_pcSSIExtensions[] = {
 // REST Interface methods
 
 #include <lwip/apps/fs.h>
+#include "json_writer.h"
 
 typedef enum {
     HTTP_METHOD_GET,
@@ -134,7 +137,42 @@ typedef enum {
 } http_method_t;
 
 
-typedef bool (*rest_handler_t)(struct fs_file *file, int num_params, char *params[], char *values[]); 
+typedef bool (*rest_handler_t)(struct fs_file *file, int num_params, char *params[], char *values[]);
+
+// Response of a JSON handler. The writer emits into a chunk owned by the connection.
+typedef struct rest_response {
+    json_writer_t json;
+    u32_t part;         // 0 on the first call, the only call with request parameters
+    u32_t cursor;       // Free for the handler to carry state from one part to the next
+    const char * content_type;  // Set in part 0 for a non-JSON body, NULL for application/json
+    void (*on_close)(struct rest_response *response);  // Called once when the response is done, sent or not
+} rest_response_t;
+
+/**
+ * JSON REST handler, called with part = 0, 1, 2, ... until it returns false.
+ *
+ * Each call writes one part of the response. A part that does not fit into the current chunk is
+ * dropped, together with its cursor update, and the handler is called again for the same part once the
+ * chunk is sent, so parts shall only depend on the part number and the cursor. Small responses are
+ * typically written in one part.
+*/
+typedef bool (*rest_json_handler_t)(rest_response_t *response, int num_params, char *params[], char *values[]);
+
+typedef struct {
+    u16_t connections_in_use;
+    u16_t connections_peak;
+    u16_t connections_max;
+    u16_t arena_size;               // Bytes per connection
+    u16_t arena_peak;               // Most bytes used by a single request
+    u32_t connection_alloc_failures;
+    u32_t arena_alloc_failures;
+    u32_t keepalive_responses;      // Responses after which the connection stayed open
+    u32_t keepalive_idle_closes;    // Persistent connections closed for being idle
+} http_pool_stats_t;
+
+// Set by a REST handler to keep the connection open as a text/event-stream after the
+// initial response is sent. Further events are pushed with http_event_stream_publish().
+#define FS_FILE_FLAGS_EVENT_STREAM  0x80
 
 #ifdef __cplusplus
 extern "C" {
@@ -143,6 +181,16 @@ extern "C" {
 
 void rest_register_handler(char * uri, rest_handler_t f);
 rest_handler_t rest_get_handler(const char *uri);
+void rest_register_json_handler(char * uri, rest_json_handler_t f);
+rest_json_handler_t rest_get_json_handler(const char *uri);
+
+// Connection pool and arena utilisation. Must be called with the lwIP lock held.
+void http_get_pool_stats(http_pool_stats_t * stats);
+bool http_rest_http_pool(rest_response_t * response, int num_params, char * params[], char * values[]);
+
+// Event stream (Server-Sent Events). Must be called with the lwIP lock held.
+u8_t http_event_stream_subscriber_count(void);
+void http_event_stream_publish(const char * data, u16_t len);
 
 
 #ifdef __cplusplus
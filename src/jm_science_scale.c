@@ -11,6 +11,7 @@
 #include "configuration.h"
 #include "scale.h"
 #include "app.h"
+#include "scale_frame.h"
 
 
 typedef union {
@@ -45,60 +46,23 @@ scale_handle_t jm_science_scale_handle = {
 
 
 static float _decode_measurement_msg(jm_science_frame_data_format_t * frame) {
-    // decode sign 
-    int sign = 1;
-    if (frame->symbol == '-') {
-        sign = -1;
-    }
-
-    // Decode weight information
-    char *endptr;
-    float weight = strtof(frame->weighing_data, &endptr);
-
-    if( endptr == frame->weighing_data ) {
-        // Conversion failed
-        return nanf(frame->weighing_data);
-    }
-
-    weight *= sign;
-
-    return weight;
+    // The symbol holds the sign
+    return scale_frame_parse_weight(frame->weighing_data, sizeof(frame->weighing_data), frame->symbol);
 }
 
 
 void _jm_science_scale_listener_task(void *p) {
     jm_science_frame_data_format_t frame;
-    uint8_t byte_idx = 0;
+    scale_frame_reader_t reader;
+    scale_frame_reader_init(&reader, &frame, sizeof(frame), JM_SCIENCE_FRAME_HEADER);
 
     while (true) {
-        // Read all data 
-        while (uart_is_readable(SCALE_UART)) {
-            char ch = uart_getc(SCALE_UART);
-
-            // Determine if the frame header is received
-            // If a header is received then we should reset the decode sequence
-            if (ch == JM_SCIENCE_FRAME_HEADER) {
-                byte_idx = 0;
-            }
-
-            frame.bytes[byte_idx++] = ch;
-
-            // If we have received 17 bytes then we can decode the message
-            if (byte_idx == sizeof(jm_science_frame_data_format_t)) {
-                // Data is ready, send to decode
-                scale_config.current_scale_measurement = _decode_measurement_msg(&frame);
-
-                // Signal the data is ready
-                if (scale_config.scale_measurement_ready) {
-                    xSemaphoreGive(scale_config.scale_measurement_ready);
-                }
-
-                // Reset buffer index to avoid overflow
-                byte_idx = 0;
-            }
+        // Decode every frame received so far
+        while (scale_frame_read(&reader, HAL_UART_SCALE)) {
+            scale_update_measurement(_decode_measurement_msg(&frame));
         }
 
-        vTaskDelay(pdMS_TO_TICKS(20));
+        hal_delay_ms(20);
     }
 }
 
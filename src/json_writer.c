@@ -0,0 +1,260 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "json_writer.h"
+
+
+static void _append(json_writer_t * writer, const char * data, size_t len) {
+    if (writer->overflow) {
+        return;
+    }
+    if (len > writer->size - writer->len) {
+        writer->overflow = true;
+        return;
+    }
+    memcpy(writer->buf + writer->len, data, len);
+    writer->len += len;
+}
+
+
+static void _append_char(json_writer_t * writer, char c) {
+    _append(writer, &c, 1);
+}
+
+
+// Format in place, the formatted text is only kept if it fits entirely
+static void _append_vformat(json_writer_t * writer, const char * format, va_list args) {
+    if (writer->overflow) {
+        return;
+    }
+
+    size_t remaining = writer->size - writer->len;
+    int len = vsnprintf(writer->buf + writer->len, remaining, format, args);
+
+    if (len < 0 || (size_t) len >= remaining) {
+        writer->overflow = true;
+        return;
+    }
+    writer->len += len;
+}
+
+
+static void _append_format(json_writer_t * writer, const char * format, ...) __attribute__((format(printf, 2, 3)));
+static void _append_format(json_writer_t * writer, const char * format, ...) {
+    va_list args;
+    va_start(args, format);
+    _append_vformat(writer, format, args);
+    va_end(args);
+}
+
+
+static void _append_escaped(json_writer_t * writer, const char * s) {
+    _append_char(writer, '"');
+
+    while (*s && !writer->overflow) {
+        // Copy the longest run that needs no escaping in one go
+        const char * run = s;
+        while (*s && *s != '"' && *s != '\\' && (unsigned char) *s >= 0x20) {
+            s += 1;
+        }
+        _append(writer, run, s - run);
+
+        if (*s == '"' || *s == '\\') {
+            char escaped[2] = {'\\', *s};
+            _append(writer, escaped, sizeof(escaped));
+            s += 1;
+        }
+        else if (*s) {
+            _append_format(writer, "\\u%04x", (unsigned char) *s);
+            s += 1;
+        }
+    }
+
+    _append_char(writer, '"');
+}
+
+
+// Comma between elements, unless the value belongs to a key
+static void _separator(json_writer_t * writer) {
+    if (writer->after_key) {
+        writer->after_key = false;
+        return;
+    }
+
+    uint32_t level_mask = 1u << writer->depth;
+    if (writer->depth > 0 && (writer->first & level_mask) == 0) {
+        _append_char(writer, ',');
+    }
+    writer->first &= ~level_mask;
+}
+
+
+static void _begin(json_writer_t * writer, char c) {
+    _separator(writer);
+    _append_char(writer, c);
+
+    if (writer->depth + 1 >= JSON_WRITER_MAX_DEPTH) {
+        writer->overflow = true;
+        return;
+    }
+    writer->depth += 1;
+    writer->first |= 1u << writer->depth;
+}
+
+
+static void _end(json_writer_t * writer, char c) {
+    if (writer->depth > 0) {
+        writer->depth -= 1;
+    }
+    _append_char(writer, c);
+}
+
+
+void json_writer_init(json_writer_t * writer, char * buf, size_t size) {
+    writer->buf = buf;
+    writer->size = size;
+    writer->len = 0;
+    writer->first = 1;
+    writer->depth = 0;
+    writer->after_key = false;
+    writer->overflow = false;
+}
+
+
+void json_writer_set_buffer(json_writer_t * writer, char * buf, size_t size) {
+    writer->buf = buf;
+    writer->size = size;
+    writer->len = 0;
+    writer->overflow = false;
+}
+
+
+void json_begin_object(json_writer_t * writer) {
+    _begin(writer, '{');
+}
+
+
+void json_end_object(json_writer_t * writer) {
+    _end(writer, '}');
+}
+
+
+void json_begin_array(json_writer_t * writer) {
+    _begin(writer, '[');
+}
+
+
+void json_end_array(json_writer_t * writer) {
+    _end(writer, ']');
+}
+
+
+void json_key(json_writer_t * writer, const char * key) {
+    _separator(writer);
+    _append_escaped(writer, key);
+    _append_char(writer, ':');
+    writer->after_key = true;
+}
+
+
+void json_string(json_writer_t * writer, const char * value) {
+    _separator(writer);
+    _append_escaped(writer, value);
+}
+
+
+void json_int(json_writer_t * writer, int32_t value) {
+    _separator(writer);
+    _append_format(writer, "%ld", (long) value);
+}
+
+
+void json_uint(json_writer_t * writer, uint32_t value) {
+    _separator(writer);
+    _append_format(writer, "%lu", (unsigned long) value);
+}
+
+
+void json_float(json_writer_t * writer, float value, uint8_t decimal_places) {
+    _separator(writer);
+    if (isfinite(value)) {
+        _append_format(writer, "%.*f", (int) decimal_places, value);
+    }
+    else {
+        _append(writer, "null", 4);
+    }
+}
+
+
+void json_bool(json_writer_t * writer, bool value) {
+    _separator(writer);
+    if (value) {
+        _append(writer, "true", 4);
+    }
+    else {
+        _append(writer, "false", 5);
+    }
+}
+
+
+void json_raw(json_writer_t * writer, const char * value, size_t len) {
+    _separator(writer);
+    _append(writer, value, len);
+}
+
+
+void json_writer_printf(json_writer_t * writer, const char * format, ...) {
+    va_list args;
+    va_start(args, format);
+    _append_vformat(writer, format, args);
+    va_end(args);
+}
+
+
+void json_writer_write(json_writer_t * writer, const void * data, size_t len) {
+    _append(writer, data, len);
+}
+
+
+void json_add_object(json_writer_t * writer, const char * key) {
+    json_key(writer, key);
+    json_begin_object(writer);
+}
+
+
+void json_add_array(json_writer_t * writer, const char * key) {
+    json_key(writer, key);
+    json_begin_array(writer);
+}
+
+
+void json_add_string(json_writer_t * writer, const char * key, const char * value) {
+    json_key(writer, key);
+    json_string(writer, value);
+}
+
+
+void json_add_int(json_writer_t * writer, const char * key, int32_t value) {
+    json_key(writer, key);
+    json_int(writer, value);
+}
+
+
+void json_add_uint(json_writer_t * writer, const char * key, uint32_t value) {
+    json_key(writer, key);
+    json_uint(writer, value);
+}
+
+
+void json_add_float(json_writer_t * writer, const char * key, float value, uint8_t decimal_places) {
+    json_key(writer, key);
+    json_float(writer, value, decimal_places);
+}
+
+
+void json_add_bool(json_writer_t * writer, const char * key, bool value) {
+    json_key(writer, key);
+    json_bool(writer, value);
+}
@@ -0,0 +1,85 @@
+#ifndef JSON_WRITER_H_
+#define JSON_WRITER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Streaming JSON writer
+//
+// Values are formatted straight into a caller provided buffer (e.g., the response chunk of an HTTP
+// connection), commas and string escaping are handled by the writer. Nothing is allocated and there is
+// no static state, so any number of writers can be active at the same time.
+//
+// When a value does not fit, the writer stops writing and reports overflow. The caller may save a copy
+// of the writer before emitting a part and restore it to drop an incomplete part.
+
+#define JSON_WRITER_MAX_DEPTH   32
+
+
+typedef struct {
+    char * buf;
+    size_t size;
+    size_t len;
+    uint32_t first;         // One bit per nesting level, set until the first element is written
+    uint8_t depth;
+    bool after_key;         // A key has been written, the next value follows without a comma
+    bool overflow;
+} json_writer_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void json_writer_init(json_writer_t * writer, char * buf, size_t size);
+
+/**
+ * Continue writing into a new buffer, e.g., the next chunk of a response. The nesting is kept.
+*/
+void json_writer_set_buffer(json_writer_t * writer, char * buf, size_t size);
+
+static inline bool json_writer_overflow(const json_writer_t * writer) {
+    return writer->overflow;
+}
+
+// Containers
+void json_begin_object(json_writer_t * writer);
+void json_end_object(json_writer_t * writer);
+void json_begin_array(json_writer_t * writer);
+void json_end_array(json_writer_t * writer);
+
+// Values, used for array elements or after json_key()
+void json_key(json_writer_t * writer, const char * key);
+void json_string(json_writer_t * writer, const char * value);
+void json_int(json_writer_t * writer, int32_t value);
+void json_uint(json_writer_t * writer, uint32_t value);
+void json_float(json_writer_t * writer, float value, uint8_t decimal_places);      // Non-finite values are written as null
+void json_bool(json_writer_t * writer, bool value);
+void json_raw(json_writer_t * writer, const char * value, size_t len);                // Already serialised JSON value
+
+/**
+ * Append formatted text as is, without separator or escaping, e.g., for a plain text response
+*/
+void json_writer_printf(json_writer_t * writer, const char * format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * Append bytes as is, e.g., for a binary response. Nothing is written unless all of them fit.
+*/
+void json_writer_write(json_writer_t * writer, const void * data, size_t len);
+
+// Object members
+void json_add_object(json_writer_t * writer, const char * key);
+void json_add_array(json_writer_t * writer, const char * key);
+void json_add_string(json_writer_t * writer, const char * key, const char * value);
+void json_add_int(json_writer_t * writer, const char * key, int32_t value);
+void json_add_uint(json_writer_t * writer, const char * key, uint32_t value);
+void json_add_float(json_writer_t * writer, const char * key, float value, uint8_t decimal_places);
+void json_add_bool(json_writer_t * writer, const char * key, bool value);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // JSON_WRITER_H_
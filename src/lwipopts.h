@@ -11,6 +11,10 @@
 #undef MEM_SIZE
 #define MEM_SIZE                    16000
 
+// Track heap use and its peak, reported by /rest/http_pool
+#undef MEM_STATS
+#define MEM_STATS                   1
+
 // Increase TCP send buffer for large HTML pages
 #undef TCP_SND_BUF
 #define TCP_SND_BUF                 (16 * TCP_MSS)
@@ -46,6 +50,19 @@
 #define LWIP_HTTPD_MAX_CGI_PARAMETERS 16
 #define LWIP_HTTPD_MAX_REQUEST_URI_LEN 2048
 
+// HTTP connection state (including the per-connection arena) comes from a static pool
+#define HTTPD_USE_MEM_POOL          1
+#define MEMP_NUM_PARALLEL_HTTPD_CONNS 6
+#define LWIP_HTTPD_ARENA_SIZE       2560
+
+// HTTP/1.1 persistent connections. At most LWIP_HTTPD_MAX_KEEPALIVE_CONNS connections are kept open
+// between requests, idle ones are closed after LWIP_HTTPD_KEEPALIVE_IDLE_POLLS polls (2 s each). When
+// the pool runs out, the oldest idle connection is closed to accept the new one.
+#define LWIP_HTTPD_SUPPORT_11_KEEPALIVE 1
+#define LWIP_HTTPD_KILL_OLD_ON_CONNECTIONS_EXCEEDED 1
+#define LWIP_HTTPD_MAX_KEEPALIVE_CONNS 4
+#define LWIP_HTTPD_KEEPALIVE_IDLE_POLLS 3
+
 #if !NO_SYS
 #define TCPIP_THREAD_STACKSIZE 4096
 #define DEFAULT_THREAD_STACKSIZE 1024
@@ -0,0 +1,599 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "metrics.h"
+#include "profile.h"
+#include "error.h"
+
+
+#define METRICS_CONTENT_TYPE            "text/plain; version=0.0.4; charset=utf-8"
+#define METRICS_MAX_BUCKETS             10          // Upper bounds per histogram, +Inf is added
+
+
+typedef struct {
+    volatile uint32_t value[NUM_CORES];
+} metrics_counter_t;
+
+typedef struct {
+    volatile uint32_t buckets[NUM_CORES][METRICS_MAX_BUCKETS + 1];     // Not cumulative, the last one is +Inf
+    volatile float sum[NUM_CORES];
+} metrics_histogram_t;
+
+typedef struct {
+    const char * name;
+    const char * type;
+    const char * help;
+    uint8_t (*num_series)(void);
+    void (*write_series)(json_writer_t * writer, const char * name, uint8_t idx);
+} metrics_family_t;
+
+
+typedef enum {
+    CHARGE_PHASE_COARSE = 0,
+    CHARGE_PHASE_FINE,
+    CHARGE_PHASE_TOTAL,
+    NUM_CHARGE_PHASES,
+} charge_phase_t;
+
+static const char * const charge_phase_names[NUM_CHARGE_PHASES] = {"coarse", "fine", "total"};
+static const char * const motor_names[METRICS_NUM_MOTORS] = {"coarse", "fine"};
+
+// Bucket upper bounds
+static const float charge_phase_bounds[] = {1, 2, 5, 10, 15, 20, 30, 60, 120};
+static const float overthrow_bounds[] = {-0.1f, -0.04f, -0.02f, 0, 0.02f, 0.04f, 0.06f, 0.1f, 0.2f, 0.5f};
+static const float http_response_bounds[] = {0.001f, 0.0025f, 0.005f, 0.01f, 0.025f, 0.05f, 0.1f, 0.25f, 0.5f, 1};
+static const float display_frame_bounds[] = {0.005f, 0.01f, 0.015f, 0.02f, 0.03f, 0.04f, 0.05f, 0.075f, 0.1f, 0.25f};
+
+static metrics_counter_t charges_completed;
+static metrics_histogram_t charge_phase_seconds[NUM_CHARGE_PHASES];
+static metrics_histogram_t charge_overthrow[MAX_PROFILE_CNT];
+static metrics_counter_t scale_frames;
+static metrics_counter_t scale_errors;
+static metrics_counter_t motor_commands[METRICS_NUM_MOTORS];
+static metrics_counter_t eeprom_writes;
+static metrics_counter_t eeprom_write_bytes;
+static metrics_counter_t eeprom_write_us;
+static metrics_counter_t http_requests;
+static metrics_histogram_t http_response_seconds;
+static metrics_counter_t display_bytes;
+static metrics_counter_t display_renders;
+static metrics_counter_t display_render_us;
+static metrics_histogram_t display_frame_seconds;
+
+// Task snapshot, written by the metrics task and read by /metrics in the lwIP interrupt
+static metrics_task_t metrics_tasks[METRICS_MAX_TASKS];
+static uint8_t metrics_num_tasks = 0;
+static uint16_t metrics_idle_permille[configNUMBER_OF_CORES];
+static spin_lock_t * metrics_tasks_lock = NULL;
+
+static StackType_t metrics_task_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t metrics_task_buffer;
+
+
+static inline void _counter_add(metrics_counter_t * counter, uint32_t value) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    counter->value[get_core_num()] += value;
+    restore_interrupts(irq_state);
+}
+
+
+static uint32_t _counter_get(const metrics_counter_t * counter) {
+    uint32_t value = 0;
+    for (uint8_t core = 0; core < NUM_CORES; core += 1) {
+        value += counter->value[core];
+    }
+    return value;
+}
+
+
+static void _histogram_observe(metrics_histogram_t * histogram, const float * bounds, uint8_t num_bounds, float value) {
+    if (isnan(value)) {
+        return;
+    }
+
+    uint8_t idx = 0;
+    while (idx < num_bounds && value > bounds[idx]) {
+        idx += 1;
+    }
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    uint8_t core = get_core_num();
+    histogram->buckets[core][idx] += 1;
+    histogram->sum[core] += value;
+    restore_interrupts(irq_state);
+}
+
+
+void metrics_record_charge(uint8_t profile_idx, float coarse_time_ms, float fine_time_ms, float total_time_ms, float overthrow) {
+    _counter_add(&charges_completed, 1);
+
+    float phase_ms[NUM_CHARGE_PHASES] = {coarse_time_ms, fine_time_ms, total_time_ms};
+    for (uint8_t phase = 0; phase < NUM_CHARGE_PHASES; phase += 1) {
+        _histogram_observe(&charge_phase_seconds[phase], charge_phase_bounds, count_of(charge_phase_bounds), phase_ms[phase] / 1000.0f);
+    }
+
+    if (profile_idx < MAX_PROFILE_CNT) {
+        _histogram_observe(&charge_overthrow[profile_idx], overthrow_bounds, count_of(overthrow_bounds), overthrow);
+    }
+}
+
+
+void metrics_record_scale_frame(bool valid) {
+    _counter_add(&scale_frames, 1);
+    if (!valid) {
+        _counter_add(&scale_errors, 1);
+    }
+}
+
+
+void metrics_record_motor_command(metrics_motor_t motor) {
+    if (motor < METRICS_NUM_MOTORS) {
+        _counter_add(&motor_commands[motor], 1);
+    }
+}
+
+
+void metrics_record_eeprom_write(size_t len, uint32_t elapsed_us) {
+    _counter_add(&eeprom_writes, 1);
+    _counter_add(&eeprom_write_bytes, len);
+    _counter_add(&eeprom_write_us, elapsed_us);
+}
+
+
+void metrics_record_http_request() {
+    _counter_add(&http_requests, 1);
+}
+
+
+void metrics_record_http_response(uint32_t elapsed_us) {
+    _histogram_observe(&http_response_seconds, http_response_bounds, count_of(http_response_bounds), elapsed_us / 1e6f);
+}
+
+
+void metrics_record_display_transfer(size_t len) {
+    _counter_add(&display_bytes, len);
+}
+
+
+void metrics_record_display_render(uint32_t elapsed_us) {
+    _counter_add(&display_renders, 1);
+    _counter_add(&display_render_us, elapsed_us);
+}
+
+
+void metrics_record_display_frame(uint32_t elapsed_us) {
+    _histogram_observe(&display_frame_seconds, display_frame_bounds, count_of(display_frame_bounds), elapsed_us / 1e6f);
+}
+
+
+// Share of one core, in 1/1000, of a run time over the elapsed time
+static uint16_t _permille(configRUN_TIME_COUNTER_TYPE run_time, configRUN_TIME_COUNTER_TYPE elapsed) {
+    if (elapsed == 0) {
+        return 0;
+    }
+
+    configRUN_TIME_COUNTER_TYPE permille = run_time * 1000 / elapsed;
+    return permille > 1000 ? 1000 : (uint16_t) permille;
+}
+
+
+void metrics_task(void *p) {
+    // Static, too large for the task stack
+    static TaskStatus_t task_status[METRICS_MAX_TASKS];
+    static UBaseType_t last_task_numbers[METRICS_MAX_TASKS];
+    static configRUN_TIME_COUNTER_TYPE last_run_times[METRICS_MAX_TASKS];
+    UBaseType_t last_num_tasks = 0;
+    configRUN_TIME_COUNTER_TYPE last_total_run_time = 0;
+
+    while (true) {
+        // Returns 0 if there are more tasks than METRICS_MAX_TASKS
+        configRUN_TIME_COUNTER_TYPE total_run_time;
+        UBaseType_t num_tasks = uxTaskGetSystemState(task_status, METRICS_MAX_TASKS, &total_run_time);
+        configRUN_TIME_COUNTER_TYPE elapsed = total_run_time - last_total_run_time;
+
+        uint16_t cpu_permille[METRICS_MAX_TASKS];
+        uint16_t idle_permille[configNUMBER_OF_CORES] = {0};
+        for (UBaseType_t idx = 0; idx < num_tasks; idx += 1) {
+            // A task created during the period has run for its whole run time within it
+            configRUN_TIME_COUNTER_TYPE run_time = task_status[idx].ulRunTimeCounter;
+            for (UBaseType_t last_idx = 0; last_idx < last_num_tasks; last_idx += 1) {
+                if (last_task_numbers[last_idx] == task_status[idx].xTaskNumber) {
+                    run_time -= last_run_times[last_idx];
+                    break;
+                }
+            }
+            cpu_permille[idx] = _permille(run_time, elapsed);
+
+            for (BaseType_t core = 0; core < configNUMBER_OF_CORES; core += 1) {
+                if (task_status[idx].xHandle == xTaskGetIdleTaskHandleForCore(core)) {
+                    idle_permille[core] = cpu_permille[idx];
+                }
+            }
+        }
+
+        for (UBaseType_t idx = 0; idx < num_tasks; idx += 1) {
+            last_task_numbers[idx] = task_status[idx].xTaskNumber;
+            last_run_times[idx] = task_status[idx].ulRunTimeCounter;
+        }
+        last_num_tasks = num_tasks;
+        last_total_run_time = total_run_time;
+
+        uint32_t irq_state = spin_lock_blocking(metrics_tasks_lock);
+        for (UBaseType_t idx = 0; idx < num_tasks; idx += 1) {
+            strncpy(metrics_tasks[idx].name, task_status[idx].pcTaskName, sizeof(metrics_tasks[idx].name) - 1);
+            metrics_tasks[idx].name[sizeof(metrics_tasks[idx].name) - 1] = 0;
+            metrics_tasks[idx].stack_high_water_bytes = task_status[idx].usStackHighWaterMark * sizeof(StackType_t);
+            metrics_tasks[idx].cpu_permille = cpu_permille[idx];
+            metrics_tasks[idx].priority = task_status[idx].uxCurrentPriority;
+        }
+        metrics_num_tasks = num_tasks;
+        memcpy(metrics_idle_permille, idle_permille, sizeof(metrics_idle_permille));
+        spin_unlock(metrics_tasks_lock, irq_state);
+
+        vTaskDelay(pdMS_TO_TICKS(METRICS_TASK_PERIOD_MS));
+    }
+}
+
+
+uint8_t metrics_get_tasks(metrics_task_t * tasks, uint8_t max_tasks, uint16_t * idle_permille) {
+    if (metrics_tasks_lock == NULL) {
+        return 0;
+    }
+
+    uint32_t irq_state = spin_lock_blocking(metrics_tasks_lock);
+    uint8_t num_tasks = metrics_num_tasks < max_tasks ? metrics_num_tasks : max_tasks;
+    memcpy(tasks, metrics_tasks, num_tasks * sizeof(metrics_task_t));
+    if (idle_permille) {
+        memcpy(idle_permille, metrics_idle_permille, sizeof(metrics_idle_permille));
+    }
+    spin_unlock(metrics_tasks_lock, irq_state);
+
+    return num_tasks;
+}
+
+
+bool metrics_init() {
+    metrics_tasks_lock = spin_lock_instance(spin_lock_claim_unused(true));
+
+    TaskHandle_t task_handle = xTaskCreateStatic(metrics_task, "Metrics Task", configMINIMAL_STACK_SIZE, NULL, 1,
+                                                 metrics_task_stack, &metrics_task_buffer);
+    if (task_handle == NULL) {
+        report_error(ERR_REST_TASK_CREATE);
+        return false;
+    }
+
+    return true;
+}
+
+
+// Exposition helpers
+
+static void _write_value(json_writer_t * writer, const char * name, const char * labels, uint32_t value) {
+    if (labels) {
+        json_writer_printf(writer, "%s{%s} %lu\n", name, labels, (unsigned long) value);
+    }
+    else {
+        json_writer_printf(writer, "%s %lu\n", name, (unsigned long) value);
+    }
+}
+
+
+static void _write_histogram(json_writer_t * writer, const char * name, const char * labels,
+                             const metrics_histogram_t * histogram, const float * bounds, uint8_t num_bounds) {
+    const char * separator = labels ? "," : "";
+    labels = labels ? labels : "";
+
+    uint32_t count = 0;
+    float sum = 0;
+    for (uint8_t core = 0; core < NUM_CORES; core += 1) {
+        sum += histogram->sum[core];
+    }
+
+    for (uint8_t idx = 0; idx <= num_bounds; idx += 1) {
+        for (uint8_t core = 0; core < NUM_CORES; core += 1) {
+            count += histogram->buckets[core][idx];
+        }
+
+        if (idx < num_bounds) {
+            json_writer_printf(writer, "%s_bucket{%s%sle=\"%g\"} %lu\n", name, labels, separator, (double) bounds[idx], (unsigned long) count);
+        }
+        else {
+            json_writer_printf(writer, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, separator, (unsigned long) count);
+        }
+    }
+
+    if (labels[0]) {
+        json_writer_printf(writer, "%s_sum{%s} %g\n%s_count{%s} %lu\n", name, labels, (double) sum, name, labels, (unsigned long) count);
+    }
+    else {
+        json_writer_printf(writer, "%s_sum %g\n%s_count %lu\n", name, (double) sum, name, (unsigned long) count);
+    }
+}
+
+
+// Families
+
+static uint8_t _one_series() {
+    return 1;
+}
+
+
+static uint8_t _charge_phase_series() {
+    return NUM_CHARGE_PHASES;
+}
+
+
+static uint8_t _profile_series() {
+    return MAX_PROFILE_CNT;
+}
+
+
+static uint8_t _motor_series() {
+    return METRICS_NUM_MOTORS;
+}
+
+
+static uint8_t _task_series() {
+    return metrics_num_tasks;
+}
+
+
+static void _write_charges_completed(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_value(writer, name, NULL, _counter_get(&charges_completed));
+}
+
+
+static void _write_charge_phase_seconds(json_writer_t * writer, const char * name, uint8_t idx) {
+    char labels[24];
+    snprintf(labels, sizeof(labels), "phase=\"%s\"", charge_phase_names[idx]);
+    _write_histogram(writer, name, labels, &charge_phase_seconds[idx], charge_phase_bounds, count_of(charge_phase_bounds));
+}
+
+
+static void _write_charge_overthrow(json_writer_t * writer, const char * name, uint8_t idx) {
+    char labels[24];
+    snprintf(labels, sizeof(labels), "profile=\"%u\"", idx);
+    _write_histogram(writer, name, labels, &charge_overthrow[idx], overthrow_bounds, count_of(overthrow_bounds));
+}
+
+
+static void _write_scale_frames(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_value(writer, name, NULL, _counter_get(&scale_frames));
+}
+
+
+static void _write_scale_errors(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_value(writer, name, NULL, _counter_get(&scale_errors));
+}
+
+
+static void _write_motor_commands(json_writer_t * writer, const char * name, uint8_t idx) {
+    char labels[24];
+    snprintf(labels, sizeof(labels), "motor=\"%s\"", motor_names[idx]);
+    _write_value(writer, name, labels, _counter_get(&motor_commands[idx]));
+}
+
+
+static void _write_eeprom_writes(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_value(writer, name, NULL, _counter_get(&eeprom_writes));
+}
+
+
+static void _write_eeprom_write_bytes(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_value(writer, name, NULL, _counter_get(&eeprom_write_bytes));
+}
+
+
+static void _write_eeprom_write_seconds(json_writer_t * writer, const char * name, uint8_t idx) {
+    json_writer_printf(writer, "%s %.6f\n", name, _counter_get(&eeprom_write_us) / 1e6);
+}
+
+
+static void _write_http_requests(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_value(writer, name, NULL, _counter_get(&http_requests));
+}
+
+
+static void _write_http_response_seconds(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_histogram(writer, name, NULL, &http_response_seconds, http_response_bounds, count_of(http_response_bounds));
+}
+
+
+static void _write_display_bytes(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_value(writer, name, NULL, _counter_get(&display_bytes));
+}
+
+
+static void _write_display_renders(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_value(writer, name, NULL, _counter_get(&display_renders));
+}
+
+
+static void _write_display_render_seconds(json_writer_t * writer, const char * name, uint8_t idx) {
+    json_writer_printf(writer, "%s %.6f\n", name, _counter_get(&display_render_us) / 1e6);
+}
+
+
+static void _write_display_frame_seconds(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_histogram(writer, name, NULL, &display_frame_seconds, display_frame_bounds, count_of(display_frame_bounds));
+}
+
+
+static void _write_heap_free(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_value(writer, name, NULL, xPortGetFreeHeapSize());
+}
+
+
+static void _write_heap_min_free(json_writer_t * writer, const char * name, uint8_t idx) {
+    _write_value(writer, name, NULL, xPortGetMinimumEverFreeHeapSize());
+}
+
+
+static uint8_t _core_series() {
+    return configNUMBER_OF_CORES;
+}
+
+
+static bool _get_task(uint8_t idx, metrics_task_t * task) {
+    bool valid = false;
+
+    uint32_t irq_state = spin_lock_blocking(metrics_tasks_lock);
+    if (idx < metrics_num_tasks) {
+        *task = metrics_tasks[idx];
+        valid = true;
+    }
+    spin_unlock(metrics_tasks_lock, irq_state);
+
+    return valid;
+}
+
+
+static void _write_task_stack(json_writer_t * writer, const char * name, uint8_t idx) {
+    metrics_task_t task;
+    if (_get_task(idx, &task)) {
+        char labels[16 + configMAX_TASK_NAME_LEN];
+        snprintf(labels, sizeof(labels), "task=\"%s\"", task.name);
+        _write_value(writer, name, labels, task.stack_high_water_bytes);
+    }
+}
+
+
+static void _write_task_cpu(json_writer_t * writer, const char * name, uint8_t idx) {
+    metrics_task_t task;
+    if (_get_task(idx, &task)) {
+        json_writer_printf(writer, "%s{task=\"%s\"} %.3f\n", name, task.name, task.cpu_permille / 1000.0);
+    }
+}
+
+
+static void _write_core_idle(json_writer_t * writer, const char * name, uint8_t idx) {
+    json_writer_printf(writer, "%s{core=\"%u\"} %.3f\n", name, idx, metrics_idle_permille[idx] / 1000.0);
+}
+
+
+static const metrics_family_t metrics_families[] = {
+    {"opentrickler_charges_completed_total", "counter", "Charges completed",
+        _one_series, _write_charges_completed},
+    {"opentrickler_charge_phase_seconds", "histogram", "Time spent per charge phase",
+        _charge_phase_series, _write_charge_phase_seconds},
+    {"opentrickler_charge_overthrow", "histogram", "Final weight minus target, in the scale unit, per profile",
+        _profile_series, _write_charge_overthrow},
+    {"opentrickler_scale_frames_total", "counter", "Frames received from the scale",
+        _one_series, _write_scale_frames},
+    {"opentrickler_scale_errors_total", "counter", "Frames received from the scale without a valid weight",
+        _one_series, _write_scale_errors},
+    {"opentrickler_motor_commands_total", "counter", "Speed commands sent to the motors",
+        _motor_series, _write_motor_commands},
+    {"opentrickler_eeprom_writes_total", "counter", "EEPROM writes",
+        _one_series, _write_eeprom_writes},
+    {"opentrickler_eeprom_write_bytes_total", "counter", "Bytes written to the EEPROM",
+        _one_series, _write_eeprom_write_bytes},
+    {"opentrickler_eeprom_write_seconds_total", "counter", "Time spent writing to the EEPROM",
+        _one_series, _write_eeprom_write_seconds},
+    {"opentrickler_http_requests_total", "counter", "HTTP requests received",
+        _one_series, _write_http_requests},
+    {"opentrickler_http_response_seconds", "histogram", "Time from an HTTP request to the end of its response",
+        _one_series, _write_http_response_seconds},
+    {"opentrickler_display_bytes_total", "counter", "Bytes sent to the display",
+        _one_series, _write_display_bytes},
+    {"opentrickler_display_renders_total", "counter", "Renders of the screen, LVGL timer runs on the TFT",
+        _one_series, _write_display_renders},
+    {"opentrickler_display_render_seconds_total", "counter", "Time spent rendering the screen, including the transfer on the Mini 12864",
+        _one_series, _write_display_render_seconds},
+    {"opentrickler_display_frame_seconds", "histogram", "Time from the start of a TFT refresh to the end of its last transfer",
+        _one_series, _write_display_frame_seconds},
+    {"opentrickler_heap_free_bytes", "gauge", "Free FreeRTOS heap",
+        _one_series, _write_heap_free},
+    {"opentrickler_heap_min_free_bytes", "gauge", "Minimum ever free FreeRTOS heap",
+        _one_series, _write_heap_min_free},
+    {"opentrickler_task_stack_high_water_bytes", "gauge", "Minimum ever free stack per task",
+        _task_series, _write_task_stack},
+    {"opentrickler_task_cpu_ratio", "gauge", "Share of one core used per task over the last sampling period",
+        _task_series, _write_task_cpu},
+    {"opentrickler_core_idle_ratio", "gauge", "Share of each core spent idle over the last sampling period",
+        _core_series, _write_core_idle},
+};
+
+
+bool http_rest_task_stats(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // None
+    //
+    // Response
+    // p (int): Sampling period (ms)
+    // i (array): Share of each core spent idle over the period (%)
+    // t (array): Tasks, n: name, c: share of one core used over the period (%), s: minimum ever free
+    //            stack (bytes), p: priority
+    //
+    // The cursor is the next task to write
+    json_writer_t * json = &response->json;
+
+    if (response->part == 0) {
+        json_begin_object(json);
+        json_add_uint(json, "p", METRICS_TASK_PERIOD_MS);
+        json_add_array(json, "i");
+        for (uint8_t core = 0; core < configNUMBER_OF_CORES; core += 1) {
+            json_float(json, metrics_idle_permille[core] / 10.0f, 1);
+        }
+        json_end_array(json);
+        json_add_array(json, "t");
+        response->cursor = 0;
+        return true;
+    }
+
+    metrics_task_t task;
+    if (_get_task(response->cursor, &task)) {
+        json_begin_object(json);
+        json_add_string(json, "n", task.name);
+        json_add_float(json, "c", task.cpu_permille / 10.0f, 1);
+        json_add_uint(json, "s", task.stack_high_water_bytes);
+        json_add_uint(json, "p", task.priority);
+        json_end_object(json);
+        response->cursor += 1;
+        return true;
+    }
+
+    json_end_array(json);
+    json_end_object(json);
+
+    return false;
+}
+
+
+bool http_metrics(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // None
+    //
+    // Response
+    // Prometheus text exposition format
+    //
+    // Each part writes the HELP and TYPE lines of a family or one of its series. The cursor holds
+    // the family index in the upper bits and the step (0 for the header, then 1 + series) in the low byte.
+    json_writer_t * json = &response->json;
+    response->content_type = METRICS_CONTENT_TYPE;
+
+    uint32_t family_idx = response->cursor >> 8;
+    uint32_t step = response->cursor & 0xFF;
+    const metrics_family_t * family = &metrics_families[family_idx];
+
+    if (step == 0) {
+        json_writer_printf(json, "# HELP %s %s\n# TYPE %s %s\n", family->name, family->help, family->name, family->type);
+    }
+    else {
+        family->write_series(json, family->name, step - 1);
+    }
+
+    step += 1;
+    if (step > family->num_series()) {
+        family_idx += 1;
+        step = 0;
+    }
+    response->cursor = (family_idx << 8) | step;
+
+    return family_idx < count_of(metrics_families);
+}
@@ -0,0 +1,94 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <FreeRTOS.h>
+#include "http_rest.h"
+
+// Prometheus metrics: GET /metrics returns the text exposition format (version 0.0.4)
+//
+// Counters and histograms are updated from the hot paths without a lock: each core adds to its own
+// slot with interrupts disabled for the increment only, and /metrics sums the slots. The response is
+// streamed one metric family or series per part, so no buffer beyond the response chunk is needed.
+//
+// Task stack high-water marks and run times cannot be read from the lwIP interrupt, a low priority task
+// samples them every METRICS_TASK_PERIOD_MS. The CPU load of a task is its run time over the last period
+// against the period, so a task can use up to 100% of one core. The idle tasks give the idle share of each
+// core. Run times are counted by FreeRTOS from the 1 MHz system timer.
+
+
+#define METRICS_TASK_PERIOD_MS          5000
+#define METRICS_MAX_TASKS               24          // Tasks reported with a stack high-water mark
+
+
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t stack_high_water_bytes;
+    uint16_t cpu_permille;          // Share of one core over the last period
+    uint8_t priority;
+} metrics_task_t;
+
+typedef enum {
+    METRICS_MOTOR_COARSE = 0,
+    METRICS_MOTOR_FINE,
+    METRICS_NUM_MOTORS,
+} metrics_motor_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool metrics_init(void);
+
+/**
+ * A charge has completed. Times in ms, overthrow in the scale unit (negative for an undercharge).
+*/
+void metrics_record_charge(uint8_t profile_idx, float coarse_time_ms, float fine_time_ms, float total_time_ms, float overthrow);
+
+/**
+ * A scale frame has been decoded, valid is false if it carried no weight
+*/
+void metrics_record_scale_frame(bool valid);
+
+void metrics_record_motor_command(metrics_motor_t motor);
+
+void metrics_record_eeprom_write(size_t len, uint32_t elapsed_us);
+
+void metrics_record_http_request(void);
+
+/**
+ * A response has been completely handed to lwIP, elapsed_us since the request was received
+*/
+void metrics_record_http_response(uint32_t elapsed_us);
+
+/**
+ * Bytes sent to the display, and the time spent by its render task for one render (one LVGL timer run
+ * on the TFT)
+*/
+void metrics_record_display_transfer(size_t len);
+void metrics_record_display_render(uint32_t elapsed_us);
+
+/**
+ * A TFT refresh has been sent, elapsed_us from the start of the refresh to the end of the last transfer
+*/
+void metrics_record_display_frame(uint32_t elapsed_us);
+
+/**
+ * Copy the last task sample, returns the number of tasks copied. idle_permille (configNUMBER_OF_CORES
+ * entries) may be NULL.
+*/
+uint8_t metrics_get_tasks(metrics_task_t * tasks, uint8_t max_tasks, uint16_t * idle_permille);
+
+// REST
+bool http_rest_task_stats(rest_response_t *response, int num_params, char *params[], char *values[]);
+bool http_metrics(rest_response_t *response, int num_params, char *params[], char *values[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // METRICS_H_
@@ -42,6 +42,9 @@
 #include "mini_12864_module.h"
 #include "display.h"
 #include "display_config.h"
+#include "display_mirror.h"
+#include "metrics.h"
+#include "hal_pico.h"
 
 
 // Configs
@@ -219,7 +222,9 @@ void button_init() {
     irq_handler.register_interrupt(BUTTON0_ENC_PIN, gpio_irq_handler::irq_event::fall, _isr_on_button_enc_update);
     irq_handler.register_interrupt(BUTTON0_RST_PIN, gpio_irq_handler::irq_event::fall, _isr_on_button_rst_update);
 
-    encoder_event_queue = xQueueCreate(5, sizeof(ButtonEncoderEvent_t));
+    static StaticQueue_t encoder_event_queue_buffer;
+    static uint8_t encoder_event_queue_storage[5 * sizeof(ButtonEncoderEvent_t)];
+    encoder_event_queue = xQueueCreateStatic(5, sizeof(ButtonEncoderEvent_t), encoder_event_queue_storage, &encoder_event_queue_buffer);
     if (encoder_event_queue == 0) {
         assert(false);
     }
@@ -273,13 +278,13 @@ uint8_t u8x8_gpio_and_delay(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *ar
         case U8X8_MSG_GPIO_E:				// E/WR pin: Output level in arg_int
             break;
         case U8X8_MSG_GPIO_CS:				// CS (chip select) pin: Output level in arg_int
-            gpio_put(DISPLAY0_CS_PIN, arg_int);
+            hal_display_set_pin(HAL_DISPLAY_PIN_CS, arg_int);
             break;
         case U8X8_MSG_GPIO_DC:				// DC (data/cmd, A0, register select) pin: Output level in arg_int
-            gpio_put(DISPLAY0_A0_PIN, arg_int);
+            hal_display_set_pin(HAL_DISPLAY_PIN_DC, arg_int);
             break;
         case U8X8_MSG_GPIO_RESET:			// Reset pin: Output level in arg_int
-            gpio_put(DISPLAY0_RESET_PIN, arg_int);
+            hal_display_set_pin(HAL_DISPLAY_PIN_RESET, arg_int);
             break;
         case U8X8_MSG_GPIO_CS1:				// CS1 (chip select) pin: Output level in arg_int
             break;
@@ -314,7 +319,8 @@ uint8_t u8x8_byte_pico_hw_spi(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *
     {
         case U8X8_MSG_BYTE_SEND:
             // taskENTER_CRITICAL();
-            spi_write_blocking(DISPLAY0_SPI, (uint8_t *) arg_ptr, arg_int);
+            hal_display_write((const uint8_t *) arg_ptr, arg_int);
+            metrics_record_display_transfer(arg_int);
             // taskEXIT_CRITICAL();
             break;
         case U8X8_MSG_BYTE_INIT:
@@ -374,6 +380,9 @@ void display_init() {
         u8x8_gpio_and_delay
     );
 
+    // Capture every sent frame for /display_frame and WebSocket subscribers
+    display_mirror_attach_u8g2(&display_handler);
+
     // Initialize Screen
     u8g2_InitDisplay(&display_handler);
     u8g2_SetPowerSave(&display_handler, 0);
@@ -20,6 +20,10 @@
 #include "display.h"  // in case the stepper motor driver failed to initialize
 #include "neopixel_led.h" // in case the stepper motor driver failed to initialize
 #include "error.h"
+#include "rest_param.h"
+#include "metrics.h"
+#include "trace.h"
+#include "hal_pico.h"
 
 #define STEPPER_LOW_CYCLE_COUNT 13  // Defined as the implementation of stepper.pio
 #define MAX_RESPONSE_TIME   0.01f   // Maximum response time for PIO stepper
@@ -37,6 +41,14 @@ typedef struct {
 motor_config_t coarse_trickler_motor_config;
 motor_config_t fine_trickler_motor_config;
 
+// Driver and RTOS objects of the two motors, index 0 is the coarse trickler
+#define STEPPER_SPEED_CONTROL_QUEUE_LENGTH  2
+static TMC2209_t tmc_drivers[2];
+static StaticQueue_t stepper_speed_control_queue_buffers[2];
+static uint8_t stepper_speed_control_queue_storage[2][STEPPER_SPEED_CONTROL_QUEUE_LENGTH * sizeof(stepper_speed_control_t)];
+static StackType_t stepper_speed_control_task_stacks[2][configMINIMAL_STACK_SIZE];
+static StaticTask_t stepper_speed_control_task_buffers[2];
+
 // Global motor state
 bool motors_enabled = true;    // User setting: enable/disable motors
 bool motors_detected = false;  // Runtime: were motors actually found
@@ -240,17 +252,8 @@ bool driver_init(motor_config_t * motor_config) {
     // Return True if the initialization is successful, False otherwise. 
     // This must be called after the UART is initialized. 
     
-    // Check if the tmc driver is already initialized. If true then free the previously allocated
-    //  driver then re-create. 
-    if (motor_config->tmc_driver) {
-        free(motor_config->tmc_driver);
-    }
-
-
-    TMC2209_t * tmc_driver = malloc(sizeof(TMC2209_t));
-    if (tmc_driver == NULL) {
-        return false;
-    }
+    // Each motor has its own driver storage, re-initializing starts over from the defaults
+    TMC2209_t * tmc_driver = &tmc_drivers[motor_config == &coarse_trickler_motor_config ? 0 : 1];
 
     TMC2209_SetDefaults(tmc_driver);
 
@@ -398,7 +401,15 @@ bool motor_config_save() {
 }
 
 
+// Offset of the fine trickler from the coarse trickler trace event IDs
+static inline uint32_t _trace_motor(motor_config_t * motor_config) {
+    return motor_config == &coarse_trickler_motor_config ? 0 : 1;
+}
+
+
 void speed_ramp(motor_config_t * motor_config, float prev_speed, float new_speed, uint32_t pio_speed) {
+    TRACE_BY_ID(TRACE_ID_COARSE_RAMP_START + _trace_motor(motor_config), trace_fixed(new_speed, 1000));
+
     // Calculate ramp param
     float dv = new_speed - prev_speed;
     float ramp_time_s = fabs(dv / motor_config->persistent_config.angular_acceleration);
@@ -406,13 +417,13 @@ void speed_ramp(motor_config_t * motor_config, float prev_speed, float new_speed
 
     // Calculate termination condition
     uint32_t ramp_time_us = (uint32_t) (fabs(ramp_time_s) * 1e6);
-    uint32_t start_time = time_us_32();
+    uint32_t start_time = hal_time_us();
     uint32_t stop_time = start_time + ramp_time_us;
 
     float current_speed;
     uint32_t current_period;
     while (true) {
-        uint32_t current_time = time_us_32();
+        uint32_t current_time = hal_time_us();
         if (current_time > stop_time) {
             break;
         }
@@ -421,13 +432,13 @@ void speed_ramp(motor_config_t * motor_config, float prev_speed, float new_speed
 
         current_speed = prev_speed + dv * percentage;
         current_period = speed_to_period(current_speed, pio_speed, full_rotation_steps);
-        pio_sm_clear_fifos(motor_config->pio_config.pio, motor_config->pio_config.sm);
-        pio_sm_put(motor_config->pio_config.pio, motor_config->pio_config.sm, current_period);
+        hal_step_set_period(pio_get_index(motor_config->pio_config.pio), motor_config->pio_config.sm, current_period, false);
     }
 
     current_period = speed_to_period(new_speed, pio_speed, full_rotation_steps);
-    pio_sm_clear_fifos(motor_config->pio_config.pio, motor_config->pio_config.sm);
-    pio_sm_put_blocking(motor_config->pio_config.pio, motor_config->pio_config.sm, current_period);
+    hal_step_set_period(pio_get_index(motor_config->pio_config.pio), motor_config->pio_config.sm, current_period, true);
+
+    TRACE_BY_ID(TRACE_ID_COARSE_RAMP_END + _trace_motor(motor_config), trace_fixed(new_speed, 1000));
 }
 
 
@@ -437,12 +448,13 @@ void stepper_speed_control_task(void * p) {
         // Wait for new speed
         float new_velocity;
         xQueueReceive(((motor_config_t *) p)->stepper_speed_control_queue, &new_velocity, portMAX_DELAY);
+        TRACE_BY_ID(TRACE_ID_COARSE_APPLIED + _trace_motor((motor_config_t *) p), trace_fixed(new_velocity, 1000));
 
         // Calculate the speed of the motor
         new_velocity /= ((motor_config_t *) p)->persistent_config.gear_ratio;
 
         // Get latest PIO speed, in case of the change of system clock
-        uint32_t pio_speed = clock_get_hz(clk_sys);
+        uint32_t pio_speed = hal_step_clock_hz();
 
         // Determine if both have same direction (no need to change DIR pin state)
         if ((new_velocity >= 0) == (((motor_config_t *) p)->prev_velocity >= 0)) {
@@ -461,7 +473,7 @@ void stepper_speed_control_task(void * p) {
             ((motor_config_t *) p)->step_direction = !((motor_config_t *) p)->step_direction;
 
             // Toggle the direction
-            gpio_put(((motor_config_t *) p)->dir_pin, ((motor_config_t *) p)->step_direction);
+            hal_gpio_put(((motor_config_t *) p)->dir_pin, ((motor_config_t *) p)->step_direction);
 
             // Ramp to the new speed
             speed_ramp(((motor_config_t *) p), 
@@ -480,12 +492,16 @@ void motor_set_speed(motor_select_t selected_motor, float new_velocity) {
     if (selected_motor == SELECT_COARSE_TRICKLER_MOTOR || selected_motor == SELECT_BOTH_MOTOR) {
         if (coarse_trickler_motor_config.stepper_speed_control_queue) {
             xQueueSend(coarse_trickler_motor_config.stepper_speed_control_queue, &new_velocity, portMAX_DELAY);
+            metrics_record_motor_command(METRICS_MOTOR_COARSE);
+            TRACE(COARSE_QUEUED, trace_fixed(new_velocity, 1000));
         }
     }
 
     if (selected_motor == SELECT_FINE_TRICKLER_MOTOR || selected_motor == SELECT_BOTH_MOTOR) {
         if (fine_trickler_motor_config.stepper_speed_control_queue) {
             xQueueSend(fine_trickler_motor_config.stepper_speed_control_queue, &new_velocity, portMAX_DELAY);
+            metrics_record_motor_command(METRICS_MOTOR_FINE);
+            TRACE(FINE_QUEUED, trace_fixed(new_velocity, 1000));
         }
     }
 }
@@ -495,7 +511,7 @@ void motor_enable(motor_select_t selected_motor, bool enable) {
     if (selected_motor == SELECT_COARSE_TRICKLER_MOTOR || selected_motor == SELECT_BOTH_MOTOR) {
         bool en_signal = coarse_trickler_motor_config.persistent_config.inverted_enable ? enable : !enable;
 
-        gpio_put(coarse_trickler_motor_config.en_pin, en_signal);
+        hal_gpio_put(coarse_trickler_motor_config.en_pin, en_signal);
 
         // If disabled, we shall also disable the stepper signal
         if (!enable) {
@@ -506,7 +522,7 @@ void motor_enable(motor_select_t selected_motor, bool enable) {
     if (selected_motor == SELECT_FINE_TRICKLER_MOTOR || selected_motor == SELECT_BOTH_MOTOR) {
         bool en_signal = fine_trickler_motor_config.persistent_config.inverted_enable ? enable : !enable;
 
-        gpio_put(fine_trickler_motor_config.en_pin, en_signal);
+        hal_gpio_put(fine_trickler_motor_config.en_pin, en_signal);
 
         // If disabled, we shall also disable the stepper signal
         if (!enable) {
@@ -624,23 +640,27 @@ motor_init_err_t motors_init(void) {
     }
 
     // Initialize motor related RTOS control
-    coarse_trickler_motor_config.stepper_speed_control_queue = xQueueCreate(2, sizeof(stepper_speed_control_t));
-    fine_trickler_motor_config.stepper_speed_control_queue = xQueueCreate(2, sizeof(stepper_speed_control_t));
+    coarse_trickler_motor_config.stepper_speed_control_queue = xQueueCreateStatic(STEPPER_SPEED_CONTROL_QUEUE_LENGTH, sizeof(stepper_speed_control_t),
+                                                                                   stepper_speed_control_queue_storage[0], &stepper_speed_control_queue_buffers[0]);
+    fine_trickler_motor_config.stepper_speed_control_queue = xQueueCreateStatic(STEPPER_SPEED_CONTROL_QUEUE_LENGTH, sizeof(stepper_speed_control_t),
+                                                                                 stepper_speed_control_queue_storage[1], &stepper_speed_control_queue_buffers[1]);
 
     // Create one task for each stepper controller
-    xTaskCreate(stepper_speed_control_task, 
-                "Coarse Trickler", 
-                configMINIMAL_STACK_SIZE, 
-                (void *) &coarse_trickler_motor_config, 
-                9,  // Coarse trickler at higher priority to response faster to stop
-                &coarse_trickler_motor_config.stepper_speed_control_task_handler);
-
-    xTaskCreate(stepper_speed_control_task, 
-                "Fine Trickler", 
-                configMINIMAL_STACK_SIZE, 
-                (void *) &fine_trickler_motor_config, 
-                8, 
-                &fine_trickler_motor_config.stepper_speed_control_task_handler);
+    coarse_trickler_motor_config.stepper_speed_control_task_handler = xTaskCreateStatic(stepper_speed_control_task, 
+                                                                                        "Coarse Trickler", 
+                                                                                        configMINIMAL_STACK_SIZE, 
+                                                                                        (void *) &coarse_trickler_motor_config, 
+                                                                                        9,  // Coarse trickler at higher priority to response faster to stop
+                                                                                        stepper_speed_control_task_stacks[0],
+                                                                                        &stepper_speed_control_task_buffers[0]);
+
+    fine_trickler_motor_config.stepper_speed_control_task_handler = xTaskCreateStatic(stepper_speed_control_task, 
+                                                                                      "Fine Trickler", 
+                                                                                      configMINIMAL_STACK_SIZE, 
+                                                                                      (void *) &fine_trickler_motor_config, 
+                                                                                      8, 
+                                                                                      stepper_speed_control_task_stacks[1],
+                                                                                      &stepper_speed_control_task_buffers[1]);
 
     // Motors successfully initialized
     motors_detected = true;
@@ -726,131 +746,58 @@ void handle_motor_init_error(motor_init_err_t err) {
 }
 
 
-void populate_rest_motor_config(motor_config_t * motor_config, char * buf, size_t max_len) {
-    // Mappings:
-    // m0 (float): angular_acceleration
-    // m1 (int): full_steps_per_rotation
-    // m2 (int): current_ma
-    // m3 (int): microsteps
-    // m4 (int): max_speed_rps
-    // m5 (int): r_sense
-    // m6 (float): min_speed_rps
-    // m7 (float): gear_ratio
-    // m8 (bool): inverted_enable
-    // m9 (bool): inverted_direction
-    // ee (bool): save to eeprom
+// Mappings:
+// m0 (float): angular_acceleration
+// m1 (int): full_steps_per_rotation
+// m2 (int): current_ma
+// m3 (int): microsteps
+// m4 (int): max_speed_rps
+// m5 (int): r_sense
+// m6 (float): min_speed_rps
+// m7 (float): gear_ratio
+// m8 (bool): inverted_enable
+// m9 (bool): inverted_direction
+// ee (bool): save to eeprom
+static const rest_param_t motor_config_params[] = {
+    REST_PARAM_ENTRY("m0", motor_persistent_config_t, angular_acceleration, REST_PARAM_FLOAT, 3, 0.1f, 10000.0f),
+    REST_PARAM_ENTRY("m1", motor_persistent_config_t, full_steps_per_rotation, REST_PARAM_UINT32, 0, 1, 100000),
+    REST_PARAM_ENTRY("m2", motor_persistent_config_t, current_ma, REST_PARAM_UINT16, 0, 0, 2000),
+    REST_PARAM_ENTRY("m3", motor_persistent_config_t, microsteps, REST_PARAM_UINT16, 0, 1, 256),
+    REST_PARAM_ENTRY("m4", motor_persistent_config_t, max_speed_rps, REST_PARAM_UINT16, 0, 1, 1000),
+    REST_PARAM_ENTRY("m5", motor_persistent_config_t, r_sense, REST_PARAM_UINT16, 0, 1, 1000),
+    REST_PARAM_ENTRY("m6", motor_persistent_config_t, min_speed_rps, REST_PARAM_FLOAT, 3, 0.0f, 100.0f),
+    REST_PARAM_ENTRY("m7", motor_persistent_config_t, gear_ratio, REST_PARAM_FLOAT, 7, 0.001f, 1000.0f),
+    REST_PARAM_ENTRY("m8", motor_persistent_config_t, inverted_enable, REST_PARAM_BOOL, 0, 0, 1),
+    REST_PARAM_ENTRY("m9", motor_persistent_config_t, inverted_direction, REST_PARAM_BOOL, 0, 0, 1),
+};
+static rest_param_schema_t motor_config_schema = REST_PARAM_SCHEMA(motor_config_params);
 
-    // Build response
-    snprintf(buf, 
-             max_len,
-             "%s"
-             "{\"m0\":%0.3f,\"m1\":%ld,\"m2\":%d,\"m3\":%d,\"m4\":%d,\"m5\":%d,\"m6\":%0.3f,\"m7\":%0.7f,\"m8\":%s,\"m9\":%s}",
-             http_json_header,
-             motor_config->persistent_config.angular_acceleration, 
-             motor_config->persistent_config.full_steps_per_rotation,
-             motor_config->persistent_config.current_ma,
-             motor_config->persistent_config.microsteps,
-             motor_config->persistent_config.max_speed_rps,
-             motor_config->persistent_config.r_sense,
-             motor_config->persistent_config.min_speed_rps,
-             motor_config->persistent_config.gear_ratio,
-             boolean_to_string(motor_config->persistent_config.inverted_enable),
-             boolean_to_string(motor_config->persistent_config.inverted_direction));
-}
 
-void apply_rest_motor_config(motor_config_t * motor_config, int num_params, char *params[], char *values[]) {
-    bool save_to_eeprom = false;
-
-    for (int idx = 0; idx < num_params; idx += 1) {
-        if (strcmp(params[idx], "m0") == 0) {
-            float angular_acceleration = strtof(values[idx], NULL);
-            motor_config->persistent_config.angular_acceleration = angular_acceleration;
-        }
-        else if (strcmp(params[idx], "m1") == 0) {
-            uint32_t full_steps_per_rotation = strtol(values[idx], NULL, 10);
-            motor_config->persistent_config.full_steps_per_rotation = full_steps_per_rotation;
-        }
-        else if (strcmp(params[idx], "m2") == 0) {
-            uint16_t current_ma = (uint16_t) atoi(values[idx]);
-            motor_config->persistent_config.current_ma = current_ma;
-        }
-        else if (strcmp(params[idx], "m3") == 0) {
-            uint16_t microsteps = (uint16_t) atoi(values[idx]);
-            motor_config->persistent_config.microsteps = microsteps;
-        }
-        else if (strcmp(params[idx], "m4") == 0) {
-            uint16_t max_speed_rps = (uint16_t) atoi(values[idx]);
-            motor_config->persistent_config.max_speed_rps = max_speed_rps;
-        }
-        else if (strcmp(params[idx], "m5") == 0) {
-            uint16_t r_sense = (uint16_t) atoi(values[idx]);
-            motor_config->persistent_config.r_sense = r_sense;
-        }
-        else if (strcmp(params[idx], "m6") == 0) {
-            float min_speed_rps = strtof(values[idx], NULL);
-            motor_config->persistent_config.min_speed_rps = min_speed_rps;
-        }
-        else if (strcmp(params[idx], "m7") == 0) {
-            float gear_ratio = strtof(values[idx], NULL);
-            motor_config->persistent_config.gear_ratio = gear_ratio;
-        }
-        else if (strcmp(params[idx], "m8") == 0) {
-            bool inverted_enable = string_to_boolean(values[idx]);
-            motor_config->persistent_config.inverted_enable = inverted_enable;
-        }
-        else if (strcmp(params[idx], "m9") == 0) {
-            bool inverted_direction = string_to_boolean(values[idx]);
-            motor_config->persistent_config.inverted_direction = inverted_direction;
-        }
-        else if (strcmp(params[idx], "ee") == 0) {
-            save_to_eeprom = string_to_boolean(values[idx]);
-        }
-    }
+static bool _rest_motor_config(motor_config_t * motor_config, rest_response_t *response, int num_params, char *params[], char *values[]) {
+    rest_param_result_t result = rest_param_apply(&motor_config_schema, &motor_config->persistent_config, num_params, params, values);
 
     // Perform action
-    if (save_to_eeprom) {
+    if (result.save) {
         motor_config_save();  // Note: this will save settings for both
     }
-}
 
+    rest_param_to_json(&motor_config_schema, &motor_config->persistent_config, &result, &response->json);
 
-bool http_rest_coarse_motor_config(struct fs_file *file, int num_params, char *params[], char *values[]) {
-    static char json_buffer[256];
-
-    apply_rest_motor_config(&coarse_trickler_motor_config, num_params, params, values);
-    populate_rest_motor_config(&coarse_trickler_motor_config, json_buffer, sizeof(json_buffer));
-
-    size_t response_len = strlen(json_buffer);
-    file->data = json_buffer;
-    file->len = response_len;
-    file->index = response_len;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-
-    return true;
+    return false;
 }
 
-bool http_rest_fine_motor_config(struct fs_file *file, int num_params, char *params[], char *values[]) {
-    static char json_buffer[256];
-
-    apply_rest_motor_config(&fine_trickler_motor_config, num_params, params, values);
-    populate_rest_motor_config(&fine_trickler_motor_config, json_buffer, sizeof(json_buffer));
 
-    size_t response_len = strlen(json_buffer);
-    file->data = json_buffer;
-    file->len = response_len;
-    file->index = response_len;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+bool http_rest_coarse_motor_config(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    return _rest_motor_config(&coarse_trickler_motor_config, response, num_params, params, values);
+}
 
-    return true;
+bool http_rest_fine_motor_config(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    return _rest_motor_config(&fine_trickler_motor_config, response, num_params, params, values);
 }
 
 
-// Task to initialize motors after scheduler starts (so blocking doesn't kill WiFi)
-void motor_init_task(void *p) {
-    (void)p;
-    
-    printf("Motor init task starting...\n");
-    
+// Boot stage, runs in a task after the scheduler starts (so blocking doesn't kill WiFi)
+bool motors_boot(void) {
     motor_init_err_t err = motors_init();
     
     if (err == MOTOR_INIT_OK) {
@@ -874,10 +821,10 @@ void motor_init_task(void *p) {
                 report_error(ERR_MOTOR_UART_INIT);
                 break;
         }
+        return false;
     }
     
-    // Task complete, delete self
-    vTaskDelete(NULL);
+    return true;
 }
 
 
@@ -92,7 +92,7 @@ extern "C" {
 motor_init_err_t motors_init(void);
 bool motor_config_init(void);
 bool motor_config_save(void);
-void motor_init_task(void *p);
+bool motors_boot(void);      // Init the motors and report the error, blocks on the driver UART
 void motor_set_speed(motor_select_t selected_motor, float new_velocity);
 uint16_t get_motor_max_speed(motor_select_t selected_motor);
 float get_motor_min_speed(motor_select_t selected_motor);
@@ -101,8 +101,8 @@ const char * get_motor_select_string(motor_select_t selected_motor);
 void motors_set_enabled(bool enabled);
 
 // REST interface
-bool http_rest_coarse_motor_config(struct fs_file *file, int num_params, char *params[], char *values[]);
-bool http_rest_fine_motor_config(struct fs_file *file, int num_params, char *params[], char *values[]);
+bool http_rest_coarse_motor_config(rest_response_t *response, int num_params, char *params[], char *values[]);
+bool http_rest_fine_motor_config(rest_response_t *response, int num_params, char *params[], char *values[]);
 bool http_rest_motors_state(struct fs_file *file, int num_params, char *params[], char *values[]);
 
 
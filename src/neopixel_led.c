@@ -22,26 +22,59 @@
 #include <stdint.h>
 #include <FreeRTOS.h>
 #include <task.h>
-#include <semphr.h>
+#include <timers.h>
 #include <string.h>
+#include "hardware/dma.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
 
 #include "neopixel_led.h"
 #include "generated/ws2812.pio.h"
 #include "configuration.h"
 #include "eeprom.h"
 #include "common.h"
+#include "error.h"
 
 
-
-// The parameters for updating the NeoPixel LED colors (including the target LED information)
+// The animation posted by the callers, rendered into the framebuffers by the frame timer
 typedef struct {
-    pio_config_t * pio_config;
-    uint32_t colour;
-} _neopixel_led_colour_update_params_t;
+    neopixel_led_animation_t animation;
+    rgbw_u32_t from[NEOPIXEL_MINI12864_NUM_LEDS];       // Shown when the animation was posted
+    rgbw_u32_t to[NEOPIXEL_MINI12864_NUM_LEDS];
+    uint32_t start_ms;
+    float progress;
+
+    // Set by _neopixel_led_set_colour(), the words are sent as they are
+    bool raw;
+    uint32_t raw_words[NEOPIXEL_MINI12864_NUM_LEDS];
+
+    // Latched by neopixel_led_set_error(), drawn over the animation until neopixel_led_clear_error()
+    bool error;
+    rgbw_u32_t error_colour;
+
+    bool dirty;                                         // Posted but not yet sent
+} _neopixel_led_animation_state_t;
 
 
 // Global configuration for neopixel LED instance
 neopixel_led_config_t neopixel_led_config;
+static StaticTimer_t neopixel_led_frame_timer_buffer;
+
+// Guards the animation state and the framebuffers, posted from tasks and the lwIP context
+static spin_lock_t * neopixel_led_lock;
+static _neopixel_led_animation_state_t neopixel_led_state;
+static rgbw_u32_t neopixel_led_shown[NEOPIXEL_MINI12864_NUM_LEDS];
+
+// Read by DMA, only written while the channels are idle
+static uint32_t mini12864_frame[NEOPIXEL_MINI12864_NUM_LEDS];
+static uint32_t pwm3_frame[NEOPIXEL_LED_CHAIN_COUNT_16];
+
+// The DMA is done once the last words are in the PIO FIFO, the LEDs latch the frame only after the words
+// are shifted out and the line has been held low for the reset time
+#define NEOPIXEL_LED_WORD_US            40      // 32 bits at 800 kHz, an RGB word takes 30 us
+#define NEOPIXEL_LED_LATCH_US           300     // Reset time, 50 us (WS2812) to 280 us (WS2812B)
+static uint32_t neopixel_led_latched_us;        // time_us_32() when the last frame is latched
+
 
 uint32_t urgbw_u32(rgbw_u32_t colour, neopixel_colour_order_t colour_order) {
 
@@ -61,35 +94,92 @@ uint32_t urgbw_u32(rgbw_u32_t colour, neopixel_colour_order_t colour_order) {
     
     return output;
 }
- 
-static inline void put_pixel(pio_config_t * pio_config, uint32_t pixel_grb) {
-    pio_sm_put_blocking(pio_config->pio, pio_config->sm, pixel_grb << 8u);
+
+// The state machine shifts out MSB first
+static inline uint32_t pixel_word(uint32_t pixel_grb) {
+    return pixel_grb << 8u;
 }
 
 
-// Low level function to bypass RTOS to configure colour directly
-void _neopixel_led_set_colour(uint32_t led1_colour, uint32_t led2_colour, uint32_t mini12864_backlight_colour) {
-    put_pixel(&neopixel_led_config.mini12864_pio_config, led1_colour);  // Encoder RGB1
-    put_pixel(&neopixel_led_config.mini12864_pio_config, led2_colour);  // Encoder RGB2
-    put_pixel(&neopixel_led_config.mini12864_pio_config, mini12864_backlight_colour);  // 12864 Backlight
+static inline uint8_t _mix(uint8_t from, uint8_t to, uint32_t amount) {
+    return (uint8_t) ((from * (255 - amount) + to * amount) / 255);
+}
+
+// amount 0: from, 255: to
+static rgbw_u32_t _blend(rgbw_u32_t from, rgbw_u32_t to, uint32_t amount) {
+    rgbw_u32_t colour;
+    colour.r = _mix(from.r, to.r, amount);
+    colour.g = _mix(from.g, to.g, amount);
+    colour.b = _mix(from.b, to.b, amount);
+    colour.w = _mix(from.w, to.w, amount);
+    return colour;
+}
+
+static inline rgbw_u32_t _scale(rgbw_u32_t colour, uint32_t level) {
+    rgbw_u32_t off = {._raw_colour = 0};
+    return _blend(off, colour, level);
 }
 
-void _neopixel_pwm_out_set_colour(uint32_t new_colour) {
-    for (int i = 0; i < neopixel_led_config.eeprom_neopixel_led_metadata.pwm_out_led_chain_count; i++) {
-        put_pixel(&neopixel_led_config.pwm3_pio_config, new_colour);
+
+static bool _is_animating(uint32_t now_ms) {
+    if (neopixel_led_state.raw) {
+        return false;
     }
+    return neopixel_led_state.animation != NEOPIXEL_LED_ANIMATION_SOLID ||
+           (now_ms - neopixel_led_state.start_ms) < NEOPIXEL_LED_BLEND_MS;
 }
 
 
-void neopixel_led_set_colour(rgbw_u32_t mini12864_backlight_colour, rgbw_u32_t led1_colour, rgbw_u32_t led2_colour, bool block_wait) {
-    // Assign delay time
-    TickType_t ticks_to_wait = 0;
-    if (block_wait) {
-        ticks_to_wait = portMAX_DELAY;
+static size_t _pwm3_led_count(void) {
+    size_t count = neopixel_led_config.eeprom_neopixel_led_metadata.pwm_out_led_chain_count;
+    if (count > NEOPIXEL_LED_CHAIN_COUNT_16) {
+        count = NEOPIXEL_LED_CHAIN_COUNT_16;
+    }
+    return count;
+}
+
+
+// Draw the current animation into the framebuffers, returns the number of PWM OUT words to send
+static size_t _render(uint32_t now_ms) {
+    if (neopixel_led_state.error) {
+        uint32_t word = pixel_word(urgbw_u32(neopixel_led_state.error_colour, NEOPIXEL_COLOUR_ORDER_GRB));
+        for (size_t idx = 0; idx < NEOPIXEL_MINI12864_NUM_LEDS; idx += 1) {
+            mini12864_frame[idx] = word;
+        }
+
+        neopixel_colour_order_t order = neopixel_led_config.eeprom_neopixel_led_metadata.pwm_out_led_colour_order;
+        size_t count = _pwm3_led_count();
+        for (size_t idx = 0; idx < count; idx += 1) {
+            pwm3_frame[idx] = pixel_word(urgbw_u32(neopixel_led_state.error_colour, order));
+        }
+        return count;
+    }
+
+    if (neopixel_led_state.raw) {
+        for (size_t idx = 0; idx < NEOPIXEL_MINI12864_NUM_LEDS; idx += 1) {
+            mini12864_frame[idx] = pixel_word(neopixel_led_state.raw_words[idx]);
+        }
+        return 0;  // PWM OUT keeps its colour
+    }
+
+    uint32_t elapsed_ms = now_ms - neopixel_led_state.start_ms;
+    uint32_t amount = elapsed_ms >= NEOPIXEL_LED_BLEND_MS ? 255 : elapsed_ms * 255 / NEOPIXEL_LED_BLEND_MS;
+
+    rgbw_u32_t colours[NEOPIXEL_MINI12864_NUM_LEDS];
+    for (size_t idx = 0; idx < NEOPIXEL_MINI12864_NUM_LEDS; idx += 1) {
+        colours[idx] = _blend(neopixel_led_state.from[idx], neopixel_led_state.to[idx], amount);
+        neopixel_led_shown[idx] = colours[idx];
     }
-    // Wait for the mutex
-    if (xSemaphoreTake(neopixel_led_config.mutex, ticks_to_wait) != pdTRUE) {
-        return;  // unable to take mutex, return immediately
+
+    if (neopixel_led_state.animation == NEOPIXEL_LED_ANIMATION_PULSE) {
+        // Triangle wave between the minimum level and full brightness
+        uint32_t phase = elapsed_ms % NEOPIXEL_LED_PULSE_PERIOD_MS;
+        uint32_t half = NEOPIXEL_LED_PULSE_PERIOD_MS / 2;
+        uint32_t ramp = phase < half ? phase : NEOPIXEL_LED_PULSE_PERIOD_MS - phase;
+        uint32_t level = NEOPIXEL_LED_PULSE_MIN_LEVEL + ramp * (255 - NEOPIXEL_LED_PULSE_MIN_LEVEL) / half;
+
+        colours[NEOPIXEL_MINI12864_LED1] = _scale(colours[NEOPIXEL_MINI12864_LED1], level);
+        colours[NEOPIXEL_MINI12864_LED2] = _scale(colours[NEOPIXEL_MINI12864_LED2], level);
     }
 
     /* Important: do not change the order of LED update operations. 
@@ -98,20 +188,190 @@ void neopixel_led_set_colour(rgbw_u32_t mini12864_backlight_colour, rgbw_u32_t l
         2. Encoder RGB2
         3. 12864 Backlight
     */
-    _neopixel_led_set_colour(
-        urgbw_u32(led1_colour, NEOPIXEL_COLOUR_ORDER_GRB),
-        urgbw_u32(led2_colour, NEOPIXEL_COLOUR_ORDER_GRB),
-        urgbw_u32(mini12864_backlight_colour, NEOPIXEL_COLOUR_ORDER_GRB)
-    );
+    for (size_t idx = 0; idx < NEOPIXEL_MINI12864_NUM_LEDS; idx += 1) {
+        mini12864_frame[idx] = pixel_word(urgbw_u32(colours[idx], NEOPIXEL_COLOUR_ORDER_GRB));
+    }
 
-    /* Update PWM3 output to mirror new_led1_colour */
-    // Infuse white intensity
-    _neopixel_pwm_out_set_colour(
-        urgbw_u32(led1_colour, neopixel_led_config.eeprom_neopixel_led_metadata.pwm_out_led_colour_order)
-    );
+    /* Update PWM3 output to mirror LED1 */
+    neopixel_colour_order_t order = neopixel_led_config.eeprom_neopixel_led_metadata.pwm_out_led_colour_order;
+    size_t count = _pwm3_led_count();
+
+    // Filled part in 1/256 of an LED, the LED at the edge is partly lit
+    uint32_t fill = count * 256;
+    if (neopixel_led_state.animation == NEOPIXEL_LED_ANIMATION_PROGRESS) {
+        fill = (uint32_t) (neopixel_led_state.progress * count * 256);
+    }
+
+    for (size_t idx = 0; idx < count; idx += 1) {
+        uint32_t lit = idx * 256;
+        uint32_t level = fill <= lit ? 0 : (fill - lit >= 256 ? 255 : fill - lit);
+        pwm3_frame[idx] = pixel_word(urgbw_u32(_scale(colours[NEOPIXEL_MINI12864_LED1], level), order));
+    }
+
+    return count;
+}
+
+
+// Render and start the DMA if the last frame is out, called with the lock held
+static void _push_frame(uint32_t now_ms) {
+    if (neopixel_led_config.mini12864_dma_channel < 0 || neopixel_led_config.pwm3_dma_channel < 0) {
+        return;
+    }
+
+    // The next frame timer tick sends it, no waiting with the lock held
+    if (dma_channel_is_busy(neopixel_led_config.mini12864_dma_channel) ||
+        dma_channel_is_busy(neopixel_led_config.pwm3_dma_channel) ||
+        !pio_sm_is_tx_fifo_empty(neopixel_led_config.mini12864_pio_config.pio, neopixel_led_config.mini12864_pio_config.sm) ||
+        !pio_sm_is_tx_fifo_empty(neopixel_led_config.pwm3_pio_config.pio, neopixel_led_config.pwm3_pio_config.sm) ||
+        (int32_t) (time_us_32() - neopixel_led_latched_us) < 0) {
+        return;
+    }
+
+    size_t pwm3_count = _render(now_ms);
+
+    size_t num_words = pwm3_count > NEOPIXEL_MINI12864_NUM_LEDS ? pwm3_count : NEOPIXEL_MINI12864_NUM_LEDS;
+    neopixel_led_latched_us = time_us_32() + num_words * NEOPIXEL_LED_WORD_US + NEOPIXEL_LED_LATCH_US;
+
+    dma_channel_transfer_from_buffer_now(neopixel_led_config.mini12864_dma_channel, mini12864_frame, NEOPIXEL_MINI12864_NUM_LEDS);
+    if (pwm3_count) {
+        dma_channel_transfer_from_buffer_now(neopixel_led_config.pwm3_dma_channel, pwm3_frame, pwm3_count);
+    }
+
+    neopixel_led_state.dirty = false;
+}
+
+
+static void neopixel_led_frame_timer_callback(TimerHandle_t timer) {
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+
+    uint32_t irq_state = spin_lock_blocking(neopixel_led_lock);
+    if (neopixel_led_state.dirty || _is_animating(now_ms)) {
+        _push_frame(now_ms);
+    }
+    spin_unlock(neopixel_led_lock, irq_state);
+}
 
-    // Release resource
-    xSemaphoreGive(neopixel_led_config.mutex);
+
+// Start a new animation from whatever is shown now. With keep_backlight, the backlight colour of to is
+// replaced with the one of the current animation.
+static void _post(neopixel_led_animation_t animation, rgbw_u32_t to[NEOPIXEL_MINI12864_NUM_LEDS], float progress, bool keep_backlight) {
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+
+    uint32_t irq_state = spin_lock_blocking(neopixel_led_lock);
+
+    if (keep_backlight) {
+        to[NEOPIXEL_MINI12864_BACKLIGHT] = neopixel_led_state.to[NEOPIXEL_MINI12864_BACKLIGHT];
+    }
+
+    // A colour change restarts the blend, a new progress value only moves the fill
+    bool same_colours = memcmp(neopixel_led_state.to, to, sizeof(neopixel_led_state.to)) == 0;
+    if (neopixel_led_state.raw || neopixel_led_state.animation != animation || !same_colours) {
+        memcpy(neopixel_led_state.from, neopixel_led_shown, sizeof(neopixel_led_state.from));
+        memcpy(neopixel_led_state.to, to, sizeof(neopixel_led_state.to));
+        neopixel_led_state.start_ms = now_ms;
+    }
+    neopixel_led_state.animation = animation;
+    neopixel_led_state.progress = progress < 0.0f ? 0.0f : (progress > 1.0f ? 1.0f : progress);
+    neopixel_led_state.raw = false;
+    neopixel_led_state.dirty = true;
+
+    spin_unlock(neopixel_led_lock, irq_state);
+}
+
+
+// Low level function to bypass the animations and configure colour directly
+void _neopixel_led_set_colour(uint32_t led1_colour, uint32_t led2_colour, uint32_t mini12864_backlight_colour) {
+    uint32_t irq_state = spin_lock_blocking(neopixel_led_lock);
+
+    neopixel_led_state.raw = true;
+    neopixel_led_state.raw_words[NEOPIXEL_MINI12864_LED1] = led1_colour;
+    neopixel_led_state.raw_words[NEOPIXEL_MINI12864_LED2] = led2_colour;
+    neopixel_led_state.raw_words[NEOPIXEL_MINI12864_BACKLIGHT] = mini12864_backlight_colour;
+    neopixel_led_state.dirty = true;
+
+    // Send now if the chain is idle, e.g., before the scheduler (and so the frame timer) runs
+    _push_frame(to_ms_since_boot(get_absolute_time()));
+
+    spin_unlock(neopixel_led_lock, irq_state);
+}
+
+
+void neopixel_led_set_colour(rgbw_u32_t mini12864_backlight_colour, rgbw_u32_t led1_colour, rgbw_u32_t led2_colour) {
+    rgbw_u32_t colours[NEOPIXEL_MINI12864_NUM_LEDS];
+    colours[NEOPIXEL_MINI12864_LED1] = led1_colour;
+    colours[NEOPIXEL_MINI12864_LED2] = led2_colour;
+    colours[NEOPIXEL_MINI12864_BACKLIGHT] = mini12864_backlight_colour;
+
+    _post(NEOPIXEL_LED_ANIMATION_SOLID, colours, 0.0f, false);
+}
+
+
+void neopixel_led_pulse(rgbw_u32_t colour) {
+    rgbw_u32_t colours[NEOPIXEL_MINI12864_NUM_LEDS];
+    colours[NEOPIXEL_MINI12864_LED1] = colour;
+    colours[NEOPIXEL_MINI12864_LED2] = colour;
+
+    _post(NEOPIXEL_LED_ANIMATION_PULSE, colours, 0.0f, true);
+}
+
+
+void neopixel_led_progress(rgbw_u32_t colour, float progress) {
+    rgbw_u32_t colours[NEOPIXEL_MINI12864_NUM_LEDS];
+    colours[NEOPIXEL_MINI12864_LED1] = colour;
+    colours[NEOPIXEL_MINI12864_LED2] = colour;
+
+    _post(NEOPIXEL_LED_ANIMATION_PROGRESS, colours, progress, true);
+}
+
+
+void neopixel_led_set_error(rgbw_u32_t colour) {
+    uint32_t irq_state = spin_lock_blocking(neopixel_led_lock);
+
+    neopixel_led_state.error = true;
+    neopixel_led_state.error_colour = colour;
+    neopixel_led_state.dirty = true;
+
+    // Send now if the chain is idle, the frame timer sends it otherwise
+    _push_frame(to_ms_since_boot(get_absolute_time()));
+
+    spin_unlock(neopixel_led_lock, irq_state);
+}
+
+
+void neopixel_led_clear_error(void) {
+    uint32_t irq_state = spin_lock_blocking(neopixel_led_lock);
+
+    // The next frame shows the animation posted meanwhile
+    neopixel_led_state.error = false;
+    neopixel_led_state.dirty = true;
+
+    spin_unlock(neopixel_led_lock, irq_state);
+}
+
+
+static void neopixel_led_default_colours(rgbw_u32_t colours[NEOPIXEL_MINI12864_NUM_LEDS]) {
+    neopixel_led_colours_t * defaults = &neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours;
+    colours[NEOPIXEL_MINI12864_LED1] = defaults->led1_colour;
+    colours[NEOPIXEL_MINI12864_LED2] = defaults->led2_colour;
+    colours[NEOPIXEL_MINI12864_BACKLIGHT] = defaults->mini12864_backlight_colour;
+}
+
+
+// One channel per chain, paced by the TX FIFO of the state machine
+static int _claim_dma_channel(pio_config_t * pio_config) {
+    int channel = dma_claim_unused_channel(false);
+    if (channel < 0) {
+        return channel;
+    }
+
+    dma_channel_config dma_cfg = dma_channel_get_default_config(channel);
+    channel_config_set_transfer_data_size(&dma_cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&dma_cfg, true);
+    channel_config_set_write_increment(&dma_cfg, false);
+    channel_config_set_dreq(&dma_cfg, pio_get_dreq(pio_config->pio, pio_config->sm, true));
+    dma_channel_configure(channel, &dma_cfg, &pio_config->pio->txf[pio_config->sm], NULL, 0, false);
+
+    return channel;
 }
 
 
@@ -120,6 +380,9 @@ bool neopixel_led_init(void) {
     
     // Initialize configuration
     memset(&neopixel_led_config, 0x0, sizeof(neopixel_led_config));
+    neopixel_led_config.mini12864_dma_channel = -1;
+    neopixel_led_config.pwm3_dma_channel = -1;
+    neopixel_led_lock = spin_lock_instance(spin_lock_claim_unused(true));
 
     is_ok = eeprom_read(EEPROM_NEOPIXEL_LED_CONFIG_BASE_ADDR, (uint8_t *) &neopixel_led_config.eeprom_neopixel_led_metadata, sizeof(eeprom_neopixel_led_metadata_t));
     if (!is_ok) {
@@ -153,13 +416,6 @@ bool neopixel_led_init(void) {
         }
     }
 
-    // Initialize the mutex
-    neopixel_led_config.mutex = xSemaphoreCreateMutex();
-    if (neopixel_led_config.mutex == NULL) {
-        printf("Unable to create neopixel LED mutex\n");
-        return false;
-    }
-
     // Configure Neopixel for mini12864 display
     PIO pio;
     uint sm;
@@ -179,13 +435,6 @@ bool neopixel_led_init(void) {
     neopixel_led_config.mini12864_pio_config.pio = pio;
     neopixel_led_config.mini12864_pio_config.sm = sm;
 
-    // Set default colour
-    _neopixel_led_set_colour(
-        urgbw_u32(neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led1_colour, NEOPIXEL_COLOUR_ORDER_GRB),
-        urgbw_u32(neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led2_colour, NEOPIXEL_COLOUR_ORDER_GRB),
-        urgbw_u32(neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.mini12864_backlight_colour, NEOPIXEL_COLOUR_ORDER_GRB)
-    );
-
     // Configure Neopixel for PWM3
     is_ok = pio_claim_free_sm_and_add_program_for_gpio_range(
         &ws2812_program, &pio, &sm, &offset, NEOPIXEL_PWM3_PIN, 1, true
@@ -201,12 +450,38 @@ bool neopixel_led_init(void) {
     neopixel_led_config.pwm3_pio_config.pio = pio;
     neopixel_led_config.pwm3_pio_config.sm = sm;
 
-    // Set default colour for PWM3
-    // Infuse white intensity
-    rgbw_u32_t colour = neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led1_colour;
-    _neopixel_pwm_out_set_colour(
-        urgbw_u32(colour, neopixel_led_config.eeprom_neopixel_led_metadata.pwm_out_led_colour_order)
+    // Framebuffer DMA
+    neopixel_led_config.mini12864_dma_channel = _claim_dma_channel(&neopixel_led_config.mini12864_pio_config);
+    neopixel_led_config.pwm3_dma_channel = _claim_dma_channel(&neopixel_led_config.pwm3_pio_config);
+    if (neopixel_led_config.mini12864_dma_channel < 0 || neopixel_led_config.pwm3_dma_channel < 0) {
+        report_error(ERR_NEOPIXEL_DMA_CLAIM);
+        return false;
+    }
+
+    // Set default colour, shown at once without a blend
+    neopixel_led_default_colours(neopixel_led_state.to);
+    memcpy(neopixel_led_state.from, neopixel_led_state.to, sizeof(neopixel_led_state.from));
+    memcpy(neopixel_led_shown, neopixel_led_state.to, sizeof(neopixel_led_shown));
+    neopixel_led_state.animation = NEOPIXEL_LED_ANIMATION_SOLID;
+    neopixel_led_state.dirty = true;
+
+    uint32_t irq_state = spin_lock_blocking(neopixel_led_lock);
+    _push_frame(to_ms_since_boot(get_absolute_time()));
+    spin_unlock(neopixel_led_lock, irq_state);
+
+    // Animation frames, starts with the scheduler
+    neopixel_led_config.frame_timer = xTimerCreateStatic(
+        "Neopixel",
+        pdMS_TO_TICKS(NEOPIXEL_LED_FRAME_INTERVAL_MS),
+        pdTRUE,
+        NULL,
+        neopixel_led_frame_timer_callback,
+        &neopixel_led_frame_timer_buffer
     );
+    if (neopixel_led_config.frame_timer == NULL || xTimerStart(neopixel_led_config.frame_timer, 0) != pdPASS) {
+        report_error(ERR_NEOPIXEL_TIMER_CREATE);
+        return false;
+    }
 
     // Register to eeprom save all
     eeprom_register_handler(neopixel_led_config_save);
@@ -298,12 +573,11 @@ bool http_rest_neopixel_led_config(struct fs_file *file, int num_params, char *p
     file->index = data_length;
     file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
 
-    // Update new colour
+    // Update new colour, the chain length may have changed as well
     neopixel_led_set_colour(
         neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.mini12864_backlight_colour,
         neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led1_colour,
-        neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led2_colour,
-        true  // block wait
+        neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led2_colour
     );
 
     return true;
@@ -2,12 +2,19 @@
 #define NEOPIXEL_LED_H_
 
 #include <stdbool.h>
-#include <semphr.h>
+#include <FreeRTOS.h>
+#include <timers.h>
 #include "http_rest.h"
 #include "common.h"
 
 #define EEPROM_NEOPIXEL_LED_METADATA_REV                     4              // 16 byte 
 
+// Animation engine, see neopixel_led.c
+#define NEOPIXEL_LED_FRAME_INTERVAL_MS      20      // 50 Hz, a frame of 16 LEDs takes ~0.5 ms on the wire
+#define NEOPIXEL_LED_BLEND_MS               200     // Colour changes fade over this time
+#define NEOPIXEL_LED_PULSE_PERIOD_MS        1600
+#define NEOPIXEL_LED_PULSE_MIN_LEVEL        24      // Out of 255, the pulse never goes fully dark
+
 
 // A struct that uses 8bit bitfields to map R, G, B, W into a uint32_t memory space.
 #define RGB_COLOUR_GREEN 0x00FF00ul
@@ -55,6 +62,20 @@ typedef enum {
     NEOPIXEL_LED_CHAIN_COUNT_16 = 16, // 16 LEDs from the same chain
 } neopixel_led_chain_count_t;
 
+// LEDs on the mini12864 chain, in the order they are sent
+typedef enum {
+    NEOPIXEL_MINI12864_LED1 = 0,        // Encoder RGB1
+    NEOPIXEL_MINI12864_LED2,            // Encoder RGB2
+    NEOPIXEL_MINI12864_BACKLIGHT,
+    NEOPIXEL_MINI12864_NUM_LEDS,
+} neopixel_mini12864_led_t;
+
+typedef enum {
+    NEOPIXEL_LED_ANIMATION_SOLID = 0,   // Blend into the colours, then hold them
+    NEOPIXEL_LED_ANIMATION_PULSE,       // LED1 and LED2 breathe in and out, e.g., waiting for zero
+    NEOPIXEL_LED_ANIMATION_PROGRESS,    // PWM OUT chain fills up with the progress, e.g., towards the target
+} neopixel_led_animation_t;
+
 typedef enum {
     NEOPIXEL_COLOUR_ORDER_RGB = 0,  // RGB
     NEOPIXEL_COLOUR_ORDER_GRB = 1, // GRB
@@ -74,14 +95,19 @@ typedef struct {
 
 /* Configuration file for neopixel LEDs on both mini12864 display (including three LEDs in chain) and one dedicated LED on PWM3
    PWM3 output will mirror the LED1 colour from mini12864 display.
+
+   The colours are kept in a framebuffer per chain and sent by DMA to the ws2812 state machines. A timer
+   renders the current animation into the framebuffers every NEOPIXEL_LED_FRAME_INTERVAL_MS, callers only
+   post the animation and never wait for the LEDs.
 */
 typedef struct {
     eeprom_neopixel_led_metadata_t eeprom_neopixel_led_metadata;
 
-    SemaphoreHandle_t mutex;
-    TaskHandle_t neopixel_control_task_handler;
+    TimerHandle_t frame_timer;
     pio_config_t mini12864_pio_config;
     pio_config_t pwm3_pio_config;
+    int mini12864_dma_channel;
+    int pwm3_dma_channel;
 } neopixel_led_config_t;
 
 
@@ -92,12 +118,28 @@ extern "C" {
 
 bool neopixel_led_init(void);
 bool neopixel_led_config_save();
-void neopixel_led_set_colour(rgbw_u32_t mini12864_backlight_colour, rgbw_u32_t led1_colour, rgbw_u32_t led2_colour, bool block_wait);
+
+// Blend into the new colours, the PWM OUT chain mirrors LED1. Never blocks, safe from any task.
+void neopixel_led_set_colour(rgbw_u32_t mini12864_backlight_colour, rgbw_u32_t led1_colour, rgbw_u32_t led2_colour);
+
+// Pulse LED1, LED2 and the PWM OUT chain with the colour, the backlight is kept
+void neopixel_led_pulse(rgbw_u32_t colour);
+
+// Fill the PWM OUT chain up to progress (0 - 1) with the colour, LED1 and LED2 show the colour. Call it
+// again with the new progress, the animation carries on.
+void neopixel_led_progress(rgbw_u32_t colour, float progress);
+
+// Show the colour on all LEDs over any animation, e.g., red for an error. Latched, the animations carry on
+// underneath and show again after neopixel_led_clear_error().
+void neopixel_led_set_error(rgbw_u32_t colour);
+void neopixel_led_clear_error(void);
+
 bool http_rest_neopixel_led_config(struct fs_file *file, int num_params, char *params[], char *values[]);
 
 uint32_t hex_string_to_decimal(char * string);
 
-// Low level function to bypass RTOS to configure colour directly
+// Low level function to bypass the animations and send the mini12864 colours (in GRB) as they are, held
+// until the next animation is posted
 void _neopixel_led_set_colour(uint32_t led1_colour, uint32_t led2_colour, uint32_t mini12864_backlight_colour);
 
 #ifdef __cplusplus
@@ -1,5 +1,6 @@
 #include <string.h>
 #include <stdio.h>
+#include <stddef.h>
 
 #include "profile.h"
 #include "eeprom.h"
@@ -29,6 +30,9 @@ const profile_t default_ar_2208_profile = {
     .fine_kd = 10.0f,
     .fine_min_flow_speed_rps = 0.1f,
     .fine_max_flow_speed_rps = 3.0f,
+
+    .gate_flow_start_error = 0.0f,
+    .gate_flow_min_opening = 0.5f,
 };
 
 
@@ -50,9 +54,16 @@ const profile_t default_ar_2209_profile = {
 
     .fine_min_flow_speed_rps = 0.08f,
     .fine_max_flow_speed_rps = 5.0f,
+
+    .gate_flow_start_error = 0.0f,
+    .gate_flow_min_opening = 0.5f,
 };
 
 
+// Rev 1 profiles end before the gate flow control settings
+#define PROFILE_REV1_SIZE       offsetof(profile_t, gate_flow_start_error)
+
+
 
 
 bool profile_data_save() {
@@ -66,6 +77,23 @@ bool profile_data_save() {
 }
 
 
+// Spread the rev 1 profiles, read back to back, out to the current size and add the new settings
+static void profile_data_migrate_rev1(void) {
+    uint8_t * raw = (uint8_t *) profile_data.profiles;
+
+    // Last first, a profile only moves up over the ones already moved
+    for (int idx = MAX_PROFILE_CNT - 1; idx >= 0; idx -= 1) {
+        profile_t * selected_profile = &profile_data.profiles[idx];
+        memmove(selected_profile, raw + idx * PROFILE_REV1_SIZE, PROFILE_REV1_SIZE);
+
+        selected_profile->gate_flow_start_error = default_ar_2208_profile.gate_flow_start_error;
+        selected_profile->gate_flow_min_opening = default_ar_2208_profile.gate_flow_min_opening;
+    }
+
+    profile_data.profile_data_rev = EEPROM_PROFILE_DATA_REV;
+}
+
+
 bool profile_data_init() {
     bool is_ok = true;
 
@@ -78,7 +106,13 @@ bool profile_data_init() {
         return false;
     }
 
-    if (profile_data.profile_data_rev != EEPROM_PROFILE_DATA_REV) {
+    if (profile_data.profile_data_rev == 1) {
+        profile_data_migrate_rev1();
+
+        // Write back
+        profile_data_save();
+    }
+    else if (profile_data.profile_data_rev != EEPROM_PROFILE_DATA_REV) {
         profile_data.profile_data_rev = EEPROM_PROFILE_DATA_REV;
         // Set default selected profile
         profile_data.current_profile_idx = 0;
@@ -93,6 +127,7 @@ bool profile_data_init() {
         // Update default profile data
         for (uint8_t idx=2; idx < MAX_PROFILE_CNT; idx+=1) {
             profile_t * selected_profile = &profile_data.profiles[idx];
+            selected_profile->gate_flow_min_opening = default_ar_2208_profile.gate_flow_min_opening;
 
             // Provide default name
             snprintf(selected_profile->name, PROFILE_NAME_MAX_LEN, 
@@ -152,8 +187,10 @@ bool http_rest_profile_config(struct fs_file *file, int num_params, char *params
     // p10 (float): fine_kd
     // p11 (float): fine_min_flow_speed_rps
     // p12 (float): fine_max_flow_speed_rps
+    // p13 (float): gate_flow_start_error
+    // p14 (float): gate_flow_min_opening
     // ee (bool): save to eeprom
-    static char buf[256];
+    static char buf[320];
 
     // Read the current loaded profile index
     uint8_t profile_idx = profile_get_selected_idx();
@@ -215,6 +252,13 @@ bool http_rest_profile_config(struct fs_file *file, int num_params, char *params
             else if (strcmp(params[idx], "p12") == 0) {
                 current_profile->fine_max_flow_speed_rps = strtof(values[idx], NULL);
             }
+            else if (strcmp(params[idx], "p13") == 0) {
+                current_profile->gate_flow_start_error = strtof(values[idx], NULL);
+            }
+            else if (strcmp(params[idx], "p14") == 0) {
+                float opening = strtof(values[idx], NULL);
+                current_profile->gate_flow_min_opening = opening < 0.0f ? 0.0f : (opening > 1.0f ? 1.0f : opening);
+            }
             else if (strcmp(params[idx], "ee") == 0) {
                 save_to_eeprom = string_to_boolean(values[idx]);
             }
@@ -228,7 +272,7 @@ bool http_rest_profile_config(struct fs_file *file, int num_params, char *params
         // Response
         snprintf(buf, sizeof(buf), 
                  "%s"
-                 "{\"pf\":%d,\"p0\":%ld,\"p1\":%ld,\"p2\":\"%s\",\"p3\":%0.3f,\"p4\":%0.3f,\"p5\":%0.3f,\"p6\":%0.3f,\"p7\":%0.3f,\"p8\":%0.3f,\"p9\":%0.3f,\"p10\":%0.3f,\"p11\":%0.3f,\"p12\":%0.3f}",
+                 "{\"pf\":%d,\"p0\":%ld,\"p1\":%ld,\"p2\":\"%s\",\"p3\":%0.3f,\"p4\":%0.3f,\"p5\":%0.3f,\"p6\":%0.3f,\"p7\":%0.3f,\"p8\":%0.3f,\"p9\":%0.3f,\"p10\":%0.3f,\"p11\":%0.3f,\"p12\":%0.3f,\"p13\":%0.3f,\"p14\":%0.3f}",
                  http_json_header,
                  profile_idx, 
                  current_profile->rev,
@@ -243,7 +287,9 @@ bool http_rest_profile_config(struct fs_file *file, int num_params, char *params
                  current_profile->fine_ki,
                  current_profile->fine_kd,
                  current_profile->fine_min_flow_speed_rps,
-                 current_profile->fine_max_flow_speed_rps);
+                 current_profile->fine_max_flow_speed_rps,
+                 current_profile->gate_flow_start_error,
+                 current_profile->gate_flow_min_opening);
     }
 
     size_t response_len = strlen(buf);
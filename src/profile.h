@@ -9,7 +9,7 @@
 #define PROFILE_NAME_MAX_LEN    16
 #define MAX_PROFILE_CNT         8
 
-#define EEPROM_PROFILE_DATA_REV             1           // 16 bit
+#define EEPROM_PROFILE_DATA_REV             2           // 16 bit
 
 typedef struct
 {  
@@ -31,6 +31,10 @@ typedef struct
 
     float fine_min_flow_speed_rps;
     float fine_max_flow_speed_rps;
+
+    // Servo gate flow control in the coarse phase, added in rev 2
+    float gate_flow_start_error;        // The gate starts closing this far from the target, 0 keeps it open
+    float gate_flow_min_opening;        // Opening at the coarse stop threshold, 0.0 (closed) to 1.0 (open)
 } profile_t;
 
 
@@ -9,6 +9,7 @@
 #include "configuration.h"
 #include "scale.h"
 #include "app.h"
+#include "scale_frame.h"
 
 // Radwag response frame structure for SUI command
 // Format: SUI<stability><mass(12)><unit(3)>CR LF
@@ -44,25 +45,10 @@ scale_handle_t radwag_ps_r2_scale_handle = {
  * @return float Decoded weight value, NaN if conversion failed
  */
 static float _decode_measurement_msg(radwag_sui_frame_t *msg) {
-    // Create a temporary buffer for mass conversion
     // Mass field is 12 characters with spaces padding on the left
-    char mass_str[13];
-    memcpy(mass_str, msg->mass, 12);
-    mass_str[12] = '\0';
-    
-    // Convert mass string to float (strtof handles leading spaces)
-    char *endptr;
-    float weight = strtof(mass_str, &endptr);
-    
-    if (endptr == mass_str) {
-        // Conversion failed
-        return nanf(mass_str);
-    }
-    
     // Note: The mass field in SUI doesn't have a separate sign character
     // Negative values would include '-' in the mass field itself
-    
-    return weight;
+    return scale_frame_parse_weight(msg->mass, sizeof(msg->mass), '+');
 }
 
 /**
@@ -72,42 +58,20 @@ static float _decode_measurement_msg(radwag_sui_frame_t *msg) {
  * @param p Task parameter (unused)
  */
 void _radwag_scale_listener_task(void *p) {
-    uint8_t string_buf_idx = 0;
     radwag_sui_frame_t frame;
-    
+    scale_frame_reader_t reader;
+    scale_frame_reader_init(&reader, &frame, sizeof(frame), SCALE_FRAME_NO_HEADER);
+
     while (true) {
-        // Read all available data
-        while (uart_is_readable(SCALE_UART)) {
-            char ch = uart_getc(SCALE_UART);
-            frame.bytes[string_buf_idx++] = ch;
-            
-            // Radwag SUI frame is 21 bytes
-            if (string_buf_idx == sizeof(radwag_sui_frame_t)) {
-                // Verify this is a SUI mass frame
-                if (frame.command[0] == 'S' && 
-                    frame.command[1] == 'U' && 
-                    frame.command[2] == 'I') {
-                    
-                    // Data is ready, decode and update
-                    scale_config.current_scale_measurement = _decode_measurement_msg(&frame);
-                    
-                    // Signal that data is ready
-                    if (scale_config.scale_measurement_ready) {
-                        xSemaphoreGive(scale_config.scale_measurement_ready);
-                    }
-                }
-                
-                // Reset buffer
-                string_buf_idx = 0;
-            }
-            
-            // Reset on line terminator to resynchronize if out of sync
-            if (ch == '\n') {
-                string_buf_idx = 0;
+        // Decode every frame received so far
+        while (scale_frame_read(&reader, HAL_UART_SCALE)) {
+            // Only SUI (mass in the current unit) frames carry a weight
+            if (frame.command[0] == 'S' && frame.command[1] == 'U' && frame.command[2] == 'I') {
+                scale_update_measurement(_decode_measurement_msg(&frame));
             }
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(20));
+
+        hal_delay_ms(20);
     }
 }
 
@@ -2,28 +2,32 @@
 #include "ai_tuning.h"
 #include "profile.h"
 #include "http_rest.h"
-#include "common.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// JSON response buffer
-static char ai_tuning_json_buffer[2048];
-
-// Helper function for buffer overflow errors
-static bool send_buffer_overflow_error(struct fs_file *file) {
-    static const char overflow_error[] = "HTTP/1.1 500 Internal Server Error\r\n"
-        "Content-Type: application/json\r\n\r\n"
-        "{\"success\":false,\"error\":\"Response buffer overflow\"}";
-    file->data = overflow_error;
-    file->len = sizeof(overflow_error) - 1;
-    file->index = file->len;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-    return true;
+// Write {"success":<success>,"message"|"error":<text>}
+static void write_result(json_writer_t *json, bool success, const char *text) {
+    json_begin_object(json);
+    json_add_bool(json, "success", success);
+    json_add_string(json, success ? "message" : "error", text);
+    json_end_object(json);
+}
+
+static void write_params(json_writer_t *json, const char *key,
+                         float coarse_kp, float coarse_kd,
+                         float fine_kp, float fine_kd, uint8_t decimal_places) {
+    json_add_object(json, key);
+    json_add_float(json, "coarse_kp", coarse_kp, decimal_places);
+    json_add_float(json, "coarse_kd", coarse_kd, decimal_places);
+    json_add_float(json, "fine_kp", fine_kp, decimal_places);
+    json_add_float(json, "fine_kd", fine_kd, decimal_places);
+    json_end_object(json);
 }
 
-bool http_rest_ai_tuning_start(struct fs_file *file, int num_params,
+bool http_rest_ai_tuning_start(rest_response_t *response, int num_params,
                                  char *params[], char *values[]) {
+    json_writer_t *json = &response->json;
     int profile_idx = -1;
     int mode = -1;  // -1 = not specified, 0 = quick, 1 = fine
 
@@ -45,76 +49,43 @@ bool http_rest_ai_tuning_start(struct fs_file *file, int num_params,
     }
 
     if (profile_idx < 0 || profile_idx > 7) {
-        int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-            "%s{\"success\":false,\"error\":\"Invalid profile_idx (must be 0-7)\"}",
-            http_json_header);
-
-        if (len >= 0 && len < (int)sizeof(ai_tuning_json_buffer)) {
-            file->data = ai_tuning_json_buffer;
-            file->len = len;
-            file->index = len;
-            file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-        }
-        return true;
+        write_result(json, false, "Invalid profile_idx (must be 0-7)");
+        return false;
     }
 
     // Get profile
     profile_t* profile = profile_select(profile_idx);
     if (!profile) {
-        int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-            "%s{\"success\":false,\"error\":\"Failed to select profile\"}",
-            http_json_header);
-
-        if (len >= 0 && len < (int)sizeof(ai_tuning_json_buffer)) {
-            file->data = ai_tuning_json_buffer;
-            file->len = len;
-            file->index = len;
-            file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-        }
-        return true;
+        write_result(json, false, "Failed to select profile");
+        return false;
     }
 
     // Start tuning
     if (!ai_tuning_start(profile)) {
-        int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-            "%s{\"success\":false,\"error\":\"Failed to start AI tuning\"}",
-            http_json_header);
-
-        if (len >= 0 && len < (int)sizeof(ai_tuning_json_buffer)) {
-            file->data = ai_tuning_json_buffer;
-            file->len = len;
-            file->index = len;
-            file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-        }
-        return true;
+        write_result(json, false, "Failed to start AI tuning");
+        return false;
     }
 
     // Success
     ai_tuning_mode_t current_mode = ai_tuning_get_mode();
-    int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-        "%s{\"success\":true,\"message\":\"AI tuning started\",\"profile\":\"%s\",\"mode\":\"%s\",\"step\":%.2f}",
-        http_json_header, profile->name,
-        current_mode == AI_TUNING_MODE_QUICK ? "quick" : "fine",
-        current_mode == AI_TUNING_MODE_QUICK ? 0.1f : 0.05f);
-
-    if (len < 0 || len >= (int)sizeof(ai_tuning_json_buffer)) {
-        return send_buffer_overflow_error(file);
-    }
-
-    file->data = ai_tuning_json_buffer;
-    file->len = len;
-    file->index = len;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-
-    return true;
+    json_begin_object(json);
+    json_add_bool(json, "success", true);
+    json_add_string(json, "message", "AI tuning started");
+    json_add_string(json, "profile", profile->name);
+    json_add_string(json, "mode", current_mode == AI_TUNING_MODE_QUICK ? "quick" : "fine");
+    json_add_float(json, "step", current_mode == AI_TUNING_MODE_QUICK ? 0.1f : 0.05f, 2);
+    json_end_object(json);
+
+    return false;
 }
 
-bool http_rest_ai_tuning_status(struct fs_file *file, int num_params,
+bool http_rest_ai_tuning_status(rest_response_t *response, int num_params,
                                   char *params[], char *values[]) {
     (void)num_params;
     (void)params;
     (void)values;
 
+    json_writer_t *json = &response->json;
     ai_tuning_session_t* session = ai_tuning_get_session();
 
     const char* state_str;
@@ -133,44 +104,22 @@ bool http_rest_ai_tuning_status(struct fs_file *file, int num_params,
     ai_tuning_mode_t current_mode = ai_tuning_get_mode();
 
     // Build JSON response
-    int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-        "%s{"
-        "\"state\":\"%s\","
-        "\"mode\":\"%s\","
-        "\"min_step\":%.2f,"
-        "\"is_active\":%s,"
-        "\"is_complete\":%s,"
-        "\"drops_completed\":%u,"
-        "\"drops_target\":%u,"
-        "\"drops_max\":%u,"
-        "\"progress_percent\":%u",
-        http_json_header,
-        state_str,
-        current_mode == AI_TUNING_MODE_QUICK ? "quick" : "fine",
-        current_mode == AI_TUNING_MODE_QUICK ? 0.1f : 0.05f,
-        is_active ? "true" : "false",
-        is_complete ? "true" : "false",
-        session->drops_completed,
-        session->total_drops_target,
-        session->max_drops_allowed,
-        progress);
-
-    if (len < 0 || len >= (int)sizeof(ai_tuning_json_buffer)) {
-        return send_buffer_overflow_error(file);
-    }
+    json_begin_object(json);
+    json_add_string(json, "state", state_str);
+    json_add_string(json, "mode", current_mode == AI_TUNING_MODE_QUICK ? "quick" : "fine");
+    json_add_float(json, "min_step", current_mode == AI_TUNING_MODE_QUICK ? 0.1f : 0.05f, 2);
+    json_add_bool(json, "is_active", is_active);
+    json_add_bool(json, "is_complete", is_complete);
+    json_add_uint(json, "drops_completed", session->drops_completed);
+    json_add_uint(json, "drops_target", session->total_drops_target);
+    json_add_uint(json, "drops_max", session->max_drops_allowed);
+    json_add_uint(json, "progress_percent", progress);
 
     // Add current parameters if active
     if (is_active) {
         float coarse_kp, coarse_kd, fine_kp, fine_kd;
         if (ai_tuning_get_next_params(&coarse_kp, &coarse_kd, &fine_kp, &fine_kd)) {
-            len += snprintf(ai_tuning_json_buffer + len, sizeof(ai_tuning_json_buffer) - len,
-                ",\"current_params\":{"
-                "\"coarse_kp\":%.4f,"
-                "\"coarse_kd\":%.4f,"
-                "\"fine_kp\":%.4f,"
-                "\"fine_kd\":%.4f"
-                "}",
-                coarse_kp, coarse_kd, fine_kp, fine_kd);
+            write_params(json, "current_params", coarse_kp, coarse_kd, fine_kp, fine_kd, 4);
         }
     }
 
@@ -178,114 +127,55 @@ bool http_rest_ai_tuning_status(struct fs_file *file, int num_params,
     if (is_complete) {
         float coarse_kp, coarse_kd, fine_kp, fine_kd;
         if (ai_tuning_get_recommended_params(&coarse_kp, &coarse_kd, &fine_kp, &fine_kd)) {
-            len += snprintf(ai_tuning_json_buffer + len, sizeof(ai_tuning_json_buffer) - len,
-                ",\"recommended_params\":{"
-                "\"coarse_kp\":%.4f,"
-                "\"coarse_kd\":%.4f,"
-                "\"fine_kp\":%.4f,"
-                "\"fine_kd\":%.4f"
-                "}",
-                coarse_kp, coarse_kd, fine_kp, fine_kd);
+            write_params(json, "recommended_params", coarse_kp, coarse_kd, fine_kp, fine_kd, 4);
 
             // Add statistics
-            len += snprintf(ai_tuning_json_buffer + len, sizeof(ai_tuning_json_buffer) - len,
-                ",\"statistics\":{"
-                "\"avg_overthrow\":%.2f,"
-                "\"avg_time\":%.1f,"
-                "\"consistency_score\":%.1f"
-                "}",
-                session->avg_overthrow,
-                session->avg_total_time,
-                session->consistency_score);
+            json_add_object(json, "statistics");
+            json_add_float(json, "avg_overthrow", session->avg_overthrow, 2);
+            json_add_float(json, "avg_time", session->avg_total_time, 1);
+            json_add_float(json, "consistency_score", session->consistency_score, 1);
+            json_end_object(json);
         }
     }
 
     // Add error info if in error state
     if (session->state == AI_TUNING_ERROR) {
-        len += snprintf(ai_tuning_json_buffer + len, sizeof(ai_tuning_json_buffer) - len,
-            ",\"error_message\":\"%s\""
-            ",\"best_params\":{"
-            "\"coarse_kp\":%.4f,"
-            "\"coarse_kd\":%.4f,"
-            "\"fine_kp\":%.4f,"
-            "\"fine_kd\":%.4f"
-            "}",
-            session->error_message,
-            session->recommended_coarse_kp,
-            session->recommended_coarse_kd,
-            session->recommended_fine_kp,
-            session->recommended_fine_kd);
+        json_add_string(json, "error_message", session->error_message);
+        write_params(json, "best_params",
+                     session->recommended_coarse_kp, session->recommended_coarse_kd,
+                     session->recommended_fine_kp, session->recommended_fine_kd, 4);
     }
 
     // Close JSON
-    len += snprintf(ai_tuning_json_buffer + len, sizeof(ai_tuning_json_buffer) - len, "}");
+    json_end_object(json);
 
-    if (len < 0 || len >= (int)sizeof(ai_tuning_json_buffer)) {
-        return send_buffer_overflow_error(file);
-    }
-
-    file->data = ai_tuning_json_buffer;
-    file->len = len;
-    file->index = len;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-
-    return true;
+    return false;
 }
 
-bool http_rest_ai_tuning_apply(struct fs_file *file, int num_params,
+bool http_rest_ai_tuning_apply(rest_response_t *response, int num_params,
                                  char *params[], char *values[]) {
     (void)num_params;
     (void)params;
     (void)values;
 
     if (!ai_tuning_is_complete()) {
-        int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-            "%s{\"success\":false,\"error\":\"AI tuning not complete\"}",
-            http_json_header);
-
-        if (len >= 0 && len < (int)sizeof(ai_tuning_json_buffer)) {
-            file->data = ai_tuning_json_buffer;
-            file->len = len;
-            file->index = len;
-            file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-        }
-        return true;
+        write_result(&response->json, false, "AI tuning not complete");
+        return false;
     }
 
     if (!ai_tuning_apply_params()) {
-        int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-            "%s{\"success\":false,\"error\":\"Failed to apply parameters\"}",
-            http_json_header);
-
-        if (len >= 0 && len < (int)sizeof(ai_tuning_json_buffer)) {
-            file->data = ai_tuning_json_buffer;
-            file->len = len;
-            file->index = len;
-            file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-        }
-        return true;
+        write_result(&response->json, false, "Failed to apply parameters");
+        return false;
     }
 
     // Save profile with new parameters
     profile_data_save();
 
-    int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-        "%s{\"success\":true,\"message\":\"Parameters applied and saved\"}",
-        http_json_header);
-
-    if (len < 0 || len >= (int)sizeof(ai_tuning_json_buffer)) {
-        return send_buffer_overflow_error(file);
-    }
-
-    file->data = ai_tuning_json_buffer;
-    file->len = len;
-    file->index = len;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-
-    return true;
+    write_result(&response->json, true, "Parameters applied and saved");
+    return false;
 }
 
-bool http_rest_ai_tuning_cancel(struct fs_file *file, int num_params,
+bool http_rest_ai_tuning_cancel(rest_response_t *response, int num_params,
                                   char *params[], char *values[]) {
     (void)num_params;
     (void)params;
@@ -293,72 +183,57 @@ bool http_rest_ai_tuning_cancel(struct fs_file *file, int num_params,
 
     ai_tuning_cancel();
 
-    int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-        "%s{\"success\":true,\"message\":\"AI tuning cancelled\"}",
-        http_json_header);
-
-    if (len < 0 || len >= (int)sizeof(ai_tuning_json_buffer)) {
-        return send_buffer_overflow_error(file);
-    }
-
-    file->data = ai_tuning_json_buffer;
-    file->len = len;
-    file->index = len;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-
-    return true;
+    write_result(&response->json, true, "AI tuning cancelled");
+    return false;
 }
 
-bool http_rest_ai_tuning_history(struct fs_file *file, int num_params,
+bool http_rest_ai_tuning_history(rest_response_t *response, int num_params,
                                     char *params[], char *values[]) {
     (void)num_params;
     (void)params;
     (void)values;
 
+    // Parts: 0 = summary and suggestions, 1..count = one drop record each, count + 1 = closing brackets.
+    // The record count is captured in the cursor so records added while sending do not change the layout.
+    json_writer_t *json = &response->json;
     ai_tuning_history_t* history = ai_tuning_get_history();
 
-    // Build JSON response with drop records and suggestions
-    int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-        "%s{\"count\":%d,\"has_suggestions\":%s",
-        http_json_header, history->count,
-        history->has_suggestions ? "true" : "false");
-
-    // Add suggestions if available
-    if (history->has_suggestions) {
-        len += snprintf(ai_tuning_json_buffer + len, sizeof(ai_tuning_json_buffer) - len,
-            ",\"suggested\":{\"coarse_kp\":%.3f,\"coarse_kd\":%.3f,\"fine_kp\":%.3f,\"fine_kd\":%.3f}",
-            history->suggested_coarse_kp, history->suggested_coarse_kd,
-            history->suggested_fine_kp, history->suggested_fine_kd);
-    }
+    if (response->part == 0) {
+        response->cursor = history->count;
 
-    // Add drop records
-    len += snprintf(ai_tuning_json_buffer + len, sizeof(ai_tuning_json_buffer) - len, ",\"drops\":[");
+        json_begin_object(json);
+        json_add_int(json, "count", history->count);
+        json_add_bool(json, "has_suggestions", history->has_suggestions);
 
-    for (int i = 0; i < history->count && len < (int)sizeof(ai_tuning_json_buffer) - 150; i++) {
-        ai_drop_record_t* d = &history->drops[i];
-        if (i > 0) {
-            len += snprintf(ai_tuning_json_buffer + len, sizeof(ai_tuning_json_buffer) - len, ",");
+        // Add suggestions if available
+        if (history->has_suggestions) {
+            write_params(json, "suggested",
+                         history->suggested_coarse_kp, history->suggested_coarse_kd,
+                         history->suggested_fine_kp, history->suggested_fine_kd, 3);
         }
-        len += snprintf(ai_tuning_json_buffer + len, sizeof(ai_tuning_json_buffer) - len,
-            "{\"overthrow\":%.3f,\"time\":%.0f,\"profile\":%d}",
-            d->overthrow, d->total_time_ms, d->profile_idx);
-    }
 
-    len += snprintf(ai_tuning_json_buffer + len, sizeof(ai_tuning_json_buffer) - len, "]}");
-
-    if (len < 0 || len >= (int)sizeof(ai_tuning_json_buffer)) {
-        return send_buffer_overflow_error(file);
+        // Drop records follow, one per part
+        json_add_array(json, "drops");
+    }
+    else if (response->part <= response->cursor) {
+        ai_drop_record_t* d = &history->drops[response->part - 1];
+
+        json_begin_object(json);
+        json_add_float(json, "overthrow", d->overthrow, 3);
+        json_add_float(json, "time", d->total_time_ms, 0);
+        json_add_int(json, "profile", d->profile_idx);
+        json_end_object(json);
+    }
+    else {
+        json_end_array(json);
+        json_end_object(json);
+        return false;
     }
-
-    file->data = ai_tuning_json_buffer;
-    file->len = len;
-    file->index = len;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
 
     return true;
 }
 
-bool http_rest_ai_tuning_apply_refined(struct fs_file *file, int num_params,
+bool http_rest_ai_tuning_apply_refined(rest_response_t *response, int num_params,
                                          char *params[], char *values[]) {
     int profile_idx = -1;
 
@@ -369,40 +244,20 @@ bool http_rest_ai_tuning_apply_refined(struct fs_file *file, int num_params,
     }
 
     if (profile_idx < 0 || profile_idx > 7) {
-        int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-            "%s{\"success\":false,\"error\":\"Invalid profile_idx\"}",
-            http_json_header);
-        file->data = ai_tuning_json_buffer;
-        file->len = len;
-        file->index = len;
-        file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-        return true;
+        write_result(&response->json, false, "Invalid profile_idx");
+        return false;
     }
 
     if (!ai_tuning_apply_refined_params(profile_idx)) {
-        int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-            "%s{\"success\":false,\"error\":\"No refined values to apply\"}",
-            http_json_header);
-        file->data = ai_tuning_json_buffer;
-        file->len = len;
-        file->index = len;
-        file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-        return true;
+        write_result(&response->json, false, "No refined values to apply");
+        return false;
     }
 
-    int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-        "%s{\"success\":true,\"message\":\"Refined values applied\"}",
-        http_json_header);
-
-    file->data = ai_tuning_json_buffer;
-    file->len = len;
-    file->index = len;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-
-    return true;
+    write_result(&response->json, true, "Refined values applied");
+    return false;
 }
 
-bool http_rest_ai_tuning_clear_history(struct fs_file *file, int num_params,
+bool http_rest_ai_tuning_clear_history(rest_response_t *response, int num_params,
                                          char *params[], char *values[]) {
     (void)num_params;
     (void)params;
@@ -410,31 +265,19 @@ bool http_rest_ai_tuning_clear_history(struct fs_file *file, int num_params,
 
     ai_tuning_clear_history();
 
-    int len = snprintf(ai_tuning_json_buffer, sizeof(ai_tuning_json_buffer),
-        "%s{\"success\":true,\"message\":\"History cleared\"}",
-        http_json_header);
-
-    if (len < 0 || len >= (int)sizeof(ai_tuning_json_buffer)) {
-        return send_buffer_overflow_error(file);
-    }
-
-    file->data = ai_tuning_json_buffer;
-    file->len = len;
-    file->index = len;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
-
-    return true;
+    write_result(&response->json, true, "History cleared");
+    return false;
 }
 
 bool rest_ai_tuning_init(void) {
     // Register REST endpoints
-    rest_register_handler("/rest/ai_tuning_start", http_rest_ai_tuning_start);
-    rest_register_handler("/rest/ai_tuning_status", http_rest_ai_tuning_status);
-    rest_register_handler("/rest/ai_tuning_apply", http_rest_ai_tuning_apply);
-    rest_register_handler("/rest/ai_tuning_cancel", http_rest_ai_tuning_cancel);
-    rest_register_handler("/rest/ai_tuning_history", http_rest_ai_tuning_history);
-    rest_register_handler("/rest/ai_tuning_apply_refined", http_rest_ai_tuning_apply_refined);
-    rest_register_handler("/rest/ai_tuning_clear_history", http_rest_ai_tuning_clear_history);
+    rest_register_json_handler("/rest/ai_tuning_start", http_rest_ai_tuning_start);
+    rest_register_json_handler("/rest/ai_tuning_status", http_rest_ai_tuning_status);
+    rest_register_json_handler("/rest/ai_tuning_apply", http_rest_ai_tuning_apply);
+    rest_register_json_handler("/rest/ai_tuning_cancel", http_rest_ai_tuning_cancel);
+    rest_register_json_handler("/rest/ai_tuning_history", http_rest_ai_tuning_history);
+    rest_register_json_handler("/rest/ai_tuning_apply_refined", http_rest_ai_tuning_apply_refined);
+    rest_register_json_handler("/rest/ai_tuning_clear_history", http_rest_ai_tuning_clear_history);
 
     printf("AI Tuning REST endpoints registered:\n");
     printf("  - POST /rest/ai_tuning_start?profile_idx=X\n");
@@ -2,7 +2,7 @@
 #define REST_AI_TUNING_H
 
 #include <stdbool.h>
-#include "lwip/apps/fs.h"
+#include "http_rest.h"
 
 /**
  * REST API Endpoints for AI PID Auto-Tuning
@@ -36,7 +36,7 @@ bool rest_ai_tuning_init(void);
  *
  * Returns: Success/error message
  */
-bool http_rest_ai_tuning_start(struct fs_file *file, int num_params,
+bool http_rest_ai_tuning_start(rest_response_t *response, int num_params,
                                  char *params[], char *values[]);
 
 /**
@@ -51,7 +51,7 @@ bool http_rest_ai_tuning_start(struct fs_file *file, int num_params,
  * - recommended_params: Recommended values (if complete)
  * - statistics: Performance statistics
  */
-bool http_rest_ai_tuning_status(struct fs_file *file, int num_params,
+bool http_rest_ai_tuning_status(rest_response_t *response, int num_params,
                                   char *params[], char *values[]);
 
 /**
@@ -61,7 +61,7 @@ bool http_rest_ai_tuning_status(struct fs_file *file, int num_params,
  *
  * Returns: Success/error message
  */
-bool http_rest_ai_tuning_apply(struct fs_file *file, int num_params,
+bool http_rest_ai_tuning_apply(rest_response_t *response, int num_params,
                                  char *params[], char *values[]);
 
 /**
@@ -71,7 +71,7 @@ bool http_rest_ai_tuning_apply(struct fs_file *file, int num_params,
  *
  * Returns: Success/error message
  */
-bool http_rest_ai_tuning_cancel(struct fs_file *file, int num_params,
+bool http_rest_ai_tuning_cancel(rest_response_t *response, int num_params,
                                   char *params[], char *values[]);
 
 #ifdef __cplusplus
@@ -7,10 +7,12 @@
 
 
 QueueHandle_t rest_event_queue = NULL;
+static StaticQueue_t rest_event_queue_buffer;
+static uint8_t rest_event_queue_storage[1 * sizeof(rest_control_event_t)];
 
 
 bool rest_app_control_init() {
-    rest_event_queue = xQueueCreate(1, sizeof(rest_control_event_t));
+    rest_event_queue = xQueueCreateStatic(1, sizeof(rest_control_event_t), rest_event_queue_storage, &rest_event_queue_buffer);
 
     if (rest_event_queue == NULL) {
         report_error(ERR_REST_QUEUE_CREATE);
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "rest_batch.h"
+
+
+// Resources that can be batched. Handlers are called without parameters, so only resources whose
+// handler has no side effect in that case are listed. Not listed for that reason: charge_mode_state
+// (takes the events of the polling clients), neopixel_led_config (sets the LED colours) and
+// system_control. The bit position in the request mask is the index in this table.
+static const char * const batch_resources[] = {
+    "scale_config",
+    "charge_mode_config",
+    "coarse_motor_config",
+    "fine_motor_config",
+    "motors_state",
+    "mini_12864_config",
+    "display_config",
+    "wireless_config",
+    "servo_gate_config",
+    "servo_gate_state",
+    "cleanup_mode_state",
+    "profile_summary",
+    "errors",
+    "ai_tuning_status",
+    "http_pool",
+};
+
+#define BATCH_NUM_RESOURCES     (sizeof(batch_resources) / sizeof(batch_resources[0]))
+#define BATCH_URI_PREFIX        "/rest/"
+
+// The cursor holds the resources still to write in the low half and the skipped ones in the high half
+#define BATCH_SKIPPED_SHIFT     16
+
+_Static_assert(BATCH_NUM_RESOURCES <= BATCH_SKIPPED_SHIFT, "One cursor bit per resource in each half");
+
+
+// Returns the table index, or -1 if the name is not in the table
+static int _find_resource(const char * name, size_t len) {
+    for (size_t idx = 0; idx < BATCH_NUM_RESOURCES; idx += 1) {
+        if (strlen(batch_resources[idx]) == len && strncmp(batch_resources[idx], name, len) == 0) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+
+// Parse the comma separated list into a mask, unknown names are written to the "invalid" array
+static uint32_t _parse_resources(const char * list, json_writer_t * json) {
+    uint32_t mask = 0;
+    bool invalid = false;
+
+    while (*list) {
+        const char * end = strchr(list, ',');
+        size_t len = end ? (size_t) (end - list) : strlen(list);
+
+        if (len > 0) {
+            int idx = _find_resource(list, len);
+            if (idx >= 0) {
+                mask |= 1u << idx;
+            }
+            else if (len < 32) {
+                char name[32];
+                memcpy(name, list, len);
+                name[len] = 0;
+
+                if (!invalid) {
+                    json_add_array(json, "invalid");
+                    invalid = true;
+                }
+                json_string(json, name);
+            }
+        }
+
+        list += len;
+        if (*list == ',') {
+            list += 1;
+        }
+    }
+
+    if (invalid) {
+        json_end_array(json);
+    }
+
+    return mask;
+}
+
+
+// Copy the body of a legacy handler response, the HTTP header is skipped
+static void _write_legacy(json_writer_t * json, rest_handler_t handler) {
+    struct fs_file file;
+    memset(&file, 0, sizeof(file));
+    handler(&file, 0, NULL, NULL);
+
+    const char * data = file.data;
+    size_t len = file.len;
+    for (size_t idx = 0; idx + 4 <= len; idx += 1) {
+        if (memcmp(data + idx, "\r\n\r\n", 4) == 0) {
+            json_raw(json, data + idx + 4, len - idx - 4);
+            return;
+        }
+    }
+
+    json_raw(json, "null", 4);
+}
+
+
+// Run all parts of a JSON handler into the batch chunk
+static void _write_json(json_writer_t * json, rest_json_handler_t handler) {
+    rest_response_t sub_response = {
+        .json = *json,
+        .part = 0,
+        .cursor = 0,
+    };
+
+    while (handler(&sub_response, 0, NULL, NULL) && !json_writer_overflow(&sub_response.json)) {
+        sub_response.part += 1;
+    }
+
+    *json = sub_response.json;
+}
+
+
+static void _write_resource(json_writer_t * json, const char * name) {
+    char uri[sizeof(BATCH_URI_PREFIX) + 32];
+    snprintf(uri, sizeof(uri), BATCH_URI_PREFIX "%s", name);
+
+    json_key(json, name);
+
+    rest_json_handler_t json_handler = rest_get_json_handler(uri);
+    rest_handler_t legacy_handler = rest_get_handler(uri);
+    if (json_handler) {
+        _write_json(json, json_handler);
+    }
+    else if (legacy_handler) {
+        _write_legacy(json, legacy_handler);
+    }
+    else {
+        json_raw(json, "null", 4);
+    }
+}
+
+
+bool http_rest_batch(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // r (str): Comma separated resource names, e.g., r=scale_config,charge_mode_config
+    //
+    // Each resource is one part of the response. A resource larger than a whole chunk is written as null
+    // and listed in "skipped", the other resources are still returned.
+    json_writer_t * json = &response->json;
+    uint32_t pending = response->cursor & ((1u << BATCH_SKIPPED_SHIFT) - 1);
+    uint32_t skipped = response->cursor >> BATCH_SKIPPED_SHIFT;
+
+    if (response->part == 0) {
+        json_begin_object(json);
+
+        for (int idx = 0; idx < num_params; idx += 1) {
+            if (strcmp(params[idx], "r") == 0) {
+                response->cursor = _parse_resources(values[idx], json);
+            }
+        }
+
+        return true;
+    }
+
+    if (pending == 0) {
+        if (skipped) {
+            json_add_array(json, "skipped");
+            for (uint32_t idx = 0; idx < BATCH_NUM_RESOURCES; idx += 1) {
+                if (skipped & (1u << idx)) {
+                    json_string(json, batch_resources[idx]);
+                }
+            }
+            json_end_array(json);
+        }
+        json_end_object(json);
+        return false;
+    }
+
+    // Lowest resource first
+    uint32_t idx = __builtin_ctz(pending);
+    json_writer_t saved = *json;
+    _write_resource(json, batch_resources[idx]);
+
+    // Starting from an empty chunk, the resource would not fit into the next one either
+    if (json_writer_overflow(json) && saved.len == 0) {
+        *json = saved;
+        json_key(json, batch_resources[idx]);
+        json_raw(json, "null", 4);
+        skipped |= 1u << idx;
+    }
+
+    pending &= ~(1u << idx);
+    response->cursor = pending | (skipped << BATCH_SKIPPED_SHIFT);
+
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef REST_BATCH_H_
+#define REST_BATCH_H_
+
+#include <stdbool.h>
+#include "http_rest.h"
+
+// Batched REST read: /rest/batch?r=scale_config,charge_mode_config,...
+//
+// Runs the registered handlers of the listed resources (without parameters) and streams their responses
+// as members of one JSON object, keyed by resource name, so the web portal can load all settings in a
+// single request. Only read-only resources from the batch table can be requested, names that are not in
+// the table are listed in "invalid".
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// REST
+bool http_rest_batch(rest_response_t *response, int num_params, char *params[], char *values[]);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // REST_BATCH_H_
@@ -18,6 +18,14 @@
 #include "rest_ai_tuning.h"
 #include "ai_tuning.h"
 #include "display_config.h"
+#include "rest_event_stream.h"
+#include "rest_batch.h"
+#include "deferred_log.h"
+#include "display_mirror.h"
+#include "metrics.h"
+#include "charge_history.h"
+#include "trace.h"
+#include "boot.h"
 
 // Generated headers by html2header.py, css2header.py, and bin2header.py under scripts
 #include "display_mirror.html.h"
@@ -29,10 +37,12 @@
 
 bool http_404_error(struct fs_file *file, int num_params, char *params[], char *values[]) {
 
-    file->data = "HTTP/1.1 404 Not Found\r\nContent-Type: application/json\r\n\r\n"
-                 "{\"error\":404}";
-    file->len = 13;
-    file->index = 13;
+    static const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Type: application/json\r\n\r\n"
+                                    "{\"error\":404}";
+
+    file->data = not_found;
+    file->len = sizeof(not_found) - 1;
+    file->index = file->len;
     file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
 
     return true;
@@ -107,13 +117,17 @@ bool rest_endpoints_init(bool connected_to_home) {
     rest_register_handler("/favicon.ico", http_favicon);
     rest_register_handler("/404", http_404_error);
     rest_register_handler("/rest/scale_action", http_rest_scale_action);
-    rest_register_handler("/rest/scale_config", http_rest_scale_config);
-    rest_register_handler("/rest/charge_mode_config", http_rest_charge_mode_config);
-    rest_register_handler("/rest/charge_mode_state", http_rest_charge_mode_state);
+    rest_register_json_handler("/rest/scale_config", http_rest_scale_config);
+    rest_register_json_handler("/rest/charge_mode_config", http_rest_charge_mode_config);
+    rest_register_json_handler("/rest/charge_mode_state", http_rest_charge_mode_state);
+    rest_register_handler("/rest/charge_mode_stream", http_rest_charge_mode_stream);
+    rest_register_json_handler("/rest/charge_history", http_rest_charge_history);
+    rest_register_json_handler("/rest/http_pool", http_rest_http_pool);
+    rest_register_json_handler("/rest/batch", http_rest_batch);
     rest_register_handler("/rest/cleanup_mode_state", http_rest_cleanup_mode_state);
     rest_register_handler("/rest/system_control", http_rest_system_control);
-    rest_register_handler("/rest/coarse_motor_config", http_rest_coarse_motor_config);
-    rest_register_handler("/rest/fine_motor_config", http_rest_fine_motor_config);
+    rest_register_json_handler("/rest/coarse_motor_config", http_rest_coarse_motor_config);
+    rest_register_json_handler("/rest/fine_motor_config", http_rest_fine_motor_config);
     rest_register_handler("/rest/button_control", http_rest_button_control);
     rest_register_handler("/rest/mini_12864_config", http_rest_mini_12864_module_config);
     rest_register_handler("/rest/wireless_config", http_rest_wireless_config);
@@ -122,13 +136,22 @@ bool rest_endpoints_init(bool connected_to_home) {
     rest_register_handler("/rest/profile_config", http_rest_profile_config);
     rest_register_handler("/rest/profile_summary", http_rest_profile_summary);
     rest_register_handler("/rest/servo_gate_state", http_rest_servo_gate_state);
-    rest_register_handler("/rest/servo_gate_config", http_rest_servo_gate_config);
+    rest_register_json_handler("/rest/servo_gate_config", http_rest_servo_gate_config);
     rest_register_handler("/rest/motors_state", http_rest_motors_state);
     rest_register_handler("/display_buffer", http_get_display_buffer);
     rest_register_handler("/display_mirror", http_display_mirror);
+    rest_register_handler("/display_frame", http_display_frame);
     rest_register_handler("/rest/errors", http_rest_errors);
     rest_register_handler("/rest/clear_errors", http_rest_clear_errors);
     rest_register_handler("/rest/display_config", http_rest_display_config);
+    rest_register_json_handler("/rest/log", http_rest_log);
+    rest_register_json_handler("/rest/task_stats", http_rest_task_stats);
+    rest_register_json_handler("/rest/trace", http_rest_trace);
+    rest_register_json_handler("/rest/boot", http_rest_boot);
+    rest_register_json_handler("/metrics", http_metrics);
+
+    // Live charge mode state push
+    rest_event_stream_init();
 
     // Initialize AI tuning system and REST endpoints
     ai_tuning_init();
@@ -5,27 +5,25 @@
 #include "error.h"
 #include "common.h"
 
-// Get short category string for JSON output
-static const char* error_get_short_cat(error_code_t code) {
-    if (code >= 100 && code < 200) return "EEP";
-    if (code >= 200 && code < 300) return "DSP";
-    if (code >= 300 && code < 400) return "LED";
-    if (code >= 400 && code < 500) return "WIF";
-    if (code >= 500 && code < 600) return "MOT";
-    if (code >= 600 && code < 700) return "SCL";
-    if (code >= 700 && code < 800) return "SRV";
-    if (code >= 800 && code < 900) return "PRF";
-    if (code >= 900 && code < 1000) return "CHG";
-    if (code >= 1000 && code < 1100) return "RST";
-    if (code >= 1100 && code < 1200) return "MEM";
-    if (code >= 1200 && code < 1300) return "CAL";
-    return "UNK";
+// Append one error object, returns the new offset
+static int error_record_to_json(char * buf, size_t size, int offset, const error_record_t * record) {
+    error_code_t code = (error_code_t) record->code;
+
+    return offset + snprintf(buf + offset, size - offset,
+                             "{\"code\":%d,\"cat\":\"%s\",\"msg\":\"%s\",\"t\":%lu,\"ctx\":%lu,\"task\":\"%s\"}",
+                             (int)code,
+                             error_code_to_category(code),
+                             error_code_to_string(code),
+                             (unsigned long)record->time_ms,
+                             (unsigned long)record->context,
+                             record->task);
 }
 
 bool http_rest_errors(struct fs_file *file, int num_params, char *params[], char *values[]) {
     // Buffer for JSON response
-    // Max size: header (~60) + {"count":N,"errors":[ (~25) + 8 errors * ~60 chars each + ]}
-    static char errors_json_buffer[600];
+    // Max size: header (~60) + {"count":N,"dropped":N,"errors":[ (~40) + 16 errors (this and the previous boot)
+    // * ~110 chars each + ],"previous":[ + ]}
+    static char errors_json_buffer[1900];
 
     // Check for clear parameter
     for (int idx = 0; idx < num_params; idx++) {
@@ -37,27 +35,42 @@ bool http_rest_errors(struct fs_file *file, int num_params, char *params[], char
     }
 
     uint8_t count = error_get_count();
+    error_record_t record;
 
     // Start building JSON
     int offset = snprintf(errors_json_buffer, sizeof(errors_json_buffer),
-                          "%s{\"count\":%d,\"errors\":[",
-                          http_json_header, count);
+                          "%s{\"count\":%d,\"dropped\":%lu,\"errors\":[",
+                          http_json_header, count, (unsigned long)error_get_dropped());
 
     // Add each error
-    for (uint8_t i = 0; i < count && offset < (int)sizeof(errors_json_buffer) - 80; i++) {
-        error_code_t code = error_get_at(i);
+    for (uint8_t i = 0; i < count && offset < (int)sizeof(errors_json_buffer) - 160; i++) {
+        if (!error_get_record_at(i, &record)) {
+            break;
+        }
+
+        if (i > 0) {
+            offset += snprintf(errors_json_buffer + offset,
+                               sizeof(errors_json_buffer) - offset, ",");
+        }
+
+        offset = error_record_to_json(errors_json_buffer, sizeof(errors_json_buffer), offset, &record);
+    }
+
+    // Errors of the previous boot, saved in the EEPROM
+    offset += snprintf(errors_json_buffer + offset, sizeof(errors_json_buffer) - offset, "],\"previous\":[");
+
+    uint8_t previous_count = error_get_previous_count();
+    for (uint8_t i = 0; i < previous_count && offset < (int)sizeof(errors_json_buffer) - 160; i++) {
+        if (!error_get_previous_at(i, &record)) {
+            break;
+        }
 
         if (i > 0) {
             offset += snprintf(errors_json_buffer + offset,
                                sizeof(errors_json_buffer) - offset, ",");
         }
 
-        offset += snprintf(errors_json_buffer + offset,
-                           sizeof(errors_json_buffer) - offset,
-                           "{\"code\":%d,\"cat\":\"%s\",\"msg\":\"%s\"}",
-                           (int)code,
-                           error_get_short_cat(code),
-                           error_code_to_string(code));
+        offset = error_record_to_json(errors_json_buffer, sizeof(errors_json_buffer), offset, &record);
     }
 
     // Close JSON
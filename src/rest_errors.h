@@ -9,7 +9,9 @@ extern "C" {
 #endif
 
 // REST endpoint handler for error log
-// Returns JSON: {"count":N,"errors":[{"code":105,"cat":"EEP","msg":"EEPROM alloc"},...]}
+// Returns JSON: {"count":N,"dropped":N,"errors":[{"code":105,"cat":"EEP","msg":"EEPROM alloc","t":1234,"ctx":0,"task":"Motor I"},...],
+//                "previous":[...errors of the previous boot...]}
+// Errors are also pushed as they happen, see rest_event_stream.h and the WS_TOPIC_ERRORS WebSocket topic
 bool http_rest_errors(struct fs_file *file, int num_params, char *params[], char *values[]);
 
 // REST endpoint to clear all errors
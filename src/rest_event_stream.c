@@ -0,0 +1,181 @@
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <string.h>
+#include "pico/cyw43_arch.h"
+
+#include "rest_event_stream.h"
+#include "websocket.h"
+#include "charge_mode.h"
+#include "common.h"
+
+
+// Server-Sent Event subscribers and WebSocket clients subscribed to WS_TOPIC_CHARGE_STATE share the same
+// change detection. The task also pushes the display mirror to WS_TOPIC_DISPLAY subscribers, it is
+// woken up on display changes as well.
+
+// Re-check the state at least this often, in case the scale stops reporting
+#define EVENT_STREAM_IDLE_PERIOD_MS     250
+
+// Longest event: "data: " + charge mode state object + "\n\n"
+#define EVENT_STREAM_BUFFER_SIZE        160
+
+// Longest error event: "event: error_report\ndata: " + error object + "\n\n"
+#define EVENT_STREAM_ERROR_BUFFER_SIZE  192
+
+extern charge_mode_config_t charge_mode_config;
+
+static TaskHandle_t event_stream_task_handler = NULL;
+static StackType_t event_stream_task_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t event_stream_task_buffer;
+
+
+// Returns the event length, or len if the event does not fit. Charge mode events newer than event_seq are
+// included and event_seq is advanced.
+static int _format_event(char * buf, size_t len, uint32_t * event_seq) {
+    static const char prefix[] = "data: ";
+    static const char suffix[] = "\n\n";
+
+    if (len < sizeof(prefix) + sizeof(suffix)) {
+        return len;
+    }
+    memcpy(buf, prefix, sizeof(prefix) - 1);
+
+    json_writer_t json;
+    json_writer_init(&json, buf + sizeof(prefix) - 1, len - (sizeof(prefix) - 1) - sizeof(suffix));
+    charge_mode_state_to_json(&json, event_seq);
+    if (json_writer_overflow(&json)) {
+        return len;
+    }
+
+    // Suffix including the terminating NUL
+    int data_len = sizeof(prefix) - 1 + json.len;
+    memcpy(buf + data_len, suffix, sizeof(suffix));
+
+    return data_len + sizeof(suffix) - 1;
+}
+
+
+void rest_event_stream_task(void *p) {
+    char event_buffer[EVENT_STREAM_BUFFER_SIZE];
+    char last_event_buffer[EVENT_STREAM_BUFFER_SIZE] = {0};
+
+    // Charge mode events pushed to the subscribers
+    uint32_t event_seq = charge_mode_config.charge_mode_event_seq;
+
+    while (true) {
+        // Wait for a new measurement (or time out to catch state changes)
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(EVENT_STREAM_IDLE_PERIOD_MS));
+
+        cyw43_arch_lwip_begin();
+        u8_t subscriber_count = http_event_stream_subscriber_count() + websocket_subscriber_count(WS_TOPIC_CHARGE_STATE);
+        // Display mirror deltas, only tiles changed since each client's frame are sent
+        if (websocket_subscriber_count(WS_TOPIC_DISPLAY)) {
+            websocket_publish_display();
+        }
+        cyw43_arch_lwip_end();
+
+        if (subscriber_count == 0) {
+            // New subscribers receive the full state from the handler, nothing to compare to. Events
+            // raised while nobody listens are not delivered later.
+            last_event_buffer[0] = 0;
+            event_seq = charge_mode_config.charge_mode_event_seq;
+            continue;
+        }
+
+        // The events are only taken once they are pushed
+        uint32_t next_event_seq = event_seq;
+        int len = _format_event(event_buffer, sizeof(event_buffer), &next_event_seq);
+
+        // Only push on change
+        if ((size_t) len >= sizeof(event_buffer) || strcmp(event_buffer, last_event_buffer) == 0) {
+            continue;
+        }
+        memcpy(last_event_buffer, event_buffer, len + 1);
+        event_seq = next_event_seq;
+
+        cyw43_arch_lwip_begin();
+        http_event_stream_publish(event_buffer, len);
+        websocket_publish_charge_state();
+        cyw43_arch_lwip_end();
+    }
+}
+
+
+bool rest_event_stream_init() {
+    event_stream_task_handler = xTaskCreateStatic(rest_event_stream_task, "Event Stream Task", configMINIMAL_STACK_SIZE, NULL, 1,
+                                                  event_stream_task_stack, &event_stream_task_buffer);
+    if (event_stream_task_handler == NULL) {
+        report_error(ERR_REST_TASK_CREATE);
+        return false;
+    }
+
+    return true;
+}
+
+
+void rest_event_stream_notify() {
+    if (event_stream_task_handler) {
+        xTaskNotifyGive(event_stream_task_handler);
+    }
+}
+
+
+void rest_event_stream_publish_error(const error_record_t * record) {
+    // data:
+    // code (int): Error code
+    // cat (str): Category, e.g., "EEP"
+    // msg (str): Description
+    // t (int): Time since boot (ms)
+    // ctx (int): Context passed by the reporter, 0 if none
+    // task (str): Reporting task, empty from main() or an interrupt
+    static const char prefix[] = "event: error_report\ndata: ";
+    static const char suffix[] = "\n\n";
+    char event_buffer[EVENT_STREAM_ERROR_BUFFER_SIZE];
+
+    memcpy(event_buffer, prefix, sizeof(prefix) - 1);
+
+    json_writer_t json;
+    json_writer_init(&json, event_buffer + sizeof(prefix) - 1, sizeof(event_buffer) - (sizeof(prefix) - 1) - sizeof(suffix));
+    json_begin_object(&json);
+    json_add_uint(&json, "code", record->code);
+    json_add_string(&json, "cat", error_code_to_category((error_code_t) record->code));
+    json_add_string(&json, "msg", error_code_to_string((error_code_t) record->code));
+    json_add_uint(&json, "t", record->time_ms);
+    json_add_uint(&json, "ctx", record->context);
+    json_add_string(&json, "task", record->task);
+    json_end_object(&json);
+
+    int len = sizeof(prefix) - 1 + json.len;
+    memcpy(event_buffer + len, suffix, sizeof(suffix));
+    len += sizeof(suffix) - 1;
+
+    cyw43_arch_lwip_begin();
+    if (!json_writer_overflow(&json) && http_event_stream_subscriber_count()) {
+        http_event_stream_publish(event_buffer, len);
+    }
+    websocket_publish_error(record->code, record->time_ms, record->context);
+    cyw43_arch_lwip_end();
+}
+
+
+bool http_rest_charge_mode_stream(struct fs_file *file, int num_params, char *params[], char *values[]) {
+    // Response: event stream header, reconnect delay, then the current state as the first event.
+    // Subsequent events are pushed by the event stream task on change.
+    static char charge_mode_stream_buffer[320];
+
+    int len = snprintf(charge_mode_stream_buffer, sizeof(charge_mode_stream_buffer), "%sretry: 2000\n\n", http_event_stream_header);
+    // Events raised before the subscription are not replayed
+    uint32_t event_seq = charge_mode_config.charge_mode_event_seq;
+    int event_len = _format_event(charge_mode_stream_buffer + len, sizeof(charge_mode_stream_buffer) - len, &event_seq);
+    if ((size_t) event_len < sizeof(charge_mode_stream_buffer) - len) {
+        len += event_len;
+    }
+
+    file->data = charge_mode_stream_buffer;
+    file->len = len;
+    file->index = len;
+    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED | FS_FILE_FLAGS_EVENT_STREAM;
+
+    return true;
+}
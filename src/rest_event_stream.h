@@ -0,0 +1,44 @@
+#ifndef REST_EVENT_STREAM_H_
+#define REST_EVENT_STREAM_H_
+
+#include <stdbool.h>
+#include "http_rest.h"
+#include "error.h"
+
+// The REST event stream pushes the live charge mode state to the browser with Server-Sent Events
+// (text/event-stream) instead of having the web portal poll /rest/charge_mode_state. An event is only
+// sent when a new scale measurement arrives or the state changes, and the payload uses the same keys
+// as /rest/charge_mode_state.
+//
+// Errors are pushed on the same stream as named events, "event: error_report" (not "error", which
+// EventSource uses for connection errors). Clients listen with addEventListener("error_report", ...),
+// onmessage only receives the unnamed charge mode state events.
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+bool rest_event_stream_init(void);
+
+/**
+ * Wake up the event stream task, e.g., on a new scale measurement. Safe to call before init.
+*/
+void rest_event_stream_notify(void);
+
+/**
+ * Push an error to event stream and WebSocket subscribers. Called by the error task, takes the lwIP lock.
+*/
+void rest_event_stream_publish_error(const error_record_t * record);
+
+// REST
+bool http_rest_charge_mode_stream(struct fs_file *file, int num_params, char *params[], char *values[]);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // REST_EVENT_STREAM_H_
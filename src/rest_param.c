@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "rest_param.h"
+
+
+// FNV-1a, the keys are only a few characters long
+static uint8_t _hash(const char * key) {
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (uint8_t) *key++;
+        hash *= 16777619u;
+    }
+    return hash & (REST_PARAM_INDEX_SIZE - 1);
+}
+
+
+static void _build_index(rest_param_schema_t * schema) {
+    for (uint8_t idx = 0; idx < schema->num_params; idx += 1) {
+        uint8_t slot = _hash(schema->params[idx].key);
+        while (schema->index[slot] != 0) {
+            slot = (slot + 1) & (REST_PARAM_INDEX_SIZE - 1);
+        }
+        schema->index[slot] = idx + 1;
+    }
+}
+
+
+// Returns the entry index, or -1 if the key is not in the schema
+static int _find(const rest_param_schema_t * schema, const char * key) {
+    uint8_t slot = _hash(key);
+    while (schema->index[slot] != 0) {
+        int idx = schema->index[slot] - 1;
+        if (strcmp(schema->params[idx].key, key) == 0) {
+            return idx;
+        }
+        slot = (slot + 1) & (REST_PARAM_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+
+static bool _parse_bool(const char * s, bool * value) {
+    if (strcmp(s, "true") == 0) {
+        *value = true;
+        return true;
+    }
+    if (strcmp(s, "false") == 0) {
+        *value = false;
+        return true;
+    }
+    return false;
+}
+
+
+// Parse the value as a number, the whole string must be consumed
+static bool _parse_number(const rest_param_t * param, const char * s, float * value) {
+    char * end;
+
+    if (param->type == REST_PARAM_COLOUR) {
+        // For example, #ff00ff
+        if (s[0] != '#' || s[1] == 0) {
+            return false;
+        }
+        *value = (float) strtoul(s + 1, &end, 16);
+    }
+    else if (param->type == REST_PARAM_FLOAT) {
+        *value = strtof(s, &end);
+    }
+    else {
+        *value = (float) strtol(s, &end, 10);
+    }
+
+    return end != s && *end == 0 && isfinite(*value) && *value >= param->min && *value <= param->max;
+}
+
+
+static bool _apply_one(const rest_param_t * param, void * base, const char * s) {
+    void * field = (uint8_t *) base + param->offset;
+
+    if (param->type == REST_PARAM_BOOL) {
+        return _parse_bool(s, (bool *) field);
+    }
+
+    float value;
+    if (!_parse_number(param, s, &value)) {
+        return false;
+    }
+
+    switch (param->type) {
+        case REST_PARAM_FLOAT:
+            *(float *) field = value;
+            break;
+        case REST_PARAM_INT32:
+            *(int32_t *) field = (int32_t) strtol(s, NULL, 10);
+            break;
+        case REST_PARAM_UINT32:
+            *(uint32_t *) field = (uint32_t) strtoul(s, NULL, 10);
+            break;
+        case REST_PARAM_UINT16:
+            *(uint16_t *) field = (uint16_t) value;
+            break;
+        case REST_PARAM_ENUM:
+            *(int *) field = (int) value;
+            break;
+        case REST_PARAM_COLOUR:
+            *(uint32_t *) field = (uint32_t) strtoul(s + 1, NULL, 16);
+            break;
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+
+rest_param_result_t rest_param_apply(rest_param_schema_t * schema, void * base, int num_params, char * params[], char * values[]) {
+    rest_param_result_t result = {0};
+
+    // The slot of the first key is only empty before the index is built
+    if (schema->index[_hash(schema->params[0].key)] == 0) {
+        _build_index(schema);
+    }
+
+    for (int idx = 0; idx < num_params; idx += 1) {
+        if (strcmp(params[idx], "ee") == 0) {
+            _parse_bool(values[idx], &result.save);
+            continue;
+        }
+
+        int param_idx = _find(schema, params[idx]);
+        if (param_idx < 0) {
+            continue;
+        }
+
+        const rest_param_t * param = &schema->params[param_idx];
+        if (_apply_one(param, base, values[idx])) {
+            result.changed |= 1u << param_idx;
+        }
+        else {
+            result.invalid |= 1u << param_idx;
+            printf("Rejected %s=%s\n", params[idx], values[idx]);
+        }
+    }
+
+    return result;
+}
+
+
+void rest_param_to_json(const rest_param_schema_t * schema, const void * base, const rest_param_result_t * result, json_writer_t * json) {
+    json_begin_object(json);
+
+    for (uint8_t idx = 0; idx < schema->num_params; idx += 1) {
+        const rest_param_t * param = &schema->params[idx];
+        const void * field = (const uint8_t *) base + param->offset;
+
+        json_key(json, param->key);
+        switch (param->type) {
+            case REST_PARAM_FLOAT:
+                json_float(json, *(const float *) field, param->decimal_places);
+                break;
+            case REST_PARAM_INT32:
+                json_int(json, *(const int32_t *) field);
+                break;
+            case REST_PARAM_UINT32:
+                json_uint(json, *(const uint32_t *) field);
+                break;
+            case REST_PARAM_UINT16:
+                json_uint(json, *(const uint16_t *) field);
+                break;
+            case REST_PARAM_BOOL:
+                json_bool(json, *(const bool *) field);
+                break;
+            case REST_PARAM_ENUM:
+                json_int(json, *(const int *) field);
+                break;
+            case REST_PARAM_COLOUR: {
+                char colour_string[12];
+                snprintf(colour_string, sizeof(colour_string), "#%06lx", (unsigned long) *(const uint32_t *) field);
+                json_string(json, colour_string);
+                break;
+            }
+            default:
+                json_string(json, "");
+                break;
+        }
+    }
+
+    if (result && result->invalid) {
+        json_add_array(json, "invalid");
+        for (uint8_t idx = 0; idx < schema->num_params; idx += 1) {
+            if (result->invalid & (1u << idx)) {
+                json_string(json, schema->params[idx].key);
+            }
+        }
+        json_end_array(json);
+    }
+
+    json_end_object(json);
+}
@@ -0,0 +1,84 @@
+#ifndef REST_PARAM_H_
+#define REST_PARAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "json_writer.h"
+
+// Table driven REST parameters
+//
+// A config struct is described once by a table of rest_param_t (key, field offset, type, range). The same table parses and validates the request parameters and serialises the
+// JSON response, so the key list only exists in one place. Keys are found through a small hash
+// index that is built on first use.
+//
+// The "ee" parameter (save to EEPROM) is handled for every schema and reported in the result.
+
+#define REST_PARAM_MAX_ENTRIES      32          // One bit per entry in rest_param_result_t
+#define REST_PARAM_INDEX_SIZE       64          // Hash slots, power of 2 and at least twice the entries
+
+
+typedef enum {
+    REST_PARAM_FLOAT = 0,
+    REST_PARAM_INT32,
+    REST_PARAM_UINT32,
+    REST_PARAM_UINT16,
+    REST_PARAM_BOOL,
+    REST_PARAM_ENUM,            // int sized enum
+    REST_PARAM_COLOUR,          // uint32_t, "#rrggbb"
+} rest_param_type_t;
+
+
+typedef struct {
+    const char * key;
+    uint16_t offset;            // Offset of the field in the config struct
+    uint8_t type;               // rest_param_type_t
+    uint8_t decimal_places;     // REST_PARAM_FLOAT output
+    float min;                  // Inclusive range, values outside are rejected
+    float max;
+} rest_param_t;
+
+
+typedef struct {
+    const rest_param_t * params;
+    uint8_t num_params;
+    uint8_t index[REST_PARAM_INDEX_SIZE];   // Hash slot -> entry index + 1, 0 when empty
+} rest_param_schema_t;
+
+
+typedef struct {
+    uint32_t changed;           // Bit per entry that has been written
+    uint32_t invalid;           // Bit per entry whose value has been rejected
+    bool save;                  // ee=true
+} rest_param_result_t;
+
+
+#define REST_PARAM_ENTRY(key, struct_t, field, type, decimal_places, min, max) \
+    {key, (uint16_t) offsetof(struct_t, field), type, decimal_places, min, max}
+
+#define REST_PARAM_SCHEMA(table) \
+    {table, (uint8_t) (sizeof(table) / sizeof(table[0])), {0}}
+
+#define REST_PARAM_CHANGED(result, idx)     (((result)->changed >> (idx)) & 1u)
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Parse, validate and write the request parameters into the struct at base. Unknown keys are ignored.
+*/
+rest_param_result_t rest_param_apply(rest_param_schema_t * schema, void * base, int num_params, char * params[], char * values[]);
+
+/**
+ * Write the struct at base as a JSON object. Keys rejected in result (may be NULL) are listed in "invalid".
+*/
+void rest_param_to_json(const rest_param_schema_t * schema, const void * base, const rest_param_result_t * result, json_writer_t * json);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // REST_PARAM_H_
@@ -12,6 +12,14 @@
 #include "scale.h"
 #include "common.h"
 #include "error.h"
+#include "rest_event_stream.h"
+#include "rest_param.h"
+#include "metrics.h"
+#include "display.h"
+#include "ui_events.h"
+#include "charge_history.h"
+#include "trace.h"
+#include "hal.h"
 
 extern scale_handle_t and_fxi_scale_handle;
 extern scale_handle_t steinberg_scale_handle;
@@ -23,6 +31,11 @@ extern scale_handle_t radwag_ps_r2_scale_handle;
 
 scale_config_t scale_config;
 
+static StaticSemaphore_t scale_measurement_ready_buffer;
+static StaticSemaphore_t scale_serial_write_access_mutex_buffer;
+static StackType_t scale_task_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t scale_task_buffer;
+
 
 
 void set_scale_driver(scale_driver_t scale_driver) {
@@ -158,14 +171,14 @@ bool scale_init() {
 
     // Create control variables
     // Semaphore to indicate the availability of new measurement.
-    scale_config.scale_measurement_ready = xSemaphoreCreateBinary();
+    scale_config.scale_measurement_ready = xSemaphoreCreateBinaryStatic(&scale_measurement_ready_buffer);
     if (scale_config.scale_measurement_ready == NULL) {
         report_error(ERR_SCALE_SEMAPHORE_CREATE);
         return false;
     }
 
     // Mutex to control the access to the serial port write
-    scale_config.scale_serial_write_access_mutex = xSemaphoreCreateMutex();
+    scale_config.scale_serial_write_access_mutex = xSemaphoreCreateMutexStatic(&scale_serial_write_access_mutex_buffer);
     if (scale_config.scale_serial_write_access_mutex == NULL) {
         report_error(ERR_SCALE_MUTEX_CREATE);
         return false;
@@ -179,8 +192,9 @@ bool scale_init() {
     set_scale_driver(scale_config.persistent_config.scale_driver);
 
     // Create the Task for the listener loop
-    BaseType_t task_created = xTaskCreate(scale_config.scale_handle->read_loop_task, "Scale Task", configMINIMAL_STACK_SIZE, NULL, 9, NULL);
-    if (task_created != pdPASS) {
+    TaskHandle_t task_handle = xTaskCreateStatic(scale_config.scale_handle->read_loop_task, "Scale Task", configMINIMAL_STACK_SIZE, NULL, 9,
+                                                 scale_task_stack, &scale_task_buffer);
+    if (task_handle == NULL) {
         report_error(ERR_SCALE_TASK_CREATE);
         return false;
     }
@@ -217,7 +231,7 @@ void scale_write(const char * command, size_t len) {
 
     _take_mutex(scheduler_state);
 
-    uart_write_blocking(SCALE_UART, (uint8_t *) command, len);
+    hal_uart_write(HAL_UART_SCALE, (const uint8_t *) command, len);
 
     _give_mutex(scheduler_state);
 }
@@ -228,6 +242,27 @@ float scale_get_current_measurement() {
 }
 
 
+/*
+    Called by the scale drivers once a new measurement is decoded.
+*/
+void scale_update_measurement(float measurement) {
+    scale_config.current_scale_measurement = measurement;
+    metrics_record_scale_frame(!isnan(measurement));
+    TRACE(SCALE_FRAME, trace_fixed(measurement, 1000));
+
+    // Signal the data is ready
+    if (scale_config.scale_measurement_ready) {
+        xSemaphoreGive(scale_config.scale_measurement_ready);
+    }
+
+    // Wake up live subscribers and the screen
+    rest_event_stream_notify();
+    display_notify(DISPLAY_NOTIFY_CHANGE | DISPLAY_NOTIFY_MEASUREMENT);
+    ui_events_publish(UI_EVENT_WEIGHT, 0, measurement);
+    charge_history_add(measurement);
+}
+
+
 /*
     Block wait for the next available measurement.
 
@@ -255,50 +290,33 @@ bool scale_block_wait_for_next_measurement(uint32_t block_time_ms, float * curre
 }
 
 
-bool http_rest_scale_config(struct fs_file *file, int num_params, char *params[], char *values[]) {
-    // Mappings:
-    // s0 (int): driver index
-    // s1 (int): baud rate index
-    // ee (bool): save to eeprom
+// Mappings:
+// s0 (int): driver index
+// s1 (int): baud rate index
+// ee (bool): save to eeprom
+static const rest_param_t scale_config_params[] = {
+    REST_PARAM_ENTRY("s0", eeprom_scale_data_t, scale_driver, REST_PARAM_ENUM, 0, SCALE_DRIVER_AND_FXI, SCALE_DRIVER_RADWAG_PS_R2),
+    REST_PARAM_ENTRY("s1", eeprom_scale_data_t, scale_baudrate, REST_PARAM_ENUM, 0, BAUDRATE_4800, BAUDRATE_19200),
+};
+static rest_param_schema_t scale_config_schema = REST_PARAM_SCHEMA(scale_config_params);
 
-    static char scale_config_to_json_buffer[256];
-    bool save_to_eeprom = false;
 
-    // Set value
-    for (int idx = 0; idx < num_params; idx += 1) {
-        if (strcmp(params[idx], "s0") == 0) {
-            scale_driver_t driver_idx = (scale_driver_t) atoi(values[idx]);
-            set_scale_driver(driver_idx);
-        }
-        else if (strcmp(params[idx], "s1") == 0) {
-            scale_baudrate_t baudrate_idx = (scale_baudrate_t) atoi(values[idx]);
-            scale_config.persistent_config.scale_baudrate = baudrate_idx;
-        }
-        else if (strcmp(params[idx], "ee") == 0) {
-            save_to_eeprom = string_to_boolean(values[idx]);
-        }
+bool http_rest_scale_config(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    rest_param_result_t result = rest_param_apply(&scale_config_schema, &scale_config.persistent_config, num_params, params, values);
+
+    // The driver handle follows the driver index
+    if (REST_PARAM_CHANGED(&result, 0)) {
+        set_scale_driver(scale_config.persistent_config.scale_driver);
     }
 
     // Perform action
-    if (save_to_eeprom) {
+    if (result.save) {
         scale_config_save();
     }
 
-    snprintf(scale_config_to_json_buffer, 
-             sizeof(scale_config_to_json_buffer),
-             "%s"
-             "{\"s0\":%d,\"s1\":%d}", 
-             http_json_header,
-             scale_config.persistent_config.scale_driver, 
-             scale_config.persistent_config.scale_baudrate);
-    
-    size_t data_length = strlen(scale_config_to_json_buffer);
-    file->data = scale_config_to_json_buffer;
-    file->len = data_length;
-    file->index = data_length;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+    rest_param_to_json(&scale_config_schema, &scale_config.persistent_config, &result, &response->json);
 
-    return true;
+    return false;
 }
 
 
@@ -67,6 +67,7 @@ extern "C" {
 bool scale_init();
 
 float scale_get_current_measurement();
+void scale_update_measurement(float measurement);
 bool scale_block_wait_for_next_measurement(uint32_t block_time_ms, float * current_measurement);
 
 void set_scale_driver(scale_driver_t scale_driver);
@@ -80,7 +81,7 @@ void scale_write(const char * command, size_t len);
 
 // REST
 bool http_rest_scale_action(struct fs_file *file, int num_params, char *params[], char *values[]);
-bool http_rest_scale_config(struct fs_file *file, int num_params, char *params[], char *values[]);
+bool http_rest_scale_config(rest_response_t *response, int num_params, char *params[], char *values[]);
 
 
 // Features
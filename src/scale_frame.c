@@ -0,0 +1,68 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "scale_frame.h"
+
+
+void scale_frame_reader_init(scale_frame_reader_t * reader, void * frame, size_t size, int header) {
+    reader->bytes = (char *) frame;
+    reader->size = size;
+    reader->idx = 0;
+    reader->header = header;
+}
+
+
+bool scale_frame_feed(scale_frame_reader_t * reader, char ch) {
+    // A header always starts a new frame
+    if (reader->header != SCALE_FRAME_NO_HEADER && ch == (char) reader->header) {
+        reader->idx = 0;
+    }
+
+    reader->bytes[reader->idx++] = ch;
+
+    bool is_complete = false;
+    if (reader->idx == reader->size) {
+        reader->idx = 0;
+        is_complete = true;
+    }
+
+    // \n is the terminator. We shall reset the receive of message on receiving any of those character.
+    if (reader->header == SCALE_FRAME_NO_HEADER && ch == '\n') {
+        reader->idx = 0;
+    }
+
+    return is_complete;
+}
+
+
+bool scale_frame_read(scale_frame_reader_t * reader, hal_uart_t uart) {
+    while (hal_uart_is_readable(uart)) {
+        if (scale_frame_feed(reader, hal_uart_getc(uart))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+float scale_frame_parse_weight(const char * field, size_t len, char sign) {
+    char number[SCALE_FRAME_MAX_FIELD_LEN + 1];
+    if (len > SCALE_FRAME_MAX_FIELD_LEN) {
+        len = SCALE_FRAME_MAX_FIELD_LEN;
+    }
+    memcpy(number, field, len);
+    number[len] = '\0';
+
+    // strtof skips the leading spaces
+    char *endptr;
+    float weight = strtof(number, &endptr);
+
+    if (endptr == number) {
+        // Conversion failed
+        return NAN;
+    }
+
+    return sign == '-' ? -weight : weight;
+}
@@ -0,0 +1,55 @@
+#ifndef SCALE_FRAME_H_
+#define SCALE_FRAME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hal.h"
+
+// Scale frame reader
+//
+// Every scale driver receives fixed length ASCII frames over the scale UART. The reader collects the
+// bytes into the driver's frame and starts over on the line terminator, or on the header byte for the
+// protocols that have one, so a byte lost on the wire costs one frame only. The drivers decode the fields.
+
+#define SCALE_FRAME_NO_HEADER       (-1)
+#define SCALE_FRAME_MAX_FIELD_LEN   15          // Longest number field, without the terminator
+
+
+typedef struct {
+    char * bytes;
+    size_t size;
+    size_t idx;
+    int header;                         // First byte of every frame, SCALE_FRAME_NO_HEADER to split on \n
+} scale_frame_reader_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void scale_frame_reader_init(scale_frame_reader_t * reader, void * frame, size_t size, int header);
+
+/**
+ * Add one received byte, returns true when it completes a frame
+*/
+bool scale_frame_feed(scale_frame_reader_t * reader, char ch);
+
+/**
+ * Read the bytes waiting on the UART up to the end of the next frame. Returns true with a complete frame,
+ * false once the UART is drained.
+*/
+bool scale_frame_read(scale_frame_reader_t * reader, hal_uart_t uart);
+
+/**
+ * Weight in a number field of len bytes (not terminated, leading spaces allowed), negated if sign is '-'.
+ * NaN if the field holds no number.
+*/
+float scale_frame_parse_weight(const char * field, size_t len, char sign);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // SCALE_FRAME_H_
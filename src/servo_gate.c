@@ -2,20 +2,60 @@
 #include <math.h>
 #include "hardware/pwm.h"
 #include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
 #include "configuration.h"
 #include "eeprom.h"
 #include "common.h"
 #include "servo_gate.h"
 #include "error.h"
+#include "rest_param.h"
+#include "ui_events.h"
+#include "trace.h"
 
 // Attributes
 servo_gate_t servo_gate;
 
+// Gate move, the open ratio is 0.0 for GATE_OPEN and 1.0 for GATE_CLOSE, in between for flow control
+typedef struct {
+    gate_state_t state;
+    float open_ratio;
+    uint32_t seq;               // State commands with a waiter count from 1, 0 otherwise
+    bool opening;               // Flow control opening, merged with the next one
+} servo_gate_command_t;
+
+// Queued moves, flow control openings are merged by the control task so state changes always fit
+#define SERVO_GATE_QUEUE_LENGTH         4
+
+// Done bits are reused every SERVO_GATE_DONE_BITS state commands, more than can be queued and moving
+#define SERVO_GATE_DONE_BITS            8
+#define SERVO_GATE_DONE_BIT(seq)        (1u << ((seq) % SERVO_GATE_DONE_BITS))
+
+static StaticQueue_t control_queue_buffer;
+static uint8_t control_queue_storage[SERVO_GATE_QUEUE_LENGTH * sizeof(servo_gate_command_t)];
+static StaticSemaphore_t command_mutex_buffer;
+static StaticEventGroup_t move_done_event_buffer;
+static StackType_t control_task_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t control_task_buffer;
+
 // Const settings
 const float _servo_pwm_freq = 50.0;
 const uint16_t _pwm_full_scale_level = 65535;
 
 
+// Gate ramps
+//
+// A move is a table of CC register values, one per PWM period, written into the slice by DMA paced by
+// the PWM wrap DREQ. The CC register is latched at the wrap anyway, so each value drives the servos for
+// exactly one period, and the move takes no CPU: the control task fills the table and sleeps until the
+// DMA completion interrupt. Ramps longer than the table are sent in chunks.
+#define SERVO_GATE_RAMP_MAX_STEPS       128         // 2.56 s at 50 Hz per chunk
+#define SERVO_GATE_DMA_IRQ              DMA_IRQ_1   // Shared with the TFT flush
+
+static uint32_t servo_gate_ramp_table[SERVO_GATE_RAMP_MAX_STEPS];
+static int servo_gate_dma_channel = -1;
+
+
 const eeprom_servo_gate_config_t default_eeprom_servo_gate_config = {
     .servo_gate_config_rev = EEPROM_SERVO_GATE_CONFIG_REV,
     .servo_gate_enable = false,
@@ -38,9 +78,7 @@ const char * gate_state_to_string(gate_state_t state) {
 }
 
 
-static void inline _set_duty_cycle(uint16_t shutter0_duty_cycle, uint16_t shutter1_duty_cycle) {
-    uint32_t reg_level = ((uint32_t) shutter0_duty_cycle) << 16 | shutter1_duty_cycle;
-
+static void inline _set_duty_cycle(uint32_t reg_level) {
     // Write both levels to the pwm at the same time
     hw_write_masked(
         &pwm_hw->slice[SERVO_PWM_SLICE_NUM].cc,
@@ -50,7 +88,8 @@ static void inline _set_duty_cycle(uint16_t shutter0_duty_cycle, uint16_t shutte
 }
 
 
-void _servo_gate_set_current_state(float open_ratio) {
+// CC register value with both levels, shutter 0 on channel B and shutter 1 on channel A
+static uint32_t _servo_gate_level(float open_ratio) {
     uint16_t shutter0_duty_cycle;
     uint16_t shutter1_duty_cycle;
 
@@ -60,41 +99,144 @@ void _servo_gate_set_current_state(float open_ratio) {
     shutter0_duty_cycle = _pwm_full_scale_level * (servo_gate.eeprom_servo_gate_config.shutter0_open_duty_cycle + shutter0_range * open_ratio);
     shutter1_duty_cycle = _pwm_full_scale_level * (servo_gate.eeprom_servo_gate_config.shutter1_open_duty_cycle + shutter1_range * open_ratio);
 
-    _set_duty_cycle(shutter0_duty_cycle, shutter1_duty_cycle);
+    return ((uint32_t) shutter0_duty_cycle) << 16 | shutter1_duty_cycle;
 }
 
 
-void servo_gate_set_state(gate_state_t state, bool block_wait) {
-    // Clear the semaphore state
-    xSemaphoreTake(servo_gate.move_ready_semphore, 0);
+void _servo_gate_set_current_state(float open_ratio) {
+    _set_duty_cycle(_servo_gate_level(open_ratio));
+}
+
+
+static void servo_gate_dma_irq_handler(void) {
+    if (!dma_channel_get_irq1_status(servo_gate_dma_channel)) {
+        return;
+    }
+    dma_channel_acknowledge_irq1(servo_gate_dma_channel);
+
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(servo_gate.control_task_handler, &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+
+// Move from one open ratio to the other in num_steps PWM periods, returns once the last step is written
+static void _servo_gate_ramp(float from_open_ratio, float to_open_ratio, uint32_t num_steps) {
+    uint32_t period_ms = 1000 / _servo_pwm_freq;
+    uint32_t step = 0;
+
+    while (step < num_steps) {
+        uint32_t count = num_steps - step;
+        if (count > SERVO_GATE_RAMP_MAX_STEPS) {
+            count = SERVO_GATE_RAMP_MAX_STEPS;
+        }
+
+        for (uint32_t idx = 0; idx < count; idx += 1) {
+            step += 1;
+            float percentage = step / (float) num_steps;
+            servo_gate_ramp_table[idx] = _servo_gate_level(from_open_ratio + (to_open_ratio - from_open_ratio) * percentage);
+        }
 
-    xQueueSend(servo_gate.control_queue, &state, portMAX_DELAY);
+        ulTaskNotifyTake(pdTRUE, 0);
+        dma_channel_transfer_from_buffer_now(servo_gate_dma_channel, servo_gate_ramp_table, count);
+
+        // The chunk takes count periods, plus the wait for the first wrap and the tick rounding
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((count + 2) * period_ms)) == 0) {
+            // PWM stopped, don't leave the gate half way
+            dma_channel_abort(servo_gate_dma_channel);
+            _servo_gate_set_current_state(to_open_ratio);
+            return;
+        }
+    }
+}
+
+
+void servo_gate_set_state(gate_state_t state, bool block_wait) {
+    servo_gate_command_t command = {
+        .state = state,
+        .open_ratio = state == GATE_CLOSE ? 1.0f : 0.0f,
+        .opening = false,
+    };
+
+    // Commands are moved in sequence order, done_seq tells whether this one is done
+    xSemaphoreTake(servo_gate.command_mutex, portMAX_DELAY);
+    servo_gate.command_seq += 1;
+    if (servo_gate.command_seq == 0) {
+        servo_gate.command_seq = 1;
+    }
+    command.seq = servo_gate.command_seq;
+    xEventGroupClearBits(servo_gate.move_done_event, SERVO_GATE_DONE_BIT(command.seq));
+    xQueueSend(servo_gate.control_queue, &command, portMAX_DELAY);
+    xSemaphoreGive(servo_gate.command_mutex);
 
     if (block_wait) {
-        xSemaphoreTake(servo_gate.move_ready_semphore, portMAX_DELAY);
+        while ((int32_t) (servo_gate.done_seq - command.seq) < 0) {
+            xEventGroupWaitBits(servo_gate.move_done_event, SERVO_GATE_DONE_BIT(command.seq), pdFALSE, pdTRUE, portMAX_DELAY);
+        }
     }
 }
 
 
+void servo_gate_set_opening(float opening) {
+    servo_gate_command_t command = {
+        .state = GATE_OPEN,
+        .open_ratio = 1.0f - fminf(fmaxf(opening, 0.0f), 1.0f),
+        .seq = 0,
+        .opening = true,
+    };
+
+    // A move in progress is not waited for. Queued openings are merged, so the queue is only full while a
+    // single move takes several control steps, and the next step sends a new opening.
+    xQueueSend(servo_gate.control_queue, &command, 0);
+}
+
+
+bool servo_gate_request_state(gate_state_t state) {
+    servo_gate_command_t command = {
+        .state = state,
+        .open_ratio = state == GATE_CLOSE ? 1.0f : 0.0f,
+        .seq = 0,
+        .opening = false,
+    };
+
+    // No sequence number, nobody waits for it, so neither the mutex nor the event group is touched
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    BaseType_t is_queued = xQueueSendFromISR(servo_gate.control_queue, &command, &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+
+    return is_queued == pdTRUE;
+}
+
+
+static void _servo_gate_move_done(const servo_gate_command_t * command) {
+    if (command->seq == 0) {
+        return;
+    }
+
+    servo_gate.done_seq = command->seq;
+    xEventGroupSetBits(servo_gate.move_done_event, SERVO_GATE_DONE_BIT(command->seq));
+}
+
+
 void servo_gate_control_task(void * p) {
     float prev_open_ratio = -1.0f;
 
     while (true) {
-        gate_state_t new_state;
-        xQueueReceive(servo_gate.control_queue, &new_state, portMAX_DELAY);
-
-        // Calculate the new gate open ratio
-        float new_open_ratio;
-        switch (new_state) {
-            case GATE_OPEN:
-                new_open_ratio = 0.0f;
-                break;
-            case GATE_CLOSE:
-                new_open_ratio = 1.0f;
-                break;
-            default:
-                // Invalid state - skip processing
-                continue;
+        servo_gate_command_t command;
+        xQueueReceive(servo_gate.control_queue, &command, portMAX_DELAY);
+
+        // Only the latest of back to back openings matters, a state command behind them is kept
+        servo_gate_command_t next;
+        while (command.opening && xQueuePeek(servo_gate.control_queue, &next, 0) == pdTRUE && next.opening) {
+            xQueueReceive(servo_gate.control_queue, &command, 0);
+        }
+
+        gate_state_t new_state = command.state;
+        float new_open_ratio = command.open_ratio;
+        if (new_state != GATE_OPEN && new_state != GATE_CLOSE) {
+            // Invalid state - skip processing, a waiter is not left blocked
+            _servo_gate_move_done(&command);
+            continue;
         }
 
         // First time
@@ -109,38 +251,32 @@ void servo_gate_control_task(void * p) {
             // Prevent division by zero - if speed is 0, skip ramp and jump directly
             if (speed <= 0.0f) {
                 _servo_gate_set_current_state(new_open_ratio);
-                xSemaphoreGive(servo_gate.move_ready_semphore);
                 prev_open_ratio = new_open_ratio;
                 servo_gate.gate_state = new_state;
+                ui_events_publish(UI_EVENT_GATE_STATE, (uint8_t) new_state, new_open_ratio);
+                _servo_gate_move_done(&command);
                 continue;
             }
 
-            uint32_t ramp_time_us = fabs(delta / speed) * 1e6;
-
-            uint32_t start_time = time_us_32();
-            while (true) {
-                uint32_t current_time = time_us_32();
-                // Use elapsed time comparison to handle 32-bit timer wraparound
-                uint32_t elapsed = current_time - start_time;
-                if (elapsed >= ramp_time_us) {
-                    break;
-                }
-
-                float percentage = elapsed / (float) ramp_time_us;
-                float current_ratio = prev_open_ratio + delta * percentage;
-
-                _servo_gate_set_current_state(current_ratio);
+            // One step per PWM period, the last one is the new open ratio
+            uint32_t num_steps = ceilf(fabsf(delta / speed) * _servo_pwm_freq);
+            if (num_steps < 1) {
+                num_steps = 1;
             }
+            TRACE(SERVO_MOVE_START, trace_fixed(new_open_ratio, 1000));
 
-            _servo_gate_set_current_state(new_open_ratio);
-        }
+            _servo_gate_ramp(prev_open_ratio, new_open_ratio, num_steps);
 
-        // Signal the motion is ready
-        xSemaphoreGive(servo_gate.move_ready_semphore);
+            TRACE(SERVO_MOVE_END, trace_fixed(new_open_ratio, 1000));
+        }
 
         // Update state
         prev_open_ratio = new_open_ratio;
         servo_gate.gate_state = new_state;
+        ui_events_publish(UI_EVENT_GATE_STATE, (uint8_t) new_state, new_open_ratio);
+
+        // Signal the waiter of this move, if any, once the state reads the new one
+        _servo_gate_move_done(&command);
     }
 }
 
@@ -209,32 +345,52 @@ bool servo_gate_init() {
     pwm_init(pwm_gpio_to_slice_num(SERVO0_PWM_PIN), &cfg, true);
     pwm_init(pwm_gpio_to_slice_num(SERVO1_PWM_PIN), &cfg, true);
 
+    // Ramp DMA, one CC register write per PWM wrap
+    servo_gate_dma_channel = dma_claim_unused_channel(false);
+    if (servo_gate_dma_channel < 0) {
+        report_error(ERR_SERVO_DMA_CLAIM);
+        return false;
+    }
+    dma_channel_config dma_cfg = dma_channel_get_default_config(servo_gate_dma_channel);
+    channel_config_set_transfer_data_size(&dma_cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&dma_cfg, true);
+    channel_config_set_write_increment(&dma_cfg, false);
+    channel_config_set_dreq(&dma_cfg, pwm_get_dreq(SERVO_PWM_SLICE_NUM));
+    dma_channel_configure(servo_gate_dma_channel, &dma_cfg, &pwm_hw->slice[SERVO_PWM_SLICE_NUM].cc, NULL, 0, false);
+
     // Start the RTOS task and queue
-    servo_gate.control_queue = xQueueCreate(1, sizeof(gate_state_t));
+    servo_gate.control_queue = xQueueCreateStatic(SERVO_GATE_QUEUE_LENGTH, sizeof(servo_gate_command_t), control_queue_storage, &control_queue_buffer);
     if (servo_gate.control_queue == NULL) {
         report_error(ERR_SERVO_QUEUE_CREATE);
         return false;
     }
 
-    servo_gate.move_ready_semphore = xSemaphoreCreateBinary();
-    if (servo_gate.move_ready_semphore == NULL) {
+    servo_gate.command_mutex = xSemaphoreCreateMutexStatic(&command_mutex_buffer);
+    servo_gate.move_done_event = xEventGroupCreateStatic(&move_done_event_buffer);
+    if (servo_gate.command_mutex == NULL || servo_gate.move_done_event == NULL) {
         report_error(ERR_SERVO_SEMAPHORE_CREATE);
         return false;
     }
 
-    BaseType_t task_created = xTaskCreate(
+    servo_gate.control_task_handler = xTaskCreateStatic(
         servo_gate_control_task,
         "servo_gate_controller",
         configMINIMAL_STACK_SIZE,
         NULL,
         8,
-        &servo_gate.control_task_handler
+        control_task_stack,
+        &control_task_buffer
     );
-    if (task_created != pdPASS) {
+    if (servo_gate.control_task_handler == NULL) {
         report_error(ERR_SERVO_TASK_CREATE);
         return false;
     }
 
+    // Completion interrupt wakes up the control task, enabled once the task exists
+    dma_channel_set_irq1_enabled(servo_gate_dma_channel, true);
+    irq_add_shared_handler(SERVO_GATE_DMA_IRQ, servo_gate_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(SERVO_GATE_DMA_IRQ, true);
+
     // No, we don't set the servo gate state
 
     return true;
@@ -251,7 +407,10 @@ bool http_rest_servo_gate_state(struct fs_file *file, int num_params, char *para
     for (int idx = 0; idx < num_params; idx += 1) {
         if (strcmp(params[idx], "g0") == 0) {
             gate_state_t state = (gate_state_t) atoi(values[idx]);
-            servo_gate_set_state(state, false);
+            // Runs in the lwIP interrupt, can't take the command mutex
+            if (!servo_gate_request_state(state)) {
+                report_error(ERR_SERVO_QUEUE_FULL);
+            }
         }
     }
     
@@ -273,74 +432,37 @@ bool http_rest_servo_gate_state(struct fs_file *file, int num_params, char *para
 }
 
 
-bool http_rest_servo_gate_config(struct fs_file *file, int num_params, char *params[], char *values[]) {
-    // Mappings
-    // c0 (bool): servo_gate_enable
-    // c1 (float): shutter0_close_duty_cycle
-    // c2 (float): shutter0_open_duty_cycle
-    // c3 (float): shutter1_close_duty_cycle
-    // c4 (float): shutter1_open_duty_cycle
-    // c5 (float): shutter_close_speed_pct_s
-    // c6 (float): shutter_open_speed_pct_s
-    // ee (bool): save_to_eeprom
-
-    static char servo_gate_json_buffer[256];
-    bool save_to_eeprom = false;
+// Mappings
+// c0 (bool): servo_gate_enable
+// c1 (float): shutter0_close_duty_cycle
+// c2 (float): shutter0_open_duty_cycle
+// c3 (float): shutter1_close_duty_cycle
+// c4 (float): shutter1_open_duty_cycle
+// c5 (float): shutter_close_speed_pct_s
+// c6 (float): shutter_open_speed_pct_s
+// ee (bool): save_to_eeprom
+static const rest_param_t servo_gate_config_params[] = {
+    REST_PARAM_ENTRY("c0", eeprom_servo_gate_config_t, servo_gate_enable, REST_PARAM_BOOL, 0, 0, 1),
+    REST_PARAM_ENTRY("c1", eeprom_servo_gate_config_t, shutter0_close_duty_cycle, REST_PARAM_FLOAT, 3, 0.0f, 1.0f),
+    REST_PARAM_ENTRY("c2", eeprom_servo_gate_config_t, shutter0_open_duty_cycle, REST_PARAM_FLOAT, 3, 0.0f, 1.0f),
+    REST_PARAM_ENTRY("c3", eeprom_servo_gate_config_t, shutter1_close_duty_cycle, REST_PARAM_FLOAT, 3, 0.0f, 1.0f),
+    REST_PARAM_ENTRY("c4", eeprom_servo_gate_config_t, shutter1_open_duty_cycle, REST_PARAM_FLOAT, 3, 0.0f, 1.0f),
+    REST_PARAM_ENTRY("c5", eeprom_servo_gate_config_t, shutter_close_speed_pct_s, REST_PARAM_FLOAT, 3, 0.0f, 1000.0f),
+    REST_PARAM_ENTRY("c6", eeprom_servo_gate_config_t, shutter_open_speed_pct_s, REST_PARAM_FLOAT, 3, 0.0f, 1000.0f),
+};
+static rest_param_schema_t servo_gate_config_schema = REST_PARAM_SCHEMA(servo_gate_config_params);
 
 
-    // Control
-    for (int idx = 0; idx < num_params; idx += 1) {
-        if (strcmp(params[idx], "c0") == 0) {
-            bool enable = string_to_boolean(values[idx]);
-            servo_gate.eeprom_servo_gate_config.servo_gate_enable = enable;
-        }
-        else if (strcmp(params[idx], "c1") == 0) {
-            servo_gate.eeprom_servo_gate_config.shutter0_close_duty_cycle = strtof(values[idx], NULL);;
-        }
-        else if (strcmp(params[idx], "c2") == 0) {
-            servo_gate.eeprom_servo_gate_config.shutter0_open_duty_cycle = strtof(values[idx], NULL);;
-        }
-        else if (strcmp(params[idx], "c3") == 0) {
-            servo_gate.eeprom_servo_gate_config.shutter1_close_duty_cycle = strtof(values[idx], NULL);;
-        }
-        else if (strcmp(params[idx], "c4") == 0) {
-            servo_gate.eeprom_servo_gate_config.shutter1_open_duty_cycle = strtof(values[idx], NULL);;
-        }
-        else if (strcmp(params[idx], "c5") == 0) {
-            servo_gate.eeprom_servo_gate_config.shutter_close_speed_pct_s = strtof(values[idx], NULL);;
-        }
-        else if (strcmp(params[idx], "c6") == 0) {
-            servo_gate.eeprom_servo_gate_config.shutter_open_speed_pct_s = strtof(values[idx], NULL);;
-        }
-        else if (strcmp(params[idx], "ee") == 0) {
-            save_to_eeprom = string_to_boolean(values[idx]);
-        }
-    }
+bool http_rest_servo_gate_config(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    rest_param_result_t result = rest_param_apply(&servo_gate_config_schema, &servo_gate.eeprom_servo_gate_config, num_params, params, values);
 
     // Perform action
-    if (save_to_eeprom) {
+    if (result.save) {
         servo_gate_config_save();  // Note: this will save settings for both
     }
-    
-    // Response
-    snprintf(servo_gate_json_buffer, 
-             sizeof(servo_gate_json_buffer),
-             "%s"
-             "{\"c0\":%s,\"c1\":%0.3f,\"c2\":%0.3f,\"c3\":%0.3f,\"c4\":%0.3f,\"c5\":%0.3f,\"c6\":%0.3f}",
-             http_json_header,
-             boolean_to_string(servo_gate.eeprom_servo_gate_config.servo_gate_enable),
-             servo_gate.eeprom_servo_gate_config.shutter0_close_duty_cycle,
-             servo_gate.eeprom_servo_gate_config.shutter0_open_duty_cycle,
-             servo_gate.eeprom_servo_gate_config.shutter1_close_duty_cycle,
-             servo_gate.eeprom_servo_gate_config.shutter1_open_duty_cycle,
-             servo_gate.eeprom_servo_gate_config.shutter_close_speed_pct_s,
-             servo_gate.eeprom_servo_gate_config.shutter_open_speed_pct_s);
 
-    size_t data_length = strlen(servo_gate_json_buffer);
-    file->data = servo_gate_json_buffer;
-    file->len = data_length;
-    file->index = data_length;
-    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+    // Response
+    rest_param_to_json(&servo_gate_config_schema, &servo_gate.eeprom_servo_gate_config, &result, &response->json);
 
-    return true;
+    return false;
 }
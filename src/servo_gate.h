@@ -5,6 +5,7 @@
 #include <FreeRTOS.h>
 #include <queue.h>
 #include <semphr.h>
+#include <event_groups.h>
 #include "http_rest.h"
 
 #define EEPROM_SERVO_GATE_CONFIG_REV                     1              // 16 byte 
@@ -35,7 +36,10 @@ typedef struct {
     // RTOS control
     TaskHandle_t control_task_handler;
     QueueHandle_t control_queue;
-    SemaphoreHandle_t move_ready_semphore;
+    SemaphoreHandle_t command_mutex;        // Sequence numbers are sent in order
+    EventGroupHandle_t move_done_event;     // Bit (sequence number % SERVO_GATE_DONE_BITS) per state command
+    uint32_t command_seq;                   // Of the last state command sent
+    volatile uint32_t done_seq;             // Of the last state command moved
 } servo_gate_t;
 
 
@@ -46,11 +50,28 @@ extern "C" {
 bool servo_gate_init(void);
 bool servo_gate_config_save(void);
 bool http_rest_servo_gate_state(struct fs_file *file, int num_params, char *params[], char *values[]);
-bool http_rest_servo_gate_config(struct fs_file *file, int num_params, char *params[], char *values[]);
+bool http_rest_servo_gate_config(rest_response_t *response, int num_params, char *params[], char *values[]);
 const char * gate_state_to_string(gate_state_t);
 
+/**
+ * Move the gate to GATE_OPEN or GATE_CLOSE, from a task only. With block_wait, returns once this move is
+ * done, queued openings in front of it included.
+*/
 void servo_gate_set_state(gate_state_t, bool);
 
+/**
+ * Queue a move to GATE_OPEN or GATE_CLOSE from interrupt context, e.g., the lwIP callbacks. Never
+ * blocks and can't be waited for, returns false if the queue is full.
+*/
+bool servo_gate_request_state(gate_state_t);
+
+/**
+ * Move the gate to a partial opening, 1.0 is GATE_OPEN and 0.0 is GATE_CLOSE, for flow control while
+ * charging. Does not block, replaces an opening that has not started yet, but not a queued state
+ * change. The state reads GATE_OPEN.
+*/
+void servo_gate_set_opening(float opening);
+
 #ifdef __cplusplus
 }
 #endif
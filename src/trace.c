@@ -0,0 +1,200 @@
+#include <string.h>
+#include "hardware/sync.h"
+
+#include "trace.h"
+
+
+#define TRACE_DUMP_VERSION              1
+#define TRACE_DUMP_CONTENT_TYPE         "application/octet-stream"
+#define TRACE_RECORDS_PER_PART          32
+
+// Dump sections, in the order they are sent
+#define TRACE_SECTION_HEADER            0
+#define TRACE_SECTION_EVENTS            1
+#define TRACE_SECTION_TASKS             2
+#define TRACE_SECTION_RECORDS           3           // One section per core
+
+
+// Binary dump, little endian
+//
+//  header
+//  event descriptions, num_ids of them, indexed by event ID
+//  task names, terminated by an entry with number 0
+//  records of core 0, oldest first, then of core 1
+typedef struct {
+    char magic[4];                      // "OTTR"
+    uint16_t version;
+    uint8_t num_cores;
+    uint8_t num_ids;
+    uint32_t timestamp_hz;
+    uint32_t num_records[NUM_CORES];
+} trace_dump_header_t;
+
+typedef struct {
+    uint8_t kind;                       // trace_kind_t
+    uint8_t reserved[3];
+    int32_t scale;
+    char label[TRACE_NAME_SIZE];
+} trace_dump_event_t;
+
+typedef struct {
+    uint32_t number;
+    char name[TRACE_NAME_SIZE];
+} trace_dump_task_t;
+
+
+#define TRACE_EVENT_DESC(name, kind, label, scale)      {kind, {0}, scale, label},
+
+static const trace_dump_event_t trace_events[TRACE_NUM_IDS] = {
+    TRACE_EVENTS(TRACE_EVENT_DESC)
+};
+
+#undef TRACE_EVENT_DESC
+
+
+trace_ring_t trace_rings[NUM_CORES];
+volatile bool trace_running = true;
+
+// Task names by task number, written when a task is created
+static trace_dump_task_t trace_tasks[TRACE_MAX_TASKS];
+static uint32_t trace_num_tasks = 0;
+
+// Dumps being sent, recording resumes when the last one is closed. Only touched in the lwIP context.
+static uint32_t trace_num_dumps = 0;
+
+
+void trace_task_created(uint32_t task_number, const char * name) {
+    if (trace_num_tasks >= TRACE_MAX_TASKS) {
+        return;
+    }
+
+    trace_dump_task_t * task = &trace_tasks[trace_num_tasks];
+    task->number = task_number;
+    strncpy(task->name, name, TRACE_NAME_SIZE - 1);
+    task->name[TRACE_NAME_SIZE - 1] = '\0';
+
+    // Entry before count, the dump may run on the other core
+    __dmb();
+    trace_num_tasks += 1;
+}
+
+
+void __time_critical_func(trace_task_switched_in)(uint32_t task_number) {
+    trace_write(TRACE_ID_TASK_SWITCH, (int32_t) task_number);
+}
+
+
+static inline uint32_t _num_records(const trace_ring_t * ring) {
+    return ring->head < TRACE_RING_SIZE ? ring->head : TRACE_RING_SIZE;
+}
+
+
+// Close hook of a dump, called whether it was sent completely or the connection went away
+static void _dump_closed(rest_response_t *response) {
+    (void) response;
+
+    if (trace_num_dumps > 0) {
+        trace_num_dumps -= 1;
+    }
+    if (trace_num_dumps == 0) {
+        trace_running = true;
+    }
+}
+
+
+bool http_rest_trace(rest_response_t *response, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // None
+    //
+    // Response
+    // Binary dump of the trace rings, see trace.c. Convert with scripts/trace2json.py.
+    //
+    // Recording pauses in part 0 and resumes once the response is closed (sent, failed or aborted) and no
+    // other dump is being sent, so the rings do not move while they are sent. The cursor holds the section in the upper 16 bits and the index within it in the lower.
+    json_writer_t * json = &response->json;
+
+    uint32_t section = response->cursor >> 16;
+    uint32_t idx = response->cursor & 0xFFFF;
+
+    if (section == TRACE_SECTION_HEADER) {
+        response->content_type = TRACE_DUMP_CONTENT_TYPE;
+        if (response->on_close == NULL) {
+            // Not again when the part is written a second time
+            response->on_close = _dump_closed;
+            trace_num_dumps += 1;
+            trace_running = false;
+        }
+
+        trace_dump_header_t header = {
+            .magic = {'O', 'T', 'T', 'R'},
+            .version = TRACE_DUMP_VERSION,
+            .num_cores = NUM_CORES,
+            .num_ids = TRACE_NUM_IDS,
+            .timestamp_hz = 1000000,
+        };
+        for (uint8_t core = 0; core < NUM_CORES; core += 1) {
+            header.num_records[core] = _num_records(&trace_rings[core]);
+        }
+        json_writer_write(json, &header, sizeof(header));
+
+        response->cursor = TRACE_SECTION_EVENTS << 16;
+        return true;
+    }
+
+    if (section == TRACE_SECTION_EVENTS) {
+        json_writer_write(json, &trace_events[idx], sizeof(trace_dump_event_t));
+
+        idx += 1;
+        response->cursor = idx < TRACE_NUM_IDS ? (TRACE_SECTION_EVENTS << 16) | idx : TRACE_SECTION_TASKS << 16;
+        return true;
+    }
+
+    if (section == TRACE_SECTION_TASKS) {
+        if (idx < trace_num_tasks) {
+            __dmb();
+            json_writer_write(json, &trace_tasks[idx], sizeof(trace_dump_task_t));
+            response->cursor = (TRACE_SECTION_TASKS << 16) | (idx + 1);
+        }
+        else {
+            static const trace_dump_task_t end_of_tasks = {0};
+            json_writer_write(json, &end_of_tasks, sizeof(end_of_tasks));
+            response->cursor = TRACE_SECTION_RECORDS << 16;
+        }
+        return true;
+    }
+
+    // Records, oldest first
+    uint32_t core = section - TRACE_SECTION_RECORDS;
+    const trace_ring_t * ring = &trace_rings[core];
+    uint32_t num_records = _num_records(ring);
+    uint32_t first = ring->head - num_records;
+
+    uint32_t count = num_records - idx;
+    if (count > TRACE_RECORDS_PER_PART) {
+        count = TRACE_RECORDS_PER_PART;
+    }
+
+    // The records may wrap around the end of the ring
+    uint32_t start = (first + idx) & (TRACE_RING_SIZE - 1);
+    uint32_t before_wrap = TRACE_RING_SIZE - start;
+    if (count <= before_wrap) {
+        json_writer_write(json, &ring->records[start], count * sizeof(trace_record_t));
+    }
+    else {
+        json_writer_write(json, &ring->records[start], before_wrap * sizeof(trace_record_t));
+        json_writer_write(json, &ring->records[0], (count - before_wrap) * sizeof(trace_record_t));
+    }
+
+    idx += count;
+    if (idx < num_records) {
+        response->cursor = (section << 16) | idx;
+        return true;
+    }
+
+    if (core + 1 < NUM_CORES) {
+        response->cursor = (section + 1) << 16;
+        return true;
+    }
+
+    return false;
+}
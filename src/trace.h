@@ -0,0 +1,139 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/sync.h"
+#include "hardware/structs/timer.h"
+#include "pico/platform.h"
+#include "http_rest.h"
+
+// Hot path tracing
+//
+// Trace points write an 8 byte record (timestamp, event ID and a 24 bit argument) into a ring owned by
+// the current core, with interrupts disabled for the few cycles of the store. The rings are never
+// drained, the oldest records are overwritten, so they always hold the last TRACE_RING_SIZE records of
+// each core leading up to now, e.g., the overthrow that has just happened.
+//
+// GET /rest/trace returns the rings as a binary dump (recording pauses until it is closed), which
+// scripts/trace2json.py converts into Chrome trace JSON for chrome://tracing or ui.perfetto.dev.
+//
+// The timestamp is the raw 1 MHz system timer: the RP2040 cores have no cycle counter and the timer is
+// shared by both cores, so the rings merge without aligning clocks.
+//
+// Only built in with TRACE_ENABLED=1 (cmake -DENABLE_TRACE=ON, the default for Debug builds), otherwise every
+// trace point compiles to nothing.
+
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED                   0
+#endif
+
+#define TRACE_RING_SIZE                 512         // Records per core, power of 2
+#define TRACE_MAX_TASKS                 32          // Task names kept for the dump
+#define TRACE_NAME_SIZE                 16
+
+#define TRACE_ARG_MASK                  0x00FFFFFF
+
+
+// How the host shows an event
+typedef enum {
+    TRACE_KIND_TASK = 0,                // Task with this number starts running on the core
+    TRACE_KIND_INSTANT,                 // Point in time, argument attached
+    TRACE_KIND_COUNTER,                 // New value of a counter track
+    TRACE_KIND_BEGIN,                   // Start of a slice, ended by the next END with the same label
+    TRACE_KIND_END,
+} trace_kind_t;
+
+
+//  X(name, kind, label, scale), the argument is a signed 24 bit value, divided by scale on the host.
+//  Per motor events are listed coarse then fine, the fine ID is the coarse ID + 1.
+#define TRACE_EVENTS(X) \
+    X(TASK_SWITCH,              TRACE_KIND_TASK,        "task",                 1) \
+    X(SCALE_FRAME,              TRACE_KIND_COUNTER,     "weight",               1000) \
+    X(CONTROL_STEP,             TRACE_KIND_COUNTER,     "error",                1000) \
+    X(COARSE_QUEUED,            TRACE_KIND_COUNTER,     "coarse command",       1000) \
+    X(FINE_QUEUED,              TRACE_KIND_COUNTER,     "fine command",         1000) \
+    X(COARSE_APPLIED,           TRACE_KIND_INSTANT,     "coarse applied",       1000) \
+    X(FINE_APPLIED,             TRACE_KIND_INSTANT,     "fine applied",         1000) \
+    X(COARSE_RAMP_START,        TRACE_KIND_BEGIN,       "coarse ramp",          1000) \
+    X(FINE_RAMP_START,          TRACE_KIND_BEGIN,       "fine ramp",            1000) \
+    X(COARSE_RAMP_END,          TRACE_KIND_END,         "coarse ramp",          1000) \
+    X(FINE_RAMP_END,            TRACE_KIND_END,         "fine ramp",            1000) \
+    X(SERVO_MOVE_START,         TRACE_KIND_BEGIN,       "servo move",           1000) \
+    X(SERVO_MOVE_END,           TRACE_KIND_END,         "servo move",           1000) \
+    X(EEPROM_WRITE_START,       TRACE_KIND_BEGIN,       "eeprom write",         1) \
+    X(EEPROM_WRITE_END,         TRACE_KIND_END,         "eeprom write",         1) \
+    X(CHARGE_START,             TRACE_KIND_BEGIN,       "charge",               1000) \
+    X(CHARGE_DONE,              TRACE_KIND_END,         "charge",               1000)
+
+
+#define TRACE_ID(name, kind, label, scale)      TRACE_ID_##name,
+
+typedef enum {
+    TRACE_EVENTS(TRACE_ID)
+    TRACE_NUM_IDS,
+} trace_id_t;
+
+#undef TRACE_ID
+
+
+typedef struct {
+    uint32_t timestamp;
+    uint32_t data;                      // ID in the upper 8 bits, argument in the lower 24
+} trace_record_t;
+
+typedef struct {
+    trace_record_t records[TRACE_RING_SIZE];
+    uint32_t head;                      // Records ever written
+} trace_ring_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern trace_ring_t trace_rings[NUM_CORES];
+extern volatile bool trace_running;
+
+// FreeRTOS trace hooks, see FreeRTOSConfig.h
+void trace_task_created(uint32_t task_number, const char * name);
+void trace_task_switched_in(uint32_t task_number);
+
+static __force_inline void trace_write(uint32_t id, int32_t arg) {
+    if (!trace_running) {
+        return;
+    }
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    trace_ring_t * ring = &trace_rings[get_core_num()];
+    trace_record_t * record = &ring->records[ring->head & (TRACE_RING_SIZE - 1)];
+    record->timestamp = timer_hw->timerawl;
+    record->data = (id << 24) | ((uint32_t) arg & TRACE_ARG_MASK);
+    ring->head += 1;
+    restore_interrupts(irq_state);
+}
+
+// Fixed point argument, e.g., a weight in thousandths
+static inline int32_t trace_fixed(float value, int32_t scale) {
+    return (int32_t) (value * scale);
+}
+
+// REST
+bool http_rest_trace(rest_response_t *response, int num_params, char *params[], char *values[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#if TRACE_ENABLED
+#define TRACE(name, arg)            trace_write(TRACE_ID_##name, (int32_t) (arg))
+#define TRACE_BY_ID(id, arg)        trace_write((id), (int32_t) (arg))
+#else
+#define TRACE(name, arg)            do { } while (0)
+#define TRACE_BY_ID(id, arg)        do { } while (0)
+#endif
+
+
+#endif  // TRACE_H_
@@ -0,0 +1,65 @@
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <task.h>
+#include <string.h>
+
+#include "ui_events.h"
+#include "error.h"
+
+
+static QueueHandle_t ui_event_queue = NULL;
+static StaticQueue_t ui_event_queue_buffer;
+static uint8_t ui_event_queue_storage[UI_EVENT_QUEUE_LENGTH * sizeof(ui_event_t)];
+static float last_weight;
+static bool weight_published = false;       // last_weight is valid, any first weight is published
+
+
+bool ui_events_init(void) {
+    if (ui_event_queue) {
+        return true;
+    }
+
+    ui_event_queue = xQueueCreateStatic(UI_EVENT_QUEUE_LENGTH, sizeof(ui_event_t), ui_event_queue_storage, &ui_event_queue_buffer);
+    if (ui_event_queue == NULL) {
+        report_error(ERR_DISPLAY_QUEUE_CREATE);
+        return false;
+    }
+
+    return true;
+}
+
+
+void ui_events_publish(ui_event_type_t type, uint8_t state, float value) {
+    if (ui_event_queue == NULL) {
+        return;
+    }
+
+    if (type == UI_EVENT_WEIGHT) {
+        // Compare the bits, so NaN (no weight) is only published once as well
+        if (weight_published && memcmp(&value, &last_weight, sizeof(value)) == 0) {
+            return;
+        }
+        if (uxQueueSpacesAvailable(ui_event_queue) <= UI_EVENT_QUEUE_RESERVE) {
+            return;
+        }
+        last_weight = value;
+        weight_published = true;
+    }
+
+    ui_event_t event = {
+        .type = (uint8_t) type,
+        .state = state,
+        .value = value,
+    };
+    xQueueSend(ui_event_queue, &event, 0);
+}
+
+
+bool ui_events_receive(ui_event_t * event, TickType_t timeout_ticks) {
+    if (ui_event_queue == NULL) {
+        vTaskDelay(timeout_ticks);
+        return false;
+    }
+
+    return xQueueReceive(ui_event_queue, event, timeout_ticks) == pdTRUE;
+}
@@ -0,0 +1,63 @@
+#ifndef UI_EVENTS_H_
+#define UI_EVENTS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <FreeRTOS.h>
+
+// UI change events
+//
+// Charge mode, cleanup mode, the scale and AI tuning publish what has changed into a FreeRTOS queue.
+// The LVGL task (TFT) sleeps on the queue and updates only the widgets the event affects, so an idle
+// screen is neither polled nor invalidated. Nothing is queued until a UI has called ui_events_init(),
+// the Mini 12864 render tasks are notified through display_notify() instead.
+//
+// Weight events are frequent and superseded by the next one, they are dropped rather than taking the
+// last UI_EVENT_QUEUE_RESERVE slots, which are kept for state changes.
+
+
+#define UI_EVENT_QUEUE_LENGTH           32
+#define UI_EVENT_QUEUE_RESERVE          8
+
+
+typedef enum {
+    UI_EVENT_WEIGHT = 0,                // value: scale measurement, changed since the last event
+    UI_EVENT_CHARGE_STATE,              // state: charge_mode_state_t, value: target weight
+    UI_EVENT_CHARGE_TIME,               // value: elapsed seconds of the completed charge
+    UI_EVENT_CLEANUP_SPEED,             // value: trickler speed (rps)
+    UI_EVENT_GATE_STATE,                // state: gate_state_t, value: open ratio
+    UI_EVENT_AI_TUNING,                 // state: ai_tuning_state_t, the session has changed
+} ui_event_type_t;
+
+typedef struct {
+    uint8_t type;                       // ui_event_type_t
+    uint8_t state;
+    float value;
+} ui_event_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create the queue, called by the UI before it starts receiving.
+*/
+bool ui_events_init(void);
+
+/**
+ * Publish an event, never blocks. Safe to call before init (the event is discarded).
+*/
+void ui_events_publish(ui_event_type_t type, uint8_t state, float value);
+
+/**
+ * Receive the next event, waiting up to timeout_ticks. Returns false on timeout.
+*/
+bool ui_events_receive(ui_event_t * event, TickType_t timeout_ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // UI_EVENTS_H_
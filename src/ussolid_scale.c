@@ -11,6 +11,7 @@
 #include "configuration.h"
 #include "scale.h"
 #include "app.h"
+#include "scale_frame.h"
 
 /* 
   Example data
@@ -49,63 +50,22 @@ scale_handle_t ussolid_scale_handle = {
 };
 
 static float _decode_measurement_msg(ussolid_jfdbs_data_format_t * msg) {
-    // Determine sign
-    int sign = 1;
-
-    // Check if the header contains a negative sign
-    if (msg->header[0] == '-') {
-        sign = -1;
-    }
-
-    char *endptr;
-    float weight = strtof(msg->data, &endptr);
-
-    if( endptr == msg->data ) {
-        // Conversion failed
-        return nanf(msg->data);
-    }
-
-    // Apply the sign
-    weight *= sign;
-
-    return weight;
+    // The header holds the sign
+    return scale_frame_parse_weight(msg->data, sizeof(msg->data), msg->header[0]);
 }
 
 void _ussolid_scale_listener_task(void *p) {
-    uint8_t string_buf_idx = 0;
     ussolid_jfdbs_data_format_t frame;
+    scale_frame_reader_t reader;
+    scale_frame_reader_init(&reader, &frame, sizeof(frame), SCALE_FRAME_NO_HEADER);
 
     while (true) {
-        // Read all data 
-        while (uart_is_readable(SCALE_UART)) {
-            char ch = uart_getc(SCALE_UART);
-
-            frame.bytes[string_buf_idx++] = ch;
-
-            // If we have received 15 bytes then we can decode the message
-            if (string_buf_idx == sizeof(ussolid_jfdbs_data_format_t)) {
-                
-                // Data is ready, send to decode
-                float weight = _decode_measurement_msg(&frame);
-
-                scale_config.current_scale_measurement = weight;
-
-                // Signal the data is ready
-                if (scale_config.scale_measurement_ready) {
-                    xSemaphoreGive(scale_config.scale_measurement_ready);
-                }
-
-                // Reset
-                string_buf_idx = 0;
-            }
-
-            // \n is the terminator. We shall reset the receive of message on receiving any of those character.
-            if (ch =='\n') {
-                string_buf_idx = 0;
-            }
+        // Decode every frame received so far
+        while (scale_frame_read(&reader, HAL_UART_SCALE)) {
+            scale_update_measurement(_decode_measurement_msg(&frame));
         }
 
-        vTaskDelay(pdMS_TO_TICKS(20));
+        hal_delay_ms(20);
     }
 }
 
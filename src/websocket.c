@@ -0,0 +1,596 @@
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "lwip/tcp.h"
+
+#include "websocket.h"
+#include "charge_mode.h"
+#include "scale.h"
+#include "mini_12864_module.h"
+#include "display_mirror.h"
+
+
+#define WEBSOCKET_GUID                  "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WEBSOCKET_KEY_HEADER            "Sec-WebSocket-Key: "
+#define WEBSOCKET_KEY_LEN               24          // base64 of a 16 byte nonce
+#define WEBSOCKET_POLL_INTERVAL         4           // In TCP coarse timer ticks (500 ms), same as HTTPD_POLL_INTERVAL
+#define WEBSOCKET_MAX_RETRIES           4           // Unanswered polls (each sends a ping) before closing
+
+// Opcodes
+#define WS_OPCODE_TEXT                  0x1
+#define WS_OPCODE_BINARY                0x2
+#define WS_OPCODE_CLOSE                 0x8
+#define WS_OPCODE_PING                  0x9
+#define WS_OPCODE_PONG                  0xA
+
+// Close status codes
+#define WS_CLOSE_NORMAL                 1000
+#define WS_CLOSE_PROTOCOL_ERROR         1002
+#define WS_CLOSE_TOO_BIG                1009
+
+
+typedef struct {
+    struct altcp_pcb * pcb;     // NULL when the slot is free
+    uint8_t topics;             // websocket_topic_t
+    uint8_t retries;
+    uint32_t event_seq;         // Last charge mode event sent, see charge_mode_take_events()
+
+    // Receive state, frames may be split across any number of pbufs
+    uint8_t rx_header[14];
+    uint8_t rx_header_len;
+    uint8_t rx_header_expected;
+    uint8_t rx_payload[WEBSOCKET_MAX_PAYLOAD_LEN];
+    uint32_t rx_payload_len;
+    uint32_t rx_payload_received;
+
+    // Display mirror
+    uint32_t display_frame;         // Frame the client has
+    uint32_t display_next_frame;    // Frame of the delta being sent in parts
+    uint16_t display_next_tile;     // Next part of that delta, 0 when none is in progress
+} websocket_client_t;
+
+
+extern charge_mode_config_t charge_mode_config;
+extern QueueHandle_t encoder_event_queue;
+
+static websocket_client_t websocket_clients[WEBSOCKET_MAX_CLIENTS];
+
+
+/*
+  SHA-1, only used to compute Sec-WebSocket-Accept during the handshake
+*/
+#define SHA1_ROL(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
+
+static void _sha1_block(uint32_t state[5], const uint8_t block[64]) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i += 1) {
+        w[i] = ((uint32_t) block[i * 4] << 24) | ((uint32_t) block[i * 4 + 1] << 16) |
+               ((uint32_t) block[i * 4 + 2] << 8) | (uint32_t) block[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i += 1) {
+        w[i] = SHA1_ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int i = 0; i < 80; i += 1) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        }
+        else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        }
+        else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        }
+        else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t temp = SHA1_ROL(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = SHA1_ROL(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+
+static void _sha1(const uint8_t * data, size_t len, uint8_t digest[20]) {
+    uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    uint8_t block[64];
+    size_t idx = 0;
+
+    // Full blocks
+    for (; idx + 64 <= len; idx += 64) {
+        _sha1_block(state, data + idx);
+    }
+
+    // Padding, with the message length in bits at the end
+    size_t remaining = len - idx;
+    memset(block, 0, sizeof(block));
+    memcpy(block, data + idx, remaining);
+    block[remaining] = 0x80;
+    if (remaining >= 56) {
+        _sha1_block(state, block);
+        memset(block, 0, sizeof(block));
+    }
+    uint64_t bit_len = (uint64_t) len * 8;
+    for (int i = 0; i < 8; i += 1) {
+        block[63 - i] = (uint8_t) (bit_len >> (i * 8));
+    }
+    _sha1_block(state, block);
+
+    for (int i = 0; i < 5; i += 1) {
+        digest[i * 4] = (uint8_t) (state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t) (state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t) (state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t) state[i];
+    }
+}
+
+
+static size_t _base64_encode(const uint8_t * src, size_t len, char * dst) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t out = 0;
+
+    for (size_t idx = 0; idx < len; idx += 3) {
+        uint32_t triple = (uint32_t) src[idx] << 16;
+        if (idx + 1 < len) {
+            triple |= (uint32_t) src[idx + 1] << 8;
+        }
+        if (idx + 2 < len) {
+            triple |= src[idx + 2];
+        }
+
+        dst[out++] = table[(triple >> 18) & 0x3F];
+        dst[out++] = table[(triple >> 12) & 0x3F];
+        dst[out++] = (idx + 1 < len) ? table[(triple >> 6) & 0x3F] : '=';
+        dst[out++] = (idx + 2 < len) ? table[triple & 0x3F] : '=';
+    }
+    dst[out] = 0;
+
+    return out;
+}
+
+
+/*
+  Framing
+*/
+static bool _send_frame(websocket_client_t * client, uint8_t opcode, const void * payload, uint16_t len) {
+    // Server frames are never masked, the length is 7 bit or 16 bit extended
+    uint8_t header[4] = {0x80 | opcode, len};
+    uint8_t header_len = 2;
+    if (len >= 126) {
+        header[1] = 126;
+        header[2] = len >> 8;
+        header[3] = len & 0xFF;
+        header_len = 4;
+    }
+
+    // Backpressure: drop the frame rather than queueing a partial one
+    if ((altcp_sndbuf(client->pcb) < header_len + len) || (altcp_sndqueuelen(client->pcb) >= TCP_SND_QUEUELEN / 2)) {
+        return false;
+    }
+
+    err_t err = altcp_write(client->pcb, header, header_len, TCP_WRITE_FLAG_COPY | (len ? TCP_WRITE_FLAG_MORE : 0));
+    if (err == ERR_OK && len) {
+        err = altcp_write(client->pcb, payload, len, TCP_WRITE_FLAG_COPY);
+    }
+    if (err == ERR_OK) {
+        altcp_output(client->pcb);
+    }
+
+    return err == ERR_OK;
+}
+
+
+// Returns ERR_ABRT if the pcb had to be aborted, lwIP callbacks shall pass it on
+static err_t _close_client(websocket_client_t * client, bool abort_conn) {
+    struct altcp_pcb * pcb = client->pcb;
+
+    altcp_arg(pcb, NULL);
+    altcp_recv(pcb, NULL);
+    altcp_sent(pcb, NULL);
+    altcp_poll(pcb, NULL, 0);
+    altcp_err(pcb, NULL);
+
+    memset(client, 0, sizeof(websocket_client_t));
+
+    if (abort_conn || altcp_close(pcb) != ERR_OK) {
+        altcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    return ERR_CLSD;
+}
+
+
+static err_t _send_close_and_close(websocket_client_t * client, uint16_t status) {
+    uint8_t payload[2] = {status >> 8, status & 0xFF};
+    _send_frame(client, WS_OPCODE_CLOSE, payload, sizeof(payload));
+    return _close_client(client, false);
+}
+
+
+static void _send_ack(websocket_client_t * client, uint8_t msg_id, websocket_status_t status) {
+    uint8_t payload[3] = {WS_MSG_ACK, msg_id, status};
+    _send_frame(client, WS_OPCODE_BINARY, payload, sizeof(payload));
+}
+
+
+static void _send_charge_state(websocket_client_t * client) {
+    websocket_charge_state_msg_t msg = {
+        .msg_id = WS_MSG_CHARGE_STATE,
+        .current_weight = scale_get_current_measurement(),
+        .target_weight = charge_mode_config.target_charge_weight,
+        .charge_mode_state = (uint8_t) charge_mode_config.charge_mode_state,
+        .charge_mode_event = (uint8_t) charge_mode_take_events(&client->event_seq),
+    };
+    _send_frame(client, WS_OPCODE_BINARY, &msg, sizeof(msg));
+}
+
+
+static websocket_status_t _handle_message(websocket_client_t * client, const uint8_t * payload, uint32_t len) {
+    switch (payload[0]) {
+        case WS_MSG_SUBSCRIBE: {
+            if (len < 2) {
+                return WS_STATUS_INVALID_ARGUMENT;
+            }
+            // A new display subscriber starts with the full frame
+            if ((payload[1] & WS_TOPIC_DISPLAY) && !(client->topics & WS_TOPIC_DISPLAY)) {
+                client->display_frame = 0;
+                client->display_next_tile = 0;
+            }
+            client->topics = payload[1];
+            // Events raised before the subscription are not replayed
+            client->event_seq = charge_mode_config.charge_mode_event_seq;
+            break;
+        }
+        case WS_MSG_SET_TARGET: {
+            float target;
+            if (len < 1 + sizeof(target)) {
+                return WS_STATUS_INVALID_ARGUMENT;
+            }
+            memcpy(&target, &payload[1], sizeof(target));
+            if (!isfinite(target) || target < 0) {
+                return WS_STATUS_INVALID_ARGUMENT;
+            }
+            charge_mode_config.target_charge_weight = target;
+            break;
+        }
+        case WS_MSG_CHARGE_CONTROL: {
+            if (len < 2 || (payload[1] != CHARGE_MODE_EXIT && payload[1] != CHARGE_MODE_WAIT_FOR_ZERO)) {
+                return WS_STATUS_INVALID_ARGUMENT;
+            }
+            charge_mode_request_state((charge_mode_state_t) payload[1]);
+            break;
+        }
+        case WS_MSG_BUTTON: {
+            if (len < 2 || payload[1] < BUTTON_ENCODER_ROTATE_CW || payload[1] > BUTTON_RST_PRESSED) {
+                return WS_STATUS_INVALID_ARGUMENT;
+            }
+            ButtonEncoderEvent_t button_event = (ButtonEncoderEvent_t) payload[1];
+            xQueueSend(encoder_event_queue, &button_event, 0);
+            break;
+        }
+        default:
+            return WS_STATUS_UNKNOWN_MESSAGE;
+    }
+
+    return WS_STATUS_OK;
+}
+
+
+// Returns ERR_OK, or the result of _close_client() if the client has been closed
+static err_t _handle_frame(websocket_client_t * client) {
+    bool fin = client->rx_header[0] & 0x80;
+    uint8_t opcode = client->rx_header[0] & 0x0F;
+
+    switch (opcode) {
+        case WS_OPCODE_BINARY:
+            // Our messages are tiny, fragmented or empty messages are not expected
+            if (!fin || client->rx_payload_len == 0) {
+                return _send_close_and_close(client, WS_CLOSE_PROTOCOL_ERROR);
+            }
+            _send_ack(client, client->rx_payload[0], _handle_message(client, client->rx_payload, client->rx_payload_len));
+
+            // New subscribers get the current state right away, updates are only pushed on change
+            if (client->rx_payload[0] == WS_MSG_SUBSCRIBE && (client->topics & WS_TOPIC_CHARGE_STATE)) {
+                _send_charge_state(client);
+            }
+            break;
+        case WS_OPCODE_PING:
+            _send_frame(client, WS_OPCODE_PONG, client->rx_payload, client->rx_payload_len);
+            break;
+        case WS_OPCODE_CLOSE:
+            return _send_close_and_close(client, WS_CLOSE_NORMAL);
+        default:
+            // Text and pong frames are ignored
+            break;
+    }
+
+    return ERR_OK;
+}
+
+
+// Returns ERR_OK, or the result of _close_client() if the client has been closed
+static err_t _receive_byte(websocket_client_t * client, uint8_t byte) {
+    // Header
+    if (client->rx_header_len < client->rx_header_expected) {
+        client->rx_header[client->rx_header_len++] = byte;
+
+        if (client->rx_header_len == 2) {
+            // Clients shall always mask
+            if ((client->rx_header[1] & 0x80) == 0) {
+                return _send_close_and_close(client, WS_CLOSE_PROTOCOL_ERROR);
+            }
+            uint8_t len7 = client->rx_header[1] & 0x7F;
+            client->rx_header_expected = 2 + (len7 == 126 ? 2 : (len7 == 127 ? 8 : 0)) + 4;
+        }
+
+        if (client->rx_header_len < client->rx_header_expected) {
+            return ERR_OK;
+        }
+
+        // Header complete, decode the payload length
+        uint8_t len7 = client->rx_header[1] & 0x7F;
+        if (len7 < 126) {
+            client->rx_payload_len = len7;
+        }
+        else if (len7 == 126) {
+            client->rx_payload_len = ((uint32_t) client->rx_header[2] << 8) | client->rx_header[3];
+        }
+        else {
+            client->rx_payload_len = UINT32_MAX;  // Way too big anyway
+        }
+
+        if (client->rx_payload_len > WEBSOCKET_MAX_PAYLOAD_LEN) {
+            return _send_close_and_close(client, WS_CLOSE_TOO_BIG);
+        }
+        client->rx_payload_received = 0;
+    }
+    // Payload, unmasked in place
+    else {
+        const uint8_t * mask = &client->rx_header[client->rx_header_expected - 4];
+        client->rx_payload[client->rx_payload_received] = byte ^ mask[client->rx_payload_received & 0x3];
+        client->rx_payload_received += 1;
+    }
+
+    if (client->rx_payload_received < client->rx_payload_len) {
+        return ERR_OK;
+    }
+
+    // Frame complete
+    err_t err = _handle_frame(client);
+    if (err == ERR_OK) {
+        client->rx_header_len = 0;
+        client->rx_header_expected = 2;
+    }
+    return err;
+}
+
+
+/*
+  lwIP callbacks
+*/
+static err_t _websocket_recv(void *arg, struct altcp_pcb *pcb, struct pbuf *p, err_t err) {
+    websocket_client_t * client = (websocket_client_t *) arg;
+
+    if (p == NULL || err != ERR_OK || client == NULL) {
+        // Closed by the remote end
+        if (p != NULL) {
+            altcp_recved(pcb, p->tot_len);
+            pbuf_free(p);
+        }
+        if (client != NULL) {
+            return (_close_client(client, false) == ERR_ABRT) ? ERR_ABRT : ERR_OK;
+        }
+        altcp_close(pcb);
+        return ERR_OK;
+    }
+
+    altcp_recved(pcb, p->tot_len);
+    client->retries = 0;
+
+    err_t rx_err = ERR_OK;
+    for (struct pbuf * q = p; q != NULL && rx_err == ERR_OK; q = q->next) {
+        const uint8_t * data = (const uint8_t *) q->payload;
+        for (u16_t idx = 0; idx < q->len && rx_err == ERR_OK; idx += 1) {
+            rx_err = _receive_byte(client, data[idx]);
+        }
+    }
+    pbuf_free(p);
+
+    return (rx_err == ERR_ABRT) ? ERR_ABRT : ERR_OK;
+}
+
+
+static err_t _websocket_sent(void *arg, struct altcp_pcb *pcb, u16_t len) {
+    websocket_client_t * client = (websocket_client_t *) arg;
+    if (client != NULL) {
+        client->retries = 0;
+    }
+    return ERR_OK;
+}
+
+
+static err_t _websocket_poll(void *arg, struct altcp_pcb *pcb) {
+    websocket_client_t * client = (websocket_client_t *) arg;
+    if (client == NULL) {
+        altcp_abort(pcb);
+        return ERR_ABRT;
+    }
+
+    client->retries += 1;
+    if (client->retries >= WEBSOCKET_MAX_RETRIES) {
+        return _close_client(client, true);
+    }
+
+    // Keep alive, the pong (or just its ACK) resets the retries
+    _send_frame(client, WS_OPCODE_PING, NULL, 0);
+    return ERR_OK;
+}
+
+
+static void _websocket_err(void *arg, err_t err) {
+    // The pcb is already freed
+    websocket_client_t * client = (websocket_client_t *) arg;
+    if (client != NULL) {
+        memset(client, 0, sizeof(websocket_client_t));
+    }
+}
+
+
+bool websocket_upgrade(struct altcp_pcb *pcb, const char *uri, const char *headers, u16_t headers_len) {
+    if (strcmp(uri, WEBSOCKET_URI) != 0) {
+        return false;
+    }
+
+    const char * key = lwip_strnstr(headers, WEBSOCKET_KEY_HEADER, headers_len);
+    if (key == NULL) {
+        return false;
+    }
+    key += strlen(WEBSOCKET_KEY_HEADER);
+    if (key + WEBSOCKET_KEY_LEN > headers + headers_len) {
+        return false;
+    }
+
+    // Find a free slot
+    websocket_client_t * client = NULL;
+    for (size_t idx = 0; idx < WEBSOCKET_MAX_CLIENTS; idx += 1) {
+        if (websocket_clients[idx].pcb == NULL) {
+            client = &websocket_clients[idx];
+            break;
+        }
+    }
+    if (client == NULL) {
+        return false;
+    }
+
+    // Sec-WebSocket-Accept = base64(sha1(key + GUID))
+    char accept_source[WEBSOCKET_KEY_LEN + sizeof(WEBSOCKET_GUID)];
+    memcpy(accept_source, key, WEBSOCKET_KEY_LEN);
+    memcpy(accept_source + WEBSOCKET_KEY_LEN, WEBSOCKET_GUID, sizeof(WEBSOCKET_GUID));
+
+    uint8_t digest[20];
+    _sha1((const uint8_t *) accept_source, strlen(accept_source), digest);
+
+    char accept[32];
+    _base64_encode(digest, sizeof(digest), accept);
+
+    char response[160];
+    int len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 101 Switching Protocols\r\n"
+                       "Upgrade: websocket\r\n"
+                       "Connection: Upgrade\r\n"
+                       "Sec-WebSocket-Accept: %s\r\n\r\n",
+                       accept);
+
+    if (altcp_write(pcb, response, len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+        return false;
+    }
+    altcp_output(pcb);
+
+    // Take over the connection
+    memset(client, 0, sizeof(websocket_client_t));
+    client->pcb = pcb;
+    client->rx_header_expected = 2;
+
+    altcp_nagle_disable(pcb);
+    altcp_arg(pcb, client);
+    altcp_recv(pcb, _websocket_recv);
+    altcp_sent(pcb, _websocket_sent);
+    altcp_poll(pcb, _websocket_poll, WEBSOCKET_POLL_INTERVAL);
+    altcp_err(pcb, _websocket_err);
+
+    return true;
+}
+
+
+uint8_t websocket_subscriber_count(websocket_topic_t topic) {
+    uint8_t count = 0;
+    for (size_t idx = 0; idx < WEBSOCKET_MAX_CLIENTS; idx += 1) {
+        if (websocket_clients[idx].pcb && (websocket_clients[idx].topics & topic)) {
+            count += 1;
+        }
+    }
+    return count;
+}
+
+
+void websocket_publish_charge_state() {
+    for (size_t idx = 0; idx < WEBSOCKET_MAX_CLIENTS; idx += 1) {
+        websocket_client_t * client = &websocket_clients[idx];
+        if (client->pcb && (client->topics & WS_TOPIC_CHARGE_STATE)) {
+            _send_charge_state(client);
+        }
+    }
+}
+
+
+// Send the delta since the client's frame, in as many messages as the send buffer takes
+static void _send_display(websocket_client_t * client) {
+    static uint8_t msg[WEBSOCKET_DISPLAY_MSG_SIZE];
+    msg[0] = WS_MSG_DISPLAY;
+
+    while (true) {
+        size_t len = display_mirror_encode(client->display_frame, client->display_next_tile, msg + 1, sizeof(msg) - 1);
+        if (len == 0 || !_send_frame(client, WS_OPCODE_BINARY, msg, len + 1)) {
+            // Up to date, or retried on the next publish
+            return;
+        }
+
+        uint32_t frame = msg[1] | (msg[2] << 8) | (msg[3] << 16) | ((uint32_t) msg[4] << 24);
+        uint16_t next_tile = msg[5] | (msg[6] << 8);
+
+        // The frame of the first part is the one the client has once all parts are sent
+        if (client->display_next_tile == 0) {
+            client->display_next_frame = frame;
+        }
+        client->display_next_tile = next_tile;
+        if (next_tile == 0) {
+            client->display_frame = client->display_next_frame;
+            return;
+        }
+    }
+}
+
+
+void websocket_publish_display() {
+    for (size_t idx = 0; idx < WEBSOCKET_MAX_CLIENTS; idx += 1) {
+        websocket_client_t * client = &websocket_clients[idx];
+        if (client->pcb && (client->topics & WS_TOPIC_DISPLAY)) {
+            _send_display(client);
+        }
+    }
+}
+
+
+void websocket_publish_error(uint16_t code, uint32_t time_ms, uint32_t context) {
+    websocket_error_msg_t msg = {
+        .msg_id = WS_MSG_ERROR,
+        .code = code,
+        .time_ms = time_ms,
+        .context = context,
+    };
+
+    for (size_t idx = 0; idx < WEBSOCKET_MAX_CLIENTS; idx += 1) {
+        websocket_client_t * client = &websocket_clients[idx];
+        if (client->pcb && (client->topics & WS_TOPIC_ERRORS)) {
+            _send_frame(client, WS_OPCODE_BINARY, &msg, sizeof(msg));
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef WEBSOCKET_H_
+#define WEBSOCKET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/altcp.h"
+
+// WebSocket (RFC 6455) control and telemetry channel on ws://<ip>/ws
+//
+// The HTTP server hands the connection over on "Upgrade: websocket". Afterwards each client owns a
+// slot from a fixed pool, frames are parsed in place and answered from the stack, so no memory is
+// allocated per message.
+//
+// All messages are binary frames, little-endian. The first byte is the message ID (websocket_msg_t).
+//
+// Client -> OpenTrickler
+//   WS_MSG_SUBSCRIBE       u8 topics (websocket_topic_t bit mask, 0 to unsubscribe)
+//   WS_MSG_SET_TARGET      f32 target charge weight
+//   WS_MSG_CHARGE_CONTROL  u8 charge_mode_state_t (CHARGE_MODE_WAIT_FOR_ZERO to start, CHARGE_MODE_EXIT to stop)
+//   WS_MSG_BUTTON          u8 ButtonEncoderEvent_t
+//
+// OpenTrickler -> Client
+//   WS_MSG_ACK             u8 request message ID, u8 websocket_status_t
+//   WS_MSG_CHARGE_STATE    f32 current weight, f32 target weight, u8 charge_mode_state_t, u8 charge mode event
+//   WS_MSG_DISPLAY         Display mirror delta (see display_mirror.h), the full frame after subscribing
+//   WS_MSG_ERROR           u16 error code, u32 time since boot (ms), u32 context, see error.h
+
+#define WEBSOCKET_URI                   "/ws"
+#define WEBSOCKET_MAX_CLIENTS           2
+#define WEBSOCKET_MAX_PAYLOAD_LEN       16          // Longest client message, larger frames close the connection
+#define WEBSOCKET_DISPLAY_MSG_SIZE      1400        // Longest display delta message, fits one TCP segment
+
+
+typedef enum {
+    WS_MSG_SUBSCRIBE = 0x01,
+    WS_MSG_SET_TARGET = 0x02,
+    WS_MSG_CHARGE_CONTROL = 0x03,
+    WS_MSG_BUTTON = 0x04,
+
+    WS_MSG_ACK = 0x80,
+    WS_MSG_CHARGE_STATE = 0x81,
+    WS_MSG_DISPLAY = 0x82,
+    WS_MSG_ERROR = 0x83,
+} websocket_msg_t;
+
+
+typedef enum {
+    WS_TOPIC_CHARGE_STATE = (1 << 0),
+    WS_TOPIC_DISPLAY = (1 << 1),
+    WS_TOPIC_ERRORS = (1 << 2),
+} websocket_topic_t;
+
+
+typedef enum {
+    WS_STATUS_OK = 0,
+    WS_STATUS_UNKNOWN_MESSAGE = 1,
+    WS_STATUS_INVALID_ARGUMENT = 2,
+} websocket_status_t;
+
+
+typedef struct __attribute__((packed)) {
+    uint8_t msg_id;
+    float current_weight;
+    float target_weight;
+    uint8_t charge_mode_state;
+    uint8_t charge_mode_event;
+} websocket_charge_state_msg_t;
+
+
+typedef struct __attribute__((packed)) {
+    uint8_t msg_id;
+    uint16_t code;
+    uint32_t time_ms;
+    uint32_t context;
+} websocket_error_msg_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Take over an HTTP connection that requested a WebSocket upgrade. Called by the HTTP server with the
+ * request URI and the remaining request headers.
+ *
+ * Returns true if the handshake is sent and the pcb now belongs to the WebSocket client, false if the
+ * request is not a valid upgrade (the HTTP server keeps handling it).
+*/
+bool websocket_upgrade(struct altcp_pcb *pcb, const char *uri, const char *headers, u16_t headers_len);
+
+// Must be called with the lwIP lock held
+uint8_t websocket_subscriber_count(websocket_topic_t topic);
+void websocket_publish_charge_state(void);
+void websocket_publish_display(void);
+void websocket_publish_error(uint16_t code, uint32_t time_ms, uint32_t context);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // WEBSOCKET_H_
@@ -68,7 +68,7 @@
     #define TFT_TOUCH_IRQ_PIN   25  // Touch interrupt (active low)
 
     // SPI speeds
-    #define TFT_SPI_FREQ_HZ     (40 * 1000 * 1000)  // 40MHz for display
+    #define TFT_SPI_FREQ_HZ     (62500000)          // 62.5MHz (max for RP2040 SPI), capped per controller
     #define TFT_TOUCH_SPI_FREQ_HZ (2 * 1000 * 1000) // 2MHz for touch
 
     // Display-specific parameters
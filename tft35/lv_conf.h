@@ -18,8 +18,8 @@
 /* Color depth: 16 (RGB565) */
 #define LV_COLOR_DEPTH 16
 
-/* Swap the 2 bytes of RGB565 color for SPI displays */
-#define LV_COLOR_16_SWAP 1
+/* RGB565 is rendered in native byte order, the display driver sends it as 16-bit SPI frames (MSB first),
+ * so no byte swap is needed while rendering */
 
 /*====================
    MEMORY SETTINGS
@@ -246,7 +246,7 @@
 /* Widgets */
 #define LV_USE_ANIMIMG    0
 #define LV_USE_CALENDAR   0
-#define LV_USE_CHART      0
+#define LV_USE_CHART      1
 #define LV_USE_COLORWHEEL 0
 #define LV_USE_IMGBTN     0
 #define LV_USE_KEYBOARD   1
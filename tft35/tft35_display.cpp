@@ -7,10 +7,17 @@
 
 #include "tft35_display.h"
 #include "configuration.h"
+#include "display_mirror.h"
+#include "metrics.h"
+#include "deferred_log.h"
+#include "error.h"
 #include "pico/stdlib.h"
 #include "hardware/spi.h"
 #include "hardware/dma.h"
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "tft35_rgb666.pio.h"
 #include "lvgl.h"
 #include "FreeRTOS.h"
 #include "semphr.h"
@@ -26,8 +33,25 @@
 #define TFT35_RST_PIN       21
 #endif
 
-// SPI clock speed
+// SPI clock speed, the board limit
+#ifndef TFT35_SPI_FREQ_HZ
 #define TFT35_SPI_FREQ_HZ   (40 * 1000 * 1000)  // 40MHz for display
+#endif
+
+// Write clock per controller, capped by TFT35_SPI_FREQ_HZ. The ST7796 serial write cycle is 15 ns
+// (66MHz). The ILI9488 is specified much slower but is commonly driven at 40MHz.
+#ifndef TFT35_ST7796_FREQ_HZ
+#define TFT35_ST7796_FREQ_HZ    (66 * 1000 * 1000)
+#endif
+#ifndef TFT35_ILI9488_FREQ_HZ
+#define TFT35_ILI9488_FREQ_HZ   (40 * 1000 * 1000)
+#endif
+
+// Read clock, used for the controller detection (the read cycle is 150 ns or slower on both)
+#define TFT35_READ_FREQ_HZ  (6 * 1000 * 1000)
+
+// DMA completion interrupt, shared with other users of the DMA IRQ
+#define TFT35_DMA_IRQ       DMA_IRQ_1
 
 // Display commands (common to ST7796 and ILI9488)
 #define CMD_NOP             0x00
@@ -58,7 +82,26 @@ static tft35_controller_t detected_controller = TFT35_CONTROLLER_UNKNOWN;
 static tft35_rotation_t current_rotation = TFT35_ROTATION_0;
 static lv_display_t *lvgl_display = NULL;
 static int dma_channel = -1;
-static SemaphoreHandle_t spi_mutex = NULL;
+
+// SPI bus lock, shared with the touch controller. A binary semaphore rather than a mutex, as it is
+// released by the DMA completion interrupt at the end of a flush.
+static SemaphoreHandle_t spi_bus = NULL;
+static StaticSemaphore_t spi_bus_buffer;
+
+// Pixel transport, selected for the detected controller
+typedef enum {
+    PIXEL_TRANSPORT_SPI16 = 0,      // RGB565 as 16-bit SPI frames
+    PIXEL_TRANSPORT_PIO_RGB666,     // RGB565 expanded to RGB666 by a PIO state machine (ILI9488)
+} pixel_transport_t;
+
+static pixel_transport_t pixel_transport = PIXEL_TRANSPORT_SPI16;
+static PIO rgb666_pio = NULL;
+static uint rgb666_sm = 0;
+
+// Flush in progress, completed by the DMA interrupt
+static lv_display_t *flush_display = NULL;
+static bool flush_last = false;
+static uint32_t frame_start_us = 0;
 
 // Forward declarations
 static void write_cmd(uint8_t cmd);
@@ -67,6 +110,9 @@ static void write_data_byte(uint8_t data);
 static void init_st7796(void);
 static void init_ili9488(void);
 static uint32_t read_display_id(void);
+static void dma_irq_handler(void);
+static bool rgb666_init(uint32_t freq);
+static void fill_pixels(uint16_t colour, uint32_t len);
 
 // CS control
 static inline void cs_select(void) {
@@ -210,9 +256,14 @@ static void init_ili9488(void) {
     write_cmd(CMD_SLPOUT);
     sleep_ms(120);
 
-    // Interface Pixel Format - 16bit/pixel for SPI
+    // Interface Pixel Format - 18bit/pixel when the PIO transport is available (the only format
+    // the ILI9488 supports on SPI besides 3bit/pixel), 16bit/pixel otherwise
     write_cmd(CMD_COLMOD);
-    write_data_byte(0x55);  // RGB565
+    if (pixel_transport == PIXEL_TRANSPORT_PIO_RGB666) {
+        write_data_byte(0x66);  // RGB666
+    } else {
+        write_data_byte(0x55);  // RGB565
+    }
 
     // Memory Access Control
     write_cmd(CMD_MADCTL);
@@ -278,11 +329,12 @@ static void init_ili9488(void) {
 
 // Initialize display
 void tft35_display_init(void) {
-    // Create mutex for SPI access
-    spi_mutex = xSemaphoreCreateMutex();
+    // Create the SPI bus lock, initially free
+    spi_bus = xSemaphoreCreateBinaryStatic(&spi_bus_buffer);
+    xSemaphoreGive(spi_bus);
 
-    // Initialize SPI
-    spi_init(TFT35_SPI, TFT35_SPI_FREQ_HZ);
+    // Initialize SPI, at the read clock until the controller is known
+    spi_init(TFT35_SPI, TFT35_READ_FREQ_HZ);
     gpio_set_function(TFT35_SCK_PIN, GPIO_FUNC_SPI);
     gpio_set_function(TFT35_MOSI_PIN, GPIO_FUNC_SPI);
     gpio_set_function(TFT35_MISO_PIN, GPIO_FUNC_SPI);
@@ -309,26 +361,52 @@ void tft35_display_init(void) {
     uint32_t id = read_display_id();
 
     // ST7796 typically returns 0x7796XX, ILI9488 returns 0x9488XX
-    if ((id >> 8) == 0x7796 || (id >> 16) == 0x77) {
-        detected_controller = TFT35_CONTROLLER_ST7796;
-        init_st7796();
-    } else if ((id >> 8) == 0x9488 || (id >> 16) == 0x94) {
+    uint32_t freq = TFT35_SPI_FREQ_HZ;
+    if ((id >> 8) == 0x9488 || (id >> 16) == 0x94) {
         detected_controller = TFT35_CONTROLLER_ILI9488;
+        if (freq > TFT35_ILI9488_FREQ_HZ) {
+            freq = TFT35_ILI9488_FREQ_HZ;
+        }
+        spi_set_baudrate(TFT35_SPI, freq);
+        rgb666_init(freq);  // Falls back to RGB565 over SPI
         init_ili9488();
     } else {
         // Default to ST7796 if detection fails
         detected_controller = TFT35_CONTROLLER_ST7796;
+        if (freq > TFT35_ST7796_FREQ_HZ) {
+            freq = TFT35_ST7796_FREQ_HZ;
+        }
+        spi_set_baudrate(TFT35_SPI, freq);
         init_st7796();
     }
 
-    // Initialize DMA channel for fast transfers
+    // Initialize DMA channel for fast transfers, one RGB565 pixel per transfer
     dma_channel = dma_claim_unused_channel(true);
     dma_channel_config c = dma_channel_get_default_config(dma_channel);
-    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
-    channel_config_set_dreq(&c, spi_get_dreq(TFT35_SPI, true));
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
     channel_config_set_read_increment(&c, true);
     channel_config_set_write_increment(&c, false);
-    dma_channel_configure(dma_channel, &c, &spi_get_hw(TFT35_SPI)->dr, NULL, 0, false);
+    if (pixel_transport == PIXEL_TRANSPORT_PIO_RGB666) {
+        channel_config_set_dreq(&c, pio_get_dreq(rgb666_pio, rgb666_sm, true));
+        dma_channel_configure(dma_channel, &c, &rgb666_pio->txf[rgb666_sm], NULL, 0, false);
+    } else {
+        channel_config_set_dreq(&c, spi_get_dreq(TFT35_SPI, true));
+        dma_channel_configure(dma_channel, &c, &spi_get_hw(TFT35_SPI)->dr, NULL, 0, false);
+    }
+
+    // Completion interrupt, ends the flush
+    dma_channel_set_irq1_enabled(dma_channel, true);
+    irq_add_shared_handler(TFT35_DMA_IRQ, dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(TFT35_DMA_IRQ, true);
+
+    // Clear the screen, timed as the full screen refresh benchmark
+    uint32_t start_us = time_us_32();
+    tft35_display_set_window(0, 0, TFT35_DISPLAY_WIDTH - 1, TFT35_DISPLAY_HEIGHT - 1);
+    fill_pixels(0x0000, TFT35_DISPLAY_WIDTH * TFT35_DISPLAY_HEIGHT);
+    DLOG3(TFT_FULL_REFRESH,
+          DLOG_S(detected_controller == TFT35_CONTROLLER_ILI9488 ? "ILI9488" : "ST7796"),
+          spi_get_baudrate(TFT35_SPI) / 1000,
+          time_us_32() - start_us);
 }
 
 // Get detected controller
@@ -355,8 +433,13 @@ void tft35_display_set_rotation(tft35_rotation_t rotation) {
             break;
     }
 
+    // Not in the middle of a flush
+    bool locked = tft35_display_bus_acquire(100);
     write_cmd(CMD_MADCTL);
     write_data_byte(madctl);
+    if (locked) {
+        tft35_display_bus_release();
+    }
     current_rotation = rotation;
 }
 
@@ -389,24 +472,153 @@ void tft35_display_set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1
     write_cmd(CMD_RAMWR);
 }
 
-// Write pixels using DMA
-void tft35_display_write_pixels(const uint16_t *data, uint32_t len) {
+// Start sending len pixels to the current window. The DMA reads RGB565 as half words, the SPI sends
+// them as 16-bit frames (MSB first, so in the controller byte order without a swap) or the PIO
+// expands them to RGB666.
+static void pixels_start(const void *data, uint32_t len) {
     dc_data();
     cs_select();
 
-    // Use DMA for large transfers
-    if (len > 32 && dma_channel >= 0) {
-        dma_channel_set_read_addr(dma_channel, data, false);
-        dma_channel_set_trans_count(dma_channel, len * 2, true);  // 2 bytes per pixel
-        dma_channel_wait_for_finish_blocking(dma_channel);
+    if (pixel_transport == PIXEL_TRANSPORT_PIO_RGB666) {
+        gpio_set_function(TFT35_SCK_PIN, pio_get_funcsel(rgb666_pio));
+        gpio_set_function(TFT35_MOSI_PIN, pio_get_funcsel(rgb666_pio));
+    } else {
+        spi_set_format(TFT35_SPI, 16, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    }
+
+    dma_channel_transfer_from_buffer_now(dma_channel, data, len);
+}
+
+// Wait for the last pixel to leave and return the bus to 8-bit SPI. The SPI receive FIFO is drained so
+// the next read (e.g., touch) starts clean.
+static void pixels_finish(void) {
+    if (pixel_transport == PIXEL_TRANSPORT_PIO_RGB666) {
+        uint32_t stall_mask = 1u << (PIO_FDEBUG_TXSTALL_LSB + rgb666_sm);
+        rgb666_pio->fdebug = stall_mask;
+        while (!(rgb666_pio->fdebug & stall_mask)) {
+            tight_loop_contents();
+        }
+        gpio_set_function(TFT35_SCK_PIN, GPIO_FUNC_SPI);
+        gpio_set_function(TFT35_MOSI_PIN, GPIO_FUNC_SPI);
     } else {
-        spi_write_blocking(TFT35_SPI, (const uint8_t *)data, len * 2);
+        while (spi_is_busy(TFT35_SPI)) {
+            tight_loop_contents();
+        }
+        while (spi_is_readable(TFT35_SPI)) {
+            (void) spi_get_hw(TFT35_SPI)->dr;
+        }
+        spi_get_hw(TFT35_SPI)->icr = SPI_SSPICR_RORIC_BITS;
+        spi_set_format(TFT35_SPI, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
     }
+}
+
+// Write pixels using DMA
+void tft35_display_write_pixels(const uint16_t *data, uint32_t len) {
+    pixels_start(data, len);
+    dma_channel_wait_for_finish_blocking(dma_channel);
+    pixels_finish();
 
     cs_deselect();
 }
 
+// Fill the current window with one colour, the DMA reads the same pixel len times
+static void fill_pixels(uint16_t colour, uint32_t len) {
+    static uint16_t fill_colour;
+    fill_colour = colour;
+
+    dma_channel_config c = dma_get_channel_config(dma_channel);
+    channel_config_set_read_increment(&c, false);
+    dma_channel_set_config(dma_channel, &c, false);
+
+    tft35_display_write_pixels(&fill_colour, len);
+
+    channel_config_set_read_increment(&c, true);
+    dma_channel_set_config(dma_channel, &c, false);
+}
+
+// Set up the RGB666 transport for the ILI9488, false if no PIO state machine is free
+static bool rgb666_init(uint32_t freq) {
+    uint offset;
+    uint pin_base = TFT35_SCK_PIN < TFT35_MOSI_PIN ? TFT35_SCK_PIN : TFT35_MOSI_PIN;
+    uint pin_count = (TFT35_SCK_PIN < TFT35_MOSI_PIN ? TFT35_MOSI_PIN : TFT35_SCK_PIN) - pin_base + 1;
+
+    if (!pio_claim_free_sm_and_add_program_for_gpio_range(&tft35_rgb666_program, &rgb666_pio, &rgb666_sm, &offset,
+                                                          pin_base, pin_count, true)) {
+        return false;
+    }
+
+    tft35_rgb666_program_init(rgb666_pio, rgb666_sm, offset, TFT35_SCK_PIN, TFT35_MOSI_PIN, freq);
+    pixel_transport = PIXEL_TRANSPORT_PIO_RGB666;
+    return true;
+}
+
+// End of a flush: deselect and hand the buffer back to LVGL. flush_display has been cleared by the caller.
+static void flush_complete(lv_display_t *display) {
+    cs_deselect();
+
+    if (flush_last) {
+        metrics_record_display_frame(time_us_32() - frame_start_us);
+    }
+
+    lv_display_flush_ready(display);
+}
+
+// DMA completion, the last pixels may still be in the SPI or PIO FIFO
+static void dma_irq_handler(void) {
+    if (!dma_channel_get_irq1_status(dma_channel)) {
+        return;
+    }
+    dma_channel_acknowledge_irq1(dma_channel);
+
+    // Blocking transfer from tft35_display_write_pixels()
+    lv_display_t *display = flush_display;
+    if (display == NULL) {
+        return;
+    }
+    flush_display = NULL;
+
+    pixels_finish();
+    flush_complete(display);
+
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    xSemaphoreGiveFromISR(spi_bus, &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+// Start of a refresh, for the frame time
+static void refresh_start_cb(lv_event_t *e) {
+    (void) e;
+    frame_start_us = time_us_32();
+}
+
+// Areas dropped because the bus was not free, redrawn on the next LVGL timer run. Only touched by the
+// LVGL task.
+static lv_area_t dropped_area;
+static bool dropped_pending = false;
+
+// LVGL refuses invalidations while it renders, so this runs from lv_async_call() after the refresh
+static void redraw_dropped_cb(void *disp) {
+    dropped_pending = false;
+    lv_inv_area((lv_display_t *)disp, &dropped_area);
+}
+
+static void drop_area(lv_display_t *display, const lv_area_t *area) {
+    if (dropped_pending) {
+        dropped_area.x1 = LV_MIN(dropped_area.x1, area->x1);
+        dropped_area.y1 = LV_MIN(dropped_area.y1, area->y1);
+        dropped_area.x2 = LV_MAX(dropped_area.x2, area->x2);
+        dropped_area.y2 = LV_MAX(dropped_area.y2, area->y2);
+        return;
+    }
+
+    dropped_area = *area;
+    dropped_pending = lv_async_call(redraw_dropped_cb, display) == LV_RESULT_OK;
+}
+
 // LVGL flush callback
+//
+// The pixels are sent by DMA and the flush is completed by the DMA interrupt, so LVGL renders the next
+// band into the other buffer while this one is sent.
 void tft35_display_flush_cb(void *disp, const void *area, uint8_t *color_map) {
     lv_display_t *display = (lv_display_t *)disp;
     const lv_area_t *a = (const lv_area_t *)area;
@@ -417,14 +629,76 @@ void tft35_display_flush_cb(void *disp, const void *area, uint8_t *color_map) {
     uint16_t y2 = a->y2;
 
     uint32_t size = (x2 - x1 + 1) * (y2 - y1 + 1);
+    bool last = lv_display_flush_is_last(display);
+
+    if (xSemaphoreTake(spi_bus, pdMS_TO_TICKS(100)) != pdTRUE) {
+        // Not sent, the band is drawn again instead of leaving stale pixels on the screen
+        report_error_context(ERR_DISPLAY_BUS_TIMEOUT, ((uint32_t) y1 << 16) | y2);
+        drop_area(display, a);
+        lv_display_flush_ready(display);
+        return;
+    }
+
+    tft35_display_set_window(x1, y1, x2, y2);
+    metrics_record_display_transfer(size * (pixel_transport == PIXEL_TRANSPORT_PIO_RGB666 ? 3 : 2));
 
-    if (xSemaphoreTake(spi_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        tft35_display_set_window(x1, y1, x2, y2);
-        tft35_display_write_pixels((const uint16_t *)color_map, size);
-        xSemaphoreGive(spi_mutex);
+    flush_display = display;
+    flush_last = last;
+    pixels_start(color_map, size);
+
+    // Sample the area for the remote display mirror while it is sent, LVGL does not touch the buffer
+    // until the flush is complete
+    display_mirror_capture_area(x1, y1, x2, y2, (const uint16_t *)color_map, last);
+}
+
+// Called by LVGL before it renders into a buffer that is still being sent, or at the end of a refresh.
+// Never returns while the DMA still reads the buffer.
+void tft35_display_flush_wait_cb(void *disp) {
+    (void) disp;
+    bool reported = false;
+
+    // Free once the DMA interrupt has released the bus
+    while (xSemaphoreTake(spi_bus, pdMS_TO_TICKS(100)) != pdTRUE) {
+        // The bus may also be held by the touch controller, only a flush is waited for here
+        uint32_t irq_state = save_and_disable_interrupts();
+        lv_display_t *display = flush_display;
+        bool flushing = display != NULL;
+        bool lost = flushing && !dma_channel_is_busy(dma_channel);
+        if (lost) {
+            // Take the flush over, the interrupt handler leaves it alone from now on
+            flush_display = NULL;
+        }
+        restore_interrupts(irq_state);
+
+        if (flushing && !reported) {
+            report_error_context(ERR_DISPLAY_FLUSH_TIMEOUT, lost);
+            reported = true;
+        }
+
+        if (lost) {
+            // The transfer has ended without its interrupt, complete it here. The bus is ours then.
+            pixels_finish();
+            flush_complete(display);
+            break;
+        }
     }
 
-    lv_display_flush_ready(display);
+    xSemaphoreGive(spi_bus);
+}
+
+// Register the frame time measurement
+void tft35_display_attach(void *disp) {
+    lvgl_display = (lv_display_t *)disp;
+    lv_display_add_event_cb(lvgl_display, refresh_start_cb, LV_EVENT_REFR_START, NULL);
+}
+
+// Exclusive access to the SPI bus, e.g., for the touch controller
+bool tft35_display_bus_acquire(uint32_t timeout_ms) {
+    return xSemaphoreTake(spi_bus, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
+}
+
+void tft35_display_bus_release(void) {
+    xSemaphoreGive(spi_bus);
 }
 
 // Signal flush complete
@@ -3,7 +3,8 @@
  * @brief TFT35 Display Driver for ST7796/ILI9488
  *
  * Supports both ST7796 and ILI9488 controllers with runtime auto-detection.
- * Uses SPI interface with DMA for efficient framebuffer transfers.
+ * Uses SPI interface with DMA for efficient framebuffer transfers: RGB565 is sent as 16-bit SPI
+ * frames, or expanded to RGB666 by a PIO state machine for the ILI9488.
  */
 
 #ifndef TFT35_DISPLAY_H
@@ -49,9 +50,20 @@ void tft35_display_set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1
 // Write pixel data to the current window
 void tft35_display_write_pixels(const uint16_t *data, uint32_t len);
 
-// LVGL flush callback - registered with LVGL display driver
+// LVGL flush callback - registered with LVGL display driver. Returns with the DMA
+// transfer running, the flush is completed from the DMA interrupt.
 void tft35_display_flush_cb(void *disp, const void *area, uint8_t *color_map);
 
+// LVGL flush wait callback - blocks until the running transfer is complete
+void tft35_display_flush_wait_cb(void *disp);
+
+// Attach the LVGL display, for the frame time measurement
+void tft35_display_attach(void *disp);
+
+// Exclusive access to the shared SPI bus (display and touch controller)
+bool tft35_display_bus_acquire(uint32_t timeout_ms);
+void tft35_display_bus_release(void);
+
 // Signal that flush is complete (called after DMA transfer)
 void tft35_display_flush_ready(void);
 
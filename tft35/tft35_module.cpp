@@ -9,6 +9,10 @@
 #include "configuration.h"
 #include "eeprom.h"
 #include "display_config.h"
+#include "display_mirror.h"
+#include "metrics.h"
+#include "ui_events.h"
+#include "lvgl_port.h"
 #include "mini_12864_module.h"  // For encoder_event_queue and ButtonEncoderEvent_t
 #include "pico/stdlib.h"
 #include "FreeRTOS.h"
@@ -30,6 +34,7 @@ static lv_display_t *display = NULL;
 static lv_indev_t *touch_indev = NULL;
 static lv_indev_t *encoder_indev = NULL;
 static TimerHandle_t lvgl_tick_timer = NULL;
+static StaticTimer_t lvgl_tick_timer_buffer;
 
 // External encoder queue (initialized by button_init in mini_12864_module.cpp)
 extern QueueHandle_t encoder_event_queue;
@@ -125,9 +130,14 @@ void tft35_module_init(void) {
     // Create LVGL display
     display = lv_display_create(TFT35_DISPLAY_WIDTH, TFT35_DISPLAY_HEIGHT);
     lv_display_set_flush_cb(display, (lv_display_flush_cb_t)tft35_display_flush_cb);
+    lv_display_set_flush_wait_cb(display, (lv_display_flush_wait_cb_t)tft35_display_flush_wait_cb);
+    tft35_display_attach(display);
     lv_display_set_buffers(display, lvgl_buf1, lvgl_buf2, sizeof(lvgl_buf1),
                            LV_DISPLAY_RENDER_MODE_PARTIAL);
 
+    // Remote display mirror, fed by the flush callback
+    display_mirror_init_rgb565(TFT35_DISPLAY_WIDTH, TFT35_DISPLAY_HEIGHT);
+
     // Create LVGL touch input device
     touch_indev = lv_indev_create();
     lv_indev_set_type(touch_indev, LV_INDEV_TYPE_POINTER);
@@ -139,12 +149,13 @@ void tft35_module_init(void) {
     lv_indev_set_read_cb(encoder_indev, encoder_read_cb);
 
     // Create LVGL tick timer (1ms period)
-    lvgl_tick_timer = xTimerCreate(
+    lvgl_tick_timer = xTimerCreateStatic(
         "LVGL Tick",
         pdMS_TO_TICKS(1),
         pdTRUE,     // Auto-reload
         NULL,
-        lvgl_tick_callback
+        lvgl_tick_callback,
+        &lvgl_tick_timer_buffer
     );
     xTimerStart(lvgl_tick_timer, 0);
 }
@@ -201,15 +212,17 @@ void tft35_touch_calibrate(void) {
 void tft35_lvgl_task(void *p) {
     (void)p;
 
-    // Import UI screens (declared in lvgl_ui headers)
-    extern void ui_init(void);
+    ui_events_init();
     ui_init();
 
     while (true) {
-        // Let LVGL handle timers and rendering
+        // Let LVGL handle timers and rendering. The time spent here against the period gives the CPU
+        // load of the UI, transfers overlap rendering and are not included.
+        uint32_t start_us = time_us_32();
         uint32_t time_till_next = lv_timer_handler();
+        metrics_record_display_render(time_us_32() - start_us);
 
-        // Limit minimum delay to prevent CPU hogging
+        // Limit minimum delay to prevent CPU hogging, the encoder and touch are still polled by LVGL
         if (time_till_next < 5) {
             time_till_next = 5;
         }
@@ -217,6 +230,13 @@ void tft35_lvgl_task(void *p) {
             time_till_next = 50;
         }
 
-        vTaskDelay(pdMS_TO_TICKS(time_till_next));
+        // Sleep until an event arrives or the next LVGL timer is due, then apply every pending event
+        // before rendering
+        ui_event_t event;
+        if (ui_events_receive(&event, pdMS_TO_TICKS(time_till_next))) {
+            do {
+                ui_handle_event(&event);
+            } while (ui_events_receive(&event, 0));
+        }
     }
 }
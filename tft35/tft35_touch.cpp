@@ -4,13 +4,17 @@
  */
 
 #include "tft35_touch.h"
+#include "tft35_display.h"
 #include "configuration.h"
 #include "pico/stdlib.h"
 #include "hardware/spi.h"
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
 #include "lvgl.h"
 #include "FreeRTOS.h"
-#include "semphr.h"
+#include "task.h"
+#include "queue.h"
+#include "error.h"
 
 // Touch controller pins (from config)
 #ifndef TFT35_TOUCH_CS_PIN
@@ -23,7 +27,19 @@
 #endif
 
 // XPT2046 SPI speed (max 2.5MHz)
+#ifdef TFT35_TOUCH_SPI_FREQ_HZ
+#define TOUCH_SPI_FREQ_HZ       TFT35_TOUCH_SPI_FREQ_HZ
+#else
 #define TOUCH_SPI_FREQ_HZ       (2 * 1000 * 1000)
+#endif
+
+// Sampling while the panel is pressed, the pen down interrupt starts it
+#define TOUCH_SAMPLE_PERIOD_MS  10
+#define TOUCH_BUS_TIMEOUT_MS    20      // Longer than a band flush
+#define TOUCH_QUEUE_LENGTH      8
+#define TOUCH_TASK_STACK_SIZE   512     // Words
+#define TOUCH_SAMPLES           4       // X/Y conversions per point
+#define TOUCH_MAX_SPREAD        64      // Raw ADC, a point with noisier samples is dropped
 
 // XPT2046 commands
 #define XPT2046_CMD_X           0xD0    // X position
@@ -53,36 +69,193 @@ static int16_t cal_y_min = CAL_Y_MIN_DEFAULT;
 static int16_t cal_y_max = CAL_Y_MAX_DEFAULT;
 static bool cal_invert_x = false;
 static bool cal_invert_y = false;
-static SemaphoreHandle_t touch_mutex = NULL;
-static uint32_t original_spi_freq = 0;
 
-// Save and restore SPI frequency for touch (slower than display)
+// Filtered points for LVGL, written by the touch task
+static QueueHandle_t touch_queue = NULL;
+static StaticQueue_t touch_queue_buffer;
+static uint8_t touch_queue_storage[TOUCH_QUEUE_LENGTH * sizeof(tft35_touch_point_t)];
+static TaskHandle_t touch_task_handle = NULL;
+static StackType_t touch_task_stack[TOUCH_TASK_STACK_SIZE];
+static StaticTask_t touch_task_buffer;
+static tft35_touch_point_t last_point = {0, 0, false};
+
+// Clock divider registers of the display and the touch, swapped without recomputing the baud rate
+static uint32_t display_cpsr, display_scr;
+static uint32_t touch_cpsr, touch_scr;
+
+// Conversion sequence with 16 clocks per conversion: each command is sent while the previous result is
+// clocked out. Z1, Z2, then X/Y pairs, the last command powers down and enables the pen interrupt.
+static const uint8_t touch_commands[] = {
+    XPT2046_CMD_Z1, 0,
+    XPT2046_CMD_Z2, 0,
+    XPT2046_CMD_X, 0, XPT2046_CMD_Y, 0,
+    XPT2046_CMD_X, 0, XPT2046_CMD_Y, 0,
+    XPT2046_CMD_X, 0, XPT2046_CMD_Y, 0,
+    XPT2046_CMD_X, 0, XPT2046_CMD_Y, 0,
+    0,
+};
+
+static void calibrate(int16_t raw_x, int16_t raw_y, tft35_touch_point_t *point);
+
+typedef enum {
+    TOUCH_SAMPLE_RELEASED = 0,
+    TOUCH_SAMPLE_PRESSED,
+    TOUCH_SAMPLE_SKIPPED,       // Bus busy or noisy conversions, try again
+} touch_sample_t;
+
+static uint32_t read_scr(void) {
+    return (spi_get_hw(TFT35_SPI)->cr0 & SPI_SSPCR0_SCR_BITS) >> SPI_SSPCR0_SCR_LSB;
+}
+
+static void write_divider(uint32_t cpsr, uint32_t scr) {
+    spi_get_hw(TFT35_SPI)->cpsr = cpsr;
+    hw_write_masked(&spi_get_hw(TFT35_SPI)->cr0, scr << SPI_SSPCR0_SCR_LSB, SPI_SSPCR0_SCR_BITS);
+}
+
+// Called with the bus held, the display clock is restored by touch_spi_end()
 static void touch_spi_begin(void) {
-    original_spi_freq = spi_get_baudrate(TFT35_SPI);
-    spi_set_baudrate(TFT35_SPI, TOUCH_SPI_FREQ_HZ);
+    write_divider(touch_cpsr, touch_scr);
     gpio_put(TFT35_TOUCH_CS_PIN, 0);
 }
 
 static void touch_spi_end(void) {
     gpio_put(TFT35_TOUCH_CS_PIN, 1);
-    spi_set_baudrate(TFT35_SPI, original_spi_freq);
+    write_divider(display_cpsr, display_scr);
+}
+
+// XPT2046 returns 12-bit value in bits 14:3 of the two bytes after its command
+static uint16_t conversion(const uint8_t *rx, uint8_t command_idx) {
+    return ((rx[command_idx * 2 + 1] << 8) | rx[command_idx * 2 + 2]) >> 3;
 }
 
-// Read a channel from XPT2046
-static uint16_t read_channel(uint8_t cmd) {
-    uint8_t tx[3] = {cmd, 0, 0};
-    uint8_t rx[3] = {0};
+// Average of the middle two of TOUCH_SAMPLES conversions, false if they spread too far
+static bool filter_samples(uint16_t *samples, int16_t *value) {
+    for (uint8_t i = 1; i < TOUCH_SAMPLES; i++) {
+        uint16_t sample = samples[i];
+        uint8_t j = i;
+        while (j > 0 && samples[j - 1] > sample) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = sample;
+    }
 
-    spi_write_read_blocking(TFT35_SPI, tx, rx, 3);
+    if (samples[TOUCH_SAMPLES - 1] - samples[0] > TOUCH_MAX_SPREAD) {
+        return false;
+    }
 
-    // XPT2046 returns 12-bit value in bits 11:0 of response
-    return ((rx[1] << 8) | rx[2]) >> 3;
+    *value = (samples[TOUCH_SAMPLES / 2 - 1] + samples[TOUCH_SAMPLES / 2]) / 2;
+    return true;
+}
+
+// Run the conversion sequence once, waits for a running flush to complete rather than stalling it
+static touch_sample_t touch_sample(int16_t *raw_x, int16_t *raw_y) {
+    uint8_t rx[sizeof(touch_commands)];
+
+    if (!tft35_display_bus_acquire(TOUCH_BUS_TIMEOUT_MS)) {
+        return TOUCH_SAMPLE_SKIPPED;
+    }
+
+    touch_spi_begin();
+    spi_write_read_blocking(TFT35_SPI, touch_commands, rx, sizeof(touch_commands));
+    touch_spi_end();
+    tft35_display_bus_release();
+
+    // Calculate pressure (simplified formula)
+    uint16_t z1 = conversion(rx, 0);
+    uint16_t z2 = conversion(rx, 1);
+    int32_t pressure = z1;
+    if (z2 > z1) {
+        pressure = 4095 - (z2 - z1);
+    }
+
+    if (pressure <= TOUCH_PRESSURE_MIN || pressure >= TOUCH_PRESSURE_MAX) {
+        return TOUCH_SAMPLE_RELEASED;
+    }
+
+    uint16_t x_samples[TOUCH_SAMPLES];
+    uint16_t y_samples[TOUCH_SAMPLES];
+    for (uint8_t i = 0; i < TOUCH_SAMPLES; i++) {
+        x_samples[i] = conversion(rx, 2 + i * 2);
+        y_samples[i] = conversion(rx, 3 + i * 2);
+    }
+
+    if (!filter_samples(x_samples, raw_x) || !filter_samples(y_samples, raw_y)) {
+        return TOUCH_SAMPLE_SKIPPED;
+    }
+
+    return TOUCH_SAMPLE_PRESSED;
+}
+
+// Pen down, the interrupt stays off until the touch task has seen the pen lift
+static void touch_irq_handler(void) {
+    if (!(gpio_get_irq_event_mask(TFT35_TOUCH_IRQ_PIN) & GPIO_IRQ_EDGE_FALL)) {
+        return;
+    }
+    gpio_set_irq_enabled(TFT35_TOUCH_IRQ_PIN, GPIO_IRQ_EDGE_FALL, false);
+    gpio_acknowledge_irq(TFT35_TOUCH_IRQ_PIN, GPIO_IRQ_EDGE_FALL);
+
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(touch_task_handle, &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+// Queue a point for LVGL, the oldest is dropped if LVGL has not kept up
+static void touch_queue_point(const tft35_touch_point_t *point) {
+    if (xQueueSend(touch_queue, point, 0) != pdTRUE) {
+        tft35_touch_point_t dropped;
+        xQueueReceive(touch_queue, &dropped, 0);
+        xQueueSend(touch_queue, point, 0);
+    }
+}
+
+// Samples the panel from pen down to pen up, nothing is read while it is not touched
+static void touch_task(void *p) {
+    (void)p;
+
+    // The GPIO interrupt enables are per core. The task is pinned, so the handler, the enables here and the
+    // re-arm below are all on the same core.
+    gpio_add_raw_irq_handler(TFT35_TOUCH_IRQ_PIN, touch_irq_handler);
+    gpio_acknowledge_irq(TFT35_TOUCH_IRQ_PIN, GPIO_IRQ_EDGE_FALL);
+    gpio_set_irq_enabled(TFT35_TOUCH_IRQ_PIN, GPIO_IRQ_EDGE_FALL, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        tft35_touch_point_t point = {0, 0, false};
+        TickType_t last_sample_tick = xTaskGetTickCount();
+
+        while (true) {
+            int16_t raw_x, raw_y;
+            touch_sample_t sample = tft35_touch_irq_active() ? touch_sample(&raw_x, &raw_y) : TOUCH_SAMPLE_RELEASED;
+            if (sample == TOUCH_SAMPLE_RELEASED) {
+                break;
+            }
+            if (sample == TOUCH_SAMPLE_PRESSED) {
+                calibrate(raw_x, raw_y, &point);
+                touch_queue_point(&point);
+            }
+            vTaskDelayUntil(&last_sample_tick, pdMS_TO_TICKS(TOUCH_SAMPLE_PERIOD_MS));
+        }
+
+        // Released where it was last pressed
+        if (point.pressed) {
+            point.pressed = false;
+            touch_queue_point(&point);
+        }
+
+        // Re-arm, a pen down since the last sample has no edge left to trigger on
+        gpio_acknowledge_irq(TFT35_TOUCH_IRQ_PIN, GPIO_IRQ_EDGE_FALL);
+        gpio_set_irq_enabled(TFT35_TOUCH_IRQ_PIN, GPIO_IRQ_EDGE_FALL, true);
+        if (tft35_touch_irq_active()) {
+            xTaskNotifyGive(touch_task_handle);
+        }
+    }
 }
 
 // Initialize touch controller
 void tft35_touch_init(void) {
-    touch_mutex = xSemaphoreCreateMutex();
-
     // Touch CS pin
     gpio_init(TFT35_TOUCH_CS_PIN);
     gpio_set_dir(TFT35_TOUCH_CS_PIN, GPIO_OUT);
@@ -93,10 +266,33 @@ void tft35_touch_init(void) {
     gpio_set_dir(TFT35_TOUCH_IRQ_PIN, GPIO_IN);
     gpio_pull_up(TFT35_TOUCH_IRQ_PIN);
 
-    // Perform a dummy read to initialize
-    touch_spi_begin();
-    read_channel(XPT2046_CMD_X);
-    touch_spi_end();
+    // Keep both clock dividers, the display clock is set by now
+    display_cpsr = spi_get_hw(TFT35_SPI)->cpsr;
+    display_scr = read_scr();
+    uint32_t display_freq = spi_get_baudrate(TFT35_SPI);
+    spi_set_baudrate(TFT35_SPI, TOUCH_SPI_FREQ_HZ);
+    touch_cpsr = spi_get_hw(TFT35_SPI)->cpsr;
+    touch_scr = read_scr();
+    spi_set_baudrate(TFT35_SPI, display_freq);
+
+    // Perform a dummy read to initialize, it also enables the pen interrupt
+    int16_t raw_x, raw_y;
+    touch_sample(&raw_x, &raw_y);
+
+    touch_queue = xQueueCreateStatic(TOUCH_QUEUE_LENGTH, sizeof(tft35_touch_point_t), touch_queue_storage, &touch_queue_buffer);
+    if (touch_queue == NULL) {
+        report_error(ERR_DISPLAY_QUEUE_CREATE);
+        return;
+    }
+
+    touch_task_handle = xTaskCreateStatic(touch_task, "Touch Task", TOUCH_TASK_STACK_SIZE, NULL, 2, touch_task_stack, &touch_task_buffer);
+    if (touch_task_handle == NULL) {
+        report_error(ERR_DISPLAY_TASK_CREATE);
+        return;
+    }
+
+    // Shares the GPIO interrupt with the buttons, the task enables it on its core
+    vTaskCoreAffinitySet(touch_task_handle, (1 << get_core_num()));
 }
 
 // Check if touch IRQ is active
@@ -110,42 +306,7 @@ bool tft35_touch_read_raw(int16_t *raw_x, int16_t *raw_y) {
         return false;
     }
 
-    if (xSemaphoreTake(touch_mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
-        return false;
-    }
-
-    touch_spi_begin();
-
-    // Read Z (pressure) first
-    uint16_t z1 = read_channel(XPT2046_CMD_Z1);
-    uint16_t z2 = read_channel(XPT2046_CMD_Z2);
-
-    // Calculate pressure (simplified formula)
-    int32_t pressure = z1;
-    if (z2 > z1) {
-        pressure = 4095 - (z2 - z1);
-    }
-
-    bool touched = (pressure > TOUCH_PRESSURE_MIN && pressure < TOUCH_PRESSURE_MAX);
-
-    if (touched) {
-        // Average multiple readings for stability
-        int32_t sum_x = 0, sum_y = 0;
-        const int samples = 4;
-
-        for (int i = 0; i < samples; i++) {
-            sum_x += read_channel(XPT2046_CMD_X);
-            sum_y += read_channel(XPT2046_CMD_Y);
-        }
-
-        *raw_x = sum_x / samples;
-        *raw_y = sum_y / samples;
-    }
-
-    touch_spi_end();
-    xSemaphoreGive(touch_mutex);
-
-    return touched;
+    return touch_sample(raw_x, raw_y) == TOUCH_SAMPLE_PRESSED;
 }
 
 // Set calibration values
@@ -172,16 +333,8 @@ void tft35_touch_get_calibration(int16_t *x_min, int16_t *x_max,
     if (invert_y) *invert_y = cal_invert_y;
 }
 
-// Read calibrated touch coordinates
-bool tft35_touch_read(tft35_touch_point_t *point) {
-    int16_t raw_x, raw_y;
-
-    if (!tft35_touch_read_raw(&raw_x, &raw_y)) {
-        point->pressed = false;
-        return false;
-    }
-
-    // Apply calibration
+// Map raw to screen coordinates
+static void calibrate(int16_t raw_x, int16_t raw_y, tft35_touch_point_t *point) {
     int32_t x = raw_x;
     int32_t y = raw_y;
 
@@ -206,22 +359,32 @@ bool tft35_touch_read(tft35_touch_point_t *point) {
     point->x = x;
     point->y = y;
     point->pressed = true;
+}
+
+// Read calibrated touch coordinates
+bool tft35_touch_read(tft35_touch_point_t *point) {
+    int16_t raw_x, raw_y;
+
+    if (!tft35_touch_read_raw(&raw_x, &raw_y)) {
+        point->pressed = false;
+        return false;
+    }
 
+    calibrate(raw_x, raw_y, point);
     return true;
 }
 
-// LVGL input device read callback
+// LVGL input device read callback, only takes the points queued by the touch task
 void tft35_touch_read_cb(void *indev, void *data) {
-    lv_indev_t *indev_drv = (lv_indev_t *)indev;
+    (void)indev;
     lv_indev_data_t *indev_data = (lv_indev_data_t *)data;
 
-    tft35_touch_point_t point;
-
-    if (tft35_touch_read(&point)) {
-        indev_data->point.x = point.x;
-        indev_data->point.y = point.y;
-        indev_data->state = LV_INDEV_STATE_PRESSED;
-    } else {
-        indev_data->state = LV_INDEV_STATE_RELEASED;
+    if (touch_queue && xQueueReceive(touch_queue, &last_point, 0) == pdTRUE) {
+        // Let LVGL see every queued point, a short tap is pressed and released within one period
+        indev_data->continue_reading = uxQueueMessagesWaiting(touch_queue) > 0;
     }
+
+    indev_data->point.x = last_point.x;
+    indev_data->point.y = last_point.y;
+    indev_data->state = last_point.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
 }
@@ -4,6 +4,9 @@
  *
  * Driver for the XPT2046 resistive touch controller used on TFT35 displays.
  * Supports touch calibration and coordinate transformation.
+ *
+ * The pen interrupt wakes a touch task that samples the panel between display flushes until the pen
+ * lifts, and queues filtered points for LVGL. Nothing is read while the panel is not touched.
  */
 
 #ifndef TFT35_TOUCH_H
@@ -23,7 +26,7 @@ typedef struct {
     bool pressed;
 } tft35_touch_point_t;
 
-// Initialize the touch controller
+// Initialize the touch controller and start its task, after the display
 void tft35_touch_init(void);
 
 // Read current touch state (returns calibrated coordinates)
@@ -45,7 +48,7 @@ void tft35_touch_get_calibration(int16_t *x_min, int16_t *x_max,
 // Check if touch IRQ pin is active (touch detected)
 bool tft35_touch_irq_active(void);
 
-// LVGL input device read callback
+// LVGL input device read callback, takes the queued points without touching the SPI
 void tft35_touch_read_cb(void *indev, void *data);
 
 #ifdef __cplusplus